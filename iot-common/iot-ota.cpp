@@ -23,6 +23,7 @@ uint8_t ota_get_latest_version(char* src, char *buf, size_t len) {
     http_response_t resp = http_client_get_response(client);
     if(resp.status > 299 || resp.status < 200) {
         LOGE("invalid http response: %d", resp.status);
+        http_client_close(client);
         return false;
     }
     http_client_read(client, buf, len);
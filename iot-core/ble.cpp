@@ -19,7 +19,6 @@ static const scan_filter_t SCAN_FILTER_MODES[SCAN_FILTER_MODE_MAX] = {
   SCAN_FILTER_NO_FILTER, SCAN_FILTER_WHITELIST,
 };
 
-static volatile uint8_t                m_ble_conn_id_head    = 0;
 static          bt_queue_handler_t     bt_queue_handler      = NULL;
 static          bt_conn_handler_t      bt_connect_handler    = NULL;
 static          bt_conn_handler_t      bt_disconnect_handler = NULL;
@@ -30,31 +29,170 @@ static			bt_device_init_cb_t		bt_device_init_cb	= NULL;
 static			bt_device_create_cb_t	bt_device_create_cb	= NULL;
 static			bt_device_mgmt_init_t	bt_device_mgmt_init	= NULL;
 
-static EventGroupHandle_t xDeviceState;
 static EventGroupHandle_t xBLEState;
-static EventGroupHandle_t xBLEConn;
 static QueueHandle_t      xBLEDevice;
-static QueueHandle_t      xUpdateQueue;
-static TimerHandle_t      xBLEConnTimer;
+static SemaphoreHandle_t  xBLEGapArbiter;
+static TaskHandle_t       xBLEQueueTask = NULL;
+
+static_assert(BT_CONN_WORKERS <= BLE_MAX_DEVICES, "BT_CONN_WORKERS exceeds the controller connection limit");
+
+/* addresses queued or being set up by a worker, so repeated advertisements
+ * of a device are ignored while scanning continues */
+static device_addr_t      BT_CONN_INFLIGHT[BT_CONN_QUEUE_SZ];
+static uint8_t            bt_conn_inflight_cnt  = 0;
+static portMUX_TYPE       bt_conn_mux           = portMUX_INITIALIZER_UNLOCKED;
+static bt_conn_stats_t    bt_conn_cnt;
+
+typedef struct ble_scan_params {
+	uint16_t	interval;
+	uint16_t	window;
+	uint8_t		active;
+} ble_scan_params_t;
+
+#define BLE_SCAN_PARAMS(Name, interval, window, active)   { interval, window, active },
+#define BLE_SCAN_POLICY_NAME(Name, ...)                   BUILD_STRING(Name),
+
+static const ble_scan_params_t  BLE_SCAN_POLICY[]         = { BLE_SCAN_POLICIES(BLE_SCAN_PARAMS) };
+static const char              *BLE_SCAN_POLICY_STRING[]  = { BLE_SCAN_POLICIES(BLE_SCAN_POLICY_NAME) };
+
+static ble_scan_stats_t         ble_scan_cnt;
+static uint64_t                 ble_scan_airtime_ms   = 0;
+static volatile unsigned long int ble_scan_activity_ts = 0;
+
+/* connection locks by device slot, binary semaphores so on_disconnect can
+ * release a lock taken by a connection worker */
+typedef struct ble_conn_lock {
+	SemaphoreHandle_t	sem;
+	TaskHandle_t		owner;
+	uint8_t				depth;
+} ble_conn_lock_t;
+
+static ble_conn_lock_t    BLE_CONN_LOCK[MAX_DEVICES];
+static portMUX_TYPE       ble_conn_lock_mux     = portMUX_INITIALIZER_UNLOCKED;
+static ble_beacon_stats_t ble_beacon_cnt;
+
+static_assert((BLE_ADV_CACHE_SZ & BLE_ADV_CACHE_MASK) == 0, "BLE_ADV_CACHE_SZ must be a power of 2");
+
+typedef struct ble_adv_entry {
+	device_addr_t	addr;
+	uint8_t			cls;
+	uint32_t		expires;
+} ble_adv_entry_t;
+
+/* only used from the NimBLE host task */
+static ble_adv_entry_t       BLE_ADV_CACHE[BLE_ADV_CACHE_SZ];
+static ble_adv_cache_stats_t ble_adv_cnt;
+
+/* request for a connection worker, beacons only need their device config */
+typedef struct bt_conn_req {
+	device_addr_t	addr;
+	uint8_t			beacon;
+} bt_conn_req_t;
+
+#ifdef BLE_BEACONS
+typedef struct ble_beacon {
+	device_addr_t		addr;
+	uint16_t			seq;
+	unsigned long int	seen;
+} ble_beacon_t;
+
+/* last accepted frame, by device slot */
+static ble_beacon_t       BLE_BEACON[MAX_DEVICES];
+#endif
+
+static void vConnTimerCB(TimerHandle_t);
+
+static_assert((BLE_UPDATE_RING_SZ & BLE_UPDATE_RING_MASK) == 0, "BLE_UPDATE_RING_SZ must be a power of 2");
+
+/* single producer (NimBLE host) / single consumer (bt_queue_mgr) ring.
+ * head and tail run free and are masked on access.  Only the producer moves
+ * head; tail is advanced by CAS so the producer can drop the oldest entry. */
+static queue_entry_t      BLE_UPDATE_RING[BLE_UPDATE_RING_SZ];
+static volatile uint32_t  ble_ring_head       = 0;
+static volatile uint32_t  ble_ring_tail       = 0;
+static volatile uint32_t  ble_ring_overflow   = 0;
+static volatile uint32_t  ble_ring_hwm        = 0;
 
 static ble_config_t runtime;
 
-static void nim_to_bd_addr(const uint8_t *nim_addr, esp_bd_addr_t *buf) {
-	uint8_t len = sizeof(esp_bd_addr_t);
-	uint8_t *ptr = (uint8_t*)buf;
+static void nim_to_device_addr(const uint8_t *nim_addr, device_addr_t *addr) {
+	uint8_t len = DEVICE_ADDR_SZ;
 	for(uint8_t i=0; i < len; i++) {
-		ptr[(len-1)-i] = nim_addr[i];
+		addr->val[(len-1)-i] = nim_addr[i];
+	}
+}
+
+static void ble_ring_push(queue_entry_t *entry) {
+	uint32_t head = ble_ring_head;
+	uint32_t tail = __atomic_load_n(&ble_ring_tail, __ATOMIC_ACQUIRE);
+	while((head - tail) >= BLE_UPDATE_RING_SZ) {
+#ifdef BLE_UPDATE_RING_DROP_NEWEST
+		__atomic_add_fetch(&ble_ring_overflow, 1, __ATOMIC_RELAXED);
+		return;
+#else
+		// on failure the consumer moved tail for us and we re-check
+		if(__atomic_compare_exchange_n(&ble_ring_tail, &tail, tail + 1,
+					false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+			__atomic_add_fetch(&ble_ring_overflow, 1, __ATOMIC_RELAXED);
+			tail++;
+		}
+#endif
+	}
+	BLE_UPDATE_RING[head & BLE_UPDATE_RING_MASK] = *entry;
+	__atomic_store_n(&ble_ring_head, head + 1, __ATOMIC_RELEASE);
+
+	if((head + 1 - tail) > ble_ring_hwm) {
+		ble_ring_hwm = (head + 1 - tail);
+	}
+	if(xBLEQueueTask != NULL) {
+		xTaskNotifyGive(xBLEQueueTask);
+	}
+}
+
+static uint8_t ble_ring_pop(queue_entry_t *entry) {
+	uint32_t tail = __atomic_load_n(&ble_ring_tail, __ATOMIC_ACQUIRE);
+	for(;;) {
+		if(tail == __atomic_load_n(&ble_ring_head, __ATOMIC_ACQUIRE)) {
+			return false;
+		}
+		*entry = BLE_UPDATE_RING[tail & BLE_UPDATE_RING_MASK];
+		// fails if the producer dropped this entry while we copied it
+		if(__atomic_compare_exchange_n(&ble_ring_tail, &tail, tail + 1,
+					false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+			return true;
+		}
+	}
+}
+
+ble_ring_stats_t ble_update_ring_stats() {
+	ble_ring_stats_t stats;
+	stats.size = BLE_UPDATE_RING_SZ;
+	stats.depth = __atomic_load_n(&ble_ring_head, __ATOMIC_ACQUIRE) -
+					__atomic_load_n(&ble_ring_tail, __ATOMIC_ACQUIRE);
+	stats.high_water = ble_ring_hwm;
+	stats.overflow = __atomic_load_n(&ble_ring_overflow, __ATOMIC_RELAXED);
+	return stats;
+}
+
+/* time from connect to the first notification of a connection */
+static void ble_record_first_notify(const device_addr_t *addr, int64_t ts) {
+	device_t *device = get_device(*addr);
+	if(device == nullptr || device->connection == nullptr) {
+		return;
+	}
+	int64_t connected_at = device->connection->connected_at;
+	if(connected_at) {
+		device->connection->connected_at = 0;
+		stats_hist_add(&bt_conn_cnt.first_notify, (uint32_t)(ts - connected_at));
 	}
 }
 
 static void generic_ble_notify_cb(BLERemoteCharacteristic* pChar, uint8_t* pData, size_t length, bool isNotify) {
   LOGD("notifyCB: %s: %d bytes", pChar->getUUID().toString().c_str(), length);
   if(pChar->getUUID().equals(*charUUID)) {
-		esp_bd_addr_t addr;
-		nim_to_bd_addr(pChar->getRemoteService()->getClient()->getPeerAddress().getNative(), &addr);
-
 		queue_entry_t entry;
-		memcpy(entry.device_id, &addr, sizeof(esp_bd_addr_t));
+		entry.ts = esp_timer_get_time();
+		nim_to_device_addr(pChar->getRemoteService()->getClient()->getPeerAddress().getNative(), &entry.addr);
 
 		switch(length) {
 			case BLE_CHAR_LEN_8BIT: {
@@ -69,18 +207,19 @@ static void generic_ble_notify_cb(BLERemoteCharacteristic* pChar, uint8_t* pData
 				entry.data = *(uint32_t*)pData;
 			} break;
 		}
-		xQueueSend(xUpdateQueue, &entry, 1000 / portTICK_PERIOD_MS);
+		ble_ring_push(&entry);
+		ble_record_first_notify(&entry.addr, entry.ts);
 	}
 }
 
 static void ble_bas_notify_cb(BLERemoteCharacteristic* pChar, uint8_t* pData, size_t length, bool isNotify) {
     const sensor_t *sensor = sensor_get_by_type(SENSOR_BATTERY);
-	BLEAddress addr = pChar->getRemoteService()->getClient()->getPeerAddress();
-	device_id_t device_id;
-	memcpy(device_id, addr.toString().c_str(), sizeof(device_id_t));
+	device_addr_t addr;
+	nim_to_device_addr(pChar->getRemoteService()->getClient()->getPeerAddress().getNative(), &addr);
+	ble_record_first_notify(&addr, esp_timer_get_time());
 	uint8_t level = *pData;
-	LOGD("ble_bas_update: %s: batt_level = %d", device_id, level);
-    device_send_update(device_id, sensor->id, level);
+	LOGD("ble_bas_update: " DEVICE_ADDR_FMT ": batt_level = %d", DEVICE_ADDR_ARGS(addr), level);
+    device_send_update(addr, sensor->id, level);
 }
 
 static bool ble_subscribe(BLEClient *pClient, BLEUUID service, BLEUUID characteristic, ble_notify_cb_t ble_notify_cb) {
@@ -118,7 +257,7 @@ class MyClientCallback : public BLEClientCallbacks {
 	}
 
 	void onDisconnect(BLEClient* pClient) {
-		this->client->give();
+		this->client->release();
 		this->client->authstate = AUTH_NONE;
 		LOGW("on_disconnect: %s: last_err %d", this->client->device->id, pClient->getLastError());
 		if(bt_disconnect_handler != NULL) {
@@ -144,7 +283,7 @@ class MyClientCallback : public BLEClientCallbacks {
 	}
 
 	void onAuthenticationComplete(ble_gap_conn_desc *auth_cmpl) {
-		const char *ptr =  BLEAddress(auth_cmpl->peer_id_addr).toString().c_str();
+		const char *ptr = this->client->device->id;
 		if(!auth_cmpl->sec_state.authenticated) {
 			this->client->authstate = AUTH_FAILED;
 			LOGE("AUTH_FAILED: %s", ptr);
@@ -158,53 +297,226 @@ class MyClientCallback : public BLEClientCallbacks {
 	}
 };
 
-static uint8_t valid_ble_mutex_id(EventBits_t mutexId) {
-	size_t nBits = (sizeof(EventBits_t)-1)*8;
-	EventBits_t mask = 1;
-	for(; nBits > 0; --nBits) {
-		if(mutexId == (mask << (nBits-1))) {
-			return true;
+static void ble_conn_lock_init() {
+	for(uint16_t i=0; i<MAX_DEVICES; i++) {
+		ble_conn_lock_t *lock = &BLE_CONN_LOCK[i];
+		lock->sem = xSemaphoreCreateBinary();
+		lock->owner = nullptr;
+		lock->depth = 0;
+		xSemaphoreGive(lock->sem);
+	}
+}
+
+static uint8_t ble_conn_lock_take(uint16_t id, uint32_t timeout_ms) {
+	ble_conn_lock_t *lock = &BLE_CONN_LOCK[id];
+	TaskHandle_t self = xTaskGetCurrentTaskHandle();
+
+	portENTER_CRITICAL(&ble_conn_lock_mux);
+	if(lock->owner == self) {
+		lock->depth++;
+		portEXIT_CRITICAL(&ble_conn_lock_mux);
+		return true;
+	}
+	portEXIT_CRITICAL(&ble_conn_lock_mux);
+
+	if(xSemaphoreTake(lock->sem, 0) != pdTRUE) {
+		__atomic_add_fetch(&bt_conn_cnt.lock_waits, 1, __ATOMIC_RELAXED);
+		if(xSemaphoreTake(lock->sem, timeout_ms / portTICK_PERIOD_MS) != pdTRUE) {
+			__atomic_add_fetch(&bt_conn_cnt.lock_timeouts, 1, __ATOMIC_RELAXED);
+			return false;
 		}
 	}
-	return false;
+	portENTER_CRITICAL(&ble_conn_lock_mux);
+	lock->owner = self;
+	lock->depth = 1;
+	portEXIT_CRITICAL(&ble_conn_lock_mux);
+	return true;
 }
 
-static uint8_t wait_for_ble_mutex(device_t *device, uint16_t timeout = 9000) {
-	char id[DEVICE_ID_SZ];
-	if(device) {
-		strncpy(id, device->id, sizeof(id));
-	} else {
-		strncpy(id, "ble_scan_mgr()", sizeof(id));
-	}
-	LOGD("%s: waiting for ble_mutex to be available", id);
-	EventBits_t bits = xEventGroupWaitBits(xBLEConn, BLE_CONN_READY, false, true, timeout / portTICK_PERIOD_MS);
-	if(bits != BLE_CONN_READY) {
-		bits = (~(bits)) & BLE_CONN_READY;
-		if(device) {
-			LOGI("0x%06x: timeout (existing lock: 0x%06x)", device->connection->mutexId, bits);
+/* with force set the lock is released whoever holds it */
+static uint8_t ble_conn_lock_give(uint16_t id, uint8_t force) {
+	ble_conn_lock_t *lock = &BLE_CONN_LOCK[id];
+	uint8_t ret = true;
+	uint8_t release = false;
+
+	portENTER_CRITICAL(&ble_conn_lock_mux);
+	if(lock->owner != nullptr) {
+		if(force || lock->owner == xTaskGetCurrentTaskHandle()) {
+			if(force || --lock->depth == 0) {
+				lock->owner = nullptr;
+				lock->depth = 0;
+				release = true;
+			}
 		} else {
-			LOGW("%s: timeout (existing lock: 0x%06x)", id, bits);
+			ret = false;
 		}
+	}
+	portEXIT_CRITICAL(&ble_conn_lock_mux);
+
+	if(release) {
+		xSemaphoreGive(lock->sem);
+	}
+	return ret;
+}
+
+static uint8_t ble_conn_lock_held(uint16_t id) {
+	return (uxSemaphoreGetCount(BLE_CONN_LOCK[id].sem) == 0);
+}
+
+static uint8_t ble_conn_lock_owned(uint16_t id) {
+	return (BLE_CONN_LOCK[id].owner == xTaskGetCurrentTaskHandle());
+}
+
+/* wait until nobody holds the lock, without keeping it */
+static uint8_t ble_conn_lock_wait(uint16_t id, uint32_t timeout_ms) {
+	if(xSemaphoreTake(BLE_CONN_LOCK[id].sem, timeout_ms / portTICK_PERIOD_MS) != pdTRUE) {
 		return false;
 	}
+	xSemaphoreGive(BLE_CONN_LOCK[id].sem);
 	return true;
 }
 
-static void clear_ble_mutex() {
-	LOGD("clearing all ble mutex locks (0x%06x)", (~(xEventGroupGetBits(xBLEConn)) & 0xffffff));
-	xEventGroupSetBits(xBLEConn, BLE_CONN_READY);
+/* arbitration of the GAP between scanning and connection initiation */
+static uint8_t ble_gap_acquire(uint32_t timeout_ms) {
+	return (xSemaphoreTake(xBLEGapArbiter, timeout_ms / portTICK_PERIOD_MS) == pdTRUE);
+}
+
+static void ble_gap_release() {
+	xSemaphoreGive(xBLEGapArbiter);
+}
+
+static uint8_t bt_conn_claim(const device_addr_t *addr) {
+	uint8_t ret = false;
+	uint8_t i;
+	portENTER_CRITICAL(&bt_conn_mux);
+	for(i=0; i<bt_conn_inflight_cnt; i++) {
+		if(memcmp(&BT_CONN_INFLIGHT[i], addr, sizeof(device_addr_t)) == 0) {
+			break;
+		}
+	}
+	if(i == bt_conn_inflight_cnt && bt_conn_inflight_cnt < BT_CONN_QUEUE_SZ) {
+		BT_CONN_INFLIGHT[bt_conn_inflight_cnt++] = *addr;
+		if(bt_conn_inflight_cnt > bt_conn_cnt.peak_in_flight) {
+			bt_conn_cnt.peak_in_flight = bt_conn_inflight_cnt;
+		}
+		ret = true;
+	}
+	portEXIT_CRITICAL(&bt_conn_mux);
+	return ret;
+}
+
+static void bt_conn_release(const device_addr_t *addr) {
+	portENTER_CRITICAL(&bt_conn_mux);
+	for(uint8_t i=0; i<bt_conn_inflight_cnt; i++) {
+		if(memcmp(&BT_CONN_INFLIGHT[i], addr, sizeof(device_addr_t)) == 0) {
+			BT_CONN_INFLIGHT[i] = BT_CONN_INFLIGHT[--bt_conn_inflight_cnt];
+			break;
+		}
+	}
+	portEXIT_CRITICAL(&bt_conn_mux);
+}
+
+static uint16_t ble_connected_count() {
+	uint16_t cnt = 0;
+	devices_t devices = get_devices();
+	for(uint16_t i=0; i<devices.num_devices; i++) {
+		device_t *device = devices.devices[i];
+		if(device->in_use && device->connection && device->connection->isConnected()) {
+			cnt++;
+		}
+	}
+	return cnt;
+}
+
+static uint16_t ble_beacon_count() {
+	uint16_t cnt = 0;
+	devices_t devices = get_devices();
+	for(uint16_t i=0; i<devices.num_devices; i++) {
+		device_t *device = devices.devices[i];
+		if(device->in_use && device->connection && device->connection->beacon) {
+			cnt++;
+		}
+	}
+	return cnt;
 }
 
-static EventBits_t get_ble_mutex_id() {
-	EventBits_t mutexId = (1 << m_ble_conn_id_head++);
-	LOGD("assigning new id %d: lock_bits 0x%06x", m_ble_conn_id_head, mutexId);
-	return mutexId;
+ble_beacon_stats_t ble_beacon_stats() {
+	return ble_beacon_cnt;
 }
 
-static uint8_t get_ble_mutex_status(EventBits_t mutexId) {
-	EventBits_t lock = xEventGroupGetBits(xBLEConn) & BLE_CONN_READY;
-	lock = (~(lock)) & BLE_CONN_READY;
-	return (!(lock & mutexId));
+ble_scan_stats_t ble_scan_stats() {
+	ble_scan_stats_t stats = ble_scan_cnt;
+	unsigned long int uptime = MILLIS;
+	stats.avg_duty_permille = uptime ? (uint16_t)((ble_scan_airtime_ms * 1000) / uptime) : 0;
+	return stats;
+}
+
+/* pick the scan duty cycle from what the registry still needs */
+static ble_scan_policy_t ble_scan_policy_select() {
+	uint16_t connected = ble_connected_count();
+	uint16_t known = device_count() - ble_beacon_count();
+	unsigned long int activity = ble_scan_activity_ts;
+	uint8_t recent = activity && ((MILLIS - activity) < BLE_SCAN_ACTIVITY_MS);
+
+	if((connected < known || recent) && connected < BLE_MAX_DEVICES) {
+		return (connected >= BLE_SCAN_LOAD_CONNS) ? SCAN_POLICY_MAINTAIN : SCAN_POLICY_DISCOVER;
+	}
+#ifdef BLE_BEACONS
+	// readings keep arriving in advertisements
+	return SCAN_POLICY_MAINTAIN;
+#else
+	if(runtime.device_mode == BLE_DEVICE_DYNAMIC &&
+			device_count() < MAX_DEVICES && connected < BLE_MAX_DEVICES) {
+		return SCAN_POLICY_MAINTAIN;
+	}
+	return SCAN_POLICY_IDLE;
+#endif
+}
+
+static void ble_scan_apply(BLEScan *pScan, ble_scan_policy_t policy) {
+	const ble_scan_params_t *params = &BLE_SCAN_POLICY[policy];
+	pScan->setInterval(params->interval);
+	pScan->setWindow(params->window);
+	pScan->setActiveScan(params->active);
+
+	if(policy != ble_scan_cnt.policy || ble_scan_cnt.name == nullptr) {
+		ble_scan_cnt.changes++;
+		LOGI("scan policy: %s (%d/%d ms, %s)", BLE_SCAN_POLICY_STRING[policy],
+				params->window, params->interval, params->active ? "active" : "passive");
+	}
+	ble_scan_cnt.policy = policy;
+	ble_scan_cnt.name = BLE_SCAN_POLICY_STRING[policy];
+	ble_scan_cnt.interval = params->interval;
+	ble_scan_cnt.window = params->window;
+	ble_scan_cnt.active = params->active;
+	ble_scan_cnt.duty_permille = (params->window * 1000) / params->interval;
+}
+
+static void ble_scan_account(ble_scan_policy_t policy, unsigned long int elapsed) {
+	const ble_scan_params_t *params = &BLE_SCAN_POLICY[policy];
+	ble_scan_cnt.policy_ms[policy] += elapsed;
+	ble_scan_airtime_ms += ((uint64_t)elapsed * params->window) / params->interval;
+}
+
+bt_conn_stats_t bt_conn_stats() {
+	bt_conn_stats_t stats = bt_conn_cnt;
+	stats.in_flight = bt_conn_inflight_cnt;
+	stats.connected = ble_connected_count();
+	return stats;
+}
+
+/* the controller can't initiate a connection while scanning: park the scan
+ * mgr until ble_scan_resume().  Called with the GAP acquired. */
+static void ble_scan_pause() {
+	EventBits_t bits = xEventGroupSetBits(xBLEState, BLE_STOP);
+	if(bits & BLE_SCANNING) {
+		xEventGroupWaitBits(xBLEState, BLE_PAUSED, false, true, BLE_SCAN_PAUSE_MS / portTICK_PERIOD_MS);
+	}
+}
+
+static void ble_scan_resume() {
+	xEventGroupClearBits(xBLEState, BLE_STOP | BLE_PAUSED);
+	xEventGroupSetBits(xBLEState, BLE_READY);
 }
 
 static uint8_t update_version(device_t *device) {
@@ -233,55 +545,51 @@ static uint8_t update_version(device_t *device) {
 SecureClient::SecureClient(device_t *device) {
 	this->device = device;
 	this->authstate = AUTH_NONE;
-	this->mutexId = get_ble_mutex_id();
+	this->lockId = device->device_id;
+	this->timer = xTimerCreate("xBLEConnTimer", SECURE_CONN_TIMEOUT_MS, pdFALSE, (void*)device, vConnTimerCB);
 }
 
 uint8_t SecureClient::take() {
-	if(get_ble_mutex_status(this->mutexId)) {
-		LOGD("lock is already held (0x%06x)", this->mutexId);
-		return true;
-	}
-	if(valid_ble_mutex_id(this->mutexId) != true) {
-		LOGE("take(): error: got an invalid mutex id! (0x%06x)", this->mutexId);
-		return false;
-	}
-	LOGD("attempting to aquire mutexId 0x%06x", this->mutexId);
-	if(xEventGroupWaitBits(xBLEConn, this->mutexId, true, true, 6000 / portTICK_PERIOD_MS)) {
-		LOGD("acquired lock for id 0x%06x", this->mutexId);
-	} else {
-		LOGI("failed to acquire lock: id 0x%06x", this->mutexId);
+	if(!ble_conn_lock_take(this->lockId, BLE_CONN_LOCK_MS)) {
+		LOGI("failed to acquire lock: %s", this->device->id);
 		return false;
 	}
 	return true;
 }
 
 uint8_t SecureClient::give() {
-	if(!get_ble_mutex_status(this->mutexId)) {
-		return true;
-	}
-	if(valid_ble_mutex_id(this->mutexId) != true){
-		LOGD("error: got an invalid mutex id! (0x%06x)", this->mutexId);
-		return false;
-	}
-	LOGD("returning lock for id 0x%06x", this->mutexId);
-	if((xEventGroupSetBits(xBLEConn, this->mutexId) & this->mutexId) == 0) {
-		LOGD("failed to return lock: id 0x%06x", this->mutexId);
+	if(!ble_conn_lock_give(this->lockId, false)) {
+		LOGD("give(): %s: lock held by another task", this->device->id);
 		return false;
 	}
 	return true;
 }
 
+void SecureClient::release() {
+	ble_conn_lock_give(this->lockId, true);
+}
+
+void SecureClient::abort() {
+	if(this->client && this->client->isConnected()) {
+		this->client->disconnect();
+	}
+}
+
 uint8_t SecureClient::close() {
-	if(this->client) { // && this->client->isConnected()) {
-		if(get_ble_mutex_status(this->mutexId) || (wait_for_ble_mutex(this->device) && this->take())) {
+	if(this->client) {
+		if(this->take()) {
 			LOGD("disconnect(): %s", this->device->id);
+			uint8_t connected = this->client->isConnected();
 			this->client->disconnect();
+#ifndef ENABLE_GATT_CACHE
 			this->client->deleteServices();
-			if(!wait_for_ble_mutex(this->device, 8000)) {
-				this->give();
+#endif
+			// on_disconnect returns the lock
+			if(!connected || !ble_conn_lock_wait(this->lockId, 8000)) {
+				this->release();
 			}
 		} else {
-			LOGD("failed to get lock: 0x%06x", this->mutexId);
+			LOGD("failed to get lock: %s", this->device->id);
 			return false;
 		}
 	} else {
@@ -291,7 +599,52 @@ uint8_t SecureClient::close() {
 	return true;
 }
 
+void SecureClient::invalidateCache() {
+	if(this->client) {
+		this->client->deleteServices();
+	}
+	this->cached = false;
+	this->cache_presence = false;
+}
+
+/*
+ * with ENABLE_GATT_CACHE the attributes discovered on a connection are kept
+ * for the next one, so a reconnect reads and subscribes by the known
+ * handles.  They are dropped and discovered again when an operation fails
+ * or the firmware changed.
+ */
 uint8_t SecureClient::configure() {
+	int64_t start = esp_timer_get_time();
+#ifdef ENABLE_GATT_CACHE
+	// the client of a device slot is kept when the slot gets a new device
+	if(this->cached && memcmp(&this->cache_addr, &this->device->addr, sizeof(device_addr_t)) != 0) {
+		this->invalidateCache();
+	}
+#endif
+	uint8_t was_cached = this->cached;
+	uint8_t ret = this->configureAttributes();
+#ifdef ENABLE_GATT_CACHE
+	if(!ret && this->cached && this->isConnected()) {
+		LOGI("configure(): %s: cached attributes rejected, rediscovering", this->device->id);
+		this->invalidateCache();
+		ret = this->configureAttributes();
+	}
+	if(ret) {
+		__atomic_add_fetch((was_cached && this->cached) ? &bt_conn_cnt.cache_hits : &bt_conn_cnt.cache_misses,
+				1, __ATOMIC_RELAXED);
+		this->cached = true;
+		this->cache_version = this->device->version;
+		this->cache_hw_rev = this->device->hw_rev;
+		this->cache_addr = this->device->addr;
+	}
+#endif
+	if(ret) {
+		stats_hist_add(&bt_conn_cnt.configure, (uint32_t)(esp_timer_get_time() - start));
+	}
+	return ret;
+}
+
+uint8_t SecureClient::configureAttributes() {
 	char cmd[4];
 	uint32_t data;
 	BLERemoteCharacteristic *characteristic = nullptr;
@@ -303,7 +656,11 @@ uint8_t SecureClient::configure() {
 		return true;
 	}
 
-	service = this->client->getService(*presenceUUID);
+	// looking up a missing service costs a discovery, skip it when known
+	if(!this->cached || this->cache_presence) {
+		service = this->client->getService(*presenceUUID);
+		this->cache_presence = (service != nullptr);
+	}
 	if(service) {
 		if(this->device->sensors && this->device->sensors[0].id == SENSOR_PRESENCE) {
 		    if(ble_subscribe(this->client, BLE_BAS_SVC, BLE_BAS_CHR, ble_bas_notify_cb)) {
@@ -340,10 +697,16 @@ uint8_t SecureClient::configure() {
 		return false;
 	}
 
+	if(this->cached && (device->version != this->cache_version || device->hw_rev != this->cache_hw_rev)) {
+		LOGI("configure(): %s: firmware changed (v%d -> v%d)", device->id, this->cache_version, device->version);
+		return false;
+	}
+
 #ifdef DFU_START_BEFORE
 	if(device_update_needed(device, DFU_START_BEFORE)) {
 		if(ble_request_enter_dfu(device)) {
 			LOGI("ble_request_enter_dfu(): %s", device->id);
+			this->invalidateCache();
 			return false;
 		}
 		LOGE("ble_request_enter_dfu(): failed to send command");
@@ -406,23 +769,11 @@ uint8_t SecureClient::configure() {
 	return true;
 }
 
-uint8_t SecureClient::connect() {
+/* fetch the sensor config of a device from the config service, if needed */
+static uint8_t bt_device_configure(device_t *device) {
 	uint8_t ret = true;
-	if(!this->client) {
-		LOGD("adding new BLEClient to SecureClient instance");
-		this->client = BLEDevice::createClient();
-		this->client->setClientCallbacks(new MyClientCallback(this));
-		this->client->setConnectTimeout(BLE_CONNECT_TIMEOUT_SECS);
-	}
-	LOGD("connect(): %s", this->device->id);
-	if(!get_ble_mutex_status(this->mutexId)) {
-		LOGE("you must hold the device mutex prior to connect()");
-		return false;
-	}
-
-	if(bt_device_config_cb && this->device->sensors[0].in_use != true) {
-		xEventGroupClearBits(xDeviceState, DEVICE_HTTP);
-		switch(bt_device_config_cb(this->device)) {
+	if(bt_device_config_cb && device->sensors[0].in_use != true) {
+		switch(bt_device_config_cb(device)) {
 
 			case HttpStatus_Ok: {
 				ret = true;
@@ -430,15 +781,15 @@ uint8_t SecureClient::connect() {
 
 			case HttpStatus_NotFound: {
 #ifndef DISABLE_DEVICE_CREATION
-				if(this->device->sensors[0].id == SENSOR_NONE && bt_device_init_cb != NULL) {
+				if(device->sensors[0].id == SENSOR_NONE && bt_device_init_cb != NULL) {
 					LOGI("attempting to initialize as a new device");
-					ret = bt_device_init_cb(this->device->id);
+					ret = bt_device_init_cb(device->id);
 				}
 #endif
 #ifdef CREATE_STATIC_DEVICES
-				if(this->device->sensors[0].id != SENSOR_NONE && bt_device_create_cb != NULL) {
+				if(device->sensors[0].id != SENSOR_NONE && bt_device_create_cb != NULL) {
 					LOGI("attempting to create device");
-					ret = bt_device_create_cb(this->device->id, this->device->sensors[0].id);
+					ret = bt_device_create_cb(device->id, device->sensors[0].id);
 				}
 #endif
 			} break;
@@ -447,12 +798,28 @@ uint8_t SecureClient::connect() {
 				ret = false;
 				break;
 		}
-		xEventGroupSetBits(xDeviceState, DEVICE_HTTP);
-		if(!ret) {
-			LOGW("bt_device_config_cb:(): error: unable to configure device");
-			this->close();
-			return ret;
-		}
+	}
+	return ret;
+}
+
+uint8_t SecureClient::connect() {
+	uint8_t ret = true;
+	if(!this->client) {
+		LOGD("adding new BLEClient to SecureClient instance");
+		this->client = BLEDevice::createClient();
+		this->client->setClientCallbacks(new MyClientCallback(this));
+		this->client->setConnectTimeout(BLE_CONNECT_TIMEOUT_SECS);
+	}
+	LOGD("connect(): %s", this->device->id);
+	if(!ble_conn_lock_owned(this->lockId)) {
+		LOGE("you must hold the device mutex prior to connect()");
+		return false;
+	}
+
+	if(!(ret = bt_device_configure(this->device))) {
+		LOGW("bt_device_config_cb:(): error: unable to configure device");
+		this->close();
+		return ret;
 	}
 
 #ifdef BLE_USE_CONN_PARAMS
@@ -460,11 +827,32 @@ uint8_t SecureClient::connect() {
 			BLE_INIT_PARAM_MIN_INT, BLE_INIT_PARAM_MAX_INT, 0, BLE_INIT_PARAM_TIMEOUT
 		);
 #endif
+	// the connect timer restarts once this client's turn at the gate comes
+	xTimerStop(this->timer, DELAY_S4);
+	if(!ble_gap_acquire(BLE_CONN_GATE_MS * BT_CONN_WORKERS)) {
+		LOGW("ble_connect(): %s: timeout waiting for connect gate", this->device->id);
+		this->close();
+		return false;
+	}
+	xTimerReset(this->timer, DELAY_S4);
+	if(ble_connected_count() >= BLE_MAX_DEVICES) {
+		ble_gap_release();
+		LOGW("ble_connect(): controller connection limit reached (%d)", BLE_MAX_DEVICES);
+		this->close();
+		return false;
+	}
+
 	LOGD("ble_connect(): %s", this->device->id);
+	ble_scan_pause();
 	this->authstate = AUTH_PENDING;
-	xEventGroupClearBits(xDeviceState, DEVICE_BLE);
-	ret = this->client->connect(BLEAddress(this->device->id, BLE_ADDR_RANDOM));
-	xEventGroupSetBits(xDeviceState, DEVICE_BLE);
+#ifndef ENABLE_GATT_CACHE
+	ret = this->client->connect(NimBLEAddress(this->device->addr.val, BLE_ADDR_RANDOM));
+#else
+	ret = this->client->connect(NimBLEAddress(this->device->addr.val, BLE_ADDR_RANDOM), false);
+#endif
+	this->connected_at = ret ? esp_timer_get_time() : 0;
+	ble_scan_resume();
+	ble_gap_release();
 	if(!ret) {
 		LOGW("ble_connect(): failed");
 		this->close();
@@ -520,14 +908,9 @@ uint8_t bt_conn_check(device_t *device) {
 	return (elapsed > (device->connection->retries * SECURE_CONN_FAIL_BACKOFF_MS));
 }
 
-static uint8_t client_count() {
+static uint16_t client_count() {
 #ifndef DISABLE_DEVICE_CREATION
-	uint8_t count = 0;
-    devices_t devices = get_devices();
-	for(uint8_t i=0; i<MAX_DEVICES; i++) {
-		if(devices.devices[i]->in_use) count++;
-	}
-	return count;
+	return device_count();
 #else
   return 1;
 #endif
@@ -539,82 +922,305 @@ static uint8_t ble_scan_start(BLEScan* pScan) {
 		LOGI("max clients reached (%d): skipping scan", BLE_MAX_DEVICES);
 		return 99;
 	}
-	if(!wait_for_ble_mutex(0)) {
-		LOGW("failed to get ble mutex");
-		return false;
+	// a connect holds the gate: skip this scan period rather than fail it
+	if(!ble_gap_acquire(BLE_CONN_GATE_MS)) {
+		LOGI("connect gate busy: skipping scan");
+		return 99;
+	}
+	if(xEventGroupGetBits(xBLEState) & BLE_STOP) {
+		ble_gap_release();
+		LOGI("connect pending: skipping scan");
+		return 99;
 	}
 	LOGD("resuming scan");
-#ifndef DISABLE_CLIENT_BALANCING
-	vTaskDelay(cnt * DELAY_S1);
-#endif // DISABLE_CLIENT_BALANCING
-    return pScan->start(0, nullptr, false);
+	uint8_t ret = pScan->start(0, nullptr, false);
+	if(ret) {
+		// flagged under the gate, so ble_scan_pause() only waits on a running scan
+		xEventGroupClearBits(xBLEState, BLE_READY);
+		xEventGroupSetBits(xBLEState, BLE_SCANNING);
+	}
+	ble_gap_release();
+	return ret;
 }
 
-static uint8_t bt_adv_check(NimBLEAddress *addr) {
-	devices_t devices = get_devices();
-	for(uint8_t i=0; i<MAX_DEVICES; i++) {
-		if(devices.devices[i]->connection &&
-				devices.devices[i]->connection->retries) {
-			if(addr->equals(NimBLEAddress(devices.devices[i]->id))) {
-				return bt_conn_check(devices.devices[i]);
+/* remaining backoff of a device after failed connections, 0 if it may connect */
+static uint32_t bt_adv_backoff(device_addr_t *addr) {
+	device_t *device = get_device(*addr);
+	if(device && device->connection && device->connection->retries && !bt_conn_check(device)) {
+		uint32_t backoff = device->connection->retries * SECURE_CONN_FAIL_BACKOFF_MS;
+		uint32_t elapsed = (MILLIS - device->connection->attempted);
+		return (elapsed < backoff) ? (backoff - elapsed) : 1;
+	}
+	return 0;
+}
+
+static uint16_t ble_adv_hash(const device_addr_t *addr) {
+	uint32_t h = 2166136261UL;
+	for(uint8_t i=0; i<DEVICE_ADDR_SZ; i++) {
+		h = (h ^ addr->val[i]) * 16777619UL;
+	}
+	return (uint16_t)(h & BLE_ADV_CACHE_MASK);
+}
+
+#ifdef DISABLE_ADV_CACHE
+static ble_adv_class_t ble_adv_cache_lookup(const device_addr_t *addr) {
+	ble_adv_cnt.misses++;
+	return ADV_UNKNOWN;
+}
+
+static void ble_adv_cache_insert(const device_addr_t *addr, ble_adv_class_t cls, uint32_t ttl) {
+}
+#else
+static ble_adv_class_t ble_adv_cache_lookup(const device_addr_t *addr) {
+	uint16_t pos = ble_adv_hash(addr);
+	uint32_t now = (uint32_t)MILLIS;
+	for(uint8_t i=0; i<BLE_ADV_CACHE_PROBE; i++) {
+		ble_adv_entry_t *entry = &BLE_ADV_CACHE[(pos + i) & BLE_ADV_CACHE_MASK];
+		if(entry->cls != ADV_UNKNOWN &&
+				memcmp(&entry->addr, addr, sizeof(device_addr_t)) == 0) {
+			if((int32_t)(entry->expires - now) > 0) {
+				ble_adv_cnt.hits++;
+				return (ble_adv_class_t)entry->cls;
 			}
+			entry->cls = ADV_UNKNOWN;
+			break;
+		}
+	}
+	ble_adv_cnt.misses++;
+	return ADV_UNKNOWN;
+}
+
+/* takes a free or expired slot of the probe window, else the one expiring first */
+static void ble_adv_cache_insert(const device_addr_t *addr, ble_adv_class_t cls, uint32_t ttl) {
+	uint16_t pos = ble_adv_hash(addr);
+	uint32_t now = (uint32_t)MILLIS;
+	ble_adv_entry_t *victim = nullptr;
+	for(uint8_t i=0; i<BLE_ADV_CACHE_PROBE; i++) {
+		ble_adv_entry_t *entry = &BLE_ADV_CACHE[(pos + i) & BLE_ADV_CACHE_MASK];
+		if(entry->cls == ADV_UNKNOWN || (int32_t)(entry->expires - now) <= 0 ||
+				memcmp(&entry->addr, addr, sizeof(device_addr_t)) == 0) {
+			victim = entry;
+			break;
+		}
+		if(victim == nullptr || (int32_t)(entry->expires - victim->expires) < 0) {
+			victim = entry;
+		}
+	}
+	if(victim->cls != ADV_UNKNOWN && (int32_t)(victim->expires - now) > 0 &&
+			memcmp(&victim->addr, addr, sizeof(device_addr_t)) != 0) {
+		ble_adv_cnt.evictions++;
+	}
+	victim->addr = *addr;
+	victim->cls = cls;
+	victim->expires = now + ttl;
+}
+#endif // DISABLE_ADV_CACHE
+
+ble_adv_cache_stats_t ble_adv_cache_stats() {
+	ble_adv_cache_stats_t stats = ble_adv_cnt;
+	stats.size = BLE_ADV_CACHE_SZ;
+	return stats;
+}
+
+static uint8_t bt_adv_connected(device_addr_t *addr) {
+	device_t *device = get_device(*addr);
+	return (device && device->connection && device->connection->isConnected());
+}
+
+static void bt_conn_request(device_addr_t *addr, uint8_t beacon) {
+	if(bt_adv_connected(addr) || !bt_conn_claim(addr)) {
+		return;
+	}
+	ble_scan_activity_ts = MILLIS;
+	// never block the host, the queue holds every claimed address
+	bt_conn_req_t req = { *addr, beacon };
+	if(xQueueSend(xBLEDevice, &req, 0) != pdTRUE) {
+		bt_conn_release(addr);
+	}
+}
+
+#ifdef BLE_BEACONS
+/* next AD structure of a raw advertising payload, nullptr at its end */
+static const uint8_t* ble_adv_next(const uint8_t *payload, size_t len, size_t *pos,
+		uint8_t *type, size_t *data_len) {
+	if(*pos + 1 >= len) {
+		return nullptr;
+	}
+	uint8_t field_len = payload[*pos];
+	if(field_len == 0 || *pos + 1 + field_len > len) {
+		return nullptr;
+	}
+	const uint8_t *data = &payload[*pos + 2];
+	*type = payload[*pos + 1];
+	*data_len = field_len - 1;
+	*pos += 1 + field_len;
+	return data;
+}
+
+/* Finds the frame in the service data for serviceUUID, else in manufacturer
+ * data of BLE_BEACON_COMPANY_ID.  Runs on the NimBLE host task, so it points
+ * into the payload instead of copying. */
+static uint8_t ble_beacon_frame(BLEAdvertisedDevice *adv, const uint8_t **frame, size_t *len) {
+	const uint8_t *payload = adv->getPayload();
+	size_t payload_len = adv->getPayloadLength();
+	size_t uuid_len = serviceUUID->bitSize() / 8;
+	uint8_t svc_type = (uuid_len == 2) ? BLE_AD_SVC_DATA16 :
+			(uuid_len == 4) ? BLE_AD_SVC_DATA32 : BLE_AD_SVC_DATA128;
+	const uint8_t *data;
+	size_t pos = 0, data_len;
+	uint8_t type;
+
+	*frame = nullptr;
+	while((data = ble_adv_next(payload, payload_len, &pos, &type, &data_len)) != nullptr) {
+		if(type == svc_type && data_len > uuid_len &&
+				NimBLEUUID(data, uuid_len, false) == *serviceUUID) {
+			*frame = data + uuid_len;
+			*len = data_len - uuid_len;
+			return true;
+		}
+		if(type == BLE_AD_MFG_DATA && *frame == nullptr && data_len > 2 &&
+				data[0] == (BLE_BEACON_COMPANY_ID & 0xff) &&
+				data[1] == ((BLE_BEACON_COMPANY_ID >> 8) & 0xff)) {
+			*frame = data + 2;
+			*len = data_len - 2;
+		}
+	}
+	return (*frame != nullptr);
+}
+
+/* drop frames with a seq at or before the last accepted one */
+static uint8_t ble_beacon_accept(device_t *device, uint16_t seq) {
+	ble_beacon_t *beacon = &BLE_BEACON[device->device_id];
+	unsigned long int now = MILLIS;
+	if(beacon->seen && (now - beacon->seen) < BLE_BEACON_SEQ_RESET_MS &&
+			memcmp(&beacon->addr, &device->addr, sizeof(device_addr_t)) == 0) {
+		int16_t delta = (int16_t)(seq - beacon->seq);
+		if(delta == 0) {
+			beacon->seen = now;
+			ble_beacon_cnt.duplicates++;
+			return false;
+		}
+		if(delta < 0) {
+			ble_beacon_cnt.replays++;
+			return false;
 		}
 	}
+	beacon->addr = device->addr;
+	beacon->seq = seq;
+	beacon->seen = now;
 	return true;
 }
 
+/* returns true when the advertisement carried a beacon frame */
+static uint8_t ble_beacon_result(BLEAdvertisedDevice *adv, device_addr_t *addr) {
+	const uint8_t *p;
+	size_t len;
+	if(!ble_beacon_frame(adv, &p, &len)) {
+		return false;
+	}
+	if(len < (BLE_BEACON_SEQ_SZ + BLE_BEACON_ENTRY_SZ) ||
+			((len - BLE_BEACON_SEQ_SZ) % BLE_BEACON_ENTRY_SZ) != 0 ||
+			((len - BLE_BEACON_SEQ_SZ) / BLE_BEACON_ENTRY_SZ) > BLE_BEACON_MAX_ENTRIES) {
+		ble_beacon_cnt.invalid++;
+		return true;
+	}
+
+	device_t *device = get_device(*addr);
+	if(device == nullptr || !device->sensors[0].in_use) {
+		ble_beacon_cnt.unconfigured++;
+#ifdef DISABLE_DEVICE_CREATION
+		if(device == nullptr) {
+			return true;
+		}
+#endif
+		bt_conn_request(addr, true);
+		return true;
+	}
+
+	uint16_t seq = (p[0] << 8) | p[1];
+	if(!ble_beacon_accept(device, seq)) {
+		return true;
+	}
+	ble_beacon_cnt.frames++;
+
+	queue_entry_t entry;
+	entry.addr = *addr;
+	entry.ts = esp_timer_get_time();
+	for(size_t pos = BLE_BEACON_SEQ_SZ; pos < len; pos += BLE_BEACON_ENTRY_SZ) {
+		// [sensor_id, type, ..], sensor_id MAX_SENSORS is a device level battery reading
+		uint8_t sensor_id = p[pos], type = p[pos + 1];
+		if(type >= SENSOR_TYPE_CNT || sensor_id > MAX_SENSORS ||
+				(sensor_id == MAX_SENSORS && type != SENSOR_BATTERY)) {
+			ble_beacon_cnt.invalid++;
+			continue;
+		}
+		memcpy(&entry.data, p + pos, BLE_BEACON_ENTRY_SZ);
+		ble_ring_push(&entry);
+		ble_beacon_cnt.readings++;
+	}
+	return true;
+}
+#endif // BLE_BEACONS
+
 class MyAdvertisedDeviceCallbacks: public NimBLEAdvertisedDeviceCallbacks {
 	void onResult(BLEAdvertisedDevice *advertisedDevice) {
-		NimBLEAddress addr = advertisedDevice->getAddress();
-		if(!bt_adv_check(&addr)) {
-			LOGW("%s: ignored advertisement due to backoff", addr.toString().c_str());
+		device_addr_t addr;
+		nim_to_device_addr(advertisedDevice->getAddress().getNative(), &addr);
+		ble_adv_class_t cls = ble_adv_cache_lookup(&addr);
+		if(cls == ADV_FOREIGN || cls == ADV_BACKOFF) {
 			return;
 		}
-		device_id_t device_id;
-		memcpy(device_id, addr.toString().c_str(), sizeof(device_id));
+		uint32_t backoff = bt_adv_backoff(&addr);
+		if(backoff) {
+			LOGD(DEVICE_ADDR_FMT ": ignored advertisement due to backoff", DEVICE_ADDR_ARGS(addr));
+			ble_adv_cache_insert(&addr, ADV_BACKOFF, backoff);
+			return;
+		}
+#ifdef BLE_BEACONS
+		if(ble_beacon_result(advertisedDevice, &addr)) {
+			return;
+		}
+#endif // BLE_BEACONS
 #ifdef BLE_ADV_DEBUG
-		LOGD("scan: %02x / %s", advertisedDevice->getAddressType(), device_id);
+		LOGD("scan: %02x / " DEVICE_ADDR_FMT, advertisedDevice->getAddressType(), DEVICE_ADDR_ARGS(addr));
 		for(uint8_t i=0; i<advertisedDevice->getServiceUUIDCount(); i++) {
 			LOGD("remote: %s", advertisedDevice->getServiceUUID(i).toString().c_str());
 			LOGD("ours: %s", serviceUUID->toString().c_str());
 		}
 #endif // BLE_ADV_DEBUG
-		if (advertisedDevice->haveServiceUUID() &&
+		if (cls == ADV_OURS || (advertisedDevice->haveServiceUUID() &&
 				(advertisedDevice->isAdvertisingService(*serviceUUID) ||
-				 advertisedDevice->isAdvertisingService(*presenceUUID))) {
+				 advertisedDevice->isAdvertisingService(*presenceUUID)))) {
 #ifdef DISABLE_DEVICE_CREATION
-            if(get_device(device_id) == nullptr) {
-                LOGI("%s: unknown device, ignoring", device_id);
-			    vTaskDelay(DELAY_S3);
+            if(get_device(addr) == nullptr) {
+                LOGI(DEVICE_ADDR_FMT ": unknown device, ignoring", DEVICE_ADDR_ARGS(addr));
+				ble_adv_cache_insert(&addr, ADV_FOREIGN, BLE_ADV_FOREIGN_TTL_MS);
                 return;
             } 
 #endif // DISABLE_DEVICE_CREATION
-			xEventGroupSetBits(xBLEState, BLE_STOP);
-			esp_bd_addr_t device;
-			nim_to_bd_addr(advertisedDevice->getAddress().getNative(), &device);
-			if(xQueueSend(xBLEDevice, &device, DELAY_S4) != pdTRUE) {
-				xEventGroupClearBits(xBLEState, BLE_STOP);
+			if(cls == ADV_UNKNOWN) {
+				ble_adv_cache_insert(&addr, ADV_OURS, BLE_ADV_OURS_TTL_MS);
 			}
+			bt_conn_request(&addr, false);
+			return;
 		}
+		ble_adv_cache_insert(&addr, ADV_FOREIGN, BLE_ADV_FOREIGN_TTL_MS);
 	}
 };
 
 static void vConnTimerCB(TimerHandle_t xTimer) {
 	device_t *device = (device_t*)pvTimerGetTimerID(xTimer);
 	if(device) {
-		LOGW("%s: conn timer expired: closing", device->id);
-		if(xEventGroupGetBits(xDeviceState) == BLE_ALL) {
-			LOGD("conn timer: waiting for device resources to free");
-			xEventGroupWaitBits(xDeviceState, BLE_ALL, false, true, 4000);
-		}
-		device->connection->close();
+		// runs in the timer task: never wait for the worker's lock here
+		LOGW("%s: conn timer expired: aborting", device->id);
+		device->connection->abort();
 	} else {
 		LOGW("%s: timer expired but no device found!", device->id);
 	}
 }
 
 static uint8_t handleAuthState(device_t *device) {
-	while(get_ble_mutex_status(device->connection->mutexId)) {
+	while(ble_conn_lock_held(device->connection->lockId)) {
 		vTaskDelay(DELAY_S1);
 		switch(device->connection->authstate) {
 			case AUTH_PENDING: {
@@ -649,17 +1255,12 @@ static uint8_t handleAuthState(device_t *device) {
 static uint8_t handleConnection(device_t *device) {
 	if(!device) return false;
 
-	if(!(wait_for_ble_mutex(device) && device->connection->take())) {
+	if(!device->connection->take()) {
 		LOGE("handleConnection(): %s: failed to get device mutex", device->id);
 		return false;
 	}
 
-	vTimerSetTimerID(xBLEConnTimer, (void*)device);
-	if(((device_t*)pvTimerGetTimerID(xBLEConnTimer))->device_id != device->device_id) {
-		LOGW("vTimerID: mismatched id");
-		return false;
-	}
-
+	TimerHandle_t xBLEConnTimer = device->connection->timer;
 	if(xTimerStart(xBLEConnTimer, DELAY_S4) != pdTRUE) {
 		LOGW("failed to start connection handler timer");
 		return false;
@@ -714,10 +1315,14 @@ static void ble_configure_scan(BLEScan *pScan, BLEAdvertisedDeviceCallbacks *pAd
 	esp_ble_tx_power_set(ESP_BLE_PWR_TYPE_ADV, BLE_POWER_LEVEL);
 	esp_ble_tx_power_set(ESP_BLE_PWR_TYPE_SCAN ,BLE_POWER_LEVEL);
 
+#ifdef BLE_BEACONS
+	// every advertisement may carry a new reading
+	pScan->setAdvertisedDeviceCallbacks(pAdvCB, true);
+	pScan->setDuplicateFilter(false);
+	pScan->setMaxResults(0);
+#else
 	pScan->setAdvertisedDeviceCallbacks(pAdvCB);
-	pScan->setInterval(1349);
-	pScan->setWindow(449);
-	pScan->setActiveScan(true);
+#endif
 }
 
 static void ble_configure_security(BLESecurity *pSecurity) {
@@ -730,6 +1335,8 @@ static void bt_scan_mgr(void *ptx) {
     EventBits_t evt;
 	uint8_t scan_fail_cnt = 0;
 	uint8_t err;
+	ble_scan_policy_t policy;
+	unsigned long int started;
 
     BLEScan *pScan = BLEDevice::getScan();
 	BLEAdvertisedDeviceCallbacks *pAdvCB = new MyAdvertisedDeviceCallbacks();
@@ -771,10 +1378,12 @@ static void bt_scan_mgr(void *ptx) {
 			pAdvCB = new MyAdvertisedDeviceCallbacks();
 			ble_configure_scan(pScan, pAdvCB);
 		}
-		xEventGroupClearBits(xBLEState, BLE_ALL);
-		xEventGroupSetBits(xBLEState, BLE_SCANNING);
+		// READY stays set until ble_scan_start() flags SCANNING
+		xEventGroupClearBits(xBLEState, BLE_ALL & ~BLE_READY);
 		vTaskDelay(DELAY_S2);
 		LOGI("xBLEState->SCANNING");
+		policy = ble_scan_policy_select();
+		ble_scan_apply(pScan, policy);
 		if(!(err = ble_scan_start(pScan))) {
 			LOGE("failed to start scan, we'll try again..");
 			if(err != 99 && scan_fail_cnt++ > BLE_SCAN_FAIL_THRESH) {
@@ -783,12 +1392,27 @@ static void bt_scan_mgr(void *ptx) {
 			continue;
 		}
 		scan_fail_cnt = 0;
-		evt = xEventGroupWaitBits(xBLEState, BLE_FINISHED | BLE_STOP, true, false, 60000);
+		started = MILLIS;
+		// restart early when the registry calls for another policy
+		for(uint8_t i=0; i<(BLE_SCAN_PERIOD_MS / BLE_SCAN_POLICY_MS); i++) {
+			evt = xEventGroupWaitBits(xBLEState, BLE_FINISHED | BLE_STOP, true, false, BLE_SCAN_POLICY_MS / portTICK_PERIOD_MS);
+			if(evt & (BLE_FINISHED | BLE_STOP)) {
+				break;
+			}
+			if(ble_scan_policy_select() != policy) {
+				LOGD("scan policy changed: restarting scan");
+				break;
+			}
+		}
 		pScan->stop();
+		// a STOP raised while the scan was winding down still waits for PAUSED
+		evt |= xEventGroupClearBits(xBLEState, BLE_SCANNING);
+		if(err != 99) {
+			ble_scan_account(policy, MILLIS - started);
+		}
 		if (evt & BLE_STOP) {
-			LOGI("xBLEState->STOP: scan stopped");
-		    	vTaskDelay(DELAY_S0);
-			xEventGroupClearBits(xBLEState, BLE_ALL);
+			LOGI("xBLEState->STOP: scan paused for connect");
+			xEventGroupSetBits(xBLEState, BLE_PAUSED);
 		} else {
 			LOGI("xBLEState->FINISHED: scan timeout");
 		    	vTaskDelay(DELAY_S0);
@@ -798,107 +1422,124 @@ static void bt_scan_mgr(void *ptx) {
 	}
 }
 
-static void bt_device_mgr(void *ptx) {
-    xBLEDevice = xQueueCreate(1, sizeof(esp_bd_addr_t));
-	xDeviceState = xEventGroupCreate();
+static void bt_conn_device(bt_conn_req_t *req) {
+	device_addr_t *addr = &req->addr;
+	device_id_t device_id;
+	device_t *device;
+	const char *result[] = BLE_CONN_RESULT;
+	device_addr_to_str(addr, device_id);
+	LOGI("xQueueRecieve(xNewDevice): %s", device_id);
 
-	esp_bd_addr_t newDevice;
-	uint8_t client_cnt = 0;
-	BLEAddress m_ble_address(newDevice);
-	BLEAddress *address = &m_ble_address;
-	char *result[] = BLE_CONN_RESULT;
-	EventBits_t evt;
+	if((device = get_device(*addr)) == nullptr) {
+		if(client_count() >= MAX_DEVICES) {
+			LOGI("max_clients exceeded: ignoring conn request");
+			return;
+		}
+		if((device = create_device(*addr)) == nullptr) {
+			LOGE("failed to find/create a device for %s", device_id);
+			return;
+		}
+		LOGD("new device created for %s", device_id);
+	} else {
+		LOGD("found existing device for %s", device_id);
+		if(device->connection && !req->beacon) {
+			device->connection->close();
+		}
+	}
+	if(!bt_conn_check(device)) {
+		LOGI("device too soon: backing off");
+		vTaskDelay(DELAY_S1);
+		return;
+	}
 
-	if(bt_device_mgmt_init != nullptr) {
-		bt_device_mgmt_init();
+	if(req->beacon) {
+		// readings arrive in advertisements, the device only needs its config
+		if(bt_device_configure(device) && device->sensors[0].in_use) {
+			LOGI("%s: beacon configured", device_id);
+			device->connection->beacon = true;
+			device->connection->retries = 0;
+			device->connection->attempted = 0;
+		} else {
+			LOGW("%s: unable to configure beacon", device_id);
+			device->connection->retries++;
+			device->connection->attempted = MILLIS;
+		}
+		return;
 	}
-	
-	xBLEConnTimer = xTimerCreate("xBLEConnTimer", SECURE_CONN_TIMEOUT_MS, pdFALSE, (void*)0, vConnTimerCB);
+	device->connection->beacon = false;
+
+	LOGI("passing connection to handleConnection()");
+	__atomic_add_fetch(&bt_conn_cnt.attempts, 1, __ATOMIC_RELAXED);
+	int64_t start = esp_timer_get_time();
+	uint8_t res = handleConnection(device);
+	LOGI("handleConnection(): %s: %s", device_id, result[res]);
+	if(!res) {
+		__atomic_add_fetch(&bt_conn_cnt.failed, 1, __ATOMIC_RELAXED);
+		LOGW("cleanup failed client connection");
+		device->connection->close();
+		vTaskDelay(DELAY_S5);
+		device->connection->retries++;
+		device->connection->attempted = MILLIS;
+		return;
+	}
+	stats_hist_add(&bt_conn_cnt.setup, (uint32_t)(esp_timer_get_time() - start));
+	device->connection->retries = 0;
+	device->connection->attempted = 0;
+	device->connection->updateConnParams();
+
+	uint16_t connected = ble_connected_count();
+	if(bt_conn_cnt.all_connected_ms == 0 && connected >= (device_count() - ble_beacon_count())) {
+		bt_conn_cnt.all_connected_ms = MILLIS;
+		LOGI("all %d devices connected %lu ms after boot", connected, (unsigned long)bt_conn_cnt.all_connected_ms);
+	}
+}
+
+static void bt_conn_worker(void *ptx) {
+	bt_conn_req_t req;
 
 	for(;;) {
     STACK_STATS
-		if(xQueueReceive(xBLEDevice, &newDevice, portMAX_DELAY) != pdTRUE) {
-			xEventGroupWaitBits(xBLEState, BLE_SCANNING | BLE_READY, false, false, DELAY_S4);
+		if(xQueueReceive(xBLEDevice, &req, portMAX_DELAY) != pdTRUE) {
 			continue;
 		}
 	HEAP_BEGIN(new_device);
-		address = new (&m_ble_address) BLEAddress(newDevice);
-    	device_id_t device_id;
-    	device_t *device;  
-    	strncpy(device_id, address->toString().c_str(), DEVICE_ID_SZ-1);
-		LOGI("xQueueRecieve(xNewDevice): %s", device_id);
+		bt_conn_device(&req);
+		bt_conn_release(&req.addr);
+	HEAP_END(new_device);
+		vTaskDelay(DELAY_S0);
+	}
+}
 
-		vTaskDelay(client_cnt * DELAY_S1);
+static void bt_device_mgr(void *ptx) {
+	char name[configMAX_TASK_NAME_LEN];
 
-		if(client_cnt >= MAX_DEVICES) {
-			LOGI("max_clients exceeded: ignoring conn request");
-		} else {
-			xEventGroupSetBits(xDeviceState, DEVICE_ALL);
-			if((device = get_device(device_id)) == nullptr) {
-				if((device = create_device(device_id)) == nullptr) {
-          			LOGE("failed to find/create a device for %s", device_id);
-					xEventGroupClearBits(xBLEState, BLE_ALL);
-					xEventGroupSetBits(xBLEState, BLE_READY);
-          			continue;
-        		}
-        	LOGD("new device created for %s", device_id);
-      		} else {
-        		LOGD("found existing device for %s", device_id);
-        		if(device->connection) {
-          			device->connection->close();
-        		}
-      		} 
-			if(!bt_conn_check(device)) {
-				LOGI("device too soon: backing off");
-				vTaskDelay(DELAY_S1);
-			} else {
-				LOGI("passing connection to handleConnection()");
-				uint8_t res = handleConnection(device);
-				LOGI("handleConnection(): %s", result[res]);
-				if(!res) {
-					LOGW("cleanup failed client connection");
-					device->connection->close();
-		    		vTaskDelay(DELAY_S5);
-					device->connection->retries++;
-					device->connection->attempted = MILLIS;
-				} else {
-					device->connection->retries = 0;
-					device->connection->attempted = 0;
-					device->connection->updateConnParams();
-				}
-			}
-		}
-		xEventGroupClearBits(xBLEState, BLE_ALL);
-		client_cnt = client_count();
+	if(bt_device_mgmt_init != nullptr) {
+		bt_device_mgmt_init();
+	}
 
-	HEAP_END(new_device);
-	
-		vTaskDelay(DELAY_S0);
-		xEventGroupSetBits(xBLEState, BLE_READY);
+	bt_conn_cnt.workers = BT_CONN_WORKERS;
+	for(uint8_t i=0; i<BT_CONN_WORKERS; i++) {
+		snprintf(name, sizeof(name), "bt_conn_%d", i);
+		xTaskCreatePinnedToCore(bt_conn_worker, name, \
+			BT_DEVICE_STACK_SZ, NULL, BT_DEVICE_PRIO, NULL, 1);
 	}
+	vTaskDelete(NULL);
 }
 
 static void bt_queue_mgr(void *ptx) {
-	size_t len = sizeof((queue_entry_t){{},0,});
-	LOGD("xUpdateQueue size: %d", len);
-    xUpdateQueue = xQueueCreate(BLE_UPDATE_QUEUE_SZ, len);
-
 	queue_entry_t entry;
-	BLEAddress m_ble_address(entry.device_id);
-	BLEAddress *address = &m_ble_address;
 
 	for(;;) {
     STACK_STATS
-		if(xQueueReceive(xUpdateQueue, &entry, portMAX_DELAY) != pdTRUE) {
-			continue;
+		ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+		while(ble_ring_pop(&entry)) {
+		HEAP_BEGIN(send_update);
+			xEventGroupWaitBits(xBLEState, BLE_SCANNING | BLE_READY, false, false, 10000);
+			LOGD("processing ble payload: " DEVICE_ADDR_FMT, DEVICE_ADDR_ARGS(entry.addr));
+			bt_queue_handler(&entry.addr, &entry.data, entry.ts);
+		HEAP_END(send_update);
+			vTaskDelay(DELAY_S0);
 		}
-	HEAP_BEGIN(send_update);
-		xEventGroupWaitBits(xBLEState, BLE_SCANNING | BLE_READY, false, false, 10000);
-		address = new (&m_ble_address) BLEAddress(entry.device_id);
-		LOGD("processing ble payload: %s", address->toString().c_str());
-		bt_queue_handler(address, &entry.data);
-	HEAP_END(send_update);
-		vTaskDelay(DELAY_S0);
 	}
 }
 
@@ -925,22 +1566,24 @@ uint8_t ble_request_attr_update(device_t *device, uint8_t sensor_index) {
 	}
 
 	LOGI("sending request for BLE sensor update");
-	if(!wait_for_ble_mutex(device)) {
-         LOGE("timed out waiting for mutex");
-		 return false;
+	if(!device->connection->take()) {
+		LOGE("timed out waiting for mutex");
+		return false;
 	}
 
 	BLERemoteService *p_svc = device->connection->client->getService(*serviceUUID);
-	BLERemoteCharacteristic *p_char = p_svc->getCharacteristic(*configUUID);
+	BLERemoteCharacteristic *p_char = p_svc ? p_svc->getCharacteristic(*configUUID) : nullptr;
 
 	if(p_char == nullptr) {
 		LOGE("%s: unable to obtain service characteristic for configUUID", device->id);
+		device->connection->give();
 		return false;
 	}
 
 	uint8_t cmd[4] { 0xff, 0xff, 0x01, sensor_index, };
 	p_char->writeValue(cmd, sizeof(cmd), false);
 	LOGD("sends: 0x%02x-0x%02x-0x%02x-0x%02x", cmd[0], cmd[1], cmd[2], cmd[3]);
+	device->connection->give();
 	return true;
 }
 
@@ -953,35 +1596,35 @@ uint8_t ble_request_enter_dfu(device_t *device) {
 	}
 
 	LOGI("sending request for BLE sensor update");
-	if(!wait_for_ble_mutex(device)) {
-         LOGE("timed out waiting for mutex");
-		 return false;
+	if(!device->connection->take()) {
+		LOGE("timed out waiting for mutex");
+		return false;
 	}
 
 	BLERemoteService *p_svc = device->connection->client->getService(*serviceUUID);
-	BLERemoteCharacteristic *p_char = p_svc->getCharacteristic(*configUUID);
+	BLERemoteCharacteristic *p_char = p_svc ? p_svc->getCharacteristic(*configUUID) : nullptr;
 
 	if(p_char == nullptr) {
 		LOGE("%s: unable to obtain service characteristic for configUUID", device->id);
+		device->connection->give();
 		return false;
 	}
 
 	uint8_t cmd[4] { 0xff, 0xff, 0xfe, 0x0, };
 	p_char->writeValue(cmd, sizeof(cmd), false);
 	LOGD("sends: 0x%02x-0x%02x-0x%02x-0x%02x", cmd[0], cmd[1], cmd[2], cmd[3]);
+	device->connection->give();
 	return true;
 }
 
 void bt_scan_enable() {
 	LOGI("Enabling scanning: xBLEState->BLE_READY");
-	xEventGroupSetBits(xBLEConn, BLE_CONN_READY);
 	xEventGroupSetBits(xBLEState, BLE_READY);
 }
 
-void ble_add_static_device(device_id_t device_id) {
-	char *p = device_id;
-    LOGI("adding %s to ble_scan whitelist", p);
-    if(!BLEDevice::whiteListAdd(BLEAddress(p))) {
+void ble_add_static_device(device_addr_t addr) {
+    LOGI("adding " DEVICE_ADDR_FMT " to ble_scan whitelist", DEVICE_ADDR_ARGS(addr));
+    if(!BLEDevice::whiteListAdd(NimBLEAddress(addr.val))) {
         LOGE("failed to update whitelist");
     }
 }
@@ -993,8 +1636,10 @@ void ble_init(ble_device_config_t device_mode) {
     esp_log_level_set("NimBLEScan",                 BLE_LOG_LEVEL);
     esp_log_level_set("NimBLERemoteCharacteristic", BLE_LOG_LEVEL);
 
-    xBLEState  = xEventGroupCreate();
-    xBLEConn   = xEventGroupCreate();
+    xBLEState    = xEventGroupCreate();
+    xBLEDevice   = xQueueCreate(BT_CONN_QUEUE_SZ, sizeof(bt_conn_req_t));
+    xBLEGapArbiter = xSemaphoreCreateMutex();
+    ble_conn_lock_init();
 
     BLEDevice::init("NimBLE");
     esp_bt_sleep_disable();
@@ -1002,7 +1647,7 @@ void ble_init(ble_device_config_t device_mode) {
     xTaskCreatePinnedToCore(bt_device_mgr, "bt_device_mgr", \
         BT_DEVICE_STACK_SZ, NULL, BT_DEVICE_PRIO, NULL, 1);
     xTaskCreatePinnedToCore(bt_queue_mgr, "bt_queue_mgr", \
-        BT_QUEUE_STACK_SZ, NULL, BT_QUEUE_PRIO, NULL, 1);
+        BT_QUEUE_STACK_SZ, NULL, BT_QUEUE_PRIO, &xBLEQueueTask, 1);
     xTaskCreatePinnedToCore(bt_scan_mgr, "bt_scan_mgr", \
         BT_SCAN_STACK_SZ, NULL, BT_SCAN_PRIO, NULL, 1);
 
@@ -1049,15 +1694,18 @@ void ble_set_svc_uuid(ble_svc_uuid_t svc_uuid, NimBLEUUID uuid) {
 	memcpy(&UUIDS[svc_uuid], &uuid, sizeof(UUIDS[0]));
 }
 
-void ble_sensor_network_queue(BLEAddress *addr, uint32_t *data) {
+void ble_sensor_network_queue(device_addr_t *addr, uint32_t *data, int64_t ts) {
 	uint8_t ble_data[4];;
-	device_id_t device_id;
 
-	memcpy(device_id, addr->toString().c_str(), sizeof(device_id_t));
 	memcpy(ble_data, data, sizeof(uint32_t));
 
 	const uint8_t num_entries = 1;
-	device_data_t  *payload = device_payload_init((char*)device_id, num_entries);
+	device_data_t  *payload = device_payload_init(*addr, num_entries);
+	if(payload == nullptr) {
+		LOGE("no payload available: dropping update from " DEVICE_ADDR_FMT, DEVICE_ADDR_ARGS(*addr));
+		return;
+	}
+	payload->ts = ts;
 
 	for(uint8_t i=0; i<num_entries; i++) {
 		sensor_data_entry_t entry = device_payload_get_entry(payload, i);
@@ -1067,7 +1715,7 @@ void ble_sensor_network_queue(BLEAddress *addr, uint32_t *data) {
 	}
 
 	if(!network_queue_payload(payload)) {
-		LOGE("failed to queue payload: free() allocation");
+		LOGE("failed to queue payload: releasing to pool");
 		device_payload_free(payload);
 	}
 }
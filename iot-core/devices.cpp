@@ -1,9 +1,12 @@
+#include <stdarg.h>
 #include "iot-common.h"
 #include "ble.h"
 #include "network.h"
 #include "smartapp.h"
 #include "devices.h"
 #include "influx.h"
+#include "stats.h"
+#include "spool.h"
 
 static const char *TAG = "devices";
 
@@ -15,6 +18,26 @@ static	device_t	**pDEVICE = (device_t**)calloc(MAX_DEVICES, sizeof(device_t*));
 
 static	device_presence_t	DEVICE_PRESENCE[MAX_DEVICES];
 
+/* open-addressed index of in-use slots, sized to the next power of two
+ * at or above twice MAX_DEVICES to keep probe chains short */
+static constexpr uint16_t device_index_size(uint16_t n) {
+	return (n <= 1) ? 1 : (device_index_size((n + 1) / 2) * 2);
+}
+#define DEVICE_INDEX_SZ     device_index_size(MAX_DEVICES * 2)
+#define DEVICE_INDEX_MASK   (DEVICE_INDEX_SZ - 1)
+#define DEVICE_INDEX_EMPTY  0xffff
+
+static	uint16_t	DEVICE_INDEX[DEVICE_INDEX_SZ];
+static	uint16_t	DEVICE_FREE[MAX_DEVICES];
+static	uint16_t	device_free_cnt = 0;
+static	portMUX_TYPE	device_index_mux = portMUX_INITIALIZER_UNLOCKED;
+
+static	device_data_t		PAYLOAD_POOL[PAYLOAD_POOL_SZ];
+static	volatile uint32_t	payload_pool_used[PAYLOAD_POOL_WORDS];
+static	volatile uint32_t	payload_pool_in_use		= 0;
+static	volatile uint32_t	payload_pool_hwm		= 0;
+static	volatile uint32_t	payload_pool_exhausted	= 0;
+
 static EventGroupHandle_t xPresenceEvent;
 
 static  void    send_scope_updates(device_data_t *);
@@ -25,18 +48,46 @@ static  void    device_presence_update_action(device_t *);
 static  void    device_set_presence(device_t *, presence_t );
 static  void    vPresenceTask(void *);
 static  void    vDeviceTask(void *);
+static  uint16_t    device_index_find(const device_addr_t *);
+static  void    device_index_insert(uint16_t);
+static  void    device_index_remove(uint16_t);
+static  device_data_t*  payload_pool_alloc();
+static  void    payload_pool_release(device_data_t *);
 
 
-device_t* get_device(device_id_t device_id) {
-	device_t *device;
-	
-	for(uint8_t i=0; i<MAX_DEVICES; i++) {
-		device = pDEVICE[i];
-		if(strncmp(device_id, device->id, DEVICE_ID_SZ) == 0) {
-			return device;
-		}
+device_t* get_device(device_addr_t addr) {
+	device_t *device = nullptr;
+
+	portENTER_CRITICAL(&device_index_mux);
+	uint16_t pos = device_index_find(&addr);
+	if(DEVICE_INDEX[pos] != DEVICE_INDEX_EMPTY) {
+		device = pDEVICE[DEVICE_INDEX[pos]];
 	}
-	return nullptr;
+	portEXIT_CRITICAL(&device_index_mux);
+	return device;
+}
+
+uint16_t device_count() {
+	return MAX_DEVICES - device_free_cnt;
+}
+
+void device_addr_to_str(const device_addr_t *addr, device_id_t buf) {
+	snprintf(buf, DEVICE_ID_SZ, DEVICE_ADDR_FMT, DEVICE_ADDR_ARGS(*addr));
+}
+
+uint8_t device_addr_from_str(const char *str, device_addr_t *addr) {
+	unsigned int val[DEVICE_ADDR_SZ];
+	if(strlen(str) != DEVICE_ID_SZ-1) {
+		return false;
+	}
+	if(sscanf(str, "%02x:%02x:%02x:%02x:%02x:%02x", &val[0], &val[1], &val[2],
+				&val[3], &val[4], &val[5]) != DEVICE_ADDR_SZ) {
+		return false;
+	}
+	for(uint8_t i=0; i<DEVICE_ADDR_SZ; i++) {
+		addr->val[i] = (uint8_t)val[i];
+	}
+	return true;
 }
 
 devices_t get_devices() {
@@ -53,40 +104,65 @@ void delete_device(device_t *device) {
 		}
 	}
 
-	device_t new_device = NEW_DEVICE(device->device_id);
+	uint16_t i = device->device_id;
+	bool in_use = device->in_use;
+	if(in_use) {
+		portENTER_CRITICAL(&device_index_mux);
+		device_index_remove(i);
+		portEXIT_CRITICAL(&device_index_mux);
+	}
+
+	device_t new_device = NEW_DEVICE(i);
 	new_device.connection = device->connection;
 	*device = new_device;
+
+	if(in_use) {
+		portENTER_CRITICAL(&device_index_mux);
+		DEVICE_FREE[device_free_cnt++] = i;
+		portEXIT_CRITICAL(&device_index_mux);
+	}
 }
 
-device_t* create_device(device_id_t device_id) {
+device_t* create_device(device_addr_t addr) {
 	device_t *device;
+	uint16_t i;
 
-	for(uint8_t i=0; i<MAX_DEVICES; i++) {
-		device = pDEVICE[i];
-		if(!device->in_use) {
-	        device_t new_device = NEW_DEVICE(i);
-		    *device = new_device;
-			LOGI("create_device(): %s", device_id);
-			memcpy(device->id, device_id, DEVICE_ID_SZ);
-			device->in_use = true;
-			device->last_seen = MILLIS;
-			if(!device->connection) {
-				device->connection = new SecureClient(device);
-			}
-			DEVICE_PRESENCE[i].device = device;
-			DEVICE_PRESENCE[i].presence = PRESENCE_NOT_PRESENT;
-			return device;
-		}
+	portENTER_CRITICAL(&device_index_mux);
+	if(device_free_cnt == 0) {
+		portEXIT_CRITICAL(&device_index_mux);
+		return nullptr;
 	}
-	return nullptr;
+	i = DEVICE_FREE[--device_free_cnt];
+	portEXIT_CRITICAL(&device_index_mux);
+
+	device = pDEVICE[i];
+	device_t new_device = NEW_DEVICE(i);
+	new_device.connection = device->connection;
+	*device = new_device;
+	device->addr = addr;
+	device_addr_to_str(&addr, device->id);
+	LOGI("create_device(): %s", device->id);
+	device->in_use = true;
+	device->last_seen = MILLIS;
+	if(!device->connection) {
+		device->connection = new SecureClient(device);
+	}
+	DEVICE_PRESENCE[i].device = device;
+	DEVICE_PRESENCE[i].presence = PRESENCE_NOT_PRESENT;
+
+	portENTER_CRITICAL(&device_index_mux);
+	device_index_insert(i);
+	portEXIT_CRITICAL(&device_index_mux);
+	return device;
 }
 
 #ifdef STATIC_DEVICE_LIST
 void device_load_static_list(sensor_type_t sensor_type) {
 	device_id_t devices[] = { STATIC_DEVICE_LIST };
+	device_addr_t addr;
 	for(uint8_t i=0; i<(sizeof(devices) / sizeof(device_id_t)); i++) {
-		if(strlen(devices[i]) == DEVICE_ID_SZ-1) {
-			device_t *device = create_device(devices[i]);
+		if(device_addr_from_str(devices[i], &addr)) {
+			device_t *device = create_device(addr);
 			device_add_sensor(device, sensor_type);
 		}
 	}
@@ -95,23 +171,26 @@ void device_load_static_list(sensor_type_t sensor_type) {
 
 void device_payload_all_sensors(device_data_t *payload) {
 	sensor_data_entry_t entry = device_payload_get_entry(payload, 0);
-	device_t *device = get_device(payload->device_id);
+	device_t *device = get_device(payload->addr);
+	if(entry.value == nullptr) {
+		return;
+	}
 	for(uint8_t idx=0 ; idx<MAX_SENSORS; idx++) {
 		if(device->sensors[idx].in_use) {
-			device_send_update(payload->device_id, *entry.type, (*(uint16_t*)entry.value->value), idx);
+			device_send_update(payload->addr, *entry.type, (*(uint16_t*)entry.value->value), idx);
 		}
 	}
 }
 
 void device_process_payload(device_data_t *payload) {
 	device_t *device;
+	sensor_t *sensor = nullptr;
 
-	if(!(device = get_device(payload->device_id))) {
-		LOGE("no such device: %s", payload->device_id);
-		return;
+	if(!(device = get_device(payload->addr))) {
+		LOGE("no such device: " DEVICE_ADDR_FMT, DEVICE_ADDR_ARGS(payload->addr));
+		goto cleanup;
 	}
 	device->last_seen = MILLIS;
-	sensor_t *sensor = nullptr;
 	switch(payload->data.type) {
 
 		case SENSOR_BATTERY:
@@ -143,15 +222,27 @@ cleanup:
 	device_payload_free(payload);
 }
 
-device_data_t* device_payload_init(const char *device_id, uint8_t num_entries) {
-	LOGD("payload_init: using did: %s: alloc %d bytes", device_id, VAL_TRANSPORT_SZ);
-	device_data_t *payload = (device_data_t*)calloc(1, VAL_TRANSPORT_SZ);
-	memcpy(payload->device_id, device_id, sizeof(device_id_t));
-	LOGD("payload device at offset %d bytes is set to: %s", 
-			PTR_OFFSET(payload, payload->device_id), payload->device_id);
+device_data_t* device_payload_init(device_addr_t addr, uint8_t num_entries) {
+	if(num_entries > PAYLOAD_MAX_VALUES) {
+		LOGE("payload_init: " DEVICE_ADDR_FMT ": %d entries exceed %d", DEVICE_ADDR_ARGS(addr),
+				num_entries, PAYLOAD_MAX_VALUES);
+		return nullptr;
+	}
+	device_data_t *payload = payload_pool_alloc();
+	if(payload == nullptr) {
+		LOGW("payload_init: " DEVICE_ADDR_FMT ": payload pool exhausted", DEVICE_ADDR_ARGS(addr));
+		return nullptr;
+	}
+	memset(payload, 0, VAL_TRANSPORT_SZ);
+	payload->addr = addr;
+	payload->ts = esp_timer_get_time();
+	PIPELINE_STAMP(payload->ts_init);
 
 	while(num_entries--) {
-		device_payload_alloc_entry(payload);
+		if(device_payload_alloc_entry(payload) == PAYLOAD_MAX_VALUES) {
+			device_payload_free(payload);
+			return nullptr;
+		}
 	}
 	return payload;
 }
@@ -161,6 +252,11 @@ uint8_t device_payload_alloc_entry(device_data_t *payload) {
 }
 
 sensor_data_entry_t device_payload_get_entry(device_data_t *payload, uint8_t idx) {
+	if(idx >= payload->data.num_values) {
+		LOGE("payload entry %d of %d: out of range", idx, payload->data.num_values);
+		sensor_data_entry_t entry = {};
+		return entry;
+	}
 	return sensor_payload_get_entry(&payload->data, idx);
 }
 
@@ -188,7 +284,7 @@ void update_on_disconnect(device_t *device) {
 
 void device_presence_update_cb(device_data_t ret_payload, uint8_t err) {
    if(ret_payload.data.type == SENSOR_PRESENCE && !err) {
-     device_t *device = get_device((char*)ret_payload.device_id);
+     device_t *device = get_device(ret_payload.addr);
      device_presence_set_action(device, ACTION_NONE);
    } 
 }
@@ -201,11 +297,17 @@ void device_enable_ble_presence() {
 }
 
 void device_payload_free(device_data_t *payload) {
-	LOGD("device_payload_free(): 0x%08x", (uint32_t)payload);
-	free(payload->data.tags);
-	free(payload->data.values);
-	free(payload);
-	payload = NULL;
+	LOGD("device_payload_free(): %p", payload);
+	payload_pool_release(payload);
+}
+
+payload_pool_stats_t device_payload_pool_stats() {
+	payload_pool_stats_t stats;
+	stats.size = PAYLOAD_POOL_SZ;
+	stats.in_use = __atomic_load_n(&payload_pool_in_use, __ATOMIC_RELAXED);
+	stats.high_water = __atomic_load_n(&payload_pool_hwm, __ATOMIC_RELAXED);
+	stats.exhausted = __atomic_load_n(&payload_pool_exhausted, __ATOMIC_RELAXED);
+	return stats;
 }
 
 sensor_t* device_add_sensor(device_t *device, sensor_type_t type) {
@@ -228,8 +330,11 @@ sensor_t* device_add_sensor(device_t *device, sensor_type_t type) {
 	return nullptr;
 }
 
-uint8_t device_send_update(const char *device_id, sensor_type_t type, uint16_t state, uint8_t device_idx) {
-	device_data_t  *payload = device_payload_init(device_id, 1);
+uint8_t device_send_update(device_addr_t addr, sensor_type_t type, uint16_t state, uint8_t device_idx) {
+	device_data_t  *payload = device_payload_init(addr, 1);
+	if(payload == nullptr) {
+		return false;
+	}
 	sensor_data_entry_t entry = device_payload_get_entry(payload, 0);
 
 	attribute_t type_name;
@@ -251,27 +356,45 @@ uint8_t device_update_needed(device_t *device, uint16_t vers) {
 
 void device_init() {
 	memset(DEVICES, 0, DEVICES_SIZE);
-	for(uint8_t i=0; i<MAX_DEVICES; i++) {
+	for(uint16_t i=0; i<MAX_DEVICES; i++) {
 		pDEVICE[i] = &DEVICES[i];
+		DEVICE_FREE[i] = (MAX_DEVICES - 1) - i;
+	}
+	for(uint16_t i=0; i<DEVICE_INDEX_SZ; i++) {
+		DEVICE_INDEX[i] = DEVICE_INDEX_EMPTY;
 	}
+	device_free_cnt = MAX_DEVICES;
 	xTaskCreatePinnedToCore(vDeviceTask, "device_mgmt_task", DEVICE_MGMT_TASK_SZ, NULL, DEFAULT_TASK_PRIO-1, NULL, 1);
 }
 
-static void send_scope_updates(device_data_t *payload) {
+void device_scope_update(update_scope_t scope, device_data_t *payload) {
     uint8_t err = 0;
 
-    if(payload->data.scopes & SCOPE_INFLUX) {
-		influx_queue_payload(payload);
-    }
+    switch(scope) {
+        case SCOPE_INFLUX:
+            influx_queue_payload(payload);
+            break;
+
+        case SCOPE_SMARTTHINGS:
+            if(!st_send_payload(payload)) {
+                LOGE("failed to update st device");
+                err++;
+            }
+            break;
 
-    if(payload->data.scopes & SCOPE_SMARTTHINGS) {
-	    if(!st_send_payload(payload)) {
-	        LOGE("failed to update st device");
-	        err++;
-	    }
+        default:
+            break;
     }
+    switch(scope) {
+        case SCOPE_INFLUX:      PIPELINE_RECORD(PIPE_INFLUX, payload->ts_stage); break;
+        case SCOPE_SMARTTHINGS: PIPELINE_RECORD(PIPE_ST, payload->ts_stage); break;
+        case SCOPE_NOTIFY:      PIPELINE_RECORD(PIPE_NOTIFY, payload->ts_stage); break;
+        default: break;
+    }
+    PIPELINE_RECORD(PIPE_TOTAL, payload->ts_init);
 
 	device_data_t ret_payload = *payload;
+	ret_payload.data.scopes = scope;
 
 	if(device_update_cb != NULL) {
         device_update_cb(ret_payload, err);
@@ -279,10 +402,119 @@ static void send_scope_updates(device_data_t *payload) {
     wifi_err_check(err);
 }
 
+static void send_scope_updates(device_data_t *payload) {
+    PIPELINE_RECORD(PIPE_PROCESS, payload->ts_stage);
+    PIPELINE_STAMP(payload->ts_stage);
+    if(payload->data.scopes == SCOPE_NONE) {
+        device_scope_update(SCOPE_NONE, payload);
+        return;
+    }
+    network_dispatch_payload(payload);
+}
+
+static inline uint16_t device_index_hash(const device_addr_t *addr) {
+	const uint8_t *a = addr->val;
+	uint32_t h = ((uint32_t)a[2] << 24 | (uint32_t)a[3] << 16 | (uint32_t)a[4] << 8 | a[5]);
+	h ^= ((uint32_t)a[0] << 8 | a[1]);
+	h *= 0x9e3779b1;
+	return (h ^ (h >> 16)) & DEVICE_INDEX_MASK;
+}
+
+/* index position holding addr, or the empty position ending its probe chain */
+static uint16_t device_index_find(const device_addr_t *addr) {
+	uint16_t pos = device_index_hash(addr);
+	while(DEVICE_INDEX[pos] != DEVICE_INDEX_EMPTY) {
+		if(DEVICE_ADDR_EQ(*addr, DEVICES[DEVICE_INDEX[pos]].addr)) {
+			break;
+		}
+		pos = (pos + 1) & DEVICE_INDEX_MASK;
+	}
+	return pos;
+}
+
+static void device_index_insert(uint16_t slot) {
+	uint16_t pos = device_index_find(&DEVICES[slot].addr);
+	DEVICE_INDEX[pos] = slot;
+}
+
+/* backward-shift delete keeps probe chains intact without tombstones */
+static void device_index_remove(uint16_t slot) {
+	uint16_t pos = device_index_find(&DEVICES[slot].addr);
+	if(DEVICE_INDEX[pos] != slot) {
+		return;
+	}
+	uint16_t next = pos;
+	for(;;) {
+		next = (next + 1) & DEVICE_INDEX_MASK;
+		if(DEVICE_INDEX[next] == DEVICE_INDEX_EMPTY) {
+			break;
+		}
+		uint16_t home = device_index_hash(&DEVICES[DEVICE_INDEX[next]].addr);
+		if(((next - home) & DEVICE_INDEX_MASK) >= ((next - pos) & DEVICE_INDEX_MASK)) {
+			DEVICE_INDEX[pos] = DEVICE_INDEX[next];
+			pos = next;
+		}
+	}
+	DEVICE_INDEX[pos] = DEVICE_INDEX_EMPTY;
+}
+
+static device_data_t* payload_pool_alloc() {
+	for(uint8_t w=0; w<PAYLOAD_POOL_WORDS; w++) {
+		uint8_t slots = MIN(32, PAYLOAD_POOL_SZ - (w * 32));
+		uint32_t mask = (slots == 32) ? 0xffffffff : ((1UL << slots) - 1);
+		uint32_t used = __atomic_load_n(&payload_pool_used[w], __ATOMIC_ACQUIRE);
+		while(~used & mask) {
+			uint8_t bit = __builtin_ctz(~used & mask);
+			if(__atomic_compare_exchange_n(&payload_pool_used[w], &used, used | (1UL << bit),
+						false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+				uint32_t in_use = __atomic_add_fetch(&payload_pool_in_use, 1, __ATOMIC_RELAXED);
+				uint32_t hwm = __atomic_load_n(&payload_pool_hwm, __ATOMIC_RELAXED);
+				while(in_use > hwm && !__atomic_compare_exchange_n(&payload_pool_hwm, &hwm, in_use,
+						false, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+				return &PAYLOAD_POOL[(w * 32) + bit];
+			}
+		}
+	}
+	__atomic_add_fetch(&payload_pool_exhausted, 1, __ATOMIC_RELAXED);
+	return nullptr;
+}
+
+static void payload_pool_release(device_data_t *payload) {
+	size_t idx = payload - PAYLOAD_POOL;
+	if(payload < PAYLOAD_POOL || idx >= PAYLOAD_POOL_SZ) {
+		LOGE("payload_pool_release(): %p is not a pool entry", payload);
+		return;
+	}
+	uint32_t bit = (1UL << (idx % 32));
+	if(__atomic_fetch_and(&payload_pool_used[idx / 32], ~bit, __ATOMIC_RELEASE) & bit) {
+		__atomic_sub_fetch(&payload_pool_in_use, 1, __ATOMIC_RELAXED);
+	} else {
+		LOGE("payload_pool_release(): double free of entry %d", idx);
+	}
+}
+
+/* append to the display buffer, truncating once it is full */
+static void display_printf(char *msg, size_t *pos, const char *fmt, ...) {
+	if(*pos >= DEVICE_DISPLAY_BUF_SZ - 1) {
+		return;
+	}
+	va_list args;
+	va_start(args, fmt);
+	int len = vsnprintf(msg + *pos, DEVICE_DISPLAY_BUF_SZ - *pos, fmt, args);
+	va_end(args);
+	if(len > 0) {
+		*pos = MIN(*pos + len, DEVICE_DISPLAY_BUF_SZ - 1);
+	}
+}
+
 static uint8_t display_devices() {
-	uint8_t i, count = 0;
-	char *msg = (char*)malloc(1024);
-	char *pos = msg;
+	uint16_t i, count = 0;
+	char *msg = (char*)malloc(DEVICE_DISPLAY_BUF_SZ);
+	size_t pos = 0;
+	if(msg == NULL) {
+		LOGE("display_devices(): failed to allocate %d bytes", DEVICE_DISPLAY_BUF_SZ);
+		return 0;
+	}
 
   #ifdef UART_MASTER
    #define HEADER_LINE "\n-------master-------\n"
@@ -293,34 +525,98 @@ static uint8_t display_devices() {
   #endif
   #define FOOTER_LINE "---------------------"
 
-	pos += sprintf(pos, "(%s)", BUILD_VERSION);
-	pos += sprintf(pos, HEADER_LINE);
-	pos += sprintf(pos, "* HEAP FREE: RTOS: %d / malloc: %d\n", \
+	display_printf(msg, &pos, "(%s)", BUILD_VERSION);
+	display_printf(msg, &pos, HEADER_LINE);
+	display_printf(msg, &pos, "* HEAP FREE: RTOS: %d / malloc: %d\n", \
 			xPortGetFreeHeapSize(), heap_caps_get_free_size(MALLOC_CAP_INTERNAL));
+	payload_pool_stats_t pool = device_payload_pool_stats();
+	display_printf(msg, &pos, "* PAYLOAD POOL: %d/%d (high: %d / exhausted: %d)\n", \
+			pool.in_use, pool.size, pool.high_water, pool.exhausted);
+	influx_batch_stats_t influx = influx_batch_stats();
+	display_printf(msg, &pos, "* INFLUX: %d points / %d requests (max: %d / failed: %d / dropped: %d)\n", \
+			influx.points, influx.requests, influx.max_points, influx.failed, influx.dropped);
+#ifdef INFLUX_GZIP
+	if(influx.bytes) {
+		display_printf(msg, &pos, "* GZIP: %d -> %d bytes (%d%%, avg: %d us)\n", influx.bytes, influx.bytes_sent, \
+				(int)(((uint64_t)influx.bytes_sent * 100) / influx.bytes), influx.compress_us / influx.requests);
+	}
+#endif
+	if(spool_enabled()) {
+		spool_stats_t spool = spool_stats();
+		display_printf(msg, &pos, "* SPOOL: %d pending / %d sectors (dropped: %d / erases: %d-%d)\n", \
+				spool.pending, spool.sectors, spool.dropped, spool.erase_min, spool.erase_max);
+	}
+	sensor_filter_stats_t filter = sensor_filter_stats();
+	display_printf(msg, &pos, "* SENSOR FILTER: %d passed / %d suppressed\n", filter.passed, filter.suppressed);
+	bt_conn_stats_t conn = bt_conn_stats();
+	display_printf(msg, &pos, "* BLE CONN: %d connected / %d/%d in flight (peak: %d / attempts: %d / failed: %d / setup p50: <%d ms)\n", \
+			conn.connected, conn.in_flight, conn.workers, conn.peak_in_flight, conn.attempts, conn.failed, \
+			stats_hist_percentile(&conn.setup, 50) / 1000);
+	display_printf(msg, &pos, "* GATT CACHE: %d hits / %d misses (configure p50: <%d ms / first notify p50: <%d ms)\n", \
+			conn.cache_hits, conn.cache_misses, stats_hist_percentile(&conn.configure, 50) / 1000, \
+			stats_hist_percentile(&conn.first_notify, 50) / 1000);
+	display_printf(msg, &pos, "* CONN LOCKS: %d waits / %d timeouts\n", conn.lock_waits, conn.lock_timeouts);
+	if(conn.all_connected_ms) {
+		display_printf(msg, &pos, "* BLE CONN: all connected %d ms after boot\n", conn.all_connected_ms);
+	}
+#ifdef BLE_BEACONS
+	ble_beacon_stats_t beacon = ble_beacon_stats();
+	display_printf(msg, &pos, "* BEACONS: %d frames / %d readings (duplicates: %d / replays: %d / invalid: %d)\n", \
+			beacon.frames, beacon.readings, beacon.duplicates, beacon.replays, beacon.invalid);
+#endif
+	ble_scan_stats_t scan = ble_scan_stats();
+	display_printf(msg, &pos, "* SCAN: %s %d/%d ms %s (duty: %d.%d%% / avg: %d.%d%% / changes: %d)\n", \
+			scan.name ? scan.name : "-", scan.window, scan.interval, scan.active ? "active" : "passive", \
+			scan.duty_permille / 10, scan.duty_permille % 10, \
+			scan.avg_duty_permille / 10, scan.avg_duty_permille % 10, scan.changes);
+	ble_adv_cache_stats_t adv = ble_adv_cache_stats();
+	display_printf(msg, &pos, "* ADV CACHE: %d entries (hits: %d / misses: %d / evicted: %d)\n", \
+			adv.size, adv.hits, adv.misses, adv.evictions);
+	ble_ring_stats_t ring = ble_update_ring_stats();
+	display_printf(msg, &pos, "* BLE RING: %d/%d (high: %d / overflow: %d)\n", \
+			ring.depth, ring.size, ring.high_water, ring.overflow);
+	const update_scope_t lanes[] = { SCOPE_INFLUX, SCOPE_SMARTTHINGS, SCOPE_NOTIFY };
+	display_printf(msg, &pos, "* NET LANES:");
+	for(i=0; i<(sizeof(lanes) / sizeof(update_scope_t)); i++) {
+		net_lane_stats_t lane = network_lane_stats(lanes[i]);
+		display_printf(msg, &pos, " [0x%02x: %d/%d (dropped: %d)]", lane.scope, \
+				lane.depth, NET_LANE_QUEUE_SZ, lane.dropped);
+	}
+	display_printf(msg, &pos, "\n* LANE p99 (interactive/bulk):");
+	for(i=0; i<(sizeof(lanes) / sizeof(update_scope_t)); i++) {
+		net_lane_stats_t lane = network_lane_stats(lanes[i]);
+		display_printf(msg, &pos, " [0x%02x: <%d/<%d ms]", lane.scope, \
+				stats_hist_percentile(&lane.latency[NET_PRIO_INTERACTIVE], 99) / 1000, \
+				stats_hist_percentile(&lane.latency[NET_PRIO_BULK], 99) / 1000);
+	}
+	display_printf(msg, &pos, "\n");
+	http_pool_stats_t http = http_pool_stats();
+	display_printf(msg, &pos, "* HTTP POOL: %d idle / %d in use (hits: %d / misses: %d / evicted: %d)\n", \
+			http.idle, http.in_use, http.hits, http.misses, http.evictions);
 	devices_t devices = get_devices();
 	for(i=0; i<devices.num_devices; i++) {
 		device_t *device = devices.devices[i];
 		if(device->in_use && device->connection) {
 			count++;
-			pos += sprintf(pos, "conn %d: %s", i, device->id);
+			display_printf(msg, &pos, "conn %d: %s", i, device->id);
 			if(device->connection->isConnected()) {
-				pos += sprintf(pos, " * ");
+				display_printf(msg, &pos, " * ");
 			} else {
-				pos += sprintf(pos, "   ");
+				display_printf(msg, &pos, "   ");
 			}
 			if(device->version) {
-				pos += sprintf(pos, "(fw: v%d) (hw_rev: %d)", device->version, device->hw_rev);
+				display_printf(msg, &pos, "(fw: v%d) (hw_rev: %d)", device->version, device->hw_rev);
 			}
 			if(device->sensors[0].id == SENSOR_PRESENCE) {
 				int rssi = device->connection->getRssi();
 				if(rssi) {
-					pos += sprintf(pos, "(rssi: %d)", rssi);
+					display_printf(msg, &pos, "(rssi: %d)", rssi);
 				}
 			}
-			pos += sprintf(pos, "\n");
+			display_printf(msg, &pos, "\n");
 		}
 	}
-	sprintf(pos, FOOTER_LINE);
+	display_printf(msg, &pos, FOOTER_LINE);
 	
 	LOGI("%s", msg);
 	free(msg);
@@ -334,7 +630,7 @@ static uint8_t display_devices() {
 static void prune_devices() {
 #ifndef DISABLE_DEVICE_PRUNING
 	devices_t devices = get_devices();
-	for(uint8_t i=0; i<devices.num_devices; i++) {
+	for(uint16_t i=0; i<devices.num_devices; i++) {
 		device_t *device = devices.devices[i];
 		if(device->in_use && device->last_seen) {
 			if(device->sensors && device->sensors[0].id == SENSOR_PRESENCE) {
@@ -387,11 +683,10 @@ static void device_presence_update_action(device_t *device) {
 }
 
 static void device_set_presence(device_t *device, presence_t mode) {
-  char *device_id = device->id;
   device_presence_t *presence = &DEVICE_PRESENCE[device->device_id];
   presence->presence = mode;
   const sensor_t *sensor = sensor_get_by_type(SENSOR_PRESENCE);
-  device_send_update(device_id, sensor->id, mode);
+  device_send_update(device->addr, sensor->id, mode);
   if(device_presence_cb != NULL) {
 	if(device_presence_cb(*presence)) {
 		device_presence_set_action(device, ACTION_NONE);
@@ -403,7 +698,7 @@ static void vPresenceTask(void *ptx) {
   xPresenceEvent = xEventGroupCreate();
   device_presence_t *state = nullptr;
 
-  for(uint8_t i=0; i<MAX_DEVICES; i++) {
+  for(uint16_t i=0; i<MAX_DEVICES; i++) {
       state = &DEVICE_PRESENCE[i];
 	  if(state->device == nullptr) {
 		  continue;
@@ -416,7 +711,7 @@ static void vPresenceTask(void *ptx) {
     STACK_STATS
     xEventGroupWaitBits(xPresenceEvent, ACTION_MAX, true, false, PRESENCE_UPDATE_TIMEOUT);
 
-    for(uint8_t i=0; i<MAX_DEVICES; i++) {
+    for(uint16_t i=0; i<MAX_DEVICES; i++) {
       state = &DEVICE_PRESENCE[i];
 
       if(state->device == nullptr) {
@@ -453,6 +748,8 @@ static void vDeviceTask(void *ptx) {
 		vTaskDelay(DEVICE_MGMT_TASK_DELAY);
         STACK_STATS
         display_devices();
+        pipeline_stats_log();
+        http_pool_evict_idle();
         prune_devices();
     }
 }
@@ -0,0 +1,170 @@
+#include "iot-common.h"
+#include "esp_crc.h"
+#include "gzip.h"
+
+#define GZIP_MIN_MATCH      3
+#define GZIP_MAX_MATCH      258
+#define GZIP_WINDOW_MASK    (GZIP_WINDOW_SZ - 1)
+#define GZIP_HASH(p)        ((((p)[0] << 10) ^ ((p)[1] << 5) ^ (p)[2]) & (GZIP_HASH_SZ - 1))
+#define GZIP_END_OF_BLOCK   256
+
+// ID1, ID2, CM = deflate, FLG, MTIME, XFL, OS = unknown
+static const uint8_t GZIP_HEADER[] = { 0x1f, 0x8b, 0x08, 0x00, 0, 0, 0, 0, 0x00, 0xff };
+
+static const uint16_t LENGTH_BASE[] = {
+	3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+	35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+static const uint8_t LENGTH_EXTRA[] = {
+	0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+	3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+static const uint16_t DIST_BASE[] = {
+	1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+	257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+static const uint8_t DIST_EXTRA[] = {
+	0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+	7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+#define LENGTH_CODES    (sizeof(LENGTH_BASE) / sizeof(LENGTH_BASE[0]))
+#define DIST_CODES      (sizeof(DIST_BASE) / sizeof(DIST_BASE[0]))
+
+typedef struct gzip_bits {
+	uint8_t		*out;
+	size_t		size;
+	size_t		pos;
+	uint32_t	buf;
+	uint8_t		cnt;
+	uint8_t		overflow;
+} gzip_bits_t;
+
+// match finder state, positions are stored +1 so 0 is empty
+static uint16_t GZIP_HEAD[GZIP_HASH_SZ];
+static uint16_t GZIP_PREV[GZIP_WINDOW_SZ];
+
+static void gzip_put_bits(gzip_bits_t *bits, uint32_t value, uint8_t n) {
+	bits->buf |= (value << bits->cnt);
+	bits->cnt += n;
+	while(bits->cnt >= 8) {
+		if(bits->pos < bits->size) {
+			bits->out[bits->pos++] = bits->buf & 0xff;
+		} else {
+			bits->overflow = true;
+		}
+		bits->buf >>= 8;
+		bits->cnt -= 8;
+	}
+}
+
+/* Huffman codes are packed starting from their most significant bit */
+static void gzip_put_code(gzip_bits_t *bits, uint16_t code, uint8_t n) {
+	uint16_t rev = 0;
+	for(uint8_t i=0; i<n; i++) {
+		rev = (rev << 1) | (code & 1);
+		code >>= 1;
+	}
+	gzip_put_bits(bits, rev, n);
+}
+
+static void gzip_put_symbol(gzip_bits_t *bits, uint16_t sym) {
+	if(sym < 144) {
+		gzip_put_code(bits, 0x30 + sym, 8);
+	} else if(sym < 256) {
+		gzip_put_code(bits, 0x190 + (sym - 144), 9);
+	} else if(sym < 280) {
+		gzip_put_code(bits, sym - 256, 7);
+	} else {
+		gzip_put_code(bits, 0xc0 + (sym - 280), 8);
+	}
+}
+
+static void gzip_put_match(gzip_bits_t *bits, uint16_t len, uint16_t dist) {
+	uint8_t i = 0;
+	while(i < (LENGTH_CODES - 1) && LENGTH_BASE[i + 1] <= len) {
+		i++;
+	}
+	gzip_put_symbol(bits, 257 + i);
+	gzip_put_bits(bits, len - LENGTH_BASE[i], LENGTH_EXTRA[i]);
+
+	uint8_t d = 0;
+	while(d < (DIST_CODES - 1) && DIST_BASE[d + 1] <= dist) {
+		d++;
+	}
+	gzip_put_code(bits, d, 5);
+	gzip_put_bits(bits, dist - DIST_BASE[d], DIST_EXTRA[d]);
+}
+
+static void gzip_insert(const uint8_t *src, size_t pos) {
+	uint16_t hash = GZIP_HASH(src + pos);
+	GZIP_PREV[pos & GZIP_WINDOW_MASK] = GZIP_HEAD[hash];
+	GZIP_HEAD[hash] = pos + 1;
+}
+
+static uint16_t gzip_longest_match(const uint8_t *src, size_t pos, size_t len, uint16_t *dist) {
+	uint16_t best = 0;
+	size_t max = MIN(len - pos, (size_t)GZIP_MAX_MATCH);
+	uint16_t cand = GZIP_HEAD[GZIP_HASH(src + pos)];
+	for(uint8_t chain=0; cand && chain < GZIP_MAX_CHAIN; chain++) {
+		size_t prev = cand - 1;
+		// anything further back may have been overwritten in GZIP_PREV
+		if(pos - prev > GZIP_WINDOW_SZ) {
+			break;
+		}
+		uint16_t n = 0;
+		while(n < max && src[prev + n] == src[pos + n]) {
+			n++;
+		}
+		if(n > best) {
+			best = n;
+			*dist = pos - prev;
+			if(n == max) {
+				break;
+			}
+		}
+		cand = GZIP_PREV[prev & GZIP_WINDOW_MASK];
+	}
+	return best;
+}
+
+size_t gzip_compress(const void *in, size_t len, uint8_t *out, size_t size) {
+	const uint8_t *src = (const uint8_t*)in;
+	if(len > GZIP_MAX_INPUT || size < GZIP_OVERHEAD) {
+		return 0;
+	}
+	memset(GZIP_HEAD, 0, sizeof(GZIP_HEAD));
+	memcpy(out, GZIP_HEADER, sizeof(GZIP_HEADER));
+
+	// leave room for the trailer
+	gzip_bits_t bits = { out, size - 8, sizeof(GZIP_HEADER), 0, 0, false };
+	gzip_put_bits(&bits, 1, 1);		// BFINAL
+	gzip_put_bits(&bits, 1, 2);		// BTYPE: fixed Huffman codes
+
+	size_t pos = 0;
+	while(pos < len && !bits.overflow) {
+		uint16_t match = 0;
+		uint16_t dist = 0;
+		if(pos + GZIP_MIN_MATCH <= len) {
+			match = gzip_longest_match(src, pos, len, &dist);
+			gzip_insert(src, pos);
+		}
+		if(match < GZIP_MIN_MATCH) {
+			gzip_put_symbol(&bits, src[pos++]);
+			continue;
+		}
+		gzip_put_match(&bits, match, dist);
+		for(size_t end = pos + match; ++pos < end; ) {
+			if(pos + GZIP_MIN_MATCH <= len) {
+				gzip_insert(src, pos);
+			}
+		}
+	}
+	gzip_put_symbol(&bits, GZIP_END_OF_BLOCK);
+	if(bits.cnt) {
+		gzip_put_bits(&bits, 0, 8 - bits.cnt);
+	}
+	if(bits.overflow) {
+		return 0;
+	}
+
+	uint32_t trailer[2] = { esp_crc32_le(0, src, len), (uint32_t)len };
+	memcpy(out + bits.pos, trailer, sizeof(trailer));
+	return bits.pos + sizeof(trailer);
+}
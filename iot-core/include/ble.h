@@ -19,7 +19,11 @@
 
 #define BLE_PASSKEY            (122481UL)
 
-#define BLE_UPDATE_QUEUE_SZ    (6)
+#ifndef BLE_UPDATE_RING_SZ
+ #define BLE_UPDATE_RING_SZ    (16)
+#endif
+
+#define BLE_UPDATE_RING_MASK   (BLE_UPDATE_RING_SZ - 1)
 
 #define AUTH_INPUT_DELAY       (3500)
 
@@ -36,6 +40,106 @@
  #define BT_DEVICE_STACK_SZ     DEFAULT_STACK_SZ
 #endif
 
+#ifndef BT_CONN_WORKERS
+ #define BT_CONN_WORKERS        3
+#endif
+
+#define BT_CONN_QUEUE_SZ        (BT_CONN_WORKERS * 2)
+
+#ifndef BLE_SCAN_PAUSE_MS
+ #define BLE_SCAN_PAUSE_MS      1000
+#endif
+
+#define BLE_CONN_GATE_MS        ((BLE_CONNECT_TIMEOUT_SECS + 2) * 1000)
+
+/*
+ * With BLE_BEACONS defined, devices may deliver readings in advertisements
+ * instead of holding a connection.  The frame is carried in the service data
+ * of the device service UUID, or in manufacturer data after the 16 bit
+ * BLE_BEACON_COMPANY_ID (little endian):
+ *   [seq_hi, seq_lo] [sensor_id, type, val_hi, val_lo] * 1..BLE_BEACON_MAX_ENTRIES
+ * seq increments with every new reading and is repeated while the same
+ * frame is re-advertised.
+ */
+#ifndef BLE_BEACON_COMPANY_ID
+ #define BLE_BEACON_COMPANY_ID  0xffff
+#endif
+
+#define BLE_BEACON_MAX_ENTRIES  4
+#define BLE_BEACON_SEQ_SZ       2
+#define BLE_BEACON_ENTRY_SZ     4
+
+/* AD types the beacon frame is read from */
+#define BLE_AD_SVC_DATA16       0x16
+#define BLE_AD_SVC_DATA32       0x20
+#define BLE_AD_SVC_DATA128      0x21
+#define BLE_AD_MFG_DATA         0xff
+
+/* a sequence not seen for this long is accepted whatever its value,
+ * so a rebooted beacon is not locked out */
+#ifndef BLE_BEACON_SEQ_RESET_MS
+ #define BLE_BEACON_SEQ_RESET_MS    (10 * 60 * 1000)
+#endif
+
+/*
+ * Scan policies, as POLICY(name, interval ms, window ms, active scan),
+ * picked from the device registry every BLE_SCAN_POLICY_MS:
+ *   DISCOVER  known devices are missing or devices showed up recently
+ *   MAINTAIN  known devices are connected but new ones may show up, or
+ *             discovery with BLE_SCAN_LOAD_CONNS connections to serve
+ *   IDLE      known devices are connected and no new ones are accepted
+ */
+#ifndef BLE_SCAN_POLICIES
+ #define BLE_SCAN_POLICIES(POLICY)          \
+    POLICY(DISCOVER,  1349,  449,  true)    \
+    POLICY(MAINTAIN,  1349,  160,  true)    \
+    POLICY(IDLE,      5000,  100,  false)
+#endif
+
+#ifndef BLE_SCAN_ACTIVITY_MS
+ #define BLE_SCAN_ACTIVITY_MS   30000
+#endif
+
+#ifndef BLE_SCAN_LOAD_CONNS
+ #define BLE_SCAN_LOAD_CONNS    4
+#endif
+
+#define BLE_SCAN_POLICY_MS      5000
+#define BLE_SCAN_PERIOD_MS      60000
+
+#define BLE_SCAN_POLICY_ENUM(Name, interval, window, active)    SCAN_POLICY_##Name,
+
+/*
+ * Define ENABLE_GATT_CACHE to keep the attributes discovered on a connection
+ * for the reconnects of the same device.  The attribute tree of each device
+ * then stays in internal RAM for the life of its client, so the cache is
+ * off until a board shows it pays off, see iot-host/README.md.
+ */
+
+/*
+ * Cache of recently heard advertisers and what they turned out to be, so
+ * repeated advertisements skip the registry and service UUID checks.
+ * 12 bytes an entry, sized for a few hundred advertisers: once they
+ * outnumber the probe window, every lookup misses and costs more than no
+ * cache.  DISABLE_ADV_CACHE classifies every advertisement from scratch.
+ */
+#ifndef BLE_ADV_CACHE_SZ
+ #define BLE_ADV_CACHE_SZ       512
+#endif
+
+#define BLE_ADV_CACHE_MASK      (BLE_ADV_CACHE_SZ - 1)
+#ifndef BLE_ADV_CACHE_PROBE
+ #define BLE_ADV_CACHE_PROBE    4
+#endif
+
+#ifndef BLE_ADV_FOREIGN_TTL_MS
+ #define BLE_ADV_FOREIGN_TTL_MS 60000
+#endif
+
+#ifndef BLE_ADV_OURS_TTL_MS
+ #define BLE_ADV_OURS_TTL_MS    10000
+#endif
+
 #ifndef BT_QUEUE_STACK_SZ
  #define BT_QUEUE_STACK_SZ      (3 * 1024) 
 #endif
@@ -71,7 +175,10 @@
 #endif
 
 #define BLE_CONN_RESULT       { "failed", "success", }
-#define BLE_CONN_READY        ((1 << 24) - 1)
+
+#ifndef BLE_CONN_LOCK_MS
+ #define BLE_CONN_LOCK_MS      6000
+#endif
 
 #ifdef DISABLE_DYNAMIC_DEVICES 
  #define DISABLE_DEVICE_CREATION
@@ -170,9 +277,29 @@ typedef enum BLE_STATE {
 	BLE_READY    = (1 << 2),
 	BLE_STOP     = (1 << 3),
 	BLE_CONNECT  = (1 << 4),
+	BLE_PAUSED   = (1 << 5),
 	BLE_ALL      = 0xFF,
 } ble_state_t;
 
+/*!
+    @enum ble_scan_policy_t
+	@brief Scan duty cycle levels, see BLE_SCAN_POLICIES
+
+ */
+typedef enum BLE_SCAN_POLICY { BLE_SCAN_POLICIES(BLE_SCAN_POLICY_ENUM) SCAN_POLICY_MAX } ble_scan_policy_t;
+
+/*!
+    @enum ble_adv_class_t
+	@brief Classification of an advertiser in the advertisement cache
+
+ */
+typedef enum BLE_ADV_CLASS {
+	ADV_UNKNOWN,
+	ADV_OURS,
+	ADV_FOREIGN,
+	ADV_BACKOFF,
+} ble_adv_class_t;
+
 /*!
     @enum scan_filter_t
 	@brief Setting to specify HCI scan type
@@ -197,20 +324,6 @@ typedef enum BLE_DEVICE_CONFIG {
   BLE_DEVICE_CONFIG_MAX,
 } ble_device_config_t;
 
-/*!
-    @enum ble_device_status_t 
-	@brief BLE controller shared actions
-
-	Flags representing the current state of gloabl resources
-	as they pertain to device management tasks
- */
-typedef enum BLE_DEVICE_STATE {
-  DEVICE_NONE = 0,
-  DEVICE_BLE  = (1 << 0),
-  DEVICE_HTTP = (1 << 1),
-  DEVICE_ALL  = 0xFF,
-} ble_device_state_t;
-
 class SecureClient;
 
 /*!
@@ -233,10 +346,18 @@ class SecureClient {
 	public:
 	device_t				*device		= NULL;
 	BLEClient				*client		= NULL;
-	EventBits_t				mutexId		= -1;
+	uint16_t				lockId		= 0;
+	TimerHandle_t			timer		= NULL;
     volatile authstate_t	authstate 	= AUTH_NONE;
 	uint8_t					retries 	= 0; 
 	unsigned long int		attempted   = 0;
+	uint8_t					cached		= false;
+	uint8_t					cache_presence = false;
+	uint16_t				cache_version  = 0;
+	uint16_t				cache_hw_rev   = 0;
+	device_addr_t			cache_addr;
+	volatile int64_t		connected_at   = 0;
+	uint8_t					beacon         = false;
 	public:
 	SecureClient(device_t *);
 	void updateConnParams();
@@ -244,21 +365,37 @@ class SecureClient {
 	int getRssi();
 
 /*!
-    @brief Take connection semaphore
+    @brief Take connection lock
 
-	Exclusively operate on this connection handle
+	Exclusively operate on this connection handle.  The lock belongs to
+	the device slot and is recursive for the task holding it, waits up to
+	BLE_CONN_LOCK_MS.
     @return uint8_t 
  */
 	uint8_t		take();
 
 /*!
-    @brief Give back connection semaphore
+    @brief Give back connection lock
 
-	Release exclusive lock of this connection handle
-    @return uint8_t 
+	Release one level of the lock held by the calling task
+    @return uint8_t  false if another task holds the lock
  */
 	uint8_t		give();
 
+/*!
+    @brief Release the connection lock whoever holds it
+
+	Used when the connection went away under the lock holder
+ */
+	void		release();
+
+/*!
+    @brief Abort the connection without taking the lock
+
+	Disconnects the link, the lock holder sees the disconnect and cleans up.
+ */
+	void		abort();
+
 /*!
     @brief Initiate a connection with device
 
@@ -277,6 +414,22 @@ class SecureClient {
  */
 	uint8_t		configure();
 
+/*!
+    @brief Configure the device using the current GATT attributes
+
+	Uses the attributes kept from the last connection when `cached` is set,
+	which is rejected if the firmware version or hw revision changed.
+    @return uint8_t 
+ */
+	uint8_t		configureAttributes();
+
+/*!
+    @brief Drop the GATT attributes kept from the last connection
+
+	The next configure() runs a full service discovery.
+ */
+	void		invalidateCache();
+
 /*!
     @brief Close the BLE client connection
 
@@ -291,16 +444,111 @@ class SecureClient {
     @struct queue_entry_t 
 
 	Item representing a BLE notification callback, which we send
-	to a queue from the callback handler.
+	to a queue from the callback handler.  `ts` is the esp_timer
+	time the notification was received.
  */
 typedef struct queue_entry {
-	esp_bd_addr_t  device_id;
+	device_addr_t  addr;
 	uint32_t       data;
+	int64_t        ts;
 } queue_entry_t;
 
+/*!
+    @struct ble_ring_stats_t
+	@brief Counters of the notification ring
+
+	`overflow` counts entries lost to a full ring, either the oldest
+	(default) or the newest with BLE_UPDATE_RING_DROP_NEWEST.
+ */
+typedef struct ble_ring_stats {
+	uint16_t size;
+	uint16_t depth;
+	uint16_t high_water;
+	uint32_t overflow;
+} ble_ring_stats_t;
+
+/*!
+    @struct bt_conn_stats_t
+	@brief Counters of the connection workers
+
+	`all_connected_ms` is the time from boot until every known device was
+	connected at once, 0 until that happened.  `setup` holds the time from
+	the start of a connection until it was configured, `configure` the
+	GATT configuration alone and `first_notify` the time from connect to
+	the first notification, all in microseconds.  `cache_hits` counts
+	configurations done with the attributes of the last connection,
+	`lock_waits` / `lock_timeouts` contended connection lock takes.
+ */
+typedef struct bt_conn_stats {
+	uint8_t			workers;
+	uint8_t			in_flight;
+	uint8_t			peak_in_flight;
+	uint16_t		connected;
+	uint32_t		attempts;
+	uint32_t		failed;
+	uint32_t		all_connected_ms;
+	uint32_t		cache_hits;
+	uint32_t		cache_misses;
+	uint32_t		lock_waits;
+	uint32_t		lock_timeouts;
+	stats_hist_t	setup;
+	stats_hist_t	configure;
+	stats_hist_t	first_notify;
+} bt_conn_stats_t;
+
+/*!
+    @struct ble_beacon_stats_t
+	@brief Counters of advertisement ingestion
+
+	`duplicates` are frames with an already accepted seq, `replays` frames
+	with an older seq than the last accepted one.
+ */
+typedef struct ble_beacon_stats {
+	uint32_t frames;
+	uint32_t readings;
+	uint32_t duplicates;
+	uint32_t replays;
+	uint32_t invalid;
+	uint32_t unconfigured;
+} ble_beacon_stats_t;
+
+/*!
+    @struct ble_scan_stats_t
+	@brief Scan policy in use and the radio time spent scanning
+
+	`duty_permille` is the duty cycle of the current policy and
+	`avg_duty_permille` the share of time spent scanning since boot.
+	`policy_ms` is the time each policy was in use.
+ */
+typedef struct ble_scan_stats {
+	ble_scan_policy_t	policy;
+	const char			*name;
+	uint16_t			interval;
+	uint16_t			window;
+	uint8_t				active;
+	uint16_t			duty_permille;
+	uint16_t			avg_duty_permille;
+	uint32_t			changes;
+	uint32_t			policy_ms[SCAN_POLICY_MAX];
+} ble_scan_stats_t;
+
+/*!
+    @struct ble_adv_cache_stats_t
+	@brief Counters of the advertisement cache
+
+	`hits` are advertisements classified from the cache, `evictions`
+	live entries replaced before their time.
+ */
+typedef struct ble_adv_cache_stats {
+	uint16_t size;
+	uint32_t hits;
+	uint32_t misses;
+	uint32_t evictions;
+} ble_adv_cache_stats_t;
+
 extern const char *UUID_STRING[];
 
-typedef	void		(*bt_queue_handler_t)(BLEAddress*, uint32_t*);
+typedef	void		(*bt_queue_handler_t)(device_addr_t*, uint32_t*, int64_t);
 typedef	void		(*bt_conn_handler_t)(device_t*);
 typedef	void		(*bt_device_mgmt_init_t)();
 typedef void		(*ble_notify_cb_t)(BLERemoteCharacteristic*, uint8_t*, size_t, bool);
@@ -325,6 +573,48 @@ void	ble_parse_sensor_payload(sensor_data_entry_t*,  uint8_t*);
 */
 void	bt_set_queue_handler(bt_queue_handler_t);
 
+/*!
+    @brief Get the counters of the notification ring
+
+	Notifications are passed from the NimBLE host to bt_queue_mgr through
+	a lock-free ring of BLE_UPDATE_RING_SZ entries which never blocks the host.
+	@return ble_ring_stats_t
+ */
+ble_ring_stats_t	ble_update_ring_stats();
+
+/*!
+    @brief Get the counters of the connection workers
+
+	Up to BT_CONN_WORKERS devices are set up at once, each in its own phase
+	of device config, connect, authentication and GATT configuration.  Only
+	the GAP connect is serialized, scanning pauses for it and resumes right
+	after.
+	@return bt_conn_stats_t
+ */
+bt_conn_stats_t		bt_conn_stats();
+
+/*!
+    @brief Get the counters of advertisement ingestion
+
+	Always zero unless built with BLE_BEACONS.
+	@return ble_beacon_stats_t
+ */
+ble_beacon_stats_t	ble_beacon_stats();
+
+/*!
+    @brief Get the scan policy in use and the scan duty cycle
+
+	@return ble_scan_stats_t
+ */
+ble_scan_stats_t	ble_scan_stats();
+
+/*!
+    @brief Get the counters of the advertisement cache
+
+	@return ble_adv_cache_stats_t
+ */
+ble_adv_cache_stats_t	ble_adv_cache_stats();
+
 /*!
 	@brief Register callback for GAP 'on_connect' event
 
@@ -404,9 +694,9 @@ void      ble_init(ble_device_config_t config_mode=DEFAULT_BLE_SCAN_MODE);
 	@brief Used to pre-define a device in STATIC config
 
 	Chances are you'll only use this via `device_load_static_lic()`
-	@param device_id The device to create
+	@param addr The device to create
 */
-void    ble_add_static_device(device_id_t);
+void    ble_add_static_device(device_addr_t);
 
 /*!
     @brief Request the BLE device to provide update immediately
@@ -423,10 +713,11 @@ uint8_t   ble_request_attr_update(device_t*, uint8_t);
 	Handles incoming BLE payloads in their native format and
 	delivers them to the outgoing network after construct the
 	appropriate device_data_t structure
-	@param *addr BLEAddress from GATT payload
+	@param *addr device address from GATT payload
 	@param *data uint32_t value from GATT
+	@param ts capture time of the notification (esp_timer_get_time)
  */
-void	  ble_sensor_network_queue(BLEAddress*, uint32_t*);
+void	  ble_sensor_network_queue(device_addr_t*, uint32_t*, int64_t);
 
 /*!
     @brief Update the BLE UUID's we expect from a device
@@ -32,12 +32,20 @@
 
 #define DEVICE_MGMT_TASK_SZ     (3 * 1024)
 #define DEVICE_MGMT_TASK_DELAY  40000
+#define DEVICE_DISPLAY_BUF_SZ   (2048 + (MAX_DEVICES * 64))
 
 #ifndef DEVICE_TIMEOUT
  #define DEVICE_TIMEOUT          200000
 #endif
 
 #define DEVICE_ID_SZ	        18
+#define DEVICE_ADDR_SZ          6
+
+#ifndef PAYLOAD_POOL_SZ
+ #define PAYLOAD_POOL_SZ        16
+#endif
+
+#define PAYLOAD_POOL_WORDS      ((PAYLOAD_POOL_SZ + 31) / 32)
 
 #define SENSOR_SIZEOF   sizeof((sensor_t){ SENSOR_NONE, {}, {},  0, 0, 0, 0, })
 #define DEVICE_SIZEOF   sizeof((device_t){ 0, {}, { {}, {}, }, NULL, 0, 0, 0, })
@@ -51,6 +59,23 @@
  */
 typedef	char		device_id_t[DEVICE_ID_SZ];
 
+/*!
+    @struct device_addr_t
+    @brief Binary PHY address, the primary key of a device
+
+    Bytes are kept in display order (most significant first), the same
+    as esp_bd_addr_t.  Use device_addr_to_str() or DEVICE_ADDR_FMT when
+    a device_id_t string is needed.
+ */
+typedef struct device_addr {
+	uint8_t val[DEVICE_ADDR_SZ];
+} __attribute__((packed)) device_addr_t;
+
+#define DEVICE_ADDR_EQ(a, b)    (memcmp((a).val, (b).val, DEVICE_ADDR_SZ) == 0)
+#define DEVICE_ADDR_FMT         "%02x:%02x:%02x:%02x:%02x:%02x"
+#define DEVICE_ADDR_ARGS(a)     (a).val[0], (a).val[1], (a).val[2], \
+                                (a).val[3], (a).val[4], (a).val[5]
+
 class SecureClient;
 
 #define ACTION_STATE(STATE) \
@@ -78,6 +103,7 @@ typedef enum action { ACTION_STATE(ACTION_ENUM) } action_t;
     .version     = 0,                   \
     .hw_rev      = 0,                   \
     .device_id   = __id,                \
+    .addr        = { { 0, } },          \
 }
 
 /*!
@@ -93,7 +119,8 @@ typedef struct device {
 	unsigned long  last_seen;
 	uint16_t       version;
     uint16_t       hw_rev;
-	uint8_t        device_id;
+	uint16_t       device_id;
+	device_addr_t  addr;
 } device_t;
 
 /*!
@@ -116,19 +143,38 @@ typedef struct device_presence {
  */
 typedef struct devices {
     device_t **devices;
-    uint8_t num_devices = MAX_DEVICES;
+    uint16_t num_devices = MAX_DEVICES;
 } devices_t;
 
 /*!
     @struct devices_data_t
 	@brief Top level of a device update
 
+	`ts` is the monotonic capture time (esp_timer_get_time) of the update,
+	see network_time_epoch_ms() for wall clock time.
  */
 typedef struct device_data {
-  device_id_t			device_id;
+  device_addr_t			addr;
   sensor_multi_data_t	data;
+  int64_t				ts;
+#ifdef PIPELINE_STATS
+  uint32_t				ts_init;
+  uint32_t				ts_stage;
+#endif
 } device_data_t;
 
+/*!
+    @struct payload_pool_stats_t
+	@brief Usage counters of the device payload pool
+
+ */
+typedef struct payload_pool_stats {
+    uint16_t size;
+    uint16_t in_use;
+    uint16_t high_water;
+    uint32_t exhausted;
+} payload_pool_stats_t;
+
 /*!
     @fn device_update_cb_t
     @brief Callback to provide result of update
@@ -174,24 +220,37 @@ void    set_device_presence_cb(device_presence_cb_t);
 devices_t   get_devices();
 
 /*!
-    @brief Get a pointer to a sigle device by the device_id
+    @brief Get a pointer to a sigle device by its address
 
-    @return device_id
+    Lookups go through an open-addressed hash index of the in-use devices,
+    so the cost does not grow with MAX_DEVICES.
+    @param addr
+    @return device_t* ptr to the device or null
  */
-device_t*   get_device(device_id_t);
+device_t*   get_device(device_addr_t);
 
 /*!
     @brief Define a new device
 
-    Update the first device slot which is not currently in use this device_id
-    and return the pointer to the record.  Returns null if no slots available.
+    Take a free device slot from the free list, assign it this address and
+    return the pointer to the record.  Returns null if no slots available.
+    @param addr
     @return device_t* ptr to new device or null if not available
  */
-device_t*   create_device(device_id_t);
+device_t*   create_device(device_addr_t);
+
+/*!
+    @brief Get the number of device slots currently in use
+
+    @return uint16_t
+ */
+uint16_t    device_count();
 
 /*!
     @brief Clear the device record for the given device ptr
 
+    The slot is removed from the index and returned to the free list.
+
     @param device* device ptr
  */
 void    delete_device(device_t*);
@@ -207,13 +266,18 @@ void    delete_device(device_t*);
 void device_load_static_list(sensor_type_t sensor_type=SENSOR_NONE);
 
 /*!
-    @brief Allocate a new device payload from heap
-
-    @param device_id the device_id for the payload
+    @brief Allocate a new device payload from the payload pool
+
+    Payloads come from a fixed pool of PAYLOAD_POOL_SZ entries with inline
+    value/tag storage, so this never touches the heap and is safe to call
+    from any task.  Returns null if the pool is exhausted or num_entries
+    exceeds PAYLOAD_MAX_VALUES.  The capture
+    time is set to now, and may be overwritten with an earlier time.
+    @param addr the device address for the payload
     @param num_entries number of sensor entries to allocate
-    @return device_data_t* 
+    @return device_data_t* or null
  */
-device_data_t*  device_payload_init(const char*, uint8_t);
+device_data_t*  device_payload_init(device_addr_t, uint8_t);
 
 /*!
     @brief  Return a handle to a payload sensor entry by index
@@ -221,17 +285,25 @@ device_data_t*  device_payload_init(const char*, uint8_t);
     Retruns a handle for use with the sensor_payload_entry_*() calls
     @param payload a device payload
     @param idx the requested sensor data index we plan to update
-    @return sensor_data_entry_t
+    @return sensor_data_entry_t, with null pointers if idx is not an
+    allocated entry
  */
 sensor_data_entry_t device_payload_get_entry(device_data_t*, uint8_t);
 
 /*!
-    @brief Free heap memory allocation associated with a device payload
+    @brief Return a device payload to the payload pool
 
     @param payload
  */
 void    device_payload_free(device_data_t*);
 
+/*!
+    @brief Get usage counters of the payload pool
+
+    @return payload_pool_stats_t
+ */
+payload_pool_stats_t    device_payload_pool_stats();
+
 /*!
     @brief Schedule a device payload for async delivery
 
@@ -242,6 +314,16 @@ void    device_payload_free(device_data_t*);
  */
 void    device_process_payload(device_data_t*);
 
+/*!
+    @brief Deliver a processed payload to the handler of a single scope
+
+    Called from the network lane of each scope.  Runs the scope handler
+    followed by the update callback, which sees only this scope set.
+    @param scope a single update_scope_t bit
+    @param payload
+ */
+void    device_scope_update(update_scope_t, device_data_t*);
+
 /*!
     @brief Add a sensor to an existing device
 
@@ -263,12 +345,12 @@ void    device_enable_ble_presence();
 /*!
     @brief Craft an update on behalf of a device and queue for delivery
 
-    @param device_id 
+    @param addr 
     @param type sensor_type_t
     @param state  value
     @return uint8_t 
  */
-uint8_t device_send_update(const char*, sensor_type_t, uint16_t, uint8_t device_idx=0);
+uint8_t device_send_update(device_addr_t, sensor_type_t, uint16_t, uint8_t device_idx=0);
 
 /*!
     @brief set the BLE service to use on devices to BAS
@@ -283,6 +365,23 @@ void    device_enable_ble_bas();
  */
 void    device_init();
 
+/*!
+    @brief Format a device address as a device_id_t string
+
+    @param addr
+    @param buf destination string
+ */
+void    device_addr_to_str(const device_addr_t*, device_id_t);
+
+/*!
+    @brief Parse a device_id_t string into a device address
+
+    @param str "xx:xx:xx:xx:xx:xx" notation
+    @param addr destination address
+    @return uint8_t  evaluates boolean
+ */
+uint8_t device_addr_from_str(const char*, device_addr_t*);
+
 uint8_t device_payload_alloc_entry(device_data_t*);
 uint8_t device_update_needed(device_t*, uint16_t);
 
@@ -0,0 +1,47 @@
+#ifndef _GZIP_H_
+#define _GZIP_H_
+
+#include "iot-config.h"
+#include "iot-common.h"
+
+/*!
+    @file
+    @brief Small gzip encoder for request bodies
+
+    A single pass deflate encoder using the fixed Huffman codes and a
+    bounded match window, so it runs in a few KB of static memory.  It
+    favours the short, repetitive records of the InfluxDB line protocol
+    over general purpose compression.  Not thread safe.
+ */
+
+#ifndef GZIP_WINDOW_SZ
+ #define GZIP_WINDOW_SZ     1024
+#endif
+
+#ifndef GZIP_HASH_SZ
+ #define GZIP_HASH_SZ       512
+#endif
+
+#ifndef GZIP_MAX_CHAIN
+ #define GZIP_MAX_CHAIN     8
+#endif
+
+#define GZIP_MAX_INPUT      0xfffe
+#define GZIP_OVERHEAD       (10 + 8 + 2)
+
+static_assert((GZIP_WINDOW_SZ & (GZIP_WINDOW_SZ - 1)) == 0 && GZIP_WINDOW_SZ <= 32768,
+                "GZIP_WINDOW_SZ must be a power of 2, up to 32K");
+static_assert((GZIP_HASH_SZ & (GZIP_HASH_SZ - 1)) == 0, "GZIP_HASH_SZ must be a power of 2");
+
+/*!
+    @brief Compress a buffer into a gzip member
+
+    @param in
+    @param len up to GZIP_MAX_INPUT bytes
+    @param out
+    @param size size of out
+    @return size_t  length of the gzip data, or 0 if it did not fit in out
+ */
+size_t  gzip_compress(const void*, size_t, uint8_t*, size_t);
+
+#endif  // _GZIP_H_
@@ -24,12 +24,46 @@
 #endif
 
 #define INFLUX_ENDPOINT       "/write"
-#define INFLUX_PARAMS         "db=" INFLUX_DB_NAME
-#define INFLUX_BASE_QUERY     "%s,device_id=%s,sensor_id=%hhu"
+#define INFLUX_PARAMS         "db=" INFLUX_DB_NAME "&precision=ms"
+#define INFLUX_BASE_QUERY     "%s,device_id=" DEVICE_ADDR_FMT ",sensor_id=%hhu"
 
-#define INFLUX_QUERY_SZ       (100)
+#define INFLUX_TS_SZ          (21) /* " " + int64 ms epoch */
+#define INFLUX_QUERY_SZ       (128 + INFLUX_TS_SZ)
 #define INFLUX_HTTP_BUF_SZ    (150)
 #define INFLUX_QUEUE_TIMEOUT  (60000)
+#define INFLUX_QUEUE_SZ       (6)
+
+#ifndef INFLUX_BATCH_MAX_POINTS
+ #ifdef INFLUX_BATCH_BUF_SZ
+  #define INFLUX_BATCH_MAX_POINTS   INFLUX_BATCH_BUF_SZ
+ #else
+  #define INFLUX_BATCH_MAX_POINTS   1
+ #endif
+#endif
+
+#ifndef INFLUX_BATCH_MAX_AGE_MS
+ #define INFLUX_BATCH_MAX_AGE_MS    10000
+#endif
+
+#ifndef INFLUX_BATCH_RETRIES
+ #define INFLUX_BATCH_RETRIES       1
+#endif
+
+/* Define INFLUX_GZIP to compress request bodies, see gzip.h.  Bodies
+ * shorter than INFLUX_GZIP_MIN_SZ are sent as is: one point (~80 bytes)
+ * grows to 113%, two points (~160 bytes) shrink to 71%. */
+#ifndef INFLUX_GZIP_MIN_SZ
+ #define INFLUX_GZIP_MIN_SZ         128
+#endif
+
+#ifndef INFLUX_SPOOL_DRAIN_POINTS
+ #define INFLUX_SPOOL_DRAIN_POINTS  32
+#endif
+
+#define INFLUX_SPOOL_DRAIN_SZ     ((INFLUX_SPOOL_DRAIN_POINTS * INFLUX_QUERY_SZ) + 1)
+#define INFLUX_BATCH_SZ           ((INFLUX_BATCH_MAX_POINTS * INFLUX_QUERY_SZ) + 1)
+#define INFLUX_SHUTDOWN_TIMEOUT   (3000 / portTICK_PERIOD_MS)
+#define INFLUX_FLUSHED            (1 << 0)
 
 #ifndef INFLUX_QUEUE_STACK_SZ
  #define INFLUX_QUEUE_STACK_SZ  DEFAULT_STACK_SZ
@@ -38,6 +72,7 @@
 #define INFLUX_CLIENT_CONFIG(_local_buf)   \
 	{                                              \
 		.host = INFLUX_HOST,                       \
+		.port = INFLUX_PORT,                       \
 		.path = INFLUX_ENDPOINT,                   \
 		.query = INFLUX_PARAMS,                    \
 		.disable_auto_redirect = true,             \
@@ -48,15 +83,56 @@
 		.skip_cert_common_name_check = false,      \
 	}
 
+/*!
+    @struct influx_batch_stats_t
+	@brief Delivery counters of the InfluxDB batch writer
+
+	Points per request is `points / requests`.  `spooled` counts points
+	held in the flash spool (see spool.h) while the uplink was down.
+	`dropped` includes points that found the queue full.
+	`bytes` is the line protocol delivered and `bytes_sent` the request
+	bodies after compression, `compress_us` the time spent compressing.
+ */
+typedef struct influx_batch_stats {
+	uint32_t requests;
+	uint32_t points;
+	uint32_t failed;
+	uint32_t spooled;
+	uint32_t dropped;
+	uint32_t bytes;
+	uint32_t bytes_sent;
+	uint32_t compress_us;
+	uint16_t max_points;
+} influx_batch_stats_t;
+
 /*!
     @brief Schedule async update to InfluxDB
 
     Parse the payload and schedule updates, allowing the payload heap allocation
-    to be free'd immediately
+    to be free'd immediately.  Once the clock is synced by SNTP, points carry
+    the payload capture time in ms, otherwise InfluxDB stamps them on arrival.
     @param payload
  */
 void	influx_queue_payload(device_data_t *payload);
 
+/*!
+    @brief Deliver any batched points now
+
+    Points are written once INFLUX_BATCH_MAX_POINTS are pending or the oldest
+    is INFLUX_BATCH_MAX_AGE_MS old.  This forces an early write, and is called
+    from a shutdown handler so pending points survive a restart.
+    @param wait ticks to wait for the write to complete
+    @return uint8_t  evaluates boolean
+ */
+uint8_t	influx_flush(TickType_t);
+
+/*!
+    @brief Get the delivery counters of the batch writer
+
+    @return influx_batch_stats_t
+ */
+influx_batch_stats_t	influx_batch_stats();
+
 /*!	
     @brief Initialize the InfluxDB update queue and management task
 
@@ -0,0 +1,200 @@
+#ifndef _JSON_H_
+#define _JSON_H_
+
+#include "iot-config.h"
+#include "iot-common.h"
+
+/*!
+    @file
+    @brief Allocation free JSON writer and streaming tokenizer
+
+    The writer serializes straight into a caller supplied buffer, usually
+    on the stack or the outbound payload itself.  Keys are string literals
+    quoted at compile time by JSON_KEY().  Once the buffer is full the
+    writer stops, and json_writer_finish() reports the overflow instead of
+    leaving truncated JSON behind.
+
+    The tokenizer is fed a document in chunks of any size and reports each
+    token to a callback, so memory use is bounded by the parser struct no
+    matter how large the document is.
+ */
+
+#define JSON_MAX_DEPTH      32
+
+#ifndef JSON_VALUE_MAX
+ #define JSON_VALUE_MAX     64
+#endif
+
+#ifndef JSON_KEY_MAX
+ #define JSON_KEY_MAX       32
+#endif
+
+/*!
+    @struct json_writer_t
+    @brief State of a JSON writer
+
+    `items` holds one bit per nesting level, set once the current object or
+    array has a member, to place the separators.
+ */
+typedef struct json_writer {
+    char        *buf;
+    size_t      size;
+    size_t      len;
+    uint32_t    items;
+    uint8_t     depth;
+    uint8_t     after_key;
+    uint8_t     overflow;
+} json_writer_t;
+
+/*!
+    @brief Write a member key, which must be a string literal
+
+    @param writer
+    @param key
+ */
+#define JSON_KEY(writer, key)   json_write_key(writer, "\"" key "\":", sizeof("\"" key "\":") - 1)
+
+/*!
+    @brief Start writing to a buffer
+
+    @param writer
+    @param buf
+    @param size size of buf, including the terminating NUL
+ */
+void        json_writer_init(json_writer_t*, char*, size_t);
+
+/*!
+    @brief Check the document and NUL terminate it
+
+    @param writer
+    @return size_t  length of the document, or 0 if it overflowed the
+        buffer or has unclosed objects / arrays
+ */
+size_t      json_writer_finish(json_writer_t*);
+
+void        json_object_begin(json_writer_t*);
+void        json_object_end(json_writer_t*);
+void        json_array_begin(json_writer_t*);
+void        json_array_end(json_writer_t*);
+
+/*!
+    @brief Write a pre-quoted key, see JSON_KEY()
+
+    @param writer
+    @param quoted key including quotes and colon
+    @param len
+ */
+void        json_write_key(json_writer_t*, const char*, size_t);
+
+/*!
+    @brief Write a string value, escaping as needed
+
+    @param writer
+    @param str
+ */
+void        json_string(json_writer_t*, const char*);
+
+/*!
+    @brief Write a string value of up to len chars
+
+    Stops early at a NUL, for fixed size fields that may not be terminated.
+    @param writer
+    @param str
+    @param len
+ */
+void        json_string_n(json_writer_t*, const char*, size_t);
+
+void        json_int(json_writer_t*, int32_t);
+void        json_bool(json_writer_t*, uint8_t);
+void        json_null(json_writer_t*);
+
+/*!
+    @brief Write a value that is already serialized JSON
+
+    @param writer
+    @param json
+    @param len
+ */
+void        json_raw(json_writer_t*, const char*, size_t);
+
+/*!
+    @enum json_token_t
+    @brief Tokens reported by the streaming tokenizer
+
+ */
+typedef enum json_token {
+    JSON_TOK_OBJECT_BEGIN,
+    JSON_TOK_OBJECT_END,
+    JSON_TOK_ARRAY_BEGIN,
+    JSON_TOK_ARRAY_END,
+    JSON_TOK_KEY,
+    JSON_TOK_STRING,
+    JSON_TOK_NUMBER,
+    JSON_TOK_TRUE,
+    JSON_TOK_FALSE,
+    JSON_TOK_NULL,
+} json_token_t;
+
+typedef struct json_parser json_parser_t;
+
+/*!
+    @brief Token callback
+
+    `value` holds the text of keys, strings and numbers, unescaped and NUL
+    terminated.  The parser's `depth` is the nesting of the token (1 for
+    members of the root object or array) and `key` is the key of the
+    current member, or empty in arrays.
+ */
+typedef void (*json_token_cb_t)(json_parser_t*, json_token_t, const char*);
+
+/*!
+    @struct json_parser_t
+    @brief State of a streaming tokenizer
+
+    Keys and values longer than JSON_KEY_MAX / JSON_VALUE_MAX are cut
+    short and flag `truncated`, the document is still parsed.
+ */
+typedef struct json_parser {
+    json_token_cb_t cb;
+    void            *ctx;
+    char            key[JSON_KEY_MAX];
+    char            value[JSON_VALUE_MAX];
+    uint16_t        value_len;
+    uint16_t        unicode;
+    uint32_t        objects;
+    uint8_t         depth;
+    uint8_t         state;
+    uint8_t         is_key;
+    uint8_t         hex;
+    uint8_t         truncated;
+} json_parser_t;
+
+/*!
+    @brief Start parsing a new document
+
+    @param parser
+    @param cb callback for each token
+    @param ctx caller context, available as `parser->ctx`
+ */
+void        json_parser_init(json_parser_t*, json_token_cb_t, void*);
+
+/*!
+    @brief Feed the next chunk of the document
+
+    @param parser
+    @param buf
+    @param len
+    @return uint8_t  evaluates boolean, false on a syntax error
+ */
+uint8_t     json_parser_feed(json_parser_t*, const char*, size_t);
+
+/*!
+    @brief Check that a complete document was parsed
+
+    The root must be an object or an array.
+    @param parser
+    @return uint8_t  evaluates boolean
+ */
+uint8_t     json_parser_done(json_parser_t*);
+
+#endif  // _JSON_H_
@@ -15,7 +15,9 @@
 #include "esp_http_client.h"
 #include "freertos/event_groups.h"
 #include "freertos/queue.h"
+#include "freertos/semphr.h"
 #include "public-ca.h"
+#include "stats.h"
 
 /*!
     @file
@@ -33,6 +35,10 @@
 
 #define WIFI_CONNECTED_BIT      (1 << 0)
 
+#ifndef SNTP_SERVER
+ #define SNTP_SERVER            "pool.ntp.org"
+#endif
+
 #define PROV_TRANSPORT_SOFTAP   "softap"
 #define WIFI_AP_NAME            "ConnectThing"
 
@@ -44,17 +50,94 @@
  #define NET_TASK_PRIO           DEFAULT_TASK_PRIO
 #endif
 
+#ifndef NET_LANE_STACK_SZ
+ #define NET_LANE_STACK_SZ      (4 * 1024)
+#endif
+
+#ifndef NET_LANE_QUEUE_SZ
+ #define NET_LANE_QUEUE_SZ       4
+#endif
+
+#ifndef HTTP_POOL_MAX_CONN
+ #define HTTP_POOL_MAX_CONN     2
+#endif
+
+#ifndef HTTP_POOL_IDLE_MS
+ #define HTTP_POOL_IDLE_MS      30000
+#endif
+
+// an idle TLS connection holds ~40K, only keep one with room to spare
+#ifndef HTTP_POOL_MIN_HEAP
+ #define HTTP_POOL_MIN_HEAP     (48 * 1024)
+#endif
+
+#define HTTP_POOL_HOST_LEN      64
+#define HTTP_POOL_URL_LEN       256
+
+/* a wall clock before this was never set */
+#ifndef NETWORK_TIME_MIN_EPOCH
+ #define NETWORK_TIME_MIN_EPOCH 1609459200
+#endif
+
+#ifndef NET_STARVATION_LIMIT
+ #define NET_STARVATION_LIMIT   4
+#endif
+
 #define NET_UPDATE_QUEUE_SZ      8 
-#define NET_UPDATE_DELAY         50
 #define NET_QUEUE_NUM_TASKS      1
 #define NET_QUEUE_PRIO           NET_TASK_PRIO
 #define NET_QUEUE_TASK           "net_queue_task_%d"
+#define NET_LANE_TASK            "net_lane_%s"
 
 typedef struct device_data device_data_t;
 
+/*!
+    @enum net_prio_t
+	@brief Delivery priority of a payload
+
+	Interactive capabilities (see sensor_is_interactive()) are taken from
+	the network queue ahead of bulk telemetry.  After NET_STARVATION_LIMIT
+	interactive payloads in a row, a waiting bulk payload goes first.
+ */
+typedef enum net_prio {
+    NET_PRIO_INTERACTIVE,
+    NET_PRIO_BULK,
+    NET_PRIO_MAX
+} net_prio_t;
+
+/*!
+    @struct net_lane_stats_t
+	@brief Counters for one scope delivery lane
+
+	`latency` holds the time from capture until the lane handler returned,
+	for each net_prio_t.
+ */
+typedef struct net_lane_stats {
+    uint8_t  scope;
+    uint8_t  depth;
+    uint32_t queued;
+    uint32_t dropped;
+    stats_hist_t latency[NET_PRIO_MAX];
+} net_lane_stats_t;
+
+/*!
+    @struct http_pool_stats_t
+	@brief Reuse counters of the http_client connection pool
+
+	A hit reuses an open connection, a miss opens a new one.  Evictions
+	count pooled connections closed to make room or after HTTP_POOL_IDLE_MS.
+ */
+typedef struct http_pool_stats {
+    uint32_t hits;
+    uint32_t misses;
+    uint32_t evictions;
+    uint8_t  idle;
+    uint8_t  in_use;
+} http_pool_stats_t;
+
 typedef struct http_header {
-	char *key;
-	char *value;
+	const char *key;
+	const char *value;
 } http_header_t;
 
 typedef struct http_headers {
@@ -76,6 +159,8 @@ typedef struct http_client {
 	char buf[HTTP_CLIENT_BUF_LEN];
 	char *buf_ptr;
 	http_headers_t headers;
+	int8_t pool_slot;
+	uint8_t pool_hit;
 } http_client_t;
 
 typedef struct http_response {
@@ -84,10 +169,10 @@ typedef struct http_response {
 } http_response_t;
 
 typedef struct mdns_config {
-	char			*hostname;
-    char			*service;
-	char			*instance;
-	char			*proto;
+	const char		*hostname;
+    const char		*service;
+	const char		*instance;
+	const char		*proto;
 	uint16_t		port;
 	mdns_txt_item_t *service_txt;
 	uint8_t 		num_entries;
@@ -101,6 +186,32 @@ typedef HttpStatus_Code req_status_t;
  */
 void		wifi_connect();
 
+/*!
+    @brief start SNTP to discipline the wall clock
+
+    Called by wifi_connect() once connected, unless DISABLE_SNTP is defined.
+    Each sync updates the offset between esp_timer and unix time.
+ */
+void		network_time_init();
+
+/*!
+    @brief check if the wall clock has been set by SNTP
+
+    @return uint8_t  evaluates boolean
+ */
+uint8_t		network_time_synced();
+
+/*!
+    @brief convert a monotonic esp_timer_get_time() value to unix time
+
+    Until this boot's first SNTP sync, the wall clock the RTC kept across
+    a soft reset is used, if it is past NETWORK_TIME_MIN_EPOCH.
+
+    @param ts_us  esp_timer time in microseconds
+    @return int64_t  unix time in milliseconds, or 0 if the clock was never set
+ */
+int64_t		network_time_epoch_ms(int64_t);
+
 /*!
     @brief track errors for wifi clients to compare against threshold
 
@@ -123,7 +234,7 @@ http_client_t*	http_client_init(http_client_t*);
     @param http_client
     @param ca_pem PEM ASCII of the trusted CA
  */
-void		http_client_enable_ssl(http_client_t*, char*);
+void		http_client_enable_ssl(http_client_t*, const char*);
 
 /*!
     @brief set basic auth credentials for http client
@@ -141,7 +252,7 @@ void		http_client_set_auth(http_client_t*, char*, char*);
     @param key
     @param value
  */
-void		http_client_set_header(http_client_t*, char*, char*);
+void		http_client_set_header(http_client_t*, const char*, const char*);
 
 /*!
     @brief set http_client connection info (host/port)
@@ -167,7 +278,7 @@ void		http_client_set_post_data(http_client_t*, char*, size_t);
     @param http_client
     @param useragent
  */
-void		http_client_set_agent(http_client_t*, char*);
+void		http_client_set_agent(http_client_t*, const char*);
 
 /*!
     @brief set http_client query params as string
@@ -229,6 +340,22 @@ size_t		http_client_read(http_client_t*, char*, size_t);
  */
 esp_err_t	http_client_close(http_client_t*);
 
+/*!
+    @brief close pooled connections idle for more than HTTP_POOL_IDLE_MS
+
+    Requests made through http_client_get() / put() / post() reuse an idle
+    connection to the same host, port and CA, http_client_close() returns
+    it to the pool once the response has been read in full.
+ */
+void		http_pool_evict_idle();
+
+/*!
+    @brief get the reuse counters of the connection pool
+
+    @return http_pool_stats_t
+ */
+http_pool_stats_t	http_pool_stats();
+
 /*!
     @brief start tasks associated with the network queues
 
@@ -251,6 +378,35 @@ void		network_queue_init();
  */
 uint8_t		network_queue_payload(device_data_t*);
 
+/*!
+    @brief Fan a processed payload out to the lane of each of its scopes
+
+    Every scope (SCOPE_INFLUX, SCOPE_SMARTTHINGS, SCOPE_NOTIFY) has its own
+    bounded queue and worker, so a slow endpoint only backs up its own lane.
+    Each lane receives a copy, so the payload may be free'd on return.  This
+    never blocks: when a lane is full the update is dropped and counted.
+
+    @param payload
+    @return uint8_t number of lanes which accepted the payload
+ */
+uint8_t		network_dispatch_payload(device_data_t*);
+
+/*!
+    @brief Get the delivery priority of a payload
+
+    @param payload
+    @return net_prio_t
+ */
+net_prio_t	network_payload_prio(device_data_t*);
+
+/*!
+    @brief Get the counters of the delivery lane for a scope
+
+    @param scope a single update_scope_t bit
+    @return net_lane_stats_t 
+ */
+net_lane_stats_t	network_lane_stats(uint8_t);
+
 /*!
     @brief start mDNS services using config
 
@@ -3,7 +3,6 @@
 
 #include "iot-config.h"
 #include "iot-common.h"
-#include "NimBLEDevice.h"
 
 /*!
     @file
@@ -15,6 +14,10 @@
  #define MAX_SENSORS          2
 #endif
 
+#ifndef PAYLOAD_MAX_VALUES
+ #define PAYLOAD_MAX_VALUES   MAX_SENSORS
+#endif
+
 #define ADC_SCALING_FACTOR    3
 #define ADC_PRECISION         1024.0f
 #define ADC_REF_MV			  600.0f
@@ -49,6 +52,26 @@
     SENSOR(14, CURRENT,      INT_CUR)    \
 	SENSOR(255, INVALID,     INT_NONE)
 
+/*
+ * Change filters of the analog sensor types, as
+ *   FILTER(type, deadband, deadband %, min interval ms, heartbeat ms)
+ * A reading is reported once it moved by at least the larger of the two
+ * deadbands and min interval has passed, or when nothing was reported for
+ * heartbeat ms.  Unlisted types report every change, with FORCE_UPDATE_MS
+ * as heartbeat.  The SmartApp device config can override them per sensor.
+ */
+#ifndef SENSOR_FILTERS
+ #define SENSOR_FILTERS(FILTER)                                 \
+    FILTER(LIGHT,        8,  5,  5000,  FORCE_UPDATE_MS)        \
+    FILTER(HUMIDITY,     1,  2,  10000, FORCE_UPDATE_MS * 5)    \
+    FILTER(TEMPERATURE,  1,  1,  10000, FORCE_UPDATE_MS * 5)    \
+    FILTER(UV_LIGHT,     2,  5,  10000, FORCE_UPDATE_MS * 5)    \
+    FILTER(PARTICLES,    2,  5,  10000, FORCE_UPDATE_MS * 5)    \
+    FILTER(GASSES,       5,  5,  10000, FORCE_UPDATE_MS * 5)    \
+    FILTER(FORCE,        4,  2,  5000,  FORCE_UPDATE_MS)        \
+    FILTER(CURRENT,      2,  5,  5000,  FORCE_UPDATE_MS)
+#endif
+
 #define SENSOR_ENTRIES(id, type, iface)   SENSOR_ENTRY(id, type, iface),
 #define SENSOR_ENTRY(id, type, iface) \
     { (sensor_type_t)id, BUILD_STRING(type), iface, false, 0, 255, 0, }
@@ -64,6 +87,10 @@
 typedef enum sensor_type { SENSOR_TYPES(SENSOR_ENUM) } sensor_type_t;
 #define SENSOR_NONE   SENSOR_INVALID
 
+/* number of valid sensor types, SENSOR_INVALID excluded */
+#define SENSOR_TYPE_COUNT(_x, _y, _z)   + 1
+#define SENSOR_TYPE_CNT   ((0 SENSOR_TYPES(SENSOR_TYPE_COUNT)) - 1)
+
 #define PRESENCE_STATE(STATE) \
     STATE(PRESENT)            \
 	STATE(NOT_PRESENT)        \
@@ -191,6 +218,31 @@ typedef	uint8_t		sensor_idx_t;
 typedef	char		attribute_t[14];
 typedef char		tag_val_t[12];
 
+/*!
+	@struct sensor_filter_t
+    @brief Change filter of a sensor, see SENSOR_FILTERS
+
+	`custom` is set when the filter was configured for the sensor, otherwise
+	the default of its type applies.
+ */
+typedef struct sensor_filter {
+	uint16_t			deadband;
+	uint8_t				deadband_pct;
+	uint8_t				custom;
+	uint32_t			min_interval_ms;
+	uint32_t			heartbeat_ms;
+} sensor_filter_t;
+
+/*!
+	@struct sensor_filter_stats_t
+    @brief Readings reported and suppressed by the change filters
+
+ */
+typedef struct sensor_filter_stats {
+	uint32_t			passed;
+	uint32_t			suppressed;
+} sensor_filter_stats_t;
+
 typedef struct sensor_s {
 	sensor_type_t	    id;
     attribute_t			type;
@@ -199,6 +251,7 @@ typedef struct sensor_s {
 	uint16_t			state;
 	sensor_idx_t        device_idx;
 	unsigned long int	updatedAt;
+	sensor_filter_t		filter;
 } sensor_t;
 
 typedef enum sensor_data_type {
@@ -224,8 +277,8 @@ typedef struct sensor_multi_data {
 	sensor_type_t     type;
 	uint8_t           num_values;
     update_scopes_t	  scopes;
-	sensor_tag_t      *tags;
-	sensor_val_t      *values;
+	sensor_tag_t      tags[PAYLOAD_MAX_VALUES];
+	sensor_val_t      values[PAYLOAD_MAX_VALUES];
 } sensor_multi_data_t;
 
 typedef struct sensor_data_entry {
@@ -324,7 +377,48 @@ const	sensor_t*	sensor_get_by_type_name(attribute_t);
  */
 const	sensor_t*	sensor_get_by_type(sensor_type_t);
 
+/*!
+    @brief Get the default change filter of a sensor type
+
+    @param type
+    @return sensor_filter_t
+ */
+sensor_filter_t	sensor_filter_default(sensor_type_t);
+
+/*!
+    @brief Get the counters of the change filters
+
+    @return sensor_filter_stats_t
+ */
+sensor_filter_stats_t	sensor_filter_stats();
+
+/*!
+    @brief Check if a sensor type reports user facing state changes
+
+    Presence, contact and motion events are delivered ahead of bulk
+    telemetry, such as battery, light or particle readings.
+    @param type
+    @return uint8_t  evaluates boolean
+ */
+uint8_t			sensor_is_interactive(sensor_type_t);
+
+/*!
+    @brief Claim the next unused value/tag entry of a payload
+
+    Entries are stored inline in the payload, so this never allocates.
+    @param data one sensor slice from the device payload
+    @return uint8_t index of the entry, or PAYLOAD_MAX_VALUES if full
+ */
 uint8_t sensor_payload_alloc_entry(sensor_multi_data_t*);
+
+/*!
+    @brief Point the value entries of a copied payload at its own storage
+
+    Values keep a pointer to their inline storage, so a struct copy still
+    refers to the original payload until this is called on the copy.
+    @param data one sensor slice from the device payload
+ */
+void    sensor_payload_relink(sensor_multi_data_t*);
 sensor_data_entry_t sensor_payload_get_entry(sensor_multi_data_t*, uint8_t);
 void sensor_update_interface(sensor_type_t entry, interface_t interface);
 
@@ -5,14 +5,51 @@
 #include "iot-common.h"
 #include "network.h"
 #include "devices.h"
-#include "cJSON.h"
 #include "smartthings.h"
-#include "ble.h"
 
 #define ST_BODY_SZ          100
 #define ST_HTTP_BUF_SZ      150
 #define ST_QUEUE_TIMEOUT    30000
 #define ST_DEVICE_ENDPOINT  "/devices/"
+#define ST_READ_CHUNK_SZ    64
+
+/* pending events are keyed by device, sensor and type, an update to an
+ * unsent event overwrites its value in place.  Interactive events are sent
+ * first, see net_prio_t */
+#ifndef ST_PENDING_SZ
+ #define ST_PENDING_SZ      16
+#endif
+
+/* posts of one event before it is given up, counted per pending event; a
+ * failed batch counts as one post of each of its events */
+#ifndef ST_EVENT_ATTEMPTS
+ #define ST_EVENT_ATTEMPTS  2
+#endif
+
+/*
+ * Define ST_BATCH_EVENTS to collect events for up to ST_BATCH_WINDOW_MS and
+ * POST them as one array to ST_BATCH_ENDPOINT.  A batch holding an
+ * interactive event is sent without waiting out the window:
+ *
+ *   [{"device":"<id>-<sensor>","event":{...}}, ...]
+ *
+ * The SmartApp answers with an array of per-event status codes, in order.
+ * A 404 or 405 from the batch endpoint falls back to single events, a 5xx
+ * or a connection failure puts the events back in the pending table.
+ */
+#ifndef ST_BATCH_ENDPOINT
+ #define ST_BATCH_ENDPOINT  "/events"
+#endif
+
+#ifndef ST_BATCH_MAX_EVENTS
+ #define ST_BATCH_MAX_EVENTS    8
+#endif
+
+#ifndef ST_BATCH_WINDOW_MS
+ #define ST_BATCH_WINDOW_MS     500
+#endif
+
+#define ST_BATCH_BODY_SZ    ((ST_BATCH_MAX_EVENTS * (ST_PAYLOAD_SZ + 24)) + 3)
 
 #ifndef ST_QUEUE_STACK_SZ
  #define ST_QUEUE_STACK_SZ  DEFAULT_STACK_SZ
@@ -23,8 +60,48 @@
 typedef struct st_payload {
     char endpoint[DEVICE_ID_SZ+2];
     char body[ST_BODY_SZ];
+    uint8_t type;
+    uint8_t prio;
+    uint8_t attempts;
+    int64_t ts;
 } st_payload_t;
 
+/*!
+    @struct st_queue_stats_t
+    @brief Pending event table of the SmartApp update queue
+
+    `coalesced` counts updates that replaced the value of an unsent event,
+    `dropped` counts events refused because the table was full.
+ */
+typedef struct st_queue_stats {
+    uint8_t  pending;
+    uint8_t  high_water;
+    uint32_t coalesced;
+    uint32_t dropped;
+} st_queue_stats_t;
+
+/*!
+    @struct st_conn_stats_t
+    @brief Connection reuse of the SmartApp update queue
+
+    Requests that had to connect first (TCP + TLS handshake) are counted in
+    `handshakes`, their total time in `handshake_ms`.  Requests sent on an
+    open connection add to `reused_ms`.  With ST_BATCH_EVENTS, `batches`
+    and `batch_events` count batch requests and the events they carried.
+    `latency` holds the time from capture until the SmartApp accepted an
+    event, for each net_prio_t.
+ */
+typedef struct st_conn_stats {
+    uint32_t requests;
+    uint32_t handshakes;
+    uint32_t handshake_ms;
+    uint32_t reused_ms;
+    uint32_t batches;
+    uint32_t batch_events;
+    uint32_t events_rejected;
+    stats_hist_t latency[NET_PRIO_MAX];
+} st_conn_stats_t;
+
 typedef esp_http_client_method_t http_method_d;
 
 #define ST_CLIENT_CONFIG(_local_buf)   \
@@ -98,6 +175,20 @@ req_status_t	st_configure_device(device_t*);
  */
 uint8_t st_send_payload(device_data_t*);
 
+/*!
+    @brief  Get the connection reuse counters of the update queue
+
+    @return st_conn_stats_t
+ */
+st_conn_stats_t st_conn_stats();
+
+/*!
+    @brief  Get the counters of the pending event table
+
+    @return st_queue_stats_t
+ */
+st_queue_stats_t st_queue_stats();
+
 /*!
     @brief Register SmartApp callbacks
 
@@ -65,6 +65,6 @@ void		smartthings_init();
     involed requests.
     @return http_response_t 
  */
-http_response_t st_api_request(http_client_t*, esp_http_client_method_t, char*);
+http_response_t st_api_request(http_client_t*, esp_http_client_method_t, const char*);
 
 #endif /* SMARTTHINGS_H_ */
@@ -0,0 +1,127 @@
+#ifndef _SPOOL_H_
+#define _SPOOL_H_
+
+#include "iot-config.h"
+#include "iot-common.h"
+
+/*!
+    @file
+    @brief Flash backed store-and-forward log
+
+    An append-only log of small records kept in a dedicated data partition,
+    used to hold updates while the uplink is down.  The partition is split
+    into flash sectors used as a ring, oldest data is dropped when the ring
+    is full.  Add a data partition to the partition table to enable it:
+
+        spool,    data, 0x40,   ,  64K
+
+    Without the partition the spool stays disabled and every call is a no-op.
+    The spool is not thread safe, it should be owned by a single task.
+ */
+
+#ifndef SPOOL_PARTITION_LABEL
+ #define SPOOL_PARTITION_LABEL  "spool"
+#endif
+
+#ifndef SPOOL_MAX_SECTORS
+ #define SPOOL_MAX_SECTORS      16
+#endif
+
+#define SPOOL_SECTOR_SZ         SPI_FLASH_SEC_SIZE
+#define SPOOL_SECTOR_MAGIC      0x4c4f4f53
+#define SPOOL_RECORD_MAX        256
+
+/*!
+    @struct spool_cursor_t
+    @brief Position of a record in the spool
+
+ */
+typedef struct spool_cursor {
+    uint16_t sector;
+    uint16_t offset;
+} spool_cursor_t;
+
+/*!
+    @struct spool_stats_t
+    @brief Spool usage and wear counters
+
+ */
+typedef struct spool_stats {
+    uint16_t sectors;
+    uint32_t pending;
+    uint32_t written;
+    uint32_t drained;
+    uint32_t dropped;
+    uint32_t erase_min;
+    uint32_t erase_max;
+} spool_stats_t;
+
+/*!
+    @brief Open the spool partition and recover its state
+
+    Scans the sector headers and records to find the oldest undelivered
+    record and the append position.  Records torn by a reset while being
+    written are skipped.
+    @return uint8_t  evaluates boolean, false if there is no spool partition
+ */
+uint8_t         spool_init();
+
+/*!
+    @brief Check if a spool partition is available
+
+    @return uint8_t  evaluates boolean
+ */
+uint8_t         spool_enabled();
+
+/*!
+    @brief Append a record to the spool
+
+    When the spool is full the oldest sector is erased and its undelivered
+    records are counted as dropped.
+    @param data
+    @param len up to SPOOL_RECORD_MAX bytes
+    @return uint8_t  evaluates boolean
+ */
+uint8_t         spool_append(const void*, uint16_t);
+
+/*!
+    @brief Get the number of undelivered records
+
+    @return uint32_t
+ */
+uint32_t        spool_pending();
+
+/*!
+    @brief Get a cursor at the oldest undelivered record
+
+    @return spool_cursor_t
+ */
+spool_cursor_t  spool_cursor();
+
+/*!
+    @brief Read the record at the cursor and advance it
+
+    Does not remove the record, see spool_consume().
+    @param cursor
+    @param buf
+    @param size size of buf
+    @param len length of the record read
+    @return uint8_t  evaluates boolean, false when no records remain
+ */
+uint8_t         spool_next(spool_cursor_t*, void*, uint16_t, uint16_t*);
+
+/*!
+    @brief Mark all records before the cursor as delivered
+
+    @param cursor a cursor advanced by spool_next()
+ */
+void            spool_consume(const spool_cursor_t*);
+
+/*!
+    @brief Get spool usage and wear counters
+
+    @return spool_stats_t
+ */
+spool_stats_t   spool_stats();
+
+#endif  // _SPOOL_H_
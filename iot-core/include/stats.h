@@ -0,0 +1,113 @@
+#ifndef _STATS_H_
+#define _STATS_H_
+
+#include "iot-config.h"
+#include "iot-common.h"
+
+/*!
+    @file
+    @brief Lightweight latency histograms and payload pipeline statistics
+
+ */
+
+#define STATS_HIST_BUCKETS      24
+
+#ifndef PIPELINE_STATS_LOG_MS
+ #define PIPELINE_STATS_LOG_MS  60000
+#endif
+
+#define PIPELINE_STAGES(STAGE)  \
+    STAGE(QUEUE)                \
+    STAGE(PROCESS)              \
+    STAGE(INFLUX)               \
+    STAGE(ST)                   \
+    STAGE(NOTIFY)               \
+    STAGE(TOTAL)
+
+#define PIPELINE_ENUM(Name)     PIPE_##Name,
+
+/*!
+    @enum pipeline_stage_t
+    @brief Measured sections of the payload pipeline
+
+    QUEUE is the wait in the network queue, PROCESS is sensor processing up
+    to lane dispatch, INFLUX / ST / NOTIFY run from dispatch until the scope
+    handler returns, and TOTAL runs from payload init to the last handler.
+ */
+typedef enum pipeline_stage { PIPELINE_STAGES(PIPELINE_ENUM) PIPE_MAX } pipeline_stage_t;
+
+/*!
+    @struct stats_hist_t
+    @brief Histogram of microsecond samples in power of 2 buckets
+
+    Bucket N counts samples in [2^N, 2^(N+1)) us, bucket 0 also holds 0.
+    Updates are atomic, so one histogram may be fed from several tasks.
+ */
+typedef struct stats_hist {
+    volatile uint32_t count;
+    volatile uint32_t max;
+    volatile uint32_t buckets[STATS_HIST_BUCKETS];
+} stats_hist_t;
+
+#ifdef PIPELINE_STATS
+ #define PIPELINE_NOW               ((uint32_t)esp_timer_get_time())
+ #define PIPELINE_STAMP(ts)         (ts) = PIPELINE_NOW
+ #define PIPELINE_RECORD(stage, ts) pipeline_stats_record(stage, PIPELINE_NOW - (ts))
+#else
+ #define PIPELINE_STAMP(ts)
+ #define PIPELINE_RECORD(stage, ts)
+#endif
+
+/*!
+    @brief Add a sample to a histogram
+
+    @param hist
+    @param us sample in microseconds
+ */
+void        stats_hist_add(stats_hist_t*, uint32_t);
+
+/*!
+    @brief Estimate a percentile from a histogram
+
+    Returns the upper bound of the bucket holding the percentile, so the
+    result is within a factor of 2 of the true value.
+    @param hist
+    @param pct percentile 1-100
+    @return uint32_t  microseconds, or 0 when empty
+ */
+uint32_t    stats_hist_percentile(const stats_hist_t*, uint8_t);
+
+/*!
+    @brief Clear all samples of a histogram
+
+    @param hist
+ */
+void        stats_hist_reset(stats_hist_t*);
+
+/*!
+    @brief Record a latency sample for a pipeline stage
+
+    Use the PIPELINE_STAMP() / PIPELINE_RECORD() macros, which compile out
+    unless PIPELINE_STATS is defined.
+    @param stage
+    @param us
+ */
+void        pipeline_stats_record(pipeline_stage_t, uint32_t);
+
+/*!
+    @brief Log pipeline throughput, per-stage latency and heap usage
+
+    Logs at most once every PIPELINE_STATS_LOG_MS, then starts a new window.
+ */
+void        pipeline_stats_log();
+
+/*!
+    @brief Copy the pipeline histograms and start new ones
+
+    For benchmarks that read the stage latencies directly rather than
+    through pipeline_stats_log().
+    @param hists PIPE_MAX histograms, indexed by pipeline_stage_t
+ */
+void        pipeline_stats_take(stats_hist_t*);
+
+#endif  // _STATS_H_
@@ -1,84 +1,289 @@
 #include "iot-common.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/queue.h"
+#include "freertos/event_groups.h"
 #include "network.h"
 #include "influx.h"
+#include "spool.h"
+#include "gzip.h"
+#include <inttypes.h>
 
 static const char *TAG = "influx";
 
-static QueueHandle_t xInfluxQueue = NULL;
+static QueueHandle_t       xInfluxQueue = NULL;
+static EventGroupHandle_t  xInfluxState = NULL;
+static TaskHandle_t        xInfluxTask  = NULL;
+
+typedef struct influx_batch {
+	char				body[INFLUX_BATCH_SZ];
+	size_t				len;
+	uint16_t			points;
+	unsigned long int	ts;
+} influx_batch_t;
+
+static influx_batch_t		INFLUX_BATCH;
+static influx_batch_stats_t	influx_stats;
+static char					*influx_drain_buf	= NULL;
+static uint8_t				influx_uplink_ok	= true;
+// points the queue had no room for, counted by the producers
+static uint32_t				influx_queue_dropped = 0;
+
+#ifdef INFLUX_GZIP
+static uint8_t				INFLUX_GZIP_BUF[MAX(INFLUX_BATCH_SZ, INFLUX_SPOOL_DRAIN_SZ)];
+#endif
+
+static uint8_t influx_batch_post(esp_http_client_handle_t *client, esp_http_client_config_t *config,
+									const char *body, size_t len, uint8_t *retry) {
+	if(*client == nullptr) {
+		*client = esp_http_client_init(config);
+		esp_http_client_set_method(*client, HTTP_METHOD_POST);
+		esp_http_client_set_header(*client, "Content-Type", "text/plain; charset=utf-8");
+	}
+	const char *data = body;
+	size_t data_len = len;
+#ifdef INFLUX_GZIP
+	size_t gz_len = 0;
+	uint32_t compress_us = 0;
+	// a single point only grows, the gzip framing alone is 18 bytes
+	if(len >= INFLUX_GZIP_MIN_SZ) {
+		int64_t start = esp_timer_get_time();
+		gz_len = gzip_compress(body, len, INFLUX_GZIP_BUF, sizeof(INFLUX_GZIP_BUF));
+		compress_us = esp_timer_get_time() - start;
+	}
+	// fall back to plain text when the compressed body doesn't fit
+	if(gz_len && gz_len < len) {
+		data = (const char*)INFLUX_GZIP_BUF;
+		data_len = gz_len;
+		esp_http_client_set_header(*client, "Content-Encoding", "gzip");
+	} else {
+		esp_http_client_delete_header(*client, "Content-Encoding");
+	}
+	LOGD("compressed %d -> %d bytes in %d us", len, data_len, compress_us);
+#endif
+	esp_http_client_set_post_field(*client, data, data_len);
+	esp_err_t err = esp_http_client_perform(*client);
+	if(err != ESP_OK) {
+		LOGW("failed to write influx data: resp_code: 0x%04x", err);
+		*retry = true;
+		return false;
+	}
+	int status = esp_http_client_get_status_code(*client);
+	if(status / 100 != 2) {
+		LOGW("influx write rejected: status: %d", status);
+		// a 4xx means the points themselves are bad, sending them again won't help
+		*retry = (status / 100 == 5);
+		return false;
+	}
+	influx_stats.bytes += len;
+	influx_stats.bytes_sent += data_len;
+#ifdef INFLUX_GZIP
+	influx_stats.compress_us += compress_us;
+#endif
+	return true;
+}
+
+static void influx_stats_delivered(uint16_t points) {
+	influx_stats.requests++;
+	influx_stats.points += points;
+	influx_stats.max_points = MAX(influx_stats.max_points, points);
+}
+
+/* hold the points of a batch that could not be delivered in the spool */
+static uint8_t influx_batch_spool(influx_batch_t *batch) {
+	uint16_t spooled = 0;
+	char *line = batch->body;
+	char *end;
+	while((end = strchr(line, '\n')) != NULL) {
+		if(spool_append(line, end - line)) {
+			spooled++;
+		}
+		line = end + 1;
+	}
+	LOGW("uplink down: spooled %d/%d points", spooled, batch->points);
+	influx_stats.spooled += spooled;
+	influx_stats.dropped += (batch->points - spooled);
+	return (spooled > 0);
+}
+
+static void influx_batch_flush(esp_http_client_handle_t *client, esp_http_client_config_t *config) {
+	influx_batch_t *batch = &INFLUX_BATCH;
+	uint8_t err_cnt = 0;
+	uint8_t retry = false;
+	uint8_t spooled = false;
+	// while the uplink is down, spool right away instead of stalling on retries
+	uint8_t retries = (spool_enabled() && !influx_uplink_ok) ? 0 : INFLUX_BATCH_RETRIES;
+
+	LOGD("delivering influx batch: %d points / %d bytes", batch->points, batch->len);
+	for(uint8_t attempt=0; attempt <= retries; attempt++) {
+		if(attempt) {
+			LOGI("will try batch again (%d/%d)..", attempt, retries);
+			vTaskDelay(DELAY_S5);
+		}
+		if(influx_batch_post(client, config, batch->body, batch->len, &retry)) {
+			influx_stats_delivered(batch->points);
+			influx_uplink_ok = true;
+			break;
+		}
+		esp_http_client_cleanup(*client);
+		*client = nullptr;
+		err_cnt++;
+		if(!retry || attempt == retries) {
+			influx_stats.failed++;
+			if(retry) {
+				influx_uplink_ok = false;
+			}
+			spooled = retry && influx_batch_spool(batch);
+			if(!spooled) {
+				LOGE("giving up on influx batch: dropped %d points", batch->points);
+				influx_stats.dropped += batch->points;
+			}
+			break;
+		}
+	}
+	// nothing is lost once the batch is spooled, so an outage does not reset
+	if(!spooled) {
+		wifi_err_check(err_cnt);
+	}
+
+	batch->len = 0;
+	batch->points = 0;
+	batch->body[0] = '\0';
+}
+
+static void influx_batch_add(const char *query, esp_http_client_handle_t *client, esp_http_client_config_t *config) {
+	influx_batch_t *batch = &INFLUX_BATCH;
+	size_t len = strnlen(query, INFLUX_QUERY_SZ - 1);
+
+	if(batch->points && (batch->len + len + 2) > INFLUX_BATCH_SZ) {
+		influx_batch_flush(client, config);
+	}
+	if(batch->points == 0) {
+		batch->ts = MILLIS;
+	}
+	memcpy(batch->body + batch->len, query, len);
+	batch->len += len;
+	batch->body[batch->len++] = '\n';
+	batch->body[batch->len] = '\0';
+	batch->points++;
+
+	if(batch->points >= INFLUX_BATCH_MAX_POINTS) {
+		influx_batch_flush(client, config);
+	}
+}
+
+/* deliver one batch of spooled points, oldest first */
+static void influx_spool_drain(esp_http_client_handle_t *client, esp_http_client_config_t *config) {
+	if(influx_drain_buf == NULL) {
+		return;
+	}
+	spool_cursor_t cursor = spool_cursor();
+	uint16_t points = 0;
+	uint16_t rec_len;
+	size_t len = 0;
+	uint8_t retry = false;
+
+	while(points < INFLUX_SPOOL_DRAIN_POINTS && (len + INFLUX_QUERY_SZ + 1) <= INFLUX_SPOOL_DRAIN_SZ &&
+			spool_next(&cursor, influx_drain_buf + len, INFLUX_QUERY_SZ, &rec_len)) {
+		len += rec_len;
+		influx_drain_buf[len++] = '\n';
+		points++;
+	}
+	if(points == 0) {
+		return;
+	}
+
+	LOGI("draining spool: %d points / %d bytes (%d pending)", points, len, spool_pending());
+	if(influx_batch_post(client, config, influx_drain_buf, len, &retry)) {
+		influx_stats_delivered(points);
+		influx_uplink_ok = true;
+		spool_consume(&cursor);
+		wifi_err_check(0);
+		return;
+	}
+	esp_http_client_cleanup(*client);
+	*client = nullptr;
+	influx_stats.failed++;
+	if(!retry) {
+		LOGE("spooled points rejected: dropped %d points", points);
+		influx_stats.dropped += points;
+		spool_consume(&cursor);
+		return;
+	}
+	// the points stay in the spool, an outage does not count toward a reset
+	influx_uplink_ok = false;
+}
+
+static TickType_t influx_batch_wait() {
+	if(INFLUX_BATCH.points == 0) {
+		if(influx_uplink_ok && spool_pending()) {
+			return 0;
+		}
+		return INFLUX_QUEUE_TIMEOUT;
+	}
+	unsigned long int age = MILLIS - INFLUX_BATCH.ts;
+	if(age >= INFLUX_BATCH_MAX_AGE_MS) {
+		return 0;
+	}
+	return (INFLUX_BATCH_MAX_AGE_MS - age) / portTICK_PERIOD_MS;
+}
 
 static void influx_queue_task(void *ptx) {
-    xInfluxQueue = xQueueCreate(6, INFLUX_QUERY_SZ);
 	char query[INFLUX_QUERY_SZ];
-	char *body = (char*)query;
-
 	char http_resp_buf[INFLUX_HTTP_BUF_SZ];
-	uint8_t err_cnt = 0;
-	esp_err_t err;
 
 	esp_http_client_config_t config = INFLUX_CLIENT_CONFIG(http_resp_buf);
 	esp_http_client_handle_t client = nullptr;
-	uint8_t is_retry = false;
-
-#ifdef INFLUX_BATCH_BUF_SZ
-	body = (char*)calloc(INFLUX_HTTP_BUF_SZ, INFLUX_BATCH_BUF_SZ);
-#endif
 
     for(;;) {
         STACK_STATS
-		memset((void*)query, 0, INFLUX_QUERY_SZ);
-		if(xQueueReceive(xInfluxQueue, (void*)query, INFLUX_QUEUE_TIMEOUT) != pdTRUE) {
-			if(client != nullptr) {
+		if(xQueueReceive(xInfluxQueue, (void*)query, influx_batch_wait()) != pdTRUE) {
+			if(INFLUX_BATCH.points) {
+				LOGD("influx batch reached max age");
+				influx_batch_flush(&client, &config);
+			} else if(spool_pending()) {
+				// also probes the uplink while it is down
+				influx_spool_drain(&client, &config);
+			} else if(client != nullptr) {
 				esp_http_client_cleanup(client);
 				client = nullptr;
 			}
 			continue;
 		}
 
-#ifdef INFLUX_BATCH_BUF_SZ
-		LOGI("batching influx event to buffer");
-		strncat(body, query, INFLUX_QUERY_SZ);
-		strcat(body, "\n");
-		if(strlen(body) < (INFLUX_BATCH_BUF_SZ-1) * INFLUX_QUERY_SZ) {
+		// an empty query is a flush request from influx_flush()
+		if(query[0] == '\0') {
+			if(INFLUX_BATCH.points) {
+				influx_batch_flush(&client, &config);
+			}
+			xEventGroupSetBits(xInfluxState, INFLUX_FLUSHED);
 			continue;
 		}
-		LOGI("delivering batched influx payload (%d bytes):", strlen(body));
-		LOGI("%s", body);
-#endif
+		influx_batch_add(query, &client, &config);
+	}
+}
 
-		if(client == nullptr) {
- 			client = esp_http_client_init(&config);
-    		esp_http_client_set_method(client, HTTP_METHOD_POST);
-    		esp_http_client_set_header(client, "Content-Type", "application/json");
-		}
-    	esp_http_client_set_post_field(client, body, strlen(body));
-	    err = esp_http_client_perform(client);
-    	if (err == ESP_OK) {
-            esp_http_client_get_status_code(client);
-            esp_http_client_get_content_length(client);
-			is_retry = false;
-		} else {
-			LOGW("failed to write influx data: resp_code: 0x%04x", err);
-			esp_http_client_cleanup(client);
-			client = nullptr;
-			err_cnt++;
-			if(is_retry) {
-				is_retry = false;
-				LOGE("max retries reached: giving up on this message");
-			} else {
-				is_retry = true;
-				LOGI("will try again once more..");
-				xQueueSendToFront(xInfluxQueue, (void*)query, DELAY_S4);
-				vTaskDelay(DELAY_S5);
-			}
-		}
-		wifi_err_check(err_cnt);
-		err_cnt = 0;
-#ifdef INFLUX_BATCH_BUF_SZ
-		memset(body, 0, 1);
-#endif
+static void influx_shutdown_handler() {
+	influx_flush(INFLUX_SHUTDOWN_TIMEOUT);
+}
+
+uint8_t influx_flush(TickType_t wait) {
+	// the writer itself (via wifi_err_check) can't wait on its own flush
+	if(!xInfluxQueue || xTaskGetCurrentTaskHandle() == xInfluxTask) {
+		return false;
 	}
+	char query[INFLUX_QUERY_SZ] = { 0 };
+	xEventGroupClearBits(xInfluxState, INFLUX_FLUSHED);
+	// queued behind any pending points, so those are written as well
+	if(xQueueSend(xInfluxQueue, (void*)query, wait) != pdTRUE) {
+		return false;
+	}
+	return (xEventGroupWaitBits(xInfluxState, INFLUX_FLUSHED, true, true, wait) & INFLUX_FLUSHED);
+}
+
+influx_batch_stats_t influx_batch_stats() {
+	influx_batch_stats_t stats = influx_stats;
+	stats.dropped += __atomic_load_n(&influx_queue_dropped, __ATOMIC_RELAXED);
+	return stats;
 }
 
 void influx_queue_payload(device_data_t *payload) {
@@ -91,29 +296,49 @@ void influx_queue_payload(device_data_t *payload) {
 	sensor_type_get_name(payload->data.type, sensor_name);
 
 	char query[INFLUX_QUERY_SZ];
-	int pos = sprintf(query, INFLUX_BASE_QUERY, sensor_name,
-												payload->device_id,
+	size_t len = sizeof(query);
+	size_t pos = snprintf(query, len, INFLUX_BASE_QUERY, sensor_name,
+												DEVICE_ADDR_ARGS(payload->addr),
 												payload->data.sensor_id);
 
-	for(uint8_t i=0; i < payload->data.num_values; i++) {
+	for(uint8_t i=0; i < payload->data.num_values && pos < len; i++) {
 		if(strlen(payload->data.tags[i].key)) {
-			pos += sprintf(query + pos, ",%s=%s", payload->data.tags[i].key,
+			pos += snprintf(query + pos, len - pos, ",%s=%s", payload->data.tags[i].key,
 												payload->data.tags[i].val);
 		}
 	}
 
-	query[pos++] = ' ';
+	for(uint8_t i=0; i<payload->data.num_values && pos < len; i++) {
+		sensor_val_t val = payload->data.values[i];
+		pos += snprintf(query + pos, len - pos, "%c%s=%d", (i ? ',' : ' '), val.attribute, val.u16);
+	}
+
+	int64_t ts = network_time_epoch_ms(payload->ts);
+	if(ts && pos < len) {
+		pos += snprintf(query + pos, len - pos, " %" PRId64, ts);
+	}
 
-	for(uint8_t i=0; i<payload->data.num_values; i++) {
-    	sensor_val_t val = payload->data.values[i];
-		pos += sprintf(query+pos, "%s=%d,", val.attribute, val.u16);
+	if(pos >= len) {
+		LOGE("influx point exceeds %d bytes: dropped: %.*s", INFLUX_QUERY_SZ, 32, query);
+		return;
 	}
-	query[pos-1] = '\0';
 
 	LOGI("influx(POST): %s", query);
-	xQueueSend(xInfluxQueue, (void*)query, DELAY_S4);
+	if(xQueueSend(xInfluxQueue, (void*)query, DELAY_S4) != pdTRUE) {
+		LOGE("influx queue full: dropped: %.*s", 32, query);
+		__atomic_add_fetch(&influx_queue_dropped, 1, __ATOMIC_RELAXED);
+	}
 }
 
 void influx_queue_init() {
-	xTaskCreatePinnedToCore(influx_queue_task, "influx_queue", INFLUX_QUEUE_STACK_SZ, NULL, NET_QUEUE_PRIO, NULL, 1);
+	xInfluxQueue = xQueueCreate(INFLUX_QUEUE_SZ, INFLUX_QUERY_SZ);
+	xInfluxState = xEventGroupCreate();
+	if(spool_init()) {
+		influx_drain_buf = (char*)malloc(INFLUX_SPOOL_DRAIN_SZ);
+		if(influx_drain_buf == NULL) {
+			LOGE("failed to allocate spool drain buffer: spool disabled");
+		}
+	}
+	xTaskCreatePinnedToCore(influx_queue_task, "influx_queue", INFLUX_QUEUE_STACK_SZ, NULL, NET_QUEUE_PRIO, &xInfluxTask, 1);
+	esp_register_shutdown_handler(influx_shutdown_handler);
 }
@@ -0,0 +1,414 @@
+#include "iot-common.h"
+#include "json.h"
+
+static void json_put(json_writer_t *writer, const char *str, size_t len) {
+	if(writer->overflow || (writer->len + len) >= writer->size) {
+		writer->overflow = true;
+		return;
+	}
+	memcpy(writer->buf + writer->len, str, len);
+	writer->len += len;
+}
+
+static void json_putc(json_writer_t *writer, char c) {
+	json_put(writer, &c, 1);
+}
+
+/* separate a new member from the previous one, unless it follows a key */
+static void json_member(json_writer_t *writer) {
+	if(writer->after_key) {
+		writer->after_key = false;
+		return;
+	}
+	uint32_t bit = (1UL << writer->depth);
+	if(writer->items & bit) {
+		json_putc(writer, ',');
+	}
+	writer->items |= bit;
+}
+
+static void json_open(json_writer_t *writer, char c) {
+	json_member(writer);
+	json_putc(writer, c);
+	if(writer->depth + 1 >= JSON_MAX_DEPTH) {
+		writer->overflow = true;
+		return;
+	}
+	writer->depth++;
+	writer->items &= ~(1UL << writer->depth);
+}
+
+static void json_close(json_writer_t *writer, char c) {
+	if(writer->depth == 0) {
+		writer->overflow = true;
+		return;
+	}
+	writer->depth--;
+	json_putc(writer, c);
+}
+
+void json_writer_init(json_writer_t *writer, char *buf, size_t size) {
+	memset(writer, 0, sizeof(json_writer_t));
+	writer->buf = buf;
+	writer->size = size;
+	if(size) {
+		buf[0] = '\0';
+	}
+}
+
+size_t json_writer_finish(json_writer_t *writer) {
+	if(writer->size == 0) {
+		return 0;
+	}
+	writer->buf[writer->len] = '\0';
+	if(writer->overflow || writer->depth || writer->after_key) {
+		return 0;
+	}
+	return writer->len;
+}
+
+void json_object_begin(json_writer_t *writer) {
+	json_open(writer, '{');
+}
+
+void json_object_end(json_writer_t *writer) {
+	json_close(writer, '}');
+}
+
+void json_array_begin(json_writer_t *writer) {
+	json_open(writer, '[');
+}
+
+void json_array_end(json_writer_t *writer) {
+	json_close(writer, ']');
+}
+
+void json_write_key(json_writer_t *writer, const char *quoted, size_t len) {
+	json_member(writer);
+	json_put(writer, quoted, len);
+	writer->after_key = true;
+}
+
+void json_string_n(json_writer_t *writer, const char *str, size_t len) {
+	json_member(writer);
+	json_putc(writer, '"');
+	for(size_t i=0; i<len && str[i]; i++) {
+		char c = str[i];
+		switch(c) {
+			case '"':	json_put(writer, "\\\"", 2); break;
+			case '\\':	json_put(writer, "\\\\", 2); break;
+			case '\n':	json_put(writer, "\\n", 2); break;
+			case '\r':	json_put(writer, "\\r", 2); break;
+			case '\t':	json_put(writer, "\\t", 2); break;
+			default: {
+				if((uint8_t)c < 0x20) {
+					char esc[7];
+					snprintf(esc, sizeof(esc), "\\u%04x", c);
+					json_put(writer, esc, 6);
+				} else {
+					json_putc(writer, c);
+				}
+			} break;
+		}
+	}
+	json_putc(writer, '"');
+}
+
+void json_string(json_writer_t *writer, const char *str) {
+	json_string_n(writer, str, SIZE_MAX);
+}
+
+void json_int(json_writer_t *writer, int32_t value) {
+	char num[12];
+	json_member(writer);
+	json_put(writer, num, snprintf(num, sizeof(num), "%ld", (long)value));
+}
+
+void json_bool(json_writer_t *writer, uint8_t value) {
+	json_member(writer);
+	value ? json_put(writer, "true", 4) : json_put(writer, "false", 5);
+}
+
+void json_null(json_writer_t *writer) {
+	json_member(writer);
+	json_put(writer, "null", 4);
+}
+
+void json_raw(json_writer_t *writer, const char *json, size_t len) {
+	json_member(writer);
+	json_put(writer, json, len);
+}
+
+typedef enum json_state {
+	JSON_ST_VALUE,
+	JSON_ST_VALUE_OR_END,
+	JSON_ST_KEY,
+	JSON_ST_KEY_OR_END,
+	JSON_ST_COLON,
+	JSON_ST_AFTER_VALUE,
+	JSON_ST_STRING,
+	JSON_ST_ESCAPE,
+	JSON_ST_UNICODE,
+	JSON_ST_NUMBER,
+	JSON_ST_LITERAL,
+	JSON_ST_DONE,
+	JSON_ST_ERROR,
+} json_state_t;
+
+#define JSON_IS_SPACE(c)    ((c) == ' ' || (c) == '\t' || (c) == '\n' || (c) == '\r')
+#define JSON_IN_OBJECT(p)   ((p)->objects & (1UL << (p)->depth))
+
+static void json_emit(json_parser_t *parser, json_token_t token) {
+	parser->value[parser->value_len] = '\0';
+	parser->cb(parser, token, parser->value);
+	parser->value_len = 0;
+}
+
+static void json_append(json_parser_t *parser, char c) {
+	if(parser->value_len < (JSON_VALUE_MAX - 1)) {
+		parser->value[parser->value_len++] = c;
+	} else {
+		parser->truncated = true;
+	}
+}
+
+/* a value was completed, expect a separator or the end of its container */
+static void json_value_done(json_parser_t *parser) {
+	if(JSON_IN_OBJECT(parser)) {
+		parser->key[0] = '\0';
+	}
+	parser->state = (parser->depth == 0) ? JSON_ST_DONE : JSON_ST_AFTER_VALUE;
+}
+
+static void json_push(json_parser_t *parser, uint8_t object) {
+	json_emit(parser, object ? JSON_TOK_OBJECT_BEGIN : JSON_TOK_ARRAY_BEGIN);
+	if(parser->depth + 1 >= JSON_MAX_DEPTH) {
+		parser->state = JSON_ST_ERROR;
+		return;
+	}
+	parser->depth++;
+	if(object) {
+		parser->objects |= (1UL << parser->depth);
+		parser->state = JSON_ST_KEY_OR_END;
+	} else {
+		parser->objects &= ~(1UL << parser->depth);
+		parser->state = JSON_ST_VALUE_OR_END;
+	}
+	parser->key[0] = '\0';
+}
+
+static void json_pop(json_parser_t *parser, char c) {
+	uint8_t object = JSON_IN_OBJECT(parser);
+	if(c != (object ? '}' : ']')) {
+		parser->state = JSON_ST_ERROR;
+		return;
+	}
+	parser->depth--;
+	json_emit(parser, object ? JSON_TOK_OBJECT_END : JSON_TOK_ARRAY_END);
+	json_value_done(parser);
+}
+
+static void json_start_value(json_parser_t *parser, char c) {
+	switch(c) {
+		case '{': json_push(parser, true); break;
+		case '[': json_push(parser, false); break;
+		case '"': {
+			parser->is_key = false;
+			parser->state = JSON_ST_STRING;
+		} break;
+		default: {
+			if(c == '-' || (c >= '0' && c <= '9')) {
+				parser->state = JSON_ST_NUMBER;
+			} else if(c >= 'a' && c <= 'z') {
+				parser->state = JSON_ST_LITERAL;
+			} else {
+				parser->state = JSON_ST_ERROR;
+				return;
+			}
+			json_append(parser, c);
+		} break;
+	}
+}
+
+static void json_end_string(json_parser_t *parser) {
+	if(parser->is_key) {
+		parser->value[parser->value_len] = '\0';
+		strncpy(parser->key, parser->value, JSON_KEY_MAX - 1);
+		parser->key[JSON_KEY_MAX - 1] = '\0';
+		parser->truncated |= (parser->value_len >= JSON_KEY_MAX);
+		json_emit(parser, JSON_TOK_KEY);
+		parser->state = JSON_ST_COLON;
+	} else {
+		json_emit(parser, JSON_TOK_STRING);
+		json_value_done(parser);
+	}
+}
+
+static void json_end_literal(json_parser_t *parser) {
+	parser->value[parser->value_len] = '\0';
+	if(strcmp(parser->value, "true") == 0) {
+		json_emit(parser, JSON_TOK_TRUE);
+	} else if(strcmp(parser->value, "false") == 0) {
+		json_emit(parser, JSON_TOK_FALSE);
+	} else if(strcmp(parser->value, "null") == 0) {
+		json_emit(parser, JSON_TOK_NULL);
+	} else {
+		parser->state = JSON_ST_ERROR;
+		return;
+	}
+	json_value_done(parser);
+}
+
+static char json_unescape(char c) {
+	switch(c) {
+		case 'b': return '\b';
+		case 'f': return '\f';
+		case 'n': return '\n';
+		case 'r': return '\r';
+		case 't': return '\t';
+		case '"':
+		case '\\':
+		case '/': return c;
+		default:  return 0;
+	}
+}
+
+/* returns false when the char has to be handled again in the new state */
+static uint8_t json_parse_char(json_parser_t *parser, char c) {
+	switch(parser->state) {
+		case JSON_ST_VALUE_OR_END:
+			if(c == ']') {
+				json_pop(parser, c);
+				break;
+			}
+			// fall through
+		case JSON_ST_VALUE:
+			if(!JSON_IS_SPACE(c)) {
+				json_start_value(parser, c);
+			}
+			break;
+
+		case JSON_ST_KEY_OR_END:
+			if(c == '}') {
+				json_pop(parser, c);
+				break;
+			}
+			// fall through
+		case JSON_ST_KEY:
+			if(c == '"') {
+				parser->is_key = true;
+				parser->state = JSON_ST_STRING;
+			} else if(!JSON_IS_SPACE(c)) {
+				parser->state = JSON_ST_ERROR;
+			}
+			break;
+
+		case JSON_ST_COLON:
+			if(c == ':') {
+				parser->state = JSON_ST_VALUE;
+			} else if(!JSON_IS_SPACE(c)) {
+				parser->state = JSON_ST_ERROR;
+			}
+			break;
+
+		case JSON_ST_AFTER_VALUE:
+			if(c == ',') {
+				parser->state = JSON_IN_OBJECT(parser) ? JSON_ST_KEY : JSON_ST_VALUE;
+			} else if(c == '}' || c == ']') {
+				json_pop(parser, c);
+			} else if(!JSON_IS_SPACE(c)) {
+				parser->state = JSON_ST_ERROR;
+			}
+			break;
+
+		case JSON_ST_STRING:
+			if(c == '"') {
+				json_end_string(parser);
+			} else if(c == '\\') {
+				parser->state = JSON_ST_ESCAPE;
+			} else if((uint8_t)c < 0x20) {
+				parser->state = JSON_ST_ERROR;
+			} else {
+				json_append(parser, c);
+			}
+			break;
+
+		case JSON_ST_ESCAPE:
+			if(c == 'u') {
+				parser->unicode = 0;
+				parser->hex = 0;
+				parser->state = JSON_ST_UNICODE;
+			} else if(json_unescape(c)) {
+				json_append(parser, json_unescape(c));
+				parser->state = JSON_ST_STRING;
+			} else {
+				parser->state = JSON_ST_ERROR;
+			}
+			break;
+
+		case JSON_ST_UNICODE: {
+			uint8_t digit;
+			if(c >= '0' && c <= '9') {
+				digit = c - '0';
+			} else if((c | 0x20) >= 'a' && (c | 0x20) <= 'f') {
+				digit = (c | 0x20) - 'a' + 10;
+			} else {
+				parser->state = JSON_ST_ERROR;
+				break;
+			}
+			parser->unicode = (parser->unicode << 4) | digit;
+			if(++parser->hex == 4) {
+				// only ASCII is kept as is
+				json_append(parser, (parser->unicode < 0x80) ? (char)parser->unicode : '?');
+				parser->state = JSON_ST_STRING;
+			}
+		} break;
+
+		case JSON_ST_NUMBER:
+			if((c >= '0' && c <= '9') || c == '.' || c == 'e' || c == 'E' || c == '+' || c == '-') {
+				json_append(parser, c);
+				break;
+			}
+			json_emit(parser, JSON_TOK_NUMBER);
+			json_value_done(parser);
+			return false;
+
+		case JSON_ST_LITERAL:
+			if(c >= 'a' && c <= 'z') {
+				json_append(parser, c);
+				break;
+			}
+			json_end_literal(parser);
+			return false;
+
+		case JSON_ST_DONE:
+			if(!JSON_IS_SPACE(c)) {
+				parser->state = JSON_ST_ERROR;
+			}
+			break;
+
+		default:
+			break;
+	}
+	return true;
+}
+
+void json_parser_init(json_parser_t *parser, json_token_cb_t cb, void *ctx) {
+	memset(parser, 0, sizeof(json_parser_t));
+	parser->cb = cb;
+	parser->ctx = ctx;
+	parser->state = JSON_ST_VALUE;
+}
+
+uint8_t json_parser_feed(json_parser_t *parser, const char *buf, size_t len) {
+	for(size_t i=0; i<len && parser->state != JSON_ST_ERROR; ) {
+		if(json_parse_char(parser, buf[i])) {
+			i++;
+		}
+	}
+	return (parser->state != JSON_ST_ERROR);
+}
+
+uint8_t json_parser_done(json_parser_t *parser) {
+	return (parser->state == JSON_ST_DONE);
+}
@@ -2,37 +2,141 @@
 #include "devices.h"
 #include "influx.h"
 #include "network.h"
+#include "stats.h"
+#include "esp_sntp.h"
+#include <sys/time.h>
 
 static const char *TAG = "network";
 
 static	volatile    uint8_t     wifi_err_cnt    = 0;
+static	volatile    uint8_t     time_synced     = false;
+static	volatile    uint8_t     time_valid      = false;
+static              int64_t     time_offset_us  = 0;
+static              portMUX_TYPE    time_mux    = portMUX_INITIALIZER_UNLOCKED;
 
 static  EventGroupHandle_t  xWifiState          = NULL;
-static  QueueHandle_t       xNetUpdateQueue     = NULL;
+static  QueueHandle_t       xNetUpdateQueue[NET_PRIO_MAX];
+static  SemaphoreHandle_t   xNetUpdatePending   = NULL;
+
+typedef struct net_lane {
+    update_scope_t      scope;
+    const char          *name;
+    QueueHandle_t       queue;
+    volatile uint32_t   queued;
+    volatile uint32_t   dropped;
+    stats_hist_t        latency[NET_PRIO_MAX];
+} net_lane_t;
+
+static  net_lane_t  NET_LANES[] = {
+    { SCOPE_INFLUX,         "influx",   NULL, 0, 0, {} },
+    { SCOPE_SMARTTHINGS,    "st",       NULL, 0, 0, {} },
+    { SCOPE_NOTIFY,         "notify",   NULL, 0, 0, {} },
+};
+
+#define NET_NUM_LANES   (sizeof(NET_LANES) / sizeof(net_lane_t))
+
+net_prio_t network_payload_prio(device_data_t *payload) {
+    return sensor_is_interactive(payload->data.type) ? NET_PRIO_INTERACTIVE : NET_PRIO_BULK;
+}
+
+/* interactive payloads first, but let bulk through after a streak of
+ * NET_STARVATION_LIMIT interactive ones */
+static device_data_t* net_queue_take(uint8_t *streak) {
+    device_data_t *payload = NULL;
+    QueueHandle_t interactive = xNetUpdateQueue[NET_PRIO_INTERACTIVE];
+    QueueHandle_t bulk = xNetUpdateQueue[NET_PRIO_BULK];
+
+    if(*streak >= NET_STARVATION_LIMIT && xQueueReceive(bulk, &payload, 0) == pdTRUE) {
+        *streak = 0;
+    } else if(xQueueReceive(interactive, &payload, 0) == pdTRUE) {
+        (*streak)++;
+    } else if(xQueueReceive(bulk, &payload, 0) == pdTRUE) {
+        *streak = 0;
+    }
+    return payload;
+}
 
 void net_queue_mgr(void *ptx) {
-    xNetUpdateQueue = xQueueCreate(6, sizeof(void*));
     device_data_t *payload = NULL;
+    uint8_t streak = 0;
 
 	for(;;) {
         STACK_STATS
-		if(xQueueReceive(xNetUpdateQueue, &(payload), portMAX_DELAY) != pdTRUE) {
+		if(xSemaphoreTake(xNetUpdatePending, portMAX_DELAY) != pdTRUE) {
+			continue;
+		}
+		if((payload = net_queue_take(&streak)) == NULL) {
 			continue;
 		}
-        LOGD("payload received by net queue: %s", payload->device_id);
+        LOGD("payload received by net queue: " DEVICE_ADDR_FMT, DEVICE_ADDR_ARGS(payload->addr));
+		PIPELINE_RECORD(PIPE_QUEUE, payload->ts_stage);
+		PIPELINE_STAMP(payload->ts_stage);
 		device_process_payload(payload);
-		vTaskDelay(NET_UPDATE_DELAY);
 	}
 }
 
+static void net_lane_mgr(void *ptx) {
+    net_lane_t *lane = (net_lane_t*)ptx;
+    device_data_t payload;
+
+    for(;;) {
+        STACK_STATS
+        if(xQueueReceive(lane->queue, &payload, portMAX_DELAY) != pdTRUE) {
+            continue;
+        }
+        LOGD("payload received by %s lane: " DEVICE_ADDR_FMT, lane->name, DEVICE_ADDR_ARGS(payload.addr));
+        sensor_payload_relink(&payload.data);
+        device_scope_update(lane->scope, &payload);
+        stats_hist_add(&lane->latency[network_payload_prio(&payload)], esp_timer_get_time() - payload.ts);
+    }
+}
+
+uint8_t network_dispatch_payload(device_data_t *payload) {
+    uint8_t sent = 0;
+    for(uint8_t i=0; i<NET_NUM_LANES; i++) {
+        net_lane_t *lane = &NET_LANES[i];
+        if(!(payload->data.scopes & lane->scope) || lane->queue == NULL) {
+            continue;
+        }
+        if(xQueueSend(lane->queue, (void*)payload, 0) != pdTRUE) {
+            __atomic_add_fetch(&lane->dropped, 1, __ATOMIC_RELAXED);
+            LOGW("%s lane full: dropped " DEVICE_ADDR_FMT, lane->name, DEVICE_ADDR_ARGS(payload->addr));
+            continue;
+        }
+        __atomic_add_fetch(&lane->queued, 1, __ATOMIC_RELAXED);
+        sent++;
+    }
+    return sent;
+}
+
+net_lane_stats_t network_lane_stats(uint8_t scope) {
+    net_lane_stats_t stats = { scope, 0, 0, 0, {} };
+    for(uint8_t i=0; i<NET_NUM_LANES; i++) {
+        net_lane_t *lane = &NET_LANES[i];
+        if(lane->scope != scope) {
+            continue;
+        }
+        if(lane->queue) {
+            stats.depth = uxQueueMessagesWaiting(lane->queue);
+        }
+        stats.queued = __atomic_load_n(&lane->queued, __ATOMIC_RELAXED);
+        stats.dropped = __atomic_load_n(&lane->dropped, __ATOMIC_RELAXED);
+        memcpy(stats.latency, lane->latency, sizeof(stats.latency));
+    }
+    return stats;
+}
+
 uint8_t network_queue_payload(device_data_t *payload) {
-    if(xNetUpdateQueue == NULL) {
+    if(xNetUpdatePending == NULL) {
         return true;
     }
-    if(xQueueSend(xNetUpdateQueue, (void*)&payload, DELAY_S4) != pdTRUE) {
-        LOGE("failed to queue payload: %s", payload->device_id);
+    PIPELINE_STAMP(payload->ts_stage);
+    QueueHandle_t queue = xNetUpdateQueue[network_payload_prio(payload)];
+    if(xQueueSend(queue, (void*)&payload, DELAY_S4) != pdTRUE) {
+        LOGE("failed to queue payload: " DEVICE_ADDR_FMT, DEVICE_ADDR_ARGS(payload->addr));
         return false;
     }
+    xSemaphoreGive(xNetUpdatePending);
     return true;
 }
 
@@ -45,11 +149,64 @@ void wifi_err_check(uint8_t err) {
 
     if (wifi_err_cnt > WIFI_ERR_THRESH) {
         LOGE("wifi_err_cnt exceeds threshold: RESETTING DEVICE");
+        influx_flush(INFLUX_SHUTDOWN_TIMEOUT);
         vTaskDelay(DELAY_S4);
         rtc_reset();
     }
 }
 
+static void network_time_sync_cb(struct timeval *tv) {
+    int64_t offset = ((int64_t)tv->tv_sec * 1000000LL) + tv->tv_usec - esp_timer_get_time();
+    portENTER_CRITICAL(&time_mux);
+    time_offset_us = offset;
+    portEXIT_CRITICAL(&time_mux);
+    time_synced = true;
+    time_valid = true;
+    LOGI("clock synced: %ld", (long)tv->tv_sec);
+}
+
+/* the RTC keeps the wall clock across rtc_reset() and esp_restart(), so a
+ * clock set by an earlier boot's sync stamps points until this one syncs */
+static void network_time_restore() {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    if(time_valid || tv.tv_sec < NETWORK_TIME_MIN_EPOCH) {
+        return;
+    }
+    int64_t offset = ((int64_t)tv.tv_sec * 1000000LL) + tv.tv_usec - esp_timer_get_time();
+    portENTER_CRITICAL(&time_mux);
+    time_offset_us = offset;
+    portEXIT_CRITICAL(&time_mux);
+    time_valid = true;
+    LOGI("clock kept from the last boot: %ld", (long)tv.tv_sec);
+}
+
+void network_time_init() {
+    static uint8_t started = false;
+    if(started) {
+        return;
+    }
+    started = true;
+    sntp_setoperatingmode(SNTP_OPMODE_POLL);
+    sntp_setservername(0, SNTP_SERVER);
+    sntp_set_time_sync_notification_cb(network_time_sync_cb);
+    sntp_init();
+}
+
+uint8_t network_time_synced() {
+    return time_synced;
+}
+
+int64_t network_time_epoch_ms(int64_t ts_us) {
+    if(!time_valid) {
+        return 0;
+    }
+    portENTER_CRITICAL(&time_mux);
+    int64_t offset = time_offset_us;
+    portEXIT_CRITICAL(&time_mux);
+    return (ts_us + offset) / 1000;
+}
+
 void mdns_start(mdns_config_t config) {
     if(mdns_init() != ESP_OK) {
         LOGE("failed to start mDNS");
@@ -64,11 +221,180 @@ void mdns_stop() {
     mdns_free();
 }
 
+typedef struct http_pool_conn {
+    esp_http_client_handle_t    handle;
+    char                        host[HTTP_POOL_HOST_LEN];
+    uint16_t                    port;
+    esp_http_client_transport_t transport;
+    const char                  *cert_pem;
+    uint32_t                    sig;
+    uint8_t                     in_use;
+    unsigned long int           last_used;
+} http_pool_conn_t;
+
+static  http_pool_conn_t    HTTP_POOL[HTTP_POOL_MAX_CONN];
+static  http_pool_stats_t   http_pool_counters;
+static  portMUX_TYPE        http_pool_mux       = portMUX_INITIALIZER_UNLOCKED;
+
+static uint32_t http_sig_add(uint32_t sig, const void *data, size_t len) {
+    const uint8_t *p = (const uint8_t*)data;
+    for(size_t i=0; i<len; i++) {
+        sig = (sig ^ p[i]) * 16777619UL;
+    }
+    return sig;
+}
+
+static uint32_t http_sig_add_str(uint32_t sig, const char *str) {
+    return http_sig_add(sig, str ? str : "", str ? strlen(str) + 1 : 1);
+}
+
+/* FNV-1a over everything esp_http_client keeps on the handle beyond the
+ * url: credentials, user agent, event handler and custom headers.  A
+ * pooled handle is only handed to a client with the same signature */
+static uint32_t http_client_sig(http_client_t *client) {
+    esp_http_client_config_t *config = &client->esp_config;
+    uint32_t sig = 2166136261UL;
+    sig = http_sig_add_str(sig, config->username);
+    sig = http_sig_add_str(sig, config->password);
+    sig = http_sig_add_str(sig, config->user_agent);
+    sig = http_sig_add(sig, &config->auth_type, sizeof(config->auth_type));
+    sig = http_sig_add(sig, &config->event_handler, sizeof(config->event_handler));
+    for(uint8_t i=0; i < client->headers.idx; i++) {
+        sig = http_sig_add_str(sig, client->headers.entries[i].key);
+        sig = http_sig_add_str(sig, client->headers.entries[i].value);
+    }
+    return sig;
+}
+
+static uint8_t http_pool_match(http_pool_conn_t *conn, http_client_t *client, uint32_t sig) {
+    esp_http_client_config_t *config = &client->esp_config;
+    return (conn->port == config->port && conn->transport == config->transport_type &&
+            conn->cert_pem == config->cert_pem && conn->sig == sig &&
+            strcmp(conn->host, config->host) == 0);
+}
+
+/* take an idle connection to the same host opened with the same
+ * credentials and headers, or -1 to open a new one */
+static int8_t http_pool_acquire(http_client_t *client) {
+    int8_t slot = -1;
+    uint32_t sig = http_client_sig(client);
+    portENTER_CRITICAL(&http_pool_mux);
+    for(uint8_t i=0; i<HTTP_POOL_MAX_CONN; i++) {
+        http_pool_conn_t *conn = &HTTP_POOL[i];
+        if(conn->handle && !conn->in_use && http_pool_match(conn, client, sig)) {
+            conn->in_use = true;
+            slot = i;
+            break;
+        }
+    }
+    if(slot < 0) {
+        http_pool_counters.misses++;
+    } else {
+        http_pool_counters.hits++;
+    }
+    portEXIT_CRITICAL(&http_pool_mux);
+    return slot;
+}
+
+/* keep the connection for reuse, returns false if it should be closed */
+static uint8_t http_pool_release(http_client_t *client) {
+    esp_http_client_handle_t evicted = nullptr;
+    uint32_t sig = http_client_sig(client);
+    uint8_t reuse = (strlen(client->esp_config.host) < HTTP_POOL_HOST_LEN &&
+                    esp_http_client_is_complete_data_received(client->esp_handle) &&
+                    heap_caps_get_free_size(MALLOC_CAP_INTERNAL) > HTTP_POOL_MIN_HEAP);
+
+    portENTER_CRITICAL(&http_pool_mux);
+    http_pool_conn_t *conn = (client->pool_slot < 0) ? nullptr : &HTTP_POOL[client->pool_slot];
+    if(conn && !reuse) {
+        conn->handle = nullptr;
+    }
+    if(!conn && reuse) {
+        // take a free slot, or the least recently used idle one
+        for(uint8_t i=0; i<HTTP_POOL_MAX_CONN; i++) {
+            http_pool_conn_t *cand = &HTTP_POOL[i];
+            if(cand->handle == nullptr) {
+                conn = cand;
+                break;
+            }
+            if(!cand->in_use && (!conn || cand->last_used < conn->last_used)) {
+                conn = cand;
+            }
+        }
+        if(conn && conn->handle) {
+            evicted = conn->handle;
+            http_pool_counters.evictions++;
+        }
+        if(conn) {
+            conn->handle = client->esp_handle;
+            strcpy(conn->host, client->esp_config.host);
+            conn->port = client->esp_config.port;
+            conn->transport = client->esp_config.transport_type;
+            conn->cert_pem = client->esp_config.cert_pem;
+            conn->sig = sig;
+        } else {
+            reuse = false;
+        }
+    }
+    if(reuse) {
+        conn->in_use = false;
+        conn->last_used = MILLIS;
+    }
+    portEXIT_CRITICAL(&http_pool_mux);
+
+    if(evicted) {
+        esp_http_client_cleanup(evicted);
+    }
+    return reuse;
+}
+
+void http_pool_evict_idle() {
+    esp_http_client_handle_t idle[HTTP_POOL_MAX_CONN];
+    uint8_t count = 0;
+    unsigned long int now = MILLIS;
+
+    portENTER_CRITICAL(&http_pool_mux);
+    for(uint8_t i=0; i<HTTP_POOL_MAX_CONN; i++) {
+        http_pool_conn_t *conn = &HTTP_POOL[i];
+        if(conn->handle && !conn->in_use && (now - conn->last_used) > HTTP_POOL_IDLE_MS) {
+            idle[count++] = conn->handle;
+            conn->handle = nullptr;
+            http_pool_counters.evictions++;
+        }
+    }
+    portEXIT_CRITICAL(&http_pool_mux);
+
+    for(uint8_t i=0; i<count; i++) {
+        LOGD("closing idle http connection");
+        esp_http_client_cleanup(idle[i]);
+    }
+}
+
+http_pool_stats_t http_pool_stats() {
+    portENTER_CRITICAL(&http_pool_mux);
+    http_pool_stats_t stats = http_pool_counters;
+    stats.idle = 0;
+    stats.in_use = 0;
+    for(uint8_t i=0; i<HTTP_POOL_MAX_CONN; i++) {
+        if(HTTP_POOL[i].handle) {
+            HTTP_POOL[i].in_use ? stats.in_use++ : stats.idle++;
+        }
+    }
+    portEXIT_CRITICAL(&http_pool_mux);
+    return stats;
+}
+
 http_client_t* http_client_init(http_client_t *client) {
     memset(&client->esp_config, 0, sizeof(esp_http_client_config_t));
     client->esp_config.transport_type = HTTP_TRANSPORT_OVER_TCP;
     client->esp_config.timeout_ms = TCP_CONN_TIMEOUT;
-    client->esp_config.keep_alive_enable = false;
+    // probe idle pooled connections, so a dead peer is noticed early
+    client->esp_config.keep_alive_enable = true;
+    client->esp_handle = nullptr;
+    client->body = nullptr;
+    client->body_len = 0;
+    client->pool_slot = -1;
+    client->pool_hit = false;
 
     memset(&client->headers, 0, sizeof((http_headers_t){{},0}));
     memset(client->buf, 0, HTTP_CLIENT_BUF_LEN);
@@ -76,7 +402,7 @@ http_client_t* http_client_init(http_client_t *client) {
     return client;
 }
 
-void http_client_enable_ssl(http_client_t *client, char *ca_pem) {
+void http_client_enable_ssl(http_client_t *client, const char *ca_pem) {
     client->esp_config.transport_type = HTTP_TRANSPORT_OVER_SSL; 
     client->esp_config.cert_pem = ca_pem;
 }
@@ -86,11 +412,11 @@ void http_client_set_auth(http_client_t *client, char *user, char *pass) {
     client->esp_config.password = pass;
 }
 
-void http_client_set_agent(http_client_t *client, char *agent) {
+void http_client_set_agent(http_client_t *client, const char *agent) {
     client->esp_config.user_agent = agent;
 }
 
-void http_client_set_header(http_client_t *client, char *key, char *value) {
+void http_client_set_header(http_client_t *client, const char *key, const char *value) {
     http_header_t *header = &client->headers.entries[client->headers.idx++];
     header->key = key;
     header->value = value;
@@ -120,57 +446,76 @@ http_response_t http_client_get_response(http_client *client) {
     return resp;
 }
 
+/* point a pooled connection at the next request, the host stays the same
+ * so esp_http_client keeps the socket open */
+static void http_client_reuse(http_client_t *client) {
+    esp_http_client_config_t *config = &client->esp_config;
+    char url[HTTP_POOL_URL_LEN];
+    snprintf(url, sizeof(url), "%s://%s:%d%s%s%s",
+            (config->transport_type == HTTP_TRANSPORT_OVER_SSL) ? "https" : "http",
+            config->host, config->port, config->path,
+            config->query ? "?" : "", config->query ? config->query : "");
+    esp_http_client_set_url(client->esp_handle, url);
+    esp_http_client_set_method(client->esp_handle, config->method);
+}
+
 void http_client_builder(http_client_t *client) {
-   client->esp_handle = esp_http_client_init(&client->esp_config); 
+   client->pool_slot = http_pool_acquire(client);
+   client->pool_hit = (client->pool_slot >= 0);
+   if(client->pool_hit) {
+       client->esp_handle = HTTP_POOL[client->pool_slot].handle;
+       http_client_reuse(client);
+   } else {
+       client->esp_handle = esp_http_client_init(&client->esp_config);
+   }
    for(uint8_t i=0; i < client->headers.idx; i++) {
        http_header_t *header = &client->headers.entries[i];
        esp_http_client_set_header(client->esp_handle, header->key, header->value);
    }
 }
 
-http_response_t http_client_get(http_client_t *client, char *path) {
+/* send the request and read the response headers.  A pooled connection may
+ * have been closed by the server while idle, so retry once on a new one */
+static http_response_t http_client_request(http_client_t *client, char *path) {
     http_response_t resp;
     client->esp_config.path = path;
     http_client_builder(client);
-    if(esp_http_client_open(client->esp_handle, 0) == ESP_OK) {
-        esp_http_client_fetch_headers(client->esp_handle);
-        resp = http_client_get_response(client);
-    } else {
-        LOGE("http_connect(): failed");
-        resp.status = 1;
+    for(;;) {
+        if(esp_http_client_open(client->esp_handle, client->body_len) == ESP_OK &&
+                (!client->body_len || esp_http_client_write(client->esp_handle,
+                        client->body, client->body_len) == (int)client->body_len) &&
+                (esp_http_client_fetch_headers(client->esp_handle) >= 0 ||
+                        esp_http_client_is_chunked_response(client->esp_handle))) {
+            return http_client_get_response(client);
+        }
+        esp_http_client_close(client->esp_handle);
+        if(!client->pool_hit) {
+            break;
+        }
+        LOGD("pooled http connection lost, reconnecting..");
+        client->pool_hit = false;
     }
+    LOGE("http_connect(): failed");
+    resp.status = 1;
+    resp.length = 0;
     return resp;
 }
 
+http_response_t http_client_get(http_client_t *client, char *path) {
+    client->esp_config.method = HTTP_METHOD_GET;
+    client->body_len = 0;
+    return http_client_request(client, path);
+}
+
 http_response_t http_client_put(http_client_t *client, char *path) {
-    http_response_t resp;
-    client->esp_config.path = path;
     client->esp_config.method = HTTP_METHOD_PUT;
-    http_client_builder(client);
-    if(esp_http_client_open(client->esp_handle, 0) == ESP_OK) {
-        esp_http_client_fetch_headers(client->esp_handle);
-        resp = http_client_get_response(client);
-    } else {
-        LOGE("http_connect(): failed");
-        resp.status = 1;
-    }
-    return resp;
+    client->body_len = 0;
+    return http_client_request(client, path);
 }
 
 http_response_t http_client_post(http_client_t *client, char *path) {
-    http_response_t resp;
-    client->esp_config.path = path;
     client->esp_config.method = HTTP_METHOD_POST;
-    http_client_builder(client);
-    if(esp_http_client_open(client->esp_handle, client->body_len) == ESP_OK) {
-        esp_http_client_write(client->esp_handle, client->body, client->body_len);
-        esp_http_client_fetch_headers(client->esp_handle);
-        resp = http_client_get_response(client);
-    } else {
-        LOGE("http_connect(): failed");
-        resp.status = 1;
-    }
-    return resp;
+    return http_client_request(client, path);
 }
 
 size_t http_client_read(http_client_t *client, char *buf, size_t len)  {
@@ -178,6 +523,9 @@ size_t http_client_read(http_client_t *client, char *buf, size_t len)  {
 }
 
 esp_err_t http_client_close(http_client_t *client) {
+    if(client->esp_handle == nullptr || http_pool_release(client)) {
+        return ESP_OK;
+    }
     return esp_http_client_cleanup(client->esp_handle);
 }
 
@@ -254,7 +602,7 @@ esp_err_t http_event_handler(esp_http_client_event_t *evt) {
             LOGD("HTTP_EVENT_ON_DATA, len=%d", evt->data_len);
             if (!esp_http_client_is_chunked_response(evt->client)) {
                 if (evt->user_data) {
-                    memcpy(evt->user_data + output_len, evt->data, evt->data_len);
+                    memcpy((char*)evt->user_data + output_len, evt->data, evt->data_len);
                 } else {
                     if (output_buffer == NULL) {
                         output_buffer = (char *) malloc(esp_http_client_get_content_length(evt->client));
@@ -316,6 +664,7 @@ http_loc_t parse_url(char *url) {
 }
 
 void wifi_connect() {
+    network_time_restore();
     esp_err_t ret = nvs_flash_init();
     if (ret == ESP_ERR_NVS_NO_FREE_PAGES || ret == ESP_ERR_NVS_NEW_VERSION_FOUND) {
         ESP_ERROR_CHECK(nvs_flash_erase());
@@ -356,6 +705,9 @@ void wifi_connect() {
     }
 
     xEventGroupWaitBits(xWifiState, WIFI_CONNECTED_BIT, false, true, portMAX_DELAY);
+#ifndef DISABLE_SNTP
+    network_time_init();
+#endif
 }
 
 void network_queue_init() {
@@ -366,9 +718,20 @@ void network_queue_init() {
         default:
             break;
     }
-    char task[] = NET_QUEUE_TASK;
+    for(uint8_t i=0; i<NET_PRIO_MAX; i++) {
+        xNetUpdateQueue[i] = xQueueCreate(NET_UPDATE_QUEUE_SZ, sizeof(void*));
+    }
+    xNetUpdatePending = xSemaphoreCreateCounting(NET_UPDATE_QUEUE_SZ * NET_PRIO_MAX, 0);
+    for(uint8_t i=0; i<NET_NUM_LANES; i++) {
+        char task[configMAX_TASK_NAME_LEN];
+        net_lane_t *lane = &NET_LANES[i];
+        lane->queue = xQueueCreate(NET_LANE_QUEUE_SZ, sizeof(device_data_t));
+        snprintf(task, sizeof(task), NET_LANE_TASK, lane->name);
+        xTaskCreatePinnedToCore(net_lane_mgr, task, NET_LANE_STACK_SZ, (void*)lane, NET_QUEUE_PRIO, NULL, 1);
+    }
     for(uint8_t i=0; i<NET_QUEUE_NUM_TASKS; i++) {
-        snprintf(task, strlen(task), NET_QUEUE_TASK, i);
+        char task[configMAX_TASK_NAME_LEN];
+        snprintf(task, sizeof(task), NET_QUEUE_TASK, i);
         xTaskCreatePinnedToCore(net_queue_mgr, task, NET_QUEUE_STACK_SZ, NULL, NET_QUEUE_PRIO, NULL, 1);
     }
 }
@@ -1,11 +1,7 @@
 #include <math.h>
-#include "esp_http_client.h"
 #include "iot-common.h"
-#include "ble.h"
-#include "smartthings.h"
+#include "devices.h"
 #include "sensor.h"
-#include "influx.h"
-#include "esp_crt_bundle.h"
 
 static const char *TAG = "sensor";
 
@@ -15,6 +11,10 @@ const	char	*PRESENCE_STRING[]	= { PRESENCE_STATE(BUILD_STRINGS) };
 const	char	*ACTION_STRING[]	= { ACTION_STATE(BUILD_STRINGS) };
 
 static			sensor_t	SENSOR_TYPE[]	= { SENSOR_TYPES(SENSOR_ENTRIES) };
+static	sensor_filter_stats_t	sensor_filter_cnt;
+
+#define SENSOR_FILTER_CASE(Name, _deadband, _pct, _interval, _heartbeat) \
+	case SENSOR_##Name: return (sensor_filter_t){ _deadband, _pct, false, _interval, _heartbeat };
 extern const	sensor_t	INVALID_SENSOR	= SENSOR_DEFAULTS;
 
 const sensor_t* sensor_get_by_type_name(attribute_t type) {
@@ -39,14 +39,48 @@ void sensor_type_get_name(sensor_type_t id, attribute_t buf) {
     lowerchrs(p);
 }
 
+sensor_filter_t sensor_filter_default(sensor_type_t type) {
+	switch(type) {
+		SENSOR_FILTERS(SENSOR_FILTER_CASE)
+		default: return (sensor_filter_t){ 0, 0, false, 0, FORCE_UPDATE_MS };
+	}
+}
+
+sensor_filter_stats_t sensor_filter_stats() {
+	return sensor_filter_cnt;
+}
+
+/* report once the value moved past the deadband, or the heartbeat is due */
+static uint8_t sensor_filter_pass(sensor_t *sensor, uint16_t val, unsigned long int now) {
+	sensor_filter_t filter = sensor->filter.custom ? sensor->filter : sensor_filter_default(sensor->id);
+	unsigned long int since = now - sensor->updatedAt;
+	if(sensor->updatedAt == 0 || since >= filter.heartbeat_ms) {
+		return true;
+	}
+	if(since < filter.min_interval_ms) {
+		return false;
+	}
+	uint16_t diff = (val > sensor->state) ? (val - sensor->state) : (sensor->state - val);
+	uint32_t threshold = MAX((uint32_t)filter.deadband, ((uint32_t)sensor->state * filter.deadband_pct) / 100);
+	return (diff > 0 && diff >= threshold);
+}
+
+uint8_t sensor_is_interactive(sensor_type_t type) {
+	switch(type) {
+		case SENSOR_PRESENCE:
+		case SENSOR_CONTACT:
+		case SENSOR_MOTION:
+			return true;
+		default:
+			return false;
+	}
+}
+
 uint8_t sensor_process_payload(sensor_t *sensor, sensor_multi_data_t *data) {
 	unsigned long int now = MILLIS;
 	uint16_t *p_val = (uint16_t*)data->values[0].value;
 	sensor_val_type_t val_type = data->values[0].val_type;
 	bool force = false;
-	if(sensor) {
-	    force = (now > (sensor->updatedAt + FORCE_UPDATE_MS));
-	}
 
 	switch(data->type) {
 		case SENSOR_BATTERY:
@@ -64,7 +98,6 @@ uint8_t sensor_process_payload(sensor_t *sensor, sensor_multi_data_t *data) {
 			break;
 		case SENSOR_LIGHT:
 			data->scopes |= SCOPE_INFLUX;
-			force = true;
 			if(*p_val > 0xfff) {
 				(*p_val) = 0;
 			}; break;
@@ -80,12 +113,15 @@ uint8_t sensor_process_payload(sensor_t *sensor, sensor_multi_data_t *data) {
 	data->scopes |= SCOPE_ADD_DEFAULT;
 #endif
 
+	if(sensor == nullptr) {
+		return true;
+	}
 	if(val_type == VAL_U16) {
-		if(*p_val == sensor->state) {
-			if(!force) {
-				return false;
-			}
+		if(!force && !sensor_filter_pass(sensor, *p_val, now)) {
+			sensor_filter_cnt.suppressed++;
+			return false;
 		}
+		sensor_filter_cnt.passed++;
 		sensor->state = *p_val; 
 	}
 	sensor->updatedAt = now;
@@ -97,25 +133,24 @@ void sensor_update_interface(sensor_type_t entry, interface_t interface) {
 }
 
 uint8_t sensor_payload_alloc_entry(sensor_multi_data_t *data) {
+	if(data->num_values >= PAYLOAD_MAX_VALUES) {
+		LOGE("payload alloc: no free entries (max %d)", PAYLOAD_MAX_VALUES);
+		return PAYLOAD_MAX_VALUES;
+	}
 	uint8_t idx = data->num_values++;
-	size_t len;
-	void *ptr;
-
-	len = data->num_values * VAL_ENTRY_SZ;
-	data->values = (sensor_val_t*)realloc(data->values, len);
-    ptr = &data->values[idx];
-	memset(ptr, 0, VAL_ENTRY_SZ);
-	LOGD("payload alloc for values: %d bytes", len);
-
-	len = data->num_values * VAL_TAG_SZ;
-	data->tags = (sensor_tag_t*)realloc(data->tags, len);
-    ptr = &data->tags[idx];
-	memset(ptr, 0, VAL_TAG_SZ);
-	LOGD("payload alloc for tags: %d bytes", len);
-
+	memset(&data->values[idx], 0, VAL_ENTRY_SZ);
+	memset(&data->tags[idx], 0, VAL_TAG_SZ);
 	return idx;
 }
 
+void sensor_payload_relink(sensor_multi_data_t *data) {
+	for(uint8_t i=0; i<data->num_values && i<PAYLOAD_MAX_VALUES; i++) {
+		if(data->values[i].val_type == VAL_U16 && data->values[i].value) {
+			data->values[i].value = (void*)&data->values[i].u16;
+		}
+	}
+}
+
 sensor_data_entry_t sensor_payload_get_entry(sensor_multi_data_t *data, uint8_t idx) {
 	sensor_data_entry_t entry = {
 		.sensor_id = &data->sensor_id,
@@ -1,9 +1,144 @@
 #include "iot-common.h"
+#include "ble.h"
 #include "smartapp.h"
+#include "json.h"
 
 static const char *TAG = "smartapp";
 
-static QueueHandle_t xSTQueue;
+typedef struct st_pending {
+	st_payload_t	payload;
+	uint32_t		seq;
+	uint8_t			in_use;
+} st_pending_t;
+
+static TaskHandle_t		xSTTask = NULL;
+static st_pending_t		ST_PENDING[ST_PENDING_SZ];
+static st_queue_stats_t	st_queue;
+static uint32_t			st_pending_seq = 1;
+static uint8_t			st_pending_streak = 0;
+static portMUX_TYPE		st_pending_mux = portMUX_INITIALIZER_UNLOCKED;
+
+static st_conn_stats_t st_conn;
+static volatile uint32_t st_connects = 0;
+static size_t st_resp_len = 0;
+
+#ifdef ST_BATCH_EVENTS
+static uint8_t		st_batch_supported = true;
+static st_payload_t	ST_BATCH[ST_BATCH_MAX_EVENTS];
+static char			ST_BATCH_BODY[ST_BATCH_BODY_SZ];
+#endif
+
+static uint8_t st_pending_match(st_payload_t *a, st_payload_t *b) {
+	return (a->type == b->type && strncmp(a->endpoint, b->endpoint, sizeof(a->endpoint)) == 0);
+}
+
+/* Add an event to the pending table, or overwrite the unsent value of the
+ * same device, sensor and type in place.  A retry keeps its place at the
+ * front, but never overwrites a newer value. */
+static uint8_t st_pending_put(st_payload_t *payload, uint8_t retry) {
+	st_pending_t *slot = NULL;
+	uint8_t found = false;
+	uint8_t ret = true;
+
+	portENTER_CRITICAL(&st_pending_mux);
+	for(uint8_t i=0; i<ST_PENDING_SZ; i++) {
+		st_pending_t *entry = &ST_PENDING[i];
+		if(entry->in_use && st_pending_match(&entry->payload, payload)) {
+			if(!retry) {
+				memcpy(entry->payload.body, payload->body, sizeof(payload->body));
+				entry->payload.ts = payload->ts;
+				// the new value has not been tried yet
+				entry->payload.attempts = 0;
+				st_queue.coalesced++;
+			}
+			found = true;
+			break;
+		}
+		if(!entry->in_use && slot == NULL) {
+			slot = entry;
+		}
+	}
+	if(!found && slot) {
+		slot->payload = *payload;
+		slot->seq = retry ? 0 : st_pending_seq++;
+		slot->in_use = true;
+		st_queue.pending++;
+		st_queue.high_water = MAX(st_queue.high_water, st_queue.pending);
+	} else if(!found) {
+		st_queue.dropped++;
+		ret = false;
+	}
+	portEXIT_CRITICAL(&st_pending_mux);
+	return ret;
+}
+
+/* Take the oldest pending event, interactive ones first unless bulk was
+ * passed over NET_STARVATION_LIMIT times.  Waits up to `wait` ticks. */
+static uint8_t st_pending_take(st_payload_t *payload, TickType_t wait) {
+	for(;;) {
+		st_pending_t *oldest[NET_PRIO_MAX] = { NULL };
+		portENTER_CRITICAL(&st_pending_mux);
+		for(uint8_t i=0; i<ST_PENDING_SZ; i++) {
+			st_pending_t *entry = &ST_PENDING[i];
+			st_pending_t **prio = &oldest[entry->payload.prio];
+			if(entry->in_use && (!*prio || entry->seq < (*prio)->seq)) {
+				*prio = entry;
+			}
+		}
+		st_pending_t *next = oldest[NET_PRIO_INTERACTIVE];
+		if(!next || (st_pending_streak >= NET_STARVATION_LIMIT && oldest[NET_PRIO_BULK])) {
+			next = oldest[NET_PRIO_BULK];
+		}
+		if(next) {
+			st_pending_streak = (next->payload.prio == NET_PRIO_INTERACTIVE) ? st_pending_streak + 1 : 0;
+			*payload = next->payload;
+			next->in_use = false;
+			st_queue.pending--;
+		}
+		portEXIT_CRITICAL(&st_pending_mux);
+
+		if(next) {
+			return true;
+		}
+		if(ulTaskNotifyTake(pdTRUE, wait) == 0) {
+			return false;
+		}
+	}
+}
+
+st_queue_stats_t st_queue_stats() {
+	portENTER_CRITICAL(&st_pending_mux);
+	st_queue_stats_t stats = st_queue;
+	portEXIT_CRITICAL(&st_pending_mux);
+	return stats;
+}
+
+/* read the response body in chunks through a streaming tokenizer */
+static uint8_t st_parse_response(http_client_t *http_client, json_parser_t *parser) {
+	char chunk[ST_READ_CHUNK_SZ];
+	int len;
+	while((len = (int)http_client_read(http_client, chunk, sizeof(chunk))) > 0) {
+		if(!json_parser_feed(parser, chunk, len)) {
+			LOGE("invalid JSON in response");
+			return false;
+		}
+	}
+	return json_parser_done(parser);
+}
+
+static void st_device_id_token(json_parser_t *parser, json_token_t token, const char *value) {
+	if(token == JSON_TOK_KEY && parser->depth == 1 && strcmp(value, "deviceId") == 0) {
+		*(uint8_t*)parser->ctx = true;
+	}
+}
+
+/* check the response for the `deviceId` of a created device */
+static uint8_t st_parse_device_id(http_client_t *http_client) {
+	uint8_t found = false;
+	json_parser_t parser;
+	json_parser_init(&parser, st_device_id_token, &found);
+	return st_parse_response(http_client, &parser) && found;
+}
 
 uint8_t st_init_device(char *device_id) {
 	uint8_t ret = false;
@@ -15,12 +150,7 @@ uint8_t st_init_device(char *device_id) {
 	
 	http_response_t resp = st_api_request(http_client, HTTP_METHOD_PUT, endpoint);
 	if(resp.status >= 200 && resp.status < 300) {
-		char resp_body[resp.length];
-		http_client_read(http_client, resp_body, sizeof(resp_body));
-	    cJSON *root = cJSON_Parse(resp_body);
-		cJSON *id = cJSON_GetObjectItem(root, "deviceId");
-		ret = (id != NULL);
-		cJSON_Delete(root);
+		ret = st_parse_device_id(http_client);
 	} else {
 		LOGE("st_init_device(): http response code: %d", resp.status);
 	}
@@ -38,29 +168,112 @@ uint8_t st_create_device(char *device_id, sensor_type_t sensor_type) {
 	memcpy(type_str, sensor->type, sizeof(attribute_t));
 	enum_to_str((char*)type_str);
 
-    cJSON *new_device = cJSON_CreateObject();
-    cJSON *id = cJSON_CreateString(device_id);
-    cJSON *type = cJSON_CreateString(type_str);
-	cJSON_AddItemToObject(new_device, "device_id", id);
-	cJSON_AddItemToObject(new_device, "sensor_type", type);
-    char *body = cJSON_PrintUnformatted(new_device);
-    cJSON_Delete(new_device);
+	char body[ST_BODY_SZ];
+	json_writer_t json;
+	json_writer_init(&json, body, sizeof(body));
+	json_object_begin(&json);
+	JSON_KEY(&json, "device_id");
+	json_string(&json, device_id);
+	JSON_KEY(&json, "sensor_type");
+	json_string(&json, type_str);
+	json_object_end(&json);
+	if(!json_writer_finish(&json)) {
+		LOGE("st_create_device(): request exceeds %d bytes", sizeof(body));
+		return false;
+	}
 
 	LOGI("stapi(POST): %s", body);
     http_client_set_post_data(http_client, body, strlen(body));
 	http_response_t resp = st_api_request(http_client, HTTP_METHOD_POST, "/devices");
 	if(resp.status >= 200 && resp.status < 300) {
-		char resp_body[resp.length];
-		http_client_read(http_client, resp_body, sizeof(resp_body));
-	    cJSON *root = cJSON_Parse(resp_body);
-		cJSON *id = cJSON_GetObjectItem(root, "deviceId");
-		ret = (id != NULL);
-		cJSON_Delete(root);
+		ret = st_parse_device_id(http_client);
 	}
 	http_client_close(http_client);
 	return ret;
 }
 
+#define ST_FILTER_DEADBAND      (1 << 0)
+#define ST_FILTER_DEADBAND_PCT  (1 << 1)
+#define ST_FILTER_MIN_INTERVAL  (1 << 2)
+#define ST_FILTER_HEARTBEAT     (1 << 3)
+
+typedef struct st_config_ctx {
+	device_t		*device;
+	uint8_t			idx;
+	attribute_t		type_name;
+	sensor_filter_t	filter;
+	uint8_t			filter_set;
+} st_config_ctx_t;
+
+static void st_config_sensor(st_config_ctx_t *ctx) {
+	if(ctx->type_name[0] == '\0') {
+		return;
+	}
+	if(ctx->idx >= MAX_SENSORS) {
+		LOGW("update: no room for sensor type %s", ctx->type_name);
+		return;
+	}
+	const sensor_t *sensor = sensor_get_by_type_name(ctx->type_name);
+	if(sensor == nullptr) {
+		return;
+	}
+	LOGI("update: sensor_id %d / type %s", ctx->idx, ctx->type_name);
+	sensor_t *target = &ctx->device->sensors[ctx->idx++];
+	*target = *sensor;
+	target->in_use = true;
+	if(ctx->filter_set) {
+		sensor_filter_t filter = sensor_filter_default(sensor->id);
+		if(ctx->filter_set & ST_FILTER_DEADBAND) filter.deadband = ctx->filter.deadband;
+		if(ctx->filter_set & ST_FILTER_DEADBAND_PCT) filter.deadband_pct = ctx->filter.deadband_pct;
+		if(ctx->filter_set & ST_FILTER_MIN_INTERVAL) filter.min_interval_ms = ctx->filter.min_interval_ms;
+		if(ctx->filter_set & ST_FILTER_HEARTBEAT) filter.heartbeat_ms = ctx->filter.heartbeat_ms;
+		filter.custom = true;
+		target->filter = filter;
+		LOGI("update: filter %d / %d%% / %u ms / %u ms", filter.deadband, filter.deadband_pct,
+				filter.min_interval_ms, filter.heartbeat_ms);
+	}
+}
+
+/*
+ * each member of the root with a `type` configures the next sensor, optional
+ * `deadband`, `deadband_pct`, `min_interval` and `heartbeat` members override
+ * the change filter of its type
+ */
+static void st_config_token(json_parser_t *parser, json_token_t token, const char *value) {
+	st_config_ctx_t *ctx = (st_config_ctx_t*)parser->ctx;
+	if(parser->depth == 1) {
+		if(token == JSON_TOK_OBJECT_BEGIN) {
+			ctx->type_name[0] = '\0';
+			ctx->filter_set = 0;
+		} else if(token == JSON_TOK_OBJECT_END) {
+			st_config_sensor(ctx);
+		}
+		return;
+	}
+	if(parser->depth != 2) {
+		return;
+	}
+	if(token == JSON_TOK_STRING && strcmp(parser->key, "type") == 0) {
+		memset(ctx->type_name, 0, sizeof(attribute_t));
+		strncpy((char*)ctx->type_name, value, sizeof(attribute_t)-1);
+	} else if(token == JSON_TOK_NUMBER) {
+		uint32_t num = strtoul(value, NULL, 10);
+		if(strcmp(parser->key, "deadband") == 0) {
+			ctx->filter.deadband = MIN(num, 0xffffUL);
+			ctx->filter_set |= ST_FILTER_DEADBAND;
+		} else if(strcmp(parser->key, "deadband_pct") == 0) {
+			ctx->filter.deadband_pct = MIN(num, 100UL);
+			ctx->filter_set |= ST_FILTER_DEADBAND_PCT;
+		} else if(strcmp(parser->key, "min_interval") == 0) {
+			ctx->filter.min_interval_ms = num;
+			ctx->filter_set |= ST_FILTER_MIN_INTERVAL;
+		} else if(strcmp(parser->key, "heartbeat") == 0) {
+			ctx->filter.heartbeat_ms = num;
+			ctx->filter_set |= ST_FILTER_HEARTBEAT;
+		}
+	}
+}
+
 static req_status_t st_update_device(device_t *device) {
 	char endpoint[50];
 	sprintf(endpoint, "/config/%s", device->id);
@@ -77,35 +290,15 @@ static req_status_t st_update_device(device_t *device) {
 	  http_client_close(http_client);
       return (req_status_t)resp.status;
 	}
-	int len;
-	if(resp.length == -1) {
-        len = HTTP_CLIENT_BUF_LEN;	
-	} else {
-		len = resp.length;
-	}
-    char body[len];
-	http_client_read(http_client, body, len);
-	http_client_close(http_client);
 
 	LOGD("updating device config");
-    cJSON *root = cJSON_Parse(body);
-	cJSON *id;
-	uint8_t idx = 0;
-    cJSON_ArrayForEach(id, root) {
-		attribute_t type_name;
-		cJSON *t = cJSON_GetObjectItem(id, "type");
-		if(t == nullptr) {
-			continue;
-		}
-		strncpy((char*)type_name, cJSON_GetStringValue(t), sizeof(attribute_t)-1);
-		const sensor_t *sensor = sensor_get_by_type_name(type_name);
-		if(sensor != nullptr) {
-			LOGI("update: sensor_id %d / type %s", idx, type_name);
-			device->sensors[idx] = *sensor;
-			device->sensors[idx++].in_use = true;
-		}
+	st_config_ctx_t ctx = { device, 0, { 0 }, { 0 }, 0 };
+	json_parser_t parser;
+	json_parser_init(&parser, st_config_token, &ctx);
+	if(!st_parse_response(http_client, &parser)) {
+		LOGW("incomplete device config: %d sensors configured", ctx.idx);
 	}
-	cJSON_Delete(root);
+	http_client_close(http_client);
 	return (req_status_t)resp.status;
 }
 
@@ -118,8 +311,229 @@ req_status_t st_configure_device(device_t *device) {
     return status;
 }
 
+/* count connects of the update client, each one is a full TLS handshake,
+ * and keep the start of the response body in the client buffer */
+static esp_err_t st_http_event_handler(esp_http_client_event_t *evt) {
+	if(evt->event_id == HTTP_EVENT_ON_CONNECTED) {
+		st_connects++;
+	}
+	if(evt->event_id == HTTP_EVENT_ON_DATA) {
+		char *buf = (char*)evt->user_data;
+		size_t len = MIN((size_t)evt->data_len, ST_HTTP_BUF_SZ - 1 - st_resp_len);
+		memcpy(buf + st_resp_len, evt->data, len);
+		st_resp_len += len;
+		buf[st_resp_len] = '\0';
+		return ESP_OK;
+	}
+	return http_event_handler(evt);
+}
+
+static void st_conn_record(uint32_t connects, int64_t start) {
+	uint32_t ms = (esp_timer_get_time() - start) / 1000;
+	st_conn.requests++;
+	if(st_connects != connects) {
+		st_conn.handshakes++;
+		st_conn.handshake_ms += ms;
+	} else {
+		st_conn.reused_ms += ms;
+	}
+}
+
+static void st_conn_log() {
+	static uint32_t logged = 0;
+	if(st_conn.requests == logged || st_conn.handshakes == 0) {
+		return;
+	}
+	logged = st_conn.requests;
+	uint32_t reused = st_conn.requests - st_conn.handshakes;
+	uint32_t handshake_avg = st_conn.handshake_ms / st_conn.handshakes;
+	uint32_t reused_avg = reused ? (st_conn.reused_ms / reused) : 0;
+	uint32_t saved = (handshake_avg > reused_avg) ? (reused * (handshake_avg - reused_avg)) : 0;
+	LOGI("connections: %d handshakes / %d requests (avg: %d ms vs %d ms reused, saved: ~%d ms)",
+			st_conn.handshakes, st_conn.requests, handshake_avg, reused_avg, saved);
+	st_queue_stats_t queue = st_queue_stats();
+	LOGI("pending events: high: %d/%d (coalesced: %d / dropped: %d)",
+			queue.high_water, ST_PENDING_SZ, queue.coalesced, queue.dropped);
+	const char *prio_name[NET_PRIO_MAX] = { "interactive", "bulk" };
+	for(uint8_t i=0; i<NET_PRIO_MAX; i++) {
+		stats_hist_t *hist = &st_conn.latency[i];
+		if(hist->count) {
+			LOGI("  %-11s n: %-6u p50: <%u ms / p99: <%u ms / max: %u ms", prio_name[i], hist->count,
+					stats_hist_percentile(hist, 50) / 1000, stats_hist_percentile(hist, 99) / 1000, hist->max / 1000);
+		}
+	}
+}
+
+st_conn_stats_t st_conn_stats() {
+	return st_conn;
+}
+
+static void st_record_latency(st_payload_t *payload) {
+	stats_hist_add(&st_conn.latency[payload->prio], esp_timer_get_time() - payload->ts);
+}
+
+static esp_err_t st_post(esp_http_client_handle_t client, char *url, char *body, size_t len) {
+	esp_http_client_set_url(client, url);
+	esp_http_client_set_post_field(client, body, len);
+	uint32_t connects = st_connects;
+	int64_t start = esp_timer_get_time();
+	// clear the previous response so an empty body reads as empty
+	char *resp_buf = nullptr;
+	esp_http_client_get_user_data(client, (void**)&resp_buf);
+	if(resp_buf) {
+		resp_buf[0] = '\0';
+	}
+	st_resp_len = 0;
+	esp_err_t err = esp_http_client_perform(client);
+	if(err == ESP_OK) {
+		st_conn_record(connects, start);
+	} else {
+		LOGW("failed to write st data: resp_code: 0x%04x", err);
+		// only drop the socket, the client and its config are reused
+		esp_http_client_close(client);
+	}
+	return err;
+}
+
+static void st_event_url(char *url, size_t len, st_payload_t *payload) {
+	snprintf(url, len, "%s" ST_DEVICE_ENDPOINT "%.*s", ST_CONFIG->apiurl,
+			(int)sizeof(payload->endpoint), payload->endpoint);
+}
+
+#ifdef ST_BATCH_EVENTS
+/* collect events for up to ST_BATCH_WINDOW_MS after the first one; once the
+ * batch holds an interactive event only what is already pending is added */
+static uint8_t st_batch_collect(st_payload_t *first) {
+	TickType_t start = xTaskGetTickCount();
+	TickType_t window = ST_BATCH_WINDOW_MS / portTICK_PERIOD_MS;
+	uint8_t interactive = (first->prio == NET_PRIO_INTERACTIVE);
+	uint8_t count = 1;
+
+	ST_BATCH[0] = *first;
+	while(count < ST_BATCH_MAX_EVENTS) {
+		TickType_t elapsed = xTaskGetTickCount() - start;
+		TickType_t wait = (interactive || elapsed >= window) ? 0 : window - elapsed;
+		if(!st_pending_take(&ST_BATCH[count], wait)) {
+			break;
+		}
+		interactive |= (ST_BATCH[count].prio == NET_PRIO_INTERACTIVE);
+		count++;
+	}
+	return count;
+}
+
+/* put a failed batch back; a newer value of the same event still wins */
+static void st_batch_requeue(uint8_t count) {
+	uint8_t requeued = 0;
+	for(uint8_t i=0; i<count; i++) {
+		if(++ST_BATCH[i].attempts < ST_EVENT_ATTEMPTS && st_pending_put(&ST_BATCH[i], true)) {
+			requeued++;
+		}
+	}
+	if(requeued < count) {
+		LOGE("max retries reached: dropped %d events", count - requeued);
+	}
+	if(requeued) {
+		LOGI("will try again (%d events)..", requeued);
+		vTaskDelay(DELAY_S5);
+	}
+}
+
+static size_t st_batch_body(uint8_t count) {
+	json_writer_t json;
+	json_writer_init(&json, ST_BATCH_BODY, sizeof(ST_BATCH_BODY));
+	json_array_begin(&json);
+	for(uint8_t i=0; i<count; i++) {
+		st_payload_t *event = &ST_BATCH[i];
+		json_object_begin(&json);
+		JSON_KEY(&json, "device");
+		json_string_n(&json, event->endpoint, sizeof(event->endpoint));
+		JSON_KEY(&json, "event");
+		json_raw(&json, event->body, strnlen(event->body, sizeof(event->body)));
+		json_object_end(&json);
+	}
+	json_array_end(&json);
+	return json_writer_finish(&json);
+}
+
+/* the response is an array of per-event status codes, in order */
+static void st_batch_result_token(json_parser_t *parser, json_token_t token, const char *value) {
+	uint8_t *idx = (uint8_t*)parser->ctx;
+	if(parser->depth != 1 || token == JSON_TOK_KEY || token == JSON_TOK_OBJECT_END ||
+			token == JSON_TOK_ARRAY_END || *idx >= ST_BATCH_MAX_EVENTS) {
+		return;
+	}
+	int status = (token == JSON_TOK_NUMBER) ? atoi(value) : 0;
+	if(status / 100 != 2) {
+		st_payload_t *event = &ST_BATCH[*idx];
+		LOGW("event rejected: %.*s: %d", (int)sizeof(event->endpoint), event->endpoint, status);
+		st_conn.events_rejected++;
+	}
+	(*idx)++;
+}
+
+static void st_batch_results(char *resp, uint8_t count) {
+	uint8_t idx = 0;
+	json_parser_t parser;
+	json_parser_init(&parser, st_batch_result_token, &idx);
+	if(!json_parser_feed(&parser, resp, strlen(resp)) || !json_parser_done(&parser) || idx != count) {
+		LOGW("batch response has no per-event results");
+	}
+}
+
+static uint8_t st_batch_send(esp_http_client_handle_t client, st_payload_t *first, char *resp) {
+	char url[100];
+	uint8_t err_cnt = 0;
+	uint8_t count = st_batch_collect(first);
+	size_t len = st_batch_body(count);
+	esp_err_t err;
+
+	if(len == 0) {
+		LOGE("batch of %d events exceeds %d bytes: dropped", count, ST_BATCH_BODY_SZ);
+		return 0;
+	}
+
+	snprintf(url, sizeof(url), "%s" ST_BATCH_ENDPOINT, ST_CONFIG->apiurl);
+	LOGD("stapi(POST): batch of %d events / %d bytes", count, len);
+	for(uint8_t attempt=0; (err = st_post(client, url, ST_BATCH_BODY, len)) != ESP_OK; attempt++) {
+		err_cnt++;
+		if(attempt) {
+			st_batch_requeue(count);
+			return err_cnt;
+		}
+		LOGI("will try again once more..");
+		vTaskDelay(DELAY_S5);
+	}
+
+	int status = esp_http_client_get_status_code(client);
+	// not found / method not allowed: the SmartApp predates batching
+	if(status == 404 || status == 405) {
+		LOGW("SmartApp has no batch endpoint: sending single events");
+		st_batch_supported = false;
+		for(uint8_t i=0; i<count; i++) {
+			st_event_url(url, sizeof(url), &ST_BATCH[i]);
+			if(st_post(client, url, ST_BATCH[i].body, strlen(ST_BATCH[i].body)) != ESP_OK) {
+				err_cnt++;
+			}
+		}
+	} else if(status / 100 == 2) {
+		st_conn.batches++;
+		st_conn.batch_events += count;
+		for(uint8_t i=0; i<count; i++) {
+			st_record_latency(&ST_BATCH[i]);
+		}
+		st_batch_results(resp, count);
+	} else if(status / 100 == 5) {
+		LOGW("batch failed: status: %d", status);
+		st_batch_requeue(count);
+	} else {
+		LOGW("batch rejected: status: %d: dropped %d events", status, count);
+	}
+	return err_cnt;
+}
+#endif
+
 static void st_queue_task(void *ptx) {
-    xSTQueue = xQueueCreate(6, ST_PAYLOAD_SZ);
 	st_payload_t payload;
 	char url[100];
 	char apikey[50];
@@ -133,17 +547,16 @@ static void st_queue_task(void *ptx) {
 
 	esp_http_client_config_t config = ST_CLIENT_CONFIG(http_resp_buf);
 	esp_http_client_handle_t client = nullptr;
-	uint8_t is_retry = false;
+	config.event_handler = st_http_event_handler;
 
     for(;;) {
         STACK_STATS
-		strncpy(url, ST_CONFIG->apiurl, sizeof(url));
-		strcat(url, ST_DEVICE_ENDPOINT);
-		memset(&payload, 0, ST_PAYLOAD_SZ);
-		if(xQueueReceive(xSTQueue, (void*)&payload, ST_QUEUE_TIMEOUT) != pdTRUE) {
+		memset(&payload, 0, sizeof(st_payload_t));
+		if(!st_pending_take(&payload, ST_QUEUE_TIMEOUT)) {
 			if(client != nullptr) {
 				esp_http_client_close(client);
 			}
+			st_conn_log();
 			continue;
 		}
 
@@ -153,26 +566,25 @@ static void st_queue_task(void *ptx) {
 			esp_http_client_set_header(client, "Authorization", apikey);
     		esp_http_client_set_header(client, "Content-Type", "application/json");
 		}
-		strncat(url, payload.endpoint, DEVICE_ID_SZ+2);
-		esp_http_client_set_url(client, url);
-    	esp_http_client_set_post_field(client, payload.body, strlen(payload.body));
-	    err = esp_http_client_perform(client);
+#ifdef ST_BATCH_EVENTS
+		if(st_batch_supported) {
+			wifi_err_check(st_batch_send(client, &payload, http_resp_buf));
+			continue;
+		}
+#endif
+		st_event_url(url, sizeof(url), &payload);
+	    err = st_post(client, url, payload.body, strlen(payload.body));
     	if (err == ESP_OK) {
+			st_record_latency(&payload);
             esp_http_client_get_status_code(client);
             esp_http_client_get_content_length(client);
-			is_retry = false;
 		} else {
-			LOGW("failed to write st data: resp_code: 0x%04x", err);
-			esp_http_client_cleanup(client);
-			client = nullptr;
 			err_cnt++;
-			if(is_retry) {
-				is_retry = false;
+			if(++payload.attempts >= ST_EVENT_ATTEMPTS) {
 				LOGE("max retries reached: giving up on this message");
 			} else {
-				is_retry = true;
-				LOGI("will try again once more..");
-				xQueueSendToFront(xSTQueue, (void*)&payload, DELAY_S4);
+				LOGI("will try again (%d/%d)..", payload.attempts, ST_EVENT_ATTEMPTS - 1);
+				st_pending_put(&payload, true);
 				vTaskDelay(DELAY_S5);
 			}
 		}
@@ -185,61 +597,71 @@ uint8_t st_queue_payload(device_data_t *payload) {
 	st_payload_t st_payload;
 	char buf[30];
 
-    snprintf(buf, sizeof(buf), "%s-%d", payload->device_id, payload->data.sensor_id);
+    snprintf(buf, sizeof(buf), DEVICE_ADDR_FMT "-%d", DEVICE_ADDR_ARGS(payload->addr), payload->data.sensor_id);
 	memcpy(st_payload.endpoint, buf, sizeof(st_payload.endpoint));
-    cJSON *app_event = cJSON_CreateObject();
+	st_payload.type = payload->data.type;
+	st_payload.prio = network_payload_prio(payload);
+	st_payload.attempts = 0;
+	st_payload.ts = payload->ts;
 
 	attribute_t type_name;
 	sensor_type_get_name(payload->data.type, type_name);
-    cJSON *type = cJSON_CreateString((char*)type_name);
-    cJSON *v    = NULL;
 
-    sensor_val_t *vals = payload->data.values;
-    for(uint8_t i=0; i<payload->data.num_values; i++) {
-	    switch(payload->data.type) {
-		    case SENSOR_BATTERY: {
-			    v = cJSON_CreateNumber(vals[i].u16);
-			    cJSON *cap  = cJSON_CreateString("battery");
-			    cJSON *attr  = cJSON_CreateString("battery");
-  			    cJSON_AddItemToObject(app_event, "attribute", attr);
-  			    cJSON_AddItemToObject(app_event, "capability", cap);
-		    } break;
+	json_writer_t json;
+	json_writer_init(&json, st_payload.body, sizeof(st_payload.body));
+	json_object_begin(&json);
+	if(payload->data.type == SENSOR_BATTERY) {
+		JSON_KEY(&json, "attribute");
+		json_string(&json, "battery");
+		JSON_KEY(&json, "capability");
+		json_string(&json, "battery");
+	}
+	JSON_KEY(&json, "type");
+	json_string(&json, (char*)type_name);
 
+	// the event carries the last value of the sensor
+	if(payload->data.num_values) {
+		sensor_val_t *val = &payload->data.values[payload->data.num_values - 1];
+		JSON_KEY(&json, "value");
+	    switch(payload->data.type) {
 		    case SENSOR_MOTION: {
-			    strncpy(buf, MOTION_STRING[vals[i].u16], sizeof(buf)-1);
+			    strncpy(buf, MOTION_STRING[val->u16], sizeof(buf)-1);
                 enum_to_str(buf);
-			    v = cJSON_CreateString(buf);
+			    json_string(&json, buf);
 		    } break;
 
 		    case SENSOR_CONTACT: {
-			    strncpy(buf, CONTACT_STRING[vals[i].u16], sizeof(buf)-1);
+			    strncpy(buf, CONTACT_STRING[val->u16], sizeof(buf)-1);
 			    lowerchrs(buf);
-			    v = cJSON_CreateString(buf);
+			    json_string(&json, buf);
 		    } break;
 
 		    case SENSOR_PRESENCE: {
-			    strncpy(buf, PRESENCE_STRING[vals[i].u16], sizeof(buf)-1);
+			    strncpy(buf, PRESENCE_STRING[val->u16], sizeof(buf)-1);
                 enum_to_str(buf);
-			    v = cJSON_CreateString(buf);
+			    json_string(&json, buf);
 		    } break;
 
 		    default: {
-			    v = cJSON_CreateNumber(vals[i].u16);
+			    json_int(&json, val->u16);
 		    } break;
         }
     }
+	json_object_end(&json);
 
-    cJSON_AddItemToObject(app_event, "type", type);
-    cJSON_AddItemToObject(app_event, "value", v);
-
-    char *app_body = cJSON_PrintUnformatted(app_event);
-	strncpy(st_payload.body, app_body, sizeof(st_payload.body));
-
-    cJSON_Delete(app_event);
-    cJSON_free(app_body);
-
+	if(!json_writer_finish(&json)) {
+		LOGE("stapi: %s event for %.*s exceeds %d bytes: dropped", type_name,
+				(int)sizeof(st_payload.endpoint), st_payload.endpoint, sizeof(st_payload.body));
+		return false;
+	}
     LOGI("stapi(POST): %s", st_payload.body);
-	return xQueueSend(xSTQueue, &st_payload, ST_QUEUE_TIMEOUT);
+	if(!st_pending_put(&st_payload, false)) {
+		return false;
+	}
+	if(xSTTask) {
+		xTaskNotifyGive(xSTTask);
+	}
+	return true;
 }
 
 uint8_t st_send_payload(device_data_t *payload) {
@@ -254,5 +676,5 @@ void st_app_init() {
 #ifdef CREATE_STATIC_DEVICES
 	bt_set_device_create_cb((bt_device_create_cb_t)st_create_device);
 #endif
-	xTaskCreatePinnedToCore(st_queue_task, "st_app_queue", ST_QUEUE_STACK_SZ, NULL, NET_QUEUE_PRIO, NULL, 1);
+	xTaskCreatePinnedToCore(st_queue_task, "st_app_queue", ST_QUEUE_STACK_SZ, NULL, NET_QUEUE_PRIO, &xSTTask, 1);
 }
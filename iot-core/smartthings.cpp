@@ -3,7 +3,6 @@
 #include "tcpip_adapter.h"
 #include "esp_http_server.h"
 #include "nvs_flash.h"
-#include "cJSON.h"
 #include "network.h"
 #include "sensor.h"
 #include "ble.h"
@@ -181,7 +180,7 @@ void smartthings_init() {
 
 http_response_t st_api_request(http_client_t *http_client,
                                esp_http_client_method_t verb,
-                               char *endpoint) {
+                               const char *endpoint) {
     char buf[ST_API_BUF_LEN];
     strncpy(buf, ST_CONFIG->apiurl, sizeof(buf) - 1);
 	http_loc_t loc = parse_url(buf);
@@ -0,0 +1,347 @@
+#include <stddef.h>
+#include "iot-common.h"
+#include "esp_partition.h"
+#include "esp_crc.h"
+#include "spool.h"
+
+static const char *TAG = "spool";
+
+#define SPOOL_REC_ERASED        0xff
+#define SPOOL_REC_DONE          0x00
+#define SPOOL_LEN_ERASED        0xffff
+#define SPOOL_ALIGN(len)        (((len) + 3) & ~3)
+
+/* sector header, written right after the sector is erased */
+typedef struct spool_sector_hdr {
+	uint32_t magic;
+	uint32_t seq;
+	uint32_t erase_cnt;
+	uint32_t crc;
+} spool_sector_hdr_t;
+
+/* record header.  `commit` is programmed once the data is written, so a
+ * record torn by a reset is never read back, and `consumed` is programmed
+ * once the record has been delivered.  Both only ever clear bits. */
+typedef struct spool_record_hdr {
+	uint8_t  commit;
+	uint8_t  consumed;
+	uint16_t len;
+	uint32_t crc;
+} spool_record_hdr_t;
+
+#define SPOOL_SECTOR_HDR_SZ     sizeof(spool_sector_hdr_t)
+#define SPOOL_RECORD_HDR_SZ     sizeof(spool_record_hdr_t)
+
+typedef struct spool {
+	const esp_partition_t	*part;
+	uint16_t				sectors;
+	uint32_t				seq;
+	spool_cursor_t			read;
+	spool_cursor_t			write;
+	uint32_t				erase_cnt[SPOOL_MAX_SECTORS];
+	spool_stats_t			stats;
+} spool_t;
+
+static spool_t SPOOL;
+
+/* all partition access goes through these */
+static uint8_t spool_flash_read(uint16_t sector, uint16_t offset, void *buf, size_t len) {
+	size_t addr = (sector * SPOOL_SECTOR_SZ) + offset;
+	return (esp_partition_read(SPOOL.part, addr, buf, len) == ESP_OK);
+}
+
+static uint8_t spool_flash_write(uint16_t sector, uint16_t offset, const void *buf, size_t len) {
+	size_t addr = (sector * SPOOL_SECTOR_SZ) + offset;
+	return (esp_partition_write(SPOOL.part, addr, buf, len) == ESP_OK);
+}
+
+static uint8_t spool_flash_erase(uint16_t sector) {
+	return (esp_partition_erase_range(SPOOL.part, sector * SPOOL_SECTOR_SZ, SPOOL_SECTOR_SZ) == ESP_OK);
+}
+
+static uint8_t spool_read_sector_hdr(uint16_t sector, spool_sector_hdr_t *hdr) {
+	if(!spool_flash_read(sector, 0, hdr, SPOOL_SECTOR_HDR_SZ)) {
+		return false;
+	}
+	return (hdr->magic == SPOOL_SECTOR_MAGIC &&
+			hdr->crc == esp_crc32_le(0, (const uint8_t*)hdr, SPOOL_SECTOR_HDR_SZ - sizeof(uint32_t)));
+}
+
+static uint8_t spool_format_sector(uint16_t sector) {
+	spool_sector_hdr_t hdr;
+	uint32_t erase_cnt = SPOOL.erase_cnt[sector] + 1;
+
+	if(!spool_flash_erase(sector)) {
+		LOGE("failed to erase sector %d", sector);
+		return false;
+	}
+	hdr.magic = SPOOL_SECTOR_MAGIC;
+	hdr.seq = ++SPOOL.seq;
+	hdr.erase_cnt = erase_cnt;
+	hdr.crc = esp_crc32_le(0, (const uint8_t*)&hdr, SPOOL_SECTOR_HDR_SZ - sizeof(uint32_t));
+	SPOOL.erase_cnt[sector] = erase_cnt;
+	return spool_flash_write(sector, 0, &hdr, SPOOL_SECTOR_HDR_SZ);
+}
+
+static inline uint16_t spool_next_sector(uint16_t sector) {
+	return (sector + 1) % SPOOL.sectors;
+}
+
+static inline uint8_t spool_at_write(const spool_cursor_t *pos) {
+	return (pos->sector == SPOOL.write.sector && pos->offset >= SPOOL.write.offset);
+}
+
+/* position pos at the next committed record header, crossing into the
+ * following sector at an erased or torn header.  false at the write position */
+static uint8_t spool_record_at(spool_cursor_t *pos, spool_record_hdr_t *hdr) {
+	for(uint16_t hops=0; hops <= SPOOL.sectors; hops++) {
+		if(spool_at_write(pos)) {
+			return false;
+		}
+		// never formatted sectors hold no records
+		if(SPOOL.erase_cnt[pos->sector] &&
+				(pos->offset + SPOOL_RECORD_HDR_SZ) <= SPOOL_SECTOR_SZ &&
+				spool_flash_read(pos->sector, pos->offset, hdr, SPOOL_RECORD_HDR_SZ) &&
+				hdr->len != SPOOL_LEN_ERASED && hdr->commit == SPOOL_REC_DONE &&
+				(pos->offset + SPOOL_RECORD_HDR_SZ + hdr->len) <= SPOOL_SECTOR_SZ) {
+			return true;
+		}
+		if(pos->sector == SPOOL.write.sector) {
+			return false;
+		}
+		pos->sector = spool_next_sector(pos->sector);
+		pos->offset = SPOOL_SECTOR_HDR_SZ;
+	}
+	return false;
+}
+
+static inline void spool_record_skip(spool_cursor_t *pos, const spool_record_hdr_t *hdr) {
+	pos->offset += SPOOL_RECORD_HDR_SZ + SPOOL_ALIGN(hdr->len);
+}
+
+/* count undelivered records from pos up to the end of its sector */
+static uint32_t spool_count_sector(spool_cursor_t pos) {
+	spool_record_hdr_t hdr;
+	uint16_t sector = pos.sector;
+	uint32_t count = 0;
+	while(spool_record_at(&pos, &hdr) && pos.sector == sector) {
+		if(hdr.consumed == SPOOL_REC_ERASED) {
+			count++;
+		}
+		spool_record_skip(&pos, &hdr);
+	}
+	return count;
+}
+
+/* find the append position of the newest sector after a restart */
+static void spool_recover_write(uint16_t sector) {
+	spool_record_hdr_t hdr;
+	uint16_t offset = SPOOL_SECTOR_HDR_SZ;
+
+	while((offset + SPOOL_RECORD_HDR_SZ) <= SPOOL_SECTOR_SZ) {
+		if(!spool_flash_read(sector, offset, &hdr, SPOOL_RECORD_HDR_SZ)) {
+			break;
+		}
+		if(hdr.len == SPOOL_LEN_ERASED && hdr.commit == SPOOL_REC_ERASED) {
+			SPOOL.write = { sector, offset };
+			return;
+		}
+		if(hdr.commit != SPOOL_REC_DONE || (offset + SPOOL_RECORD_HDR_SZ + hdr.len) > SPOOL_SECTOR_SZ) {
+			LOGW("torn record at %d:%d: sealing sector", sector, offset);
+			break;
+		}
+		offset += SPOOL_RECORD_HDR_SZ + SPOOL_ALIGN(hdr.len);
+	}
+	// nothing more fits, the next append starts a new sector
+	SPOOL.write = { sector, (uint16_t)SPOOL_SECTOR_SZ };
+}
+
+uint8_t spool_init() {
+	SPOOL.part = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, SPOOL_PARTITION_LABEL);
+	if(SPOOL.part == nullptr) {
+		LOGI("no '%s' partition: spool disabled", SPOOL_PARTITION_LABEL);
+		return false;
+	}
+	SPOOL.sectors = MIN(SPOOL.part->size / SPOOL_SECTOR_SZ, SPOOL_MAX_SECTORS);
+	if(SPOOL.sectors < 2) {
+		LOGW("'%s' partition too small: spool disabled", SPOOL_PARTITION_LABEL);
+		SPOOL.part = nullptr;
+		return false;
+	}
+
+	spool_sector_hdr_t hdr;
+	int32_t newest = -1;
+	for(uint16_t i=0; i<SPOOL.sectors; i++) {
+		if(!spool_read_sector_hdr(i, &hdr)) {
+			continue;
+		}
+		SPOOL.erase_cnt[i] = hdr.erase_cnt;
+		if(newest < 0 || hdr.seq > SPOOL.seq) {
+			SPOOL.seq = hdr.seq;
+			newest = i;
+		}
+	}
+
+	if(newest < 0) {
+		LOGI("formatting spool: %d sectors", SPOOL.sectors);
+		if(!spool_format_sector(0)) {
+			SPOOL.part = nullptr;
+			return false;
+		}
+		SPOOL.write = { 0, SPOOL_SECTOR_HDR_SZ };
+		SPOOL.read = SPOOL.write;
+	} else {
+		spool_recover_write(newest);
+		// sectors are used in order, so the oldest is the one after the newest
+		SPOOL.read = { spool_next_sector(newest), SPOOL_SECTOR_HDR_SZ };
+		spool_record_hdr_t rec;
+		spool_cursor_t pos = SPOOL.read;
+		uint8_t found = false;
+		while(spool_record_at(&pos, &rec)) {
+			if(rec.consumed == SPOOL_REC_ERASED) {
+				if(!found) {
+					SPOOL.read = pos;
+					found = true;
+				}
+				SPOOL.stats.pending++;
+			}
+			spool_record_skip(&pos, &rec);
+		}
+		if(!found) {
+			SPOOL.read = SPOOL.write;
+		}
+	}
+	LOGI("spool ready: %d sectors / %d pending", SPOOL.sectors, SPOOL.stats.pending);
+	return true;
+}
+
+uint8_t spool_enabled() {
+	return (SPOOL.part != nullptr);
+}
+
+static uint8_t spool_rotate() {
+	uint16_t next = spool_next_sector(SPOOL.write.sector);
+	if(SPOOL.stats.pending && SPOOL.read.sector == next) {
+		uint32_t lost = spool_count_sector(SPOOL.read);
+		SPOOL.stats.dropped += lost;
+		SPOOL.stats.pending -= MIN(lost, SPOOL.stats.pending);
+		LOGW("spool full: dropped %d records", lost);
+		SPOOL.read = { spool_next_sector(next), SPOOL_SECTOR_HDR_SZ };
+	}
+	if(!spool_format_sector(next)) {
+		return false;
+	}
+	SPOOL.write = { next, SPOOL_SECTOR_HDR_SZ };
+	if(SPOOL.stats.pending == 0) {
+		SPOOL.read = SPOOL.write;
+	}
+	return true;
+}
+
+uint8_t spool_append(const void *data, uint16_t len) {
+	if(!spool_enabled() || len == 0 || len > SPOOL_RECORD_MAX) {
+		return false;
+	}
+	uint16_t size = SPOOL_RECORD_HDR_SZ + SPOOL_ALIGN(len);
+	if((SPOOL.write.offset + size) > SPOOL_SECTOR_SZ) {
+		if(!spool_rotate()) {
+			return false;
+		}
+	}
+
+	spool_record_hdr_t hdr;
+	hdr.commit = SPOOL_REC_ERASED;
+	hdr.consumed = SPOOL_REC_ERASED;
+	hdr.len = len;
+	hdr.crc = esp_crc32_le(0, (const uint8_t*)data, len);
+
+	spool_cursor_t pos = SPOOL.write;
+	uint8_t commit = SPOOL_REC_DONE;
+	SPOOL.write.offset += size;
+	if(!spool_flash_write(pos.sector, pos.offset, &hdr, SPOOL_RECORD_HDR_SZ) ||
+			!spool_flash_write(pos.sector, pos.offset + SPOOL_RECORD_HDR_SZ, data, len) ||
+			!spool_flash_write(pos.sector, pos.offset + offsetof(spool_record_hdr_t, commit), &commit, 1)) {
+		// readers stop at an uncommitted record, so seal the sector like a torn write
+		LOGE("failed to write record at %d:%d: sealing sector", pos.sector, pos.offset);
+		SPOOL.write.offset = SPOOL_SECTOR_SZ;
+		return false;
+	}
+	if(SPOOL.stats.pending == 0) {
+		SPOOL.read = pos;
+	}
+	SPOOL.stats.pending++;
+	SPOOL.stats.written++;
+	return true;
+}
+
+uint32_t spool_pending() {
+	return SPOOL.stats.pending;
+}
+
+spool_cursor_t spool_cursor() {
+	return SPOOL.read;
+}
+
+uint8_t spool_next(spool_cursor_t *cursor, void *buf, uint16_t size, uint16_t *len) {
+	spool_record_hdr_t hdr;
+	if(!spool_enabled()) {
+		return false;
+	}
+	while(spool_record_at(cursor, &hdr)) {
+		spool_cursor_t pos = *cursor;
+		spool_record_skip(cursor, &hdr);
+		if(hdr.consumed != SPOOL_REC_ERASED || hdr.len > size) {
+			continue;
+		}
+		if(!spool_flash_read(pos.sector, pos.offset + SPOOL_RECORD_HDR_SZ, buf, hdr.len)) {
+			return false;
+		}
+		if(esp_crc32_le(0, (const uint8_t*)buf, hdr.len) != hdr.crc) {
+			LOGW("bad record crc at %d:%d: skipping", pos.sector, pos.offset);
+			continue;
+		}
+		*len = hdr.len;
+		return true;
+	}
+	return false;
+}
+
+void spool_consume(const spool_cursor_t *cursor) {
+	spool_record_hdr_t hdr;
+	spool_cursor_t pos = SPOOL.read;
+	uint8_t consumed = SPOOL_REC_DONE;
+
+	if(!spool_enabled()) {
+		return;
+	}
+	// records are walked in the same steps as spool_next(), so pos lands on the cursor
+	while(!(pos.sector == cursor->sector && pos.offset >= cursor->offset)) {
+		if(!spool_record_at(&pos, &hdr) ||
+				(pos.sector == cursor->sector && pos.offset >= cursor->offset)) {
+			break;
+		}
+		if(hdr.consumed == SPOOL_REC_ERASED) {
+			spool_flash_write(pos.sector, pos.offset + offsetof(spool_record_hdr_t, consumed), &consumed, 1);
+			SPOOL.stats.pending -= MIN(1, SPOOL.stats.pending);
+			SPOOL.stats.drained++;
+		}
+		spool_record_skip(&pos, &hdr);
+	}
+	SPOOL.read = *cursor;
+	if(SPOOL.stats.pending == 0) {
+		SPOOL.read = SPOOL.write;
+	}
+}
+
+spool_stats_t spool_stats() {
+	spool_stats_t stats = SPOOL.stats;
+	stats.sectors = SPOOL.sectors;
+	stats.erase_min = stats.erase_max = 0;
+	for(uint16_t i=0; i<SPOOL.sectors; i++) {
+		if(i == 0 || SPOOL.erase_cnt[i] < stats.erase_min) {
+			stats.erase_min = SPOOL.erase_cnt[i];
+		}
+		stats.erase_max = MAX(stats.erase_max, SPOOL.erase_cnt[i]);
+	}
+	return stats;
+}
@@ -0,0 +1,90 @@
+#include "iot-common.h"
+#include "esp_heap_caps.h"
+#include "devices.h"
+#include "stats.h"
+
+static const char *TAG = "stats";
+
+static const char *PIPELINE_STRING[] = { PIPELINE_STAGES(BUILD_STRINGS) };
+
+static stats_hist_t         PIPELINE_HIST[PIPE_MAX];
+static unsigned long int    pipeline_window_ts = 0;
+
+void stats_hist_add(stats_hist_t *hist, uint32_t us) {
+	uint8_t idx = us ? (31 - __builtin_clz(us)) : 0;
+	if(idx >= STATS_HIST_BUCKETS) {
+		idx = STATS_HIST_BUCKETS - 1;
+	}
+	__atomic_add_fetch(&hist->buckets[idx], 1, __ATOMIC_RELAXED);
+	__atomic_add_fetch(&hist->count, 1, __ATOMIC_RELAXED);
+
+	uint32_t max = __atomic_load_n(&hist->max, __ATOMIC_RELAXED);
+	while(us > max && !__atomic_compare_exchange_n(&hist->max, &max, us,
+				false, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+}
+
+uint32_t stats_hist_percentile(const stats_hist_t *hist, uint8_t pct) {
+	uint32_t count = hist->count;
+	if(count == 0) {
+		return 0;
+	}
+	uint32_t rank = ((count * pct) + 99) / 100;
+	uint32_t seen = 0;
+	for(uint8_t i=0; i<STATS_HIST_BUCKETS; i++) {
+		seen += hist->buckets[i];
+		if(seen >= rank) {
+			return MIN((2UL << i), hist->max);
+		}
+	}
+	return hist->max;
+}
+
+void stats_hist_reset(stats_hist_t *hist) {
+	memset((void*)hist, 0, sizeof(stats_hist_t));
+}
+
+void pipeline_stats_record(pipeline_stage_t stage, uint32_t us) {
+	if(stage < PIPE_MAX) {
+		stats_hist_add(&PIPELINE_HIST[stage], us);
+	}
+}
+
+void pipeline_stats_take(stats_hist_t *hists) {
+	for(uint8_t i=0; i<PIPE_MAX; i++) {
+		memcpy((void*)&hists[i], (void*)&PIPELINE_HIST[i], sizeof(stats_hist_t));
+		stats_hist_reset(&PIPELINE_HIST[i]);
+	}
+}
+
+void pipeline_stats_log() {
+#ifdef PIPELINE_STATS
+	unsigned long int now = MILLIS;
+	unsigned long int elapsed = now - pipeline_window_ts;
+	if(pipeline_window_ts && elapsed < PIPELINE_STATS_LOG_MS) {
+		return;
+	}
+	pipeline_window_ts = now;
+	if(elapsed == 0) {
+		return;
+	}
+
+	stats_hist_t *queued = &PIPELINE_HIST[PIPE_QUEUE];
+	payload_pool_stats_t pool = device_payload_pool_stats();
+	uint32_t rate = ((uint64_t)queued->count * 100000) / elapsed;
+	LOGI("pipeline: %u payloads in %lu ms (%u.%02u/s) / heap low: %d / pool high: %d/%d",
+			queued->count, elapsed, rate / 100, rate % 100,
+			heap_caps_get_minimum_free_size(MALLOC_CAP_INTERNAL),
+			pool.high_water, pool.size);
+
+	for(uint8_t i=0; i<PIPE_MAX; i++) {
+		stats_hist_t *hist = &PIPELINE_HIST[i];
+		if(hist->count == 0) {
+			continue;
+		}
+		LOGI("  %-8s n: %-6u p50: <%u us / p99: <%u us / max: %u us", PIPELINE_STRING[i],
+				hist->count, stats_hist_percentile(hist, 50),
+				stats_hist_percentile(hist, 99), hist->max);
+		stats_hist_reset(hist);
+	}
+#endif
+}
@@ -0,0 +1,112 @@
+// Advertisement flood benchmark: foreign advertisers handed to onResult()
+// as fast as it takes them, for a range of advertiser populations around
+// BLE_ADV_CACHE_SZ.  Built against iot-core
+// with BLE_BEACONS, so every advertisement reaches onResult() as it does
+// on a beacon gateway, once with the advertisement cache
+// (iot-host-adv) and once with DISABLE_ADV_CACHE (iot-host-adv-nocache).
+//
+// The NimBLEAdvertisedDevice of every advertiser is built once up front
+// and passed with nimble_host_result(), so the ns per advertisement are
+// onResult() alone: the cache lookup, or the registry lookup, beacon frame
+// check and service UUID match it saves.  The shim parses the raw payload
+// on every getter call, as NimBLE does.
+//
+//   iot-host-adv[-nocache] [advertisements]
+
+#include "nimble-host.h"
+#include "network.h"
+#include "devices.h"
+#include "ble.h"
+#include "bench.h"
+
+static const uint16_t POPULATIONS[] = { 16, 64, 256, 512, 1024 };
+
+static const uint8_t IBEACON[] = {
+    0x4c, 0x00, 0x02, 0x15, 0xe2, 0xc5, 0x6d, 0xb5, 0xdf, 0xfb, 0x48, 0xd2,
+    0xb0, 0x60, 0xd0, 0xf5, 0xa7, 0x10, 0x96, 0xe0, 0x00, 0x01, 0x00, 0x02, 0xc5 };
+static const uint8_t BATTERY[] = { 0x5a };
+
+/* phones, trackers, iBeacons and the like, none of them ours */
+static void adv_make(nimble_host_adv_t *adv, uint32_t *seed, uint16_t i) {
+    memset(adv, 0, sizeof(nimble_host_adv_t));
+    uint32_t r = xorshift(seed);
+    memcpy(adv->addr, &r, 4);
+    adv->addr[4] = i >> 8;
+    adv->addr[5] = i & 0xff;
+    adv->addr_type = BLE_ADDR_RANDOM;
+    adv->rssi = -40 - (r % 50);
+    adv->connectable = (i & 1);
+    switch(i % 4) {
+        case 0:
+            adv->uuids[0] = "0000fe9f-0000-1000-8000-00805f9b34fb";
+            break;
+        case 1:
+            adv->mfg_data = IBEACON;
+            adv->mfg_data_len = sizeof(IBEACON);
+            break;
+        case 2:
+            adv->uuids[0] = "180f";
+            adv->svc_data_uuid = "180f";
+            adv->svc_data = BATTERY;
+            adv->svc_data_len = sizeof(BATTERY);
+            break;
+        default:
+            break;
+    }
+}
+
+int main(int argc, char **argv) {
+    uint32_t count = (argc > 1) ? strtoul(argv[1], NULL, 10) : 500000;
+    uint32_t seed = 0x51ed270b;
+
+    host_log_level(ESP_LOG_WARN);
+    nvs_flash_init();
+    device_init();
+    ble_init();
+    bt_scan_enable();
+
+    nimble_host_adv_t adv;
+    NimBLEAdvertisedDevice *devices[1024];
+    for(uint16_t i=0; i<1024; i++) {
+        adv_make(&adv, &seed, i);
+        devices[i] = nimble_host_adv_device(&adv);
+    }
+    for(uint16_t tries=0; !nimble_host_advertise(&adv); tries++) {
+        if(tries == 500) {
+            printf("the scan did not start\n");
+            return 1;
+        }
+        vTaskDelay(10 / portTICK_PERIOD_MS);
+    }
+
+#ifdef DISABLE_ADV_CACHE
+    printf("advertisement cache disabled\n");
+#else
+    printf("advertisement cache of %u entries\n", ble_adv_cache_stats().size);
+#endif
+    printf("%-11s %10s %8s %10s %10s %10s %10s\n", "advertisers", "adv/s", "ns/adv",
+            "cpu@1k/s", "hits", "misses", "evictions");
+    for(uint16_t population : POPULATIONS) {
+        // one round first, so the cache holds what it can
+        for(uint16_t i=0; i<population; i++) {
+            nimble_host_result(devices[i]);
+        }
+        ble_adv_cache_stats_t before = ble_adv_cache_stats();
+        uint32_t reported = 0;
+        int64_t start = esp_timer_get_time();
+        for(uint32_t i=0; i<count; i++) {
+            reported += nimble_host_result(devices[i % population]);
+        }
+        int64_t elapsed = esp_timer_get_time() - start;
+        ble_adv_cache_stats_t after = ble_adv_cache_stats();
+        if(reported != count) {
+            printf("%u of %u advertisements reached onResult()\n", reported, count);
+            return 1;
+        }
+        double ns = elapsed * 1e3 / count;
+        printf("%-11u %10.0f %8.0f %9.2f%% %10u %10u %10u\n", population, count * 1e6 / elapsed, ns,
+                ns * 1000 / 1e7, after.hits - before.hits, after.misses - before.misses,
+                after.evictions - before.evictions);
+    }
+    return 0;
+}
@@ -0,0 +1,41 @@
+#ifndef HOST_BENCH_H_
+#define HOST_BENCH_H_
+
+#include <stdint.h>
+#include <string.h>
+#include "devices.h"
+
+/*!
+    @file
+    @brief Helpers shared by the benchmarks
+
+    A fixed seed makes every run draw the same sequence, so results of two
+    builds compare like for like.
+ */
+
+/*!
+    @brief Next value of a 32-bit xorshift generator
+    @param state generator state, any value but 0
+    @return uint32_t
+ */
+static inline uint32_t xorshift(uint32_t *state) {
+    *state ^= *state << 13;
+    *state ^= *state >> 17;
+    *state ^= *state << 5;
+    return *state;
+}
+
+/*!
+    @brief Random device address drawn from `seed`
+    @param seed xorshift() state
+    @return device_addr_t
+ */
+static inline device_addr_t bench_random_addr(uint32_t *seed) {
+    device_addr_t addr;
+    uint32_t hi = xorshift(seed), lo = xorshift(seed);
+    memcpy(&addr.val[0], &hi, 4);
+    memcpy(&addr.val[4], &lo, 2);
+    return addr;
+}
+
+#endif
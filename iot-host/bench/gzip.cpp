@@ -0,0 +1,194 @@
+// Compression benchmark: ratio against CPU time of gzip_compress() on
+// InfluxDB line protocol, for the body sizes the Influx lane posts, with
+// zlib at levels 1 and 6 as a reference.  Every body is inflated again
+// with zlib and compared to the input.  zlib's times include setting up
+// its stream, as a fresh deflate per request would on the device.
+//
+// The trace is synthetic unless a file is given: line protocol, one point
+// per line, e.g. request bodies captured from the Influx lane.  Built once
+// per encoder configuration (GZIP_WINDOW_SZ / GZIP_HASH_SZ / GZIP_MAX_CHAIN),
+// see CMakeLists.txt.
+//
+//   iot-host-gzip-<config> [trace]
+
+#include <inttypes.h>
+#include <zlib.h>
+#include "influx.h"
+#include "gzip.h"
+#include "bench.h"
+
+#define TRACE_POINTS    4096
+#define TRACE_DEVICES   8
+
+static const uint16_t BATCH_POINTS[] = { 1, 2, 5, 20, 50, 100, 300 };
+
+typedef struct {
+    char    *data;
+    size_t  len;
+    size_t  *lines;     // offset of every line, plus one past the end
+    size_t  points;
+} trace_t;
+
+typedef struct {
+    size_t  in;
+    size_t  out;
+    int64_t us;
+} gz_total_t;
+
+/* points the way influx_queue_payload() formats them: a temperature and a
+   humidity sensor per device reporting every ~10 s, contact changes now
+   and then */
+static void trace_synthetic(trace_t *trace) {
+    static const char *SENSORS[] = { "temperature", "humidity", "contact" };
+    static const char *ATTRS[] = { "temperature", "humidity", "contact" };
+    uint32_t seed = 0x1234567;
+    int16_t level[TRACE_DEVICES][3] = {};
+    int64_t ts = 1760000000000LL;
+
+    trace->data = (char*)malloc(TRACE_POINTS * INFLUX_QUERY_SZ);
+    trace->len = 0;
+    for(uint16_t i=0; i<TRACE_POINTS; i++) {
+        uint8_t dev = xorshift(&seed) % TRACE_DEVICES;
+        uint8_t sensor = (xorshift(&seed) % 16 == 0) ? 2 : (xorshift(&seed) & 1);
+        int16_t *val = &level[dev][sensor];
+        if(sensor == 2) {
+            *val = !*val;
+        } else {
+            *val += (int16_t)(xorshift(&seed) % 5) - 2;
+        }
+        device_addr_t addr = { { 0xa4, 0xc1, 0x38, 0x10, 0x20, (uint8_t)(0x30 + dev) } };
+        ts += 1000 + (xorshift(&seed) % 1500);
+        trace->len += sprintf(trace->data + trace->len, INFLUX_BASE_QUERY " %s=%d %" PRId64 "\n",
+                SENSORS[sensor], DEVICE_ADDR_ARGS(addr), sensor, ATTRS[sensor],
+                (sensor == 2) ? *val : 2000 + *val * 10, ts);
+    }
+}
+
+static bool trace_read(trace_t *trace, const char *path) {
+    FILE *f = fopen(path, "r");
+    if(!f) {
+        perror(path);
+        return false;
+    }
+    fseek(f, 0, SEEK_END);
+    trace->len = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    trace->data = (char*)malloc(trace->len + 1);
+    trace->len = fread(trace->data, 1, trace->len, f);
+    fclose(f);
+    if(trace->len && trace->data[trace->len - 1] != '\n') {
+        trace->data[trace->len++] = '\n';
+    }
+    return trace->len > 0;
+}
+
+static void trace_index(trace_t *trace) {
+    trace->points = 0;
+    for(size_t i=0; i<trace->len; i++) {
+        trace->points += (trace->data[i] == '\n');
+    }
+    trace->lines = (size_t*)malloc((trace->points + 1) * sizeof(size_t));
+    size_t n = 0;
+    trace->lines[n++] = 0;
+    for(size_t i=0; i<trace->len; i++) {
+        if(trace->data[i] == '\n') {
+            trace->lines[n++] = i + 1;
+        }
+    }
+}
+
+static bool gz_verify(const uint8_t *gz, size_t gz_len, const char *body, size_t len, uint8_t *tmp) {
+    z_stream zs = {};
+    if(inflateInit2(&zs, 16 + MAX_WBITS) != Z_OK) {
+        return false;
+    }
+    zs.next_in = (Bytef*)gz;
+    zs.avail_in = gz_len;
+    zs.next_out = tmp;
+    zs.avail_out = len + 1;
+    int ret = inflate(&zs, Z_FINISH);
+    bool ok = (ret == Z_STREAM_END) && (zs.total_out == len) && memcmp(tmp, body, len) == 0;
+    inflateEnd(&zs);
+    return ok;
+}
+
+static size_t zlib_compress(int level, const char *body, size_t len, uint8_t *out, size_t size) {
+    z_stream zs = {};
+    deflateInit2(&zs, level, Z_DEFLATED, 16 + MAX_WBITS, 8, Z_DEFAULT_STRATEGY);
+    zs.next_in = (Bytef*)body;
+    zs.avail_in = len;
+    zs.next_out = out;
+    zs.avail_out = size;
+    int ret = deflate(&zs, Z_FINISH);
+    size_t out_len = zs.total_out;
+    deflateEnd(&zs);
+    return (ret == Z_STREAM_END) ? out_len : 0;
+}
+
+static void report(const gz_total_t *t, size_t bodies) {
+    printf(" %6.1f%% %7.1f", 100.0 * t->out / t->in, (double)t->us / bodies);
+}
+
+int main(int argc, char **argv) {
+    trace_t trace = {};
+    if(argc > 1 ? !trace_read(&trace, argv[1]) : (trace_synthetic(&trace), false)) {
+        return 1;
+    }
+    trace_index(&trace);
+
+    uint8_t *out = (uint8_t*)malloc(GZIP_MAX_INPUT + GZIP_OVERHEAD + 1024);
+    uint8_t *tmp = (uint8_t*)malloc(GZIP_MAX_INPUT + 1);
+    size_t out_sz = GZIP_MAX_INPUT + GZIP_OVERHEAD + 1024;
+
+    printf("%zu points, %zu bytes, window %d, hash %d, chain %d\n", trace.points, trace.len,
+            GZIP_WINDOW_SZ, GZIP_HASH_SZ, GZIP_MAX_CHAIN);
+    printf("%-7s %8s %8s | %-15s | %-15s | %-15s\n", "points", "bodies", "bytes",
+            "gzip_compress", "zlib -1", "zlib -6");
+    printf("%-7s %8s %8s | %7s %7s | %7s %7s | %7s %7s\n", "", "", "avg",
+            "ratio", "us", "ratio", "us", "ratio", "us");
+
+    for(uint16_t points : BATCH_POINTS) {
+        if(points > trace.points) {
+            break;
+        }
+        gz_total_t gz = {}, z1 = {}, z6 = {};
+        size_t bodies = 0;
+        for(size_t p=0; p + points <= trace.points; p += points) {
+            const char *body = trace.data + trace.lines[p];
+            size_t len = trace.lines[p + points] - trace.lines[p];
+            if(len > GZIP_MAX_INPUT) {
+                break;
+            }
+            int64_t start = esp_timer_get_time();
+            size_t gz_len = gzip_compress(body, len, out, out_sz);
+            gz.us += esp_timer_get_time() - start;
+            if(!gz_len || !gz_verify(out, gz_len, body, len, tmp)) {
+                printf("gzip_compress() output does not inflate to the input: %zu points at %zu\n",
+                        (size_t)points, p);
+                return 1;
+            }
+            gz.in += len;
+            gz.out += gz_len;
+
+            start = esp_timer_get_time();
+            z1.out += zlib_compress(1, body, len, out, out_sz);
+            z1.us += esp_timer_get_time() - start;
+            start = esp_timer_get_time();
+            z6.out += zlib_compress(6, body, len, out, out_sz);
+            z6.us += esp_timer_get_time() - start;
+            z1.in = z6.in = gz.in;
+            bodies++;
+        }
+        if(!bodies) {
+            break;
+        }
+        printf("%-7u %8zu %8zu |", points, bodies, gz.in / bodies);
+        report(&gz, bodies);
+        printf(" |");
+        report(&z1, bodies);
+        printf(" |");
+        report(&z6, bodies);
+        printf("\n");
+    }
+    return 0;
+}
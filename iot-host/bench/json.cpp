@@ -0,0 +1,326 @@
+// JSON writer benchmark: the SmartApp event body and a batch of
+// ST_BATCH_MAX_EVENTS events, serialized three ways:
+//   writer    json.h, as smartapp.cpp does now
+//   snprintf  one format string per document
+//   tree      a node per value with copied keys and strings, printed into
+//             a growing heap buffer and copied out, the allocation pattern
+//             of cJSON_Create*() / cJSON_PrintUnformatted() the writer
+//             replaced.  cJSON itself is not part of the host build
+// All three must produce the same bytes.  Prints ns and heap allocations
+// per document.
+//
+//   iot-host-json [documents]
+
+#include "json.h"
+#include "smartapp.h"
+
+typedef struct {
+    const char  *type;
+    uint8_t     battery;
+    uint8_t     is_str;
+    const char  *str;
+    int32_t     num;
+} event_t;
+
+static const event_t EVENTS[] = {
+    { "temperature", false, false, NULL, 2150 },
+    { "contact", false, true, "open", 0 },
+    { "battery", true, false, NULL, 87 },
+    { "motion", false, true, "active", 0 },
+};
+#define EVENT_CNT   (sizeof(EVENTS) / sizeof(EVENTS[0]))
+
+static const char *ENDPOINT = "a4:c1:38:10:20:31-1";
+
+typedef size_t (*event_fn_t)(const event_t*, char*, size_t);
+typedef size_t (*batch_fn_t)(const event_t*, char*, size_t);
+
+/* a batch cycles through EVENTS, starting at the given one */
+static const event_t* batch_event(const event_t *first, uint8_t i) {
+    return &EVENTS[((first - EVENTS) + i) % EVENT_CNT];
+}
+
+/* writer */
+
+static void writer_event_members(json_writer_t *json, const event_t *ev) {
+    json_object_begin(json);
+    if(ev->battery) {
+        JSON_KEY(json, "attribute");
+        json_string(json, "battery");
+        JSON_KEY(json, "capability");
+        json_string(json, "battery");
+    }
+    JSON_KEY(json, "type");
+    json_string(json, ev->type);
+    JSON_KEY(json, "value");
+    if(ev->is_str) {
+        json_string(json, ev->str);
+    } else {
+        json_int(json, ev->num);
+    }
+    json_object_end(json);
+}
+
+static size_t writer_event(const event_t *ev, char *buf, size_t size) {
+    json_writer_t json;
+    json_writer_init(&json, buf, size);
+    writer_event_members(&json, ev);
+    return json_writer_finish(&json);
+}
+
+static size_t writer_batch(const event_t *ev, char *buf, size_t size) {
+    json_writer_t json;
+    json_writer_init(&json, buf, size);
+    json_array_begin(&json);
+    for(uint8_t i=0; i<ST_BATCH_MAX_EVENTS; i++) {
+        json_object_begin(&json);
+        JSON_KEY(&json, "device");
+        json_string(&json, ENDPOINT);
+        JSON_KEY(&json, "event");
+        writer_event_members(&json, batch_event(ev, i));
+        json_object_end(&json);
+    }
+    json_array_end(&json);
+    return json_writer_finish(&json);
+}
+
+/* snprintf */
+
+static int printf_event_at(const event_t *ev, char *buf, size_t size) {
+    const char *battery = ev->battery ? "\"attribute\":\"battery\",\"capability\":\"battery\"," : "";
+    if(ev->is_str) {
+        return snprintf(buf, size, "{%s\"type\":\"%s\",\"value\":\"%s\"}", battery, ev->type, ev->str);
+    }
+    return snprintf(buf, size, "{%s\"type\":\"%s\",\"value\":%d}", battery, ev->type, ev->num);
+}
+
+static size_t printf_event(const event_t *ev, char *buf, size_t size) {
+    int len = printf_event_at(ev, buf, size);
+    return (len > 0 && (size_t)len < size) ? len : 0;
+}
+
+static size_t printf_batch(const event_t *ev, char *buf, size_t size) {
+    size_t pos = snprintf(buf, size, "[");
+    for(uint8_t i=0; i<ST_BATCH_MAX_EVENTS && pos < size; i++) {
+        pos += snprintf(buf + pos, size - pos, "%s{\"device\":\"%s\",\"event\":", i ? "," : "", ENDPOINT);
+        if(pos < size) {
+            pos += printf_event_at(batch_event(ev, i), buf + pos, size - pos);
+        }
+        if(pos < size) {
+            pos += snprintf(buf + pos, size - pos, "}");
+        }
+    }
+    if(pos < size) {
+        pos += snprintf(buf + pos, size - pos, "]");
+    }
+    return (pos < size) ? pos : 0;
+}
+
+/* tree */
+
+typedef enum { NODE_OBJECT, NODE_ARRAY, NODE_STRING, NODE_NUMBER } node_type_t;
+
+typedef struct node {
+    node_type_t type;
+    char        *key;
+    char        *str;
+    int32_t     num;
+    struct node *child;
+    struct node *next;
+} node_t;
+
+typedef struct {
+    char    *buf;
+    size_t  len;
+    size_t  size;
+} print_t;
+
+static node_t* node_new(node_type_t type) {
+    node_t *node = (node_t*)calloc(1, sizeof(node_t));
+    node->type = type;
+    return node;
+}
+
+static node_t* node_string(const char *str) {
+    node_t *node = node_new(NODE_STRING);
+    node->str = strdup(str);
+    return node;
+}
+
+static node_t* node_number(int32_t num) {
+    node_t *node = node_new(NODE_NUMBER);
+    node->num = num;
+    return node;
+}
+
+static void node_add(node_t *parent, const char *key, node_t *item) {
+    if(key) {
+        item->key = strdup(key);
+    }
+    node_t **tail = &parent->child;
+    while(*tail) {
+        tail = &(*tail)->next;
+    }
+    *tail = item;
+}
+
+static void node_delete(node_t *node) {
+    while(node) {
+        node_t *next = node->next;
+        node_delete(node->child);
+        free(node->key);
+        free(node->str);
+        free(node);
+        node = next;
+    }
+}
+
+static void print_put(print_t *p, const char *str, size_t len) {
+    if(p->len + len + 1 > p->size) {
+        while(p->len + len + 1 > p->size) {
+            p->size *= 2;
+        }
+        p->buf = (char*)realloc(p->buf, p->size);
+    }
+    memcpy(p->buf + p->len, str, len);
+    p->len += len;
+    p->buf[p->len] = '\0';
+}
+
+static void print_quoted(print_t *p, const char *str) {
+    print_put(p, "\"", 1);
+    print_put(p, str, strlen(str));
+    print_put(p, "\"", 1);
+}
+
+static void node_print(print_t *p, const node_t *node) {
+    char num[12];
+    switch(node->type) {
+        case NODE_STRING:
+            print_quoted(p, node->str);
+            break;
+        case NODE_NUMBER:
+            print_put(p, num, snprintf(num, sizeof(num), "%d", node->num));
+            break;
+        default:
+            print_put(p, node->type == NODE_OBJECT ? "{" : "[", 1);
+            for(const node_t *c=node->child; c; c=c->next) {
+                if(c != node->child) {
+                    print_put(p, ",", 1);
+                }
+                if(c->key) {
+                    print_quoted(p, c->key);
+                    print_put(p, ":", 1);
+                }
+                node_print(p, c);
+            }
+            print_put(p, node->type == NODE_OBJECT ? "}" : "]", 1);
+            break;
+    }
+}
+
+static node_t* tree_event_node(const event_t *ev) {
+    node_t *obj = node_new(NODE_OBJECT);
+    if(ev->battery) {
+        node_add(obj, "attribute", node_string("battery"));
+        node_add(obj, "capability", node_string("battery"));
+    }
+    node_add(obj, "type", node_string(ev->type));
+    node_add(obj, "value", ev->is_str ? node_string(ev->str) : node_number(ev->num));
+    return obj;
+}
+
+static size_t tree_print(node_t *root, char *buf, size_t size) {
+    print_t p = { (char*)malloc(256), 0, 256 };
+    node_print(&p, root);
+    node_delete(root);
+    size_t len = (p.len < size) ? p.len : 0;
+    if(len) {
+        memcpy(buf, p.buf, len + 1);
+    }
+    free(p.buf);
+    return len;
+}
+
+static size_t tree_event(const event_t *ev, char *buf, size_t size) {
+    return tree_print(tree_event_node(ev), buf, size);
+}
+
+static size_t tree_batch(const event_t *ev, char *buf, size_t size) {
+    node_t *arr = node_new(NODE_ARRAY);
+    for(uint8_t i=0; i<ST_BATCH_MAX_EVENTS; i++) {
+        node_t *obj = node_new(NODE_OBJECT);
+        node_add(obj, "device", node_string(ENDPOINT));
+        node_add(obj, "event", tree_event_node(batch_event(ev, i)));
+        node_add(arr, NULL, obj);
+    }
+    return tree_print(arr, buf, size);
+}
+
+typedef struct {
+    const char  *name;
+    event_fn_t  event;
+    batch_fn_t  batch;
+} json_impl_t;
+
+static const json_impl_t IMPLS[] = {
+    { "writer", writer_event, writer_batch },
+    { "snprintf", printf_event, printf_batch },
+    { "tree", tree_event, tree_batch },
+};
+
+static void run(event_fn_t fn, uint32_t count, size_t size, double *ns, double *allocs) {
+    char buf[ST_BATCH_BODY_SZ];
+    size_t total = 0;
+    uint64_t heap = host_heap_stats().allocs;
+    int64_t start = esp_timer_get_time();
+    for(uint32_t i=0; i<count; i++) {
+        total += fn(&EVENTS[i % EVENT_CNT], buf, size);
+    }
+    int64_t elapsed = esp_timer_get_time() - start;
+    if(!total) {
+        printf("no output\n");
+        exit(1);
+    }
+    *ns = elapsed * 1e3 / count;
+    *allocs = (double)(host_heap_stats().allocs - heap) / count;
+}
+
+/* every implementation writes the same bytes for every document */
+static bool check() {
+    char ref[ST_BATCH_BODY_SZ], out[ST_BATCH_BODY_SZ];
+    for(uint8_t e=0; e<EVENT_CNT; e++) {
+        size_t len = writer_event(&EVENTS[e], ref, ST_BODY_SZ);
+        size_t batch_len = writer_batch(&EVENTS[e], ref + len + 1, sizeof(ref) - len - 1);
+        for(const json_impl_t &impl : IMPLS) {
+            if(impl.event(&EVENTS[e], out, ST_BODY_SZ) != len || memcmp(out, ref, len)) {
+                printf("%s: event differs: %s / %s\n", impl.name, out, ref);
+                return false;
+            }
+            if(impl.batch(&EVENTS[e], out, sizeof(out)) != batch_len ||
+                    memcmp(out, ref + len + 1, batch_len)) {
+                printf("%s: batch differs: %s\n", impl.name, out);
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+int main(int argc, char **argv) {
+    uint32_t count = (argc > 1) ? strtoul(argv[1], NULL, 10) : 1000000;
+    if(!check()) {
+        return 1;
+    }
+    char sample[ST_BATCH_BODY_SZ];
+    printf("event %zu bytes, batch of %d %zu bytes\n", writer_event(&EVENTS[0], sample, ST_BODY_SZ),
+            ST_BATCH_MAX_EVENTS, writer_batch(EVENTS, sample, sizeof(sample)));
+    printf("%-9s %10s %10s | %10s %10s\n", "", "event ns", "allocs", "batch ns", "allocs");
+    for(const json_impl_t &impl : IMPLS) {
+        double ev_ns, ev_allocs, batch_ns, batch_allocs;
+        run(impl.event, count, ST_BODY_SZ, &ev_ns, &ev_allocs);
+        run(impl.batch, count / ST_BATCH_MAX_EVENTS, ST_BATCH_BODY_SZ, &batch_ns, &batch_allocs);
+        printf("%-9s %10.1f %10.1f | %10.1f %10.1f\n", impl.name, ev_ns, ev_allocs, batch_ns, batch_allocs);
+    }
+    return 0;
+}
@@ -0,0 +1,203 @@
+// Payload allocation benchmark: the slab pool behind device_payload_init()
+// against the allocation pattern it replaced, one calloc of the payload and
+// a realloc of the value and tag arrays for every entry.
+//
+// Each path runs in its own forked child, so both start from a fresh heap:
+//   speed   payloads/s and heap allocations per payload, with up to
+//           INFLIGHT payloads alive at once as in the network queue
+//   churn   the same stream interleaved with a ring of long lived blocks of
+//           random size, standing in for HTTP buffers and JSON strings, then
+//           how much of the heap arena is free but stranded between them
+//
+// Fragmentation is that of glibc malloc, not of the ESP-IDF heap, use it
+// to compare the two paths rather than as a prediction for the device.
+//
+//   iot-host-payload [payloads]
+
+#include <malloc.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "devices.h"
+#include "sensor.h"
+#include "bench.h"
+
+#define INFLIGHT        12
+#define NEIGHBOURS      48
+#define NEIGHBOUR_EVERY 4
+
+/* the payload layout before the pool: values and tags on the heap */
+typedef struct legacy_payload {
+    device_addr_t       addr;
+    uint8_t             sensor_id;
+    sensor_type_t       type;
+    uint8_t             num_values;
+    update_scopes_t     scopes;
+    sensor_tag_t        *tags;
+    sensor_val_t        *values;
+    int64_t             ts;
+} legacy_payload_t;
+
+typedef struct {
+    double      rate;
+    double      allocs;
+    size_t      arena;
+    size_t      free;
+} payload_result_t;
+
+typedef struct {
+    void*   (*init)(device_addr_t, uint8_t);
+    void    (*fill)(void*, uint8_t, uint16_t);
+    void    (*free)(void*);
+} payload_path_t;
+
+static void* legacy_init(device_addr_t addr, uint8_t entries) {
+    legacy_payload_t *payload = (legacy_payload_t*)calloc(1, sizeof(legacy_payload_t));
+    payload->addr = addr;
+    payload->ts = esp_timer_get_time();
+    while(entries--) {
+        uint8_t idx = payload->num_values++;
+        payload->values = (sensor_val_t*)realloc(payload->values, payload->num_values * sizeof(sensor_val_t));
+        memset(&payload->values[idx], 0, sizeof(sensor_val_t));
+        payload->tags = (sensor_tag_t*)realloc(payload->tags, payload->num_values * sizeof(sensor_tag_t));
+        memset(&payload->tags[idx], 0, sizeof(sensor_tag_t));
+    }
+    return payload;
+}
+
+static void legacy_fill(void *ptr, uint8_t idx, uint16_t val) {
+    legacy_payload_t *payload = (legacy_payload_t*)ptr;
+    sensor_val_t *value = &payload->values[idx];
+    strcpy(value->attribute, "temperature");
+    value->u16 = val;
+    value->value = &value->u16;
+}
+
+static void legacy_free(void *ptr) {
+    legacy_payload_t *payload = (legacy_payload_t*)ptr;
+    free(payload->tags);
+    free(payload->values);
+    free(payload);
+}
+
+static void* pool_init(device_addr_t addr, uint8_t entries) {
+    return device_payload_init(addr, entries);
+}
+
+static void pool_fill(void *ptr, uint8_t idx, uint16_t val) {
+    sensor_data_entry_t entry = device_payload_get_entry((device_data_t*)ptr, idx);
+    sensor_payload_entry_attr(entry, "temperature", VAL_U16, &val);
+}
+
+static void pool_free(void *ptr) {
+    device_payload_free((device_data_t*)ptr);
+}
+
+static const payload_path_t PATHS[] = {
+    { legacy_init, legacy_fill, legacy_free },
+    { pool_init, pool_fill, pool_free },
+};
+
+/* mostly single entry BLE updates, every fourth one fills all entries */
+static void* payload_make(const payload_path_t *path, uint32_t i) {
+    device_addr_t addr = {};
+    addr.val[5] = i & 0xff;
+    uint8_t entries = (i & 3) ? 1 : PAYLOAD_MAX_VALUES;
+    void *payload = path->init(addr, entries);
+    for(uint8_t idx=0; payload && idx<entries; idx++) {
+        path->fill(payload, idx, i & 0xffff);
+    }
+    return payload;
+}
+
+static void run_speed(const payload_path_t *path, uint32_t count, payload_result_t *res) {
+    void *inflight[INFLIGHT] = {};
+    uint64_t allocs = host_heap_stats().allocs;
+    int64_t start = esp_timer_get_time();
+    for(uint32_t i=0; i<count; i++) {
+        void **slot = &inflight[i % INFLIGHT];
+        if(*slot) {
+            path->free(*slot);
+        }
+        *slot = payload_make(path, i);
+    }
+    for(void *payload : inflight) {
+        if(payload) {
+            path->free(payload);
+        }
+    }
+    int64_t elapsed = esp_timer_get_time() - start;
+    res->rate = count * 1e6 / (elapsed ? elapsed : 1);
+    res->allocs = (double)(host_heap_stats().allocs - allocs) / count;
+}
+
+static void run_churn(const payload_path_t *path, uint32_t count, payload_result_t *res) {
+    void *inflight[INFLIGHT] = {};
+    void *neighbours[NEIGHBOURS] = {};
+    uint32_t seed = 0x2545f491;
+    for(uint32_t i=0; i<count; i++) {
+        void **slot = &inflight[i % INFLIGHT];
+        if(*slot) {
+            path->free(*slot);
+        }
+        *slot = payload_make(path, i);
+        if((i % NEIGHBOUR_EVERY) == 0) {
+            void **neighbour = &neighbours[xorshift(&seed) % NEIGHBOURS];
+            free(*neighbour);
+            *neighbour = malloc(16 + (xorshift(&seed) % 752));
+        }
+    }
+    // measured with the neighbours and the in-flight payloads still alive
+    struct mallinfo2 info = mallinfo2();
+    res->arena = info.arena;
+    res->free = info.fordblks;
+    for(void *payload : inflight) {
+        if(payload) {
+            path->free(payload);
+        }
+    }
+    for(void *neighbour : neighbours) {
+        free(neighbour);
+    }
+}
+
+static payload_result_t run_child(const payload_path_t *path, uint32_t count) {
+    payload_result_t res = {};
+    int fds[2];
+    if(pipe(fds) != 0) {
+        perror("pipe");
+        exit(1);
+    }
+    pid_t pid = fork();
+    if(pid == 0) {
+        close(fds[0]);
+        run_speed(path, count, &res);
+        run_churn(path, count, &res);
+        ssize_t n = write(fds[1], &res, sizeof(res));
+        _exit(n == sizeof(res) ? 0 : 1);
+    }
+    close(fds[1]);
+    if(read(fds[0], &res, sizeof(res)) != sizeof(res)) {
+        printf("benchmark child died\n");
+        exit(1);
+    }
+    close(fds[0]);
+    waitpid(pid, NULL, 0);
+    return res;
+}
+
+int main(int argc, char **argv) {
+    uint32_t count = (argc > 1) ? strtoul(argv[1], NULL, 10) : 2000000;
+    const char *names[] = { "calloc", "pool" };
+
+    printf("%u payloads, %d in flight, %d neighbour blocks\n", count, INFLIGHT, NEIGHBOURS);
+    printf("%-8s %12s %14s %10s %12s %8s\n", "path", "payloads/s", "allocs/payload",
+            "arena KB", "free KB", "frag %");
+    for(uint8_t i=0; i<2; i++) {
+        payload_result_t res = run_child(&PATHS[i], count);
+        printf("%-8s %12.0f %14.2f %10zu %12zu %8.1f\n", names[i], res.rate, res.allocs,
+                res.arena / 1024, res.free / 1024, res.arena ? 100.0 * res.free / res.arena : 0.0);
+    }
+    payload_pool_stats_t pool = device_payload_pool_stats();
+    printf("pool: %u slots of %zu bytes\n", pool.size, sizeof(device_data_t));
+    return 0;
+}
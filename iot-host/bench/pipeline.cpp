@@ -0,0 +1,237 @@
+// Payload pipeline benchmark.
+//
+// Drives synthetic BLE notifications through ble_sensor_network_queue() ->
+// network_queue_payload() -> device_process_payload() ->
+// sensor_process_payload() -> influx_queue_payload() / st_queue_payload(),
+// with InfluxDB and the SmartApp replaced by local HTTP sinks.  Every
+// device has a temperature sensor (Influx, bulk) and a contact sensor
+// (SmartThings, interactive), one in four notifications is a contact.  The
+// sensor filters are opened so every reading reaches the lanes.
+//
+// For each device count x notification rate it reports the payloads/s the
+// pipeline sustained, payloads dropped for lack of a pool slot, p50/p99 of
+// the PIPELINE_STATS stages, heap allocations per payload and peak heap.
+// Percentiles are histogram bucket bounds, within a factor of 2.  The
+// allocations leave out those the esp_http_client shim makes for itself.
+//
+//   iot-host-pipeline [seconds] [devices,...] [rates,...]
+//
+// A rate of 0 sends as fast as the payload pool allows.
+
+#include <sched.h>
+#include <string>
+#include <vector>
+#include "network.h"
+#include "devices.h"
+#include "sensor.h"
+#include "ble.h"
+#include "influx.h"
+#include "smartapp.h"
+#include "smartthings.h"
+#include "stats.h"
+#include "sink.h"
+
+#define DRAIN_TIMEOUT_US    (10 * 1000 * 1000)
+
+typedef struct {
+    uint16_t    devices;
+    uint32_t    rate;
+    uint32_t    sent;
+    uint32_t    dropped;
+    uint32_t    processed;
+    int64_t     elapsed_us;
+    uint64_t    allocs;
+    size_t      peak;
+    uint64_t    influx_points;
+    uint64_t    st_events;
+    stats_hist_t stages[PIPE_MAX];
+} bench_point_t;
+
+static device_addr_t bench_addr(uint16_t idx) {
+    device_addr_t addr = {};
+    addr.val[0] = 0xb0;
+    addr.val[1] = 0x0c;
+    addr.val[4] = idx >> 8;
+    addr.val[5] = idx & 0xff;
+    return addr;
+}
+
+static std::vector<uint32_t> parse_list(const char *arg, std::vector<uint32_t> def) {
+    if(arg == NULL) {
+        return def;
+    }
+    std::vector<uint32_t> list;
+    for(char *end = (char*)arg; *arg; arg = end + (*end == ',')) {
+        list.push_back(strtoul(arg, &end, 10));
+        if(end == arg) {
+            break;
+        }
+    }
+    return list;
+}
+
+static void bench_devices_init(uint16_t count) {
+    sensor_filter_t open = { 0, 0, true, 0, FORCE_UPDATE_MS };
+    for(uint16_t i=0; i<count; i++) {
+        device_t *device = create_device(bench_addr(i));
+        device_add_sensor(device, SENSOR_TEMPERATURE)->filter = open;
+        device_add_sensor(device, SENSOR_CONTACT)->filter = open;
+    }
+}
+
+/* one notification, as the BLE notify callback hands it over */
+static void bench_notify(uint16_t devices, uint32_t seq) {
+    device_addr_t addr = bench_addr(seq % devices);
+    uint8_t data[4];
+    if((seq & 3) == 3) {
+        data[0] = 1;
+        data[1] = SENSOR_CONTACT;
+        data[2] = 0;
+        data[3] = (seq >> 2) & 1;
+    } else {
+        // a random walk that always moves
+        uint16_t val = 2000 + (seq % 97) * 3;
+        data[0] = 0;
+        data[1] = SENSOR_TEMPERATURE;
+        data[2] = val >> 8;
+        data[3] = val & 0xff;
+    }
+    ble_sensor_network_queue(&addr, (uint32_t*)data, esp_timer_get_time());
+}
+
+/* wait until every payload left the pool and both uplinks are idle */
+static void bench_drain() {
+    int64_t deadline = esp_timer_get_time() + DRAIN_TIMEOUT_US;
+    while(device_payload_pool_stats().in_use && esp_timer_get_time() < deadline) {
+        vTaskDelay(1);
+    }
+    influx_flush(DRAIN_TIMEOUT_US / 1000);
+    while(st_queue_stats().pending && esp_timer_get_time() < deadline) {
+        vTaskDelay(1);
+    }
+}
+
+static bench_point_t bench_run(uint16_t devices, uint32_t rate, uint32_t secs,
+                        http_sink_t *influx, http_sink_t *st) {
+    bench_point_t pt = {};
+    pt.devices = devices;
+    pt.rate = rate;
+
+    stats_hist_t discard[PIPE_MAX];
+    pipeline_stats_take(discard);
+    payload_pool_stats_t pool = device_payload_pool_stats();
+    influx_batch_stats_t points = influx_batch_stats();
+    sink_stats_t st_sink = http_sink_stats(st);
+    uint32_t exhausted = pool.exhausted;
+    host_heap_reset_peak();
+    host_heap_stats_t heap = host_heap_stats();
+
+    int64_t start = esp_timer_get_time();
+    int64_t end = start + ((int64_t)secs * 1000000);
+    int64_t next = start;
+    for(int64_t now = start; now < end; now = esp_timer_get_time()) {
+        if(rate) {
+            if(now < next) {
+                if(next - now > 1000) {
+                    vTaskDelay(1);
+                } else {
+                    sched_yield();
+                }
+                continue;
+            }
+            next += 1000000 / rate;
+        } else if(device_payload_pool_stats().in_use >= PAYLOAD_POOL_SZ) {
+            // no pool slot, let the network task catch up
+            sched_yield();
+            continue;
+        }
+        bench_notify(devices, pt.sent++);
+    }
+    while(device_payload_pool_stats().in_use && esp_timer_get_time() < end + DRAIN_TIMEOUT_US) {
+        sched_yield();
+    }
+    pt.elapsed_us = esp_timer_get_time() - start;
+    pipeline_stats_take(pt.stages);
+    host_heap_stats_t after = host_heap_stats();
+    pt.allocs = (after.allocs - after.shim_allocs) - (heap.allocs - heap.shim_allocs);
+    pt.peak = after.peak;
+    bench_drain();
+
+    pt.dropped = device_payload_pool_stats().exhausted - exhausted;
+    pt.processed = pt.stages[PIPE_QUEUE].count;
+    pt.influx_points = influx_batch_stats().points - points.points;
+    pt.st_events = http_sink_stats(st).events - st_sink.events;
+    return pt;
+}
+
+static std::string p50_p99(const stats_hist_t *hist) {
+    char buf[32];
+    if(hist->count == 0) {
+        return "-";
+    }
+    snprintf(buf, sizeof(buf), "%u/%u", stats_hist_percentile(hist, 50), stats_hist_percentile(hist, 99));
+    return buf;
+}
+
+static void bench_print(const bench_point_t *pt) {
+    char rate[16];
+    snprintf(rate, sizeof(rate), pt->rate ? "%u" : "max", pt->rate);
+    printf("%7u %7s %8u %10.1f %6u %13s %13s %13s %13s %13s %8.2f %8zu %7lu %7lu\n",
+            pt->devices, rate, pt->sent,
+            pt->processed * 1e6 / (pt->elapsed_us ? pt->elapsed_us : 1), pt->dropped,
+            p50_p99(&pt->stages[PIPE_QUEUE]).c_str(), p50_p99(&pt->stages[PIPE_PROCESS]).c_str(),
+            p50_p99(&pt->stages[PIPE_INFLUX]).c_str(), p50_p99(&pt->stages[PIPE_ST]).c_str(),
+            p50_p99(&pt->stages[PIPE_TOTAL]).c_str(),
+            pt->processed ? (double)pt->allocs / pt->processed : 0.0, pt->peak / 1024,
+            (unsigned long)pt->influx_points, (unsigned long)pt->st_events);
+}
+
+int main(int argc, char **argv) {
+    uint32_t secs = (argc > 1) ? strtoul(argv[1], NULL, 10) : 2;
+    std::vector<uint32_t> device_counts = parse_list(argc > 2 ? argv[2] : NULL, { 1, 8, 32, MAX_DEVICES });
+    std::vector<uint32_t> rates = parse_list(argc > 3 ? argv[3] : NULL, { 10, 100, 1000, 0 });
+
+    // sinks first, they fork
+    http_sink_t *influx = http_sink_start(SINK_INFLUX, INFLUX_PORT);
+    http_sink_t *st = http_sink_start(SINK_SMARTAPP, 0);
+    if(influx == NULL || st == NULL) {
+        return 1;
+    }
+    snprintf(ST_CONFIG->apiurl, sizeof(ST_CONFIG->apiurl), "http://127.0.0.1:%u", http_sink_port(st));
+    strcpy(ST_CONFIG->apikey, "bench");
+
+    // full lanes and drops are expected at the top rates
+    if(getenv("IOT_HOST_LOG") == NULL) {
+        host_log_level(ESP_LOG_ERROR);
+        esp_log_level_set("ble", ESP_LOG_NONE);
+    }
+
+    nvs_flash_init();
+    device_init();
+    wifi_connect();
+    network_queue_init();
+    influx_queue_init();
+    st_app_init();
+
+    uint32_t max_devices = 0;
+    for(uint32_t count : device_counts) {
+        max_devices = MAX(max_devices, MIN(count, (uint32_t)MAX_DEVICES));
+    }
+    bench_devices_init(max_devices);
+    vTaskDelay(100);
+
+    printf("%u s per point, MAX_DEVICES %u, payload pool %u, latency p50/p99 in us\n",
+            secs, MAX_DEVICES, PAYLOAD_POOL_SZ);
+    printf("%7s %7s %8s %10s %6s %13s %13s %13s %13s %13s %8s %8s %7s %7s\n",
+            "devices", "rate/s", "sent", "payloads/s", "drop", "queue", "process",
+            "influx", "st", "total", "allocs/p", "peak KB", "points", "events");
+    for(uint32_t count : device_counts) {
+        for(uint32_t rate : rates) {
+            bench_point_t pt = bench_run(MIN(count, (uint32_t)MAX_DEVICES), rate, secs, influx, st);
+            bench_print(&pt);
+        }
+    }
+    host_heap_stats_t heap = host_heap_stats();
+    printf("heap: %zu bytes live at exit, %zu KB peak\n", heap.live, heap.peak / 1024);
+    return 0;
+}
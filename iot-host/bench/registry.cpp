@@ -0,0 +1,89 @@
+// Registry lookup benchmark: get_device() through the hashed address index
+// against the linear scan of pDEVICE it replaced, with the registry full.
+//
+// Built once per registry size (iot-host-registry-8, -64, -256), each run
+// prints one row in ns per operation:
+//   hit     lookup of a registered address
+//   miss    lookup of an address that is not registered, what every
+//           advertisement from a foreign device costs the scanner
+//   churn   delete_device() of one device and create_device() of another
+//
+//   iot-host-registry-<n> [lookups]
+
+#include "devices.h"
+#include "bench.h"
+
+#define ADDR_SET    1024
+
+static device_addr_t   REGISTERED[MAX_DEVICES];
+static device_addr_t   FOREIGN[ADDR_SET];
+
+/* get_device() before the index: first in-use slot with a matching address */
+static device_t* linear_get_device(device_addr_t addr) {
+    devices_t devices = get_devices();
+    for(uint16_t i=0; i<devices.num_devices; i++) {
+        device_t *device = devices.devices[i];
+        if(device->in_use && DEVICE_ADDR_EQ(addr, device->addr)) {
+            return device;
+        }
+    }
+    return nullptr;
+}
+
+static double time_lookups(device_t* (*lookup)(device_addr_t), const device_addr_t *addrs,
+        uint32_t set, uint32_t count, bool hit) {
+    uint32_t found = 0;
+    int64_t start = esp_timer_get_time();
+    for(uint32_t i=0; i<count; i++) {
+        found += (lookup(addrs[(i * 7) % set]) != nullptr);
+    }
+    int64_t elapsed = esp_timer_get_time() - start;
+    if(found != (hit ? count : 0)) {
+        printf("lookup returned %u of %u, expected %s\n", found, count, hit ? "all" : "none");
+        exit(1);
+    }
+    return elapsed * 1e3 / count;
+}
+
+static double time_churn(uint32_t count, uint32_t *seed) {
+    int64_t start = esp_timer_get_time();
+    for(uint32_t i=0; i<count; i++) {
+        uint16_t slot = i % MAX_DEVICES;
+        device_t *device = get_device(REGISTERED[slot]);
+        delete_device(device);
+        REGISTERED[slot] = bench_random_addr(seed);
+        if(!create_device(REGISTERED[slot])) {
+            printf("create_device() failed after %u\n", i);
+            exit(1);
+        }
+    }
+    int64_t elapsed = esp_timer_get_time() - start;
+    return elapsed * 1e3 / count;
+}
+
+int main(int argc, char **argv) {
+    uint32_t count = (argc > 1) ? strtoul(argv[1], NULL, 10) : 2000000;
+    uint32_t seed = 0x9e3779b9;
+
+    host_log_level(ESP_LOG_WARN);
+    device_init();
+    for(uint16_t i=0; i<MAX_DEVICES; i++) {
+        REGISTERED[i] = bench_random_addr(&seed);
+        create_device(REGISTERED[i]);
+    }
+    for(uint16_t i=0; i<ADDR_SET; i++) {
+        FOREIGN[i] = bench_random_addr(&seed);
+    }
+
+    double hash_hit = time_lookups(get_device, REGISTERED, MAX_DEVICES, count, true);
+    double hash_miss = time_lookups(get_device, FOREIGN, ADDR_SET, count, false);
+    double lin_hit = time_lookups(linear_get_device, REGISTERED, MAX_DEVICES, count, true);
+    double lin_miss = time_lookups(linear_get_device, FOREIGN, ADDR_SET, count, false);
+    double churn = time_churn(count / 16, &seed);
+
+    printf("%-8s %10s %10s %10s %10s %10s\n", "devices", "hash hit", "hash miss",
+            "scan hit", "scan miss", "churn");
+    printf("%-8u %10.1f %10.1f %10.1f %10.1f %10.1f\n", MAX_DEVICES, hash_hit, hash_miss,
+            lin_hit, lin_miss, churn);
+    return 0;
+}
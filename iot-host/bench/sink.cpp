@@ -0,0 +1,213 @@
+#include <sys/mman.h>
+#include <sys/prctl.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <signal.h>
+#include <strings.h>
+#include <string.h>
+#include <stdlib.h>
+#include <atomic>
+#include <new>
+#include <string>
+#include <thread>
+#include "sink.h"
+
+struct http_sink {
+    sink_kind_t             kind;
+    int                     fd;
+    uint16_t                port;
+    std::atomic<uint64_t>   connections;
+    std::atomic<uint64_t>   requests;
+    std::atomic<uint64_t>   bytes;
+    std::atomic<uint64_t>   events;
+};
+
+/* lives in shared memory, the counters are updated by the sink process */
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "sink counters must be lock free");
+
+/* buffered reads from one connection */
+typedef struct {
+    int         fd;
+    std::string buf;
+} sink_conn_t;
+
+static bool conn_fill(sink_conn_t *conn) {
+    char chunk[4096];
+    ssize_t n = recv(conn->fd, chunk, sizeof(chunk), 0);
+    if(n <= 0) {
+        return false;
+    }
+    conn->buf.append(chunk, n);
+    return true;
+}
+
+static bool conn_line(sink_conn_t *conn, std::string *line) {
+    size_t eol;
+    while((eol = conn->buf.find("\r\n")) == std::string::npos) {
+        if(!conn_fill(conn)) {
+            return false;
+        }
+    }
+    *line = conn->buf.substr(0, eol);
+    conn->buf.erase(0, eol + 2);
+    return true;
+}
+
+static bool conn_bytes(sink_conn_t *conn, size_t len, std::string *out) {
+    while(conn->buf.size() < len) {
+        if(!conn_fill(conn)) {
+            return false;
+        }
+    }
+    out->append(conn->buf, 0, len);
+    conn->buf.erase(0, len);
+    return true;
+}
+
+static bool conn_chunked(sink_conn_t *conn, std::string *body) {
+    std::string line;
+    for(;;) {
+        if(!conn_line(conn, &line)) {
+            return false;
+        }
+        size_t len = strtoul(line.c_str(), NULL, 16);
+        if(len == 0) {
+            // trailer, ends at an empty line
+            while(conn_line(conn, &line) && !line.empty());
+            return true;
+        }
+        if(!conn_bytes(conn, len, body) || !conn_line(conn, &line)) {
+            return false;
+        }
+    }
+}
+
+static uint64_t count(const std::string &body, const char *needle) {
+    uint64_t n = 0;
+    for(size_t at = body.find(needle); at != std::string::npos; at = body.find(needle, at + 1)) {
+        n++;
+    }
+    return n;
+}
+
+static std::string sink_reply(http_sink_t *sink, const std::string &path, const std::string &body,
+                        bool gzip) {
+    if(sink->kind == SINK_INFLUX) {
+        if(!gzip && !body.empty()) {
+            sink->events += count(body, "\n") + (body.back() != '\n');
+        }
+        return "HTTP/1.1 204 No Content\r\nContent-Length: 0\r\n\r\n";
+    }
+    std::string json = "{}";
+    if(path.size() >= 7 && path.compare(path.size() - 7, 7, "/events") == 0) {
+        uint64_t events = count(body, "\"device\"");
+        sink->events += events;
+        json = "[";
+        for(uint64_t i=0; i<events; i++) {
+            json += i ? ",200" : "200";
+        }
+        json += "]";
+    } else {
+        sink->events++;
+    }
+    return "HTTP/1.1 200 OK\r\nContent-Type: application/json\r\nContent-Length: " +
+            std::to_string(json.size()) + "\r\n\r\n" + json;
+}
+
+static void sink_serve(http_sink_t *sink, int fd) {
+    sink_conn_t conn = { fd, "" };
+    std::string line;
+    sink->connections++;
+    while(conn_line(&conn, &line)) {
+        if(line.empty()) {
+            continue;
+        }
+        // "POST /path HTTP/1.1"
+        size_t sp1 = line.find(' '), sp2 = line.rfind(' ');
+        std::string path = (sp1 != std::string::npos && sp2 > sp1) ? line.substr(sp1 + 1, sp2 - sp1 - 1) : "";
+        size_t length = 0;
+        bool chunked = false, gzip = false, close_conn = false;
+        while(conn_line(&conn, &line) && !line.empty()) {
+            const char *hdr = line.c_str();
+            if(strncasecmp(hdr, "Content-Length:", 15) == 0) {
+                length = strtoul(hdr + 15, NULL, 10);
+            } else if(strncasecmp(hdr, "Transfer-Encoding:", 18) == 0) {
+                chunked = (strcasestr(hdr, "chunked") != NULL);
+            } else if(strncasecmp(hdr, "Content-Encoding:", 17) == 0) {
+                gzip = (strcasestr(hdr, "gzip") != NULL);
+            } else if(strncasecmp(hdr, "Connection:", 11) == 0) {
+                close_conn = (strcasestr(hdr, "close") != NULL);
+            }
+        }
+        std::string body;
+        if(chunked ? !conn_chunked(&conn, &body) : !conn_bytes(&conn, length, &body)) {
+            break;
+        }
+        sink->requests++;
+        sink->bytes += body.size();
+        std::string reply = sink_reply(sink, path, body, gzip);
+        if(send(fd, reply.data(), reply.size(), MSG_NOSIGNAL) != (ssize_t)reply.size() || close_conn) {
+            break;
+        }
+    }
+    close(fd);
+}
+
+http_sink_t* http_sink_start(sink_kind_t kind, uint16_t port) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    int one = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    struct sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(port);
+    socklen_t len = sizeof(addr);
+    if(bind(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0 || listen(fd, 16) != 0 ||
+            getsockname(fd, (struct sockaddr*)&addr, &len) != 0) {
+        perror("http_sink_start");
+        close(fd);
+        return NULL;
+    }
+
+    void *shared = mmap(NULL, sizeof(http_sink_t), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if(shared == MAP_FAILED) {
+        close(fd);
+        return NULL;
+    }
+    http_sink_t *sink = new(shared) http_sink_t();
+    sink->kind = kind;
+    sink->fd = fd;
+    sink->port = ntohs(addr.sin_port);
+
+    pid_t pid = fork();
+    if(pid < 0) {
+        close(fd);
+        return NULL;
+    }
+    if(pid > 0) {
+        close(fd);
+        return sink;
+    }
+    // the sink goes away with the process under test
+    prctl(PR_SET_PDEATHSIG, SIGKILL);
+    for(;;) {
+        int conn = accept(sink->fd, NULL, NULL);
+        if(conn < 0) {
+            continue;
+        }
+        int one = 1;
+        setsockopt(conn, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        std::thread(sink_serve, sink, conn).detach();
+    }
+}
+
+uint16_t http_sink_port(const http_sink_t *sink) {
+    return sink->port;
+}
+
+sink_stats_t http_sink_stats(const http_sink_t *sink) {
+    return { sink->connections, sink->requests, sink->bytes, sink->events };
+}
@@ -0,0 +1,51 @@
+#ifndef HOST_SINK_H_
+#define HOST_SINK_H_
+
+#include <stdint.h>
+
+/*!
+    @file
+    @brief Local HTTP endpoints standing in for InfluxDB and the SmartApp
+
+    Each sink listens on 127.0.0.1, keeps connections alive and answers
+    every request the way its service does: 204 for an Influx write, 200
+    with a per-event status array for a SmartApp batch, 200 for a single
+    event.  A sink serves from a child process, so its threads and heap
+    don't show up in the heap counters of the process under test.
+ */
+
+typedef enum sink_kind {
+    SINK_INFLUX,
+    SINK_SMARTAPP,
+} sink_kind_t;
+
+/*!
+    @struct sink_stats_t
+    @brief Traffic seen by a sink
+
+    `events` counts line protocol points of uncompressed Influx writes, and
+    SmartApp events, single or batched.
+ */
+typedef struct sink_stats {
+    uint64_t connections;
+    uint64_t requests;
+    uint64_t bytes;
+    uint64_t events;
+} sink_stats_t;
+
+typedef struct http_sink http_sink_t;
+
+/*!
+    @brief Fork a sink, before the process under test starts its threads
+
+    @param kind
+    @param port  0 for any free port
+    @return http_sink_t*  NULL if the port can't be bound
+ */
+http_sink_t*    http_sink_start(sink_kind_t kind, uint16_t port);
+
+uint16_t        http_sink_port(const http_sink_t *sink);
+
+sink_stats_t    http_sink_stats(const http_sink_t *sink);
+
+#endif /* HOST_SINK_H_ */
@@ -0,0 +1,179 @@
+// Spool exerciser: drives spool.cpp against a file-backed partition.
+//
+// Every boot runs in a forked child, so the spool recovers from the flash
+// image alone, exactly as after a reset.  Three phases:
+//   wrap   append past the capacity, read everything back, oldest dropped
+//   crash  cut the power at a random byte while appending, re-open, check
+//          no torn or corrupt record is returned and nothing acked is lost
+//   wear   sector erase counts after the run
+//
+//   iot-host-spool [image] [boots]
+
+#include <sys/wait.h>
+#include <unistd.h>
+#include "esp_partition.h"
+#include "spool.h"
+
+#define SPOOL_IMAGE_SZ      (SPOOL_MAX_SECTORS * SPOOL_SECTOR_SZ)
+
+typedef struct {
+    uint32_t boot;
+    uint32_t next;      // first seq of the next boot
+    uint32_t acked;     // newest seq the next boot must read, 0 for none
+    uint32_t read;      // records read back at boot
+    uint32_t errors;
+    spool_stats_t stats;
+} boot_result_t;
+
+/* records carry their seq and a pattern derived from it */
+static uint16_t record_fill(uint32_t seq, uint8_t *buf) {
+    uint16_t len = sizeof(seq) + (seq * 37) % 113;
+    memcpy(buf, &seq, sizeof(seq));
+    for(uint16_t i=sizeof(seq); i<len; i++) {
+        buf[i] = (uint8_t)(seq + i);
+    }
+    return len;
+}
+
+/* read and consume everything pending, checking order and contents */
+static void drain(boot_result_t *res, uint32_t last) {
+    uint8_t buf[SPOOL_RECORD_MAX], expect[SPOOL_RECORD_MAX];
+    uint16_t len;
+    uint32_t prev = 0;
+    spool_cursor_t cursor = spool_cursor();
+    while(spool_next(&cursor, buf, sizeof(buf), &len)) {
+        uint32_t seq;
+        memcpy(&seq, buf, sizeof(seq));
+        if(record_fill(seq, expect) != len || memcmp(buf, expect, len) != 0) {
+            printf("  corrupt record seq %u len %u\n", seq, len);
+            res->errors++;
+        } else if(seq <= prev || seq > last) {
+            printf("  record seq %u out of order (prev %u, last %u)\n", seq, prev, last);
+            res->errors++;
+        }
+        prev = seq;
+        res->read++;
+    }
+    spool_consume(&cursor);
+    if(spool_pending()) {
+        printf("  %u records pending after draining\n", spool_pending());
+        res->errors++;
+    }
+    if(prev != res->acked) {
+        printf("  newest record read %u, expected %u\n", prev, res->acked);
+        res->errors++;
+    }
+    res->acked = 0;
+}
+
+/* run one boot in a child process and collect its result */
+static boot_result_t boot(void (*fn)(boot_result_t*), boot_result_t in) {
+    int fds[2];
+    boot_result_t res = in;
+    if(pipe(fds) != 0) {
+        perror("pipe");
+        exit(1);
+    }
+    pid_t pid = fork();
+    if(pid == 0) {
+        close(fds[0]);
+        res.boot++;
+        if(!spool_init()) {
+            res.errors++;
+        } else {
+            fn(&res);
+        }
+        res.stats = spool_stats();
+        ssize_t n = write(fds[1], &res, sizeof(res));
+        _exit(n == sizeof(res) ? 0 : 1);
+    }
+    close(fds[1]);
+    if(read(fds[0], &res, sizeof(res)) != sizeof(res)) {
+        printf("  boot died\n");
+        res = in;
+        res.errors++;
+    }
+    close(fds[0]);
+    waitpid(pid, NULL, 0);
+    return res;
+}
+
+static void boot_wrap(boot_result_t *res) {
+    uint8_t buf[SPOOL_RECORD_MAX];
+    uint32_t seq = res->next;
+    // twice the capacity, so the ring wraps and drops the oldest sectors
+    for(uint32_t bytes = 0; bytes < 2 * SPOOL_IMAGE_SZ; seq++) {
+        uint16_t len = record_fill(seq, buf);
+        if(!spool_append(buf, len)) {
+            printf("  append %u failed\n", seq);
+            res->errors++;
+        }
+        bytes += len;
+    }
+    res->next = seq;
+}
+
+static void boot_check(boot_result_t *res) {
+    res->read = 0;
+    drain(res, res->next - 1);
+}
+
+static void boot_crash(boot_result_t *res) {
+    uint8_t buf[SPOOL_RECORD_MAX];
+    boot_check(res);
+    uint32_t seq = res->next;
+    // reproducible cut points, up to two sectors into the boot
+    uint32_t cut = (res->boot * 2654435761u) >> 8;
+    host_partition_tear(SPOOL_PARTITION_LABEL, cut % (2 * SPOOL_SECTOR_SZ));
+    while(!host_partition_torn(SPOOL_PARTITION_LABEL)) {
+        uint16_t len = record_fill(seq, buf);
+        if(spool_append(buf, len) && !host_partition_torn(SPOOL_PARTITION_LABEL)) {
+            res->acked = seq;
+        }
+        seq++;
+    }
+    res->next = seq;
+}
+
+int main(int argc, char **argv) {
+    const char *image = (argc > 1) ? argv[1] : "spool.bin";
+    uint32_t boots = (argc > 2) ? strtoul(argv[2], NULL, 10) : 200;
+    uint32_t errors = 0;
+
+    // every boot warns about the ring being full or a torn record
+    esp_log_level_set("spool", ESP_LOG_ERROR);
+    unlink(image);
+    if(host_partition_add(SPOOL_PARTITION_LABEL, image, SPOOL_IMAGE_SZ) != ESP_OK) {
+        return 1;
+    }
+
+    boot_result_t res = {};
+    res.next = 1;
+    res = boot(boot_wrap, res);
+    spool_stats_t wrap = res.stats;
+    res.acked = res.next - 1;
+    res = boot(boot_check, res);
+    if(wrap.written - wrap.dropped != res.read) {
+        printf("  %u written, %u dropped, but %u read back\n", wrap.written, wrap.dropped, res.read);
+        res.errors++;
+    }
+    errors += res.errors;
+    printf("wrap    %u written, %u dropped when the ring was full, %u read back\n",
+            wrap.written, wrap.dropped, res.read);
+
+    res.errors = 0;
+    uint32_t recovered = 0;
+    for(uint32_t i=0; i<boots; i++) {
+        res = boot(boot_crash, res);
+        recovered += res.read;
+    }
+    res = boot(boot_check, res);
+    recovered += res.read;
+    errors += res.errors;
+    printf("crash   %u power cuts, %u records recovered, %u errors\n", boots, recovered, res.errors);
+    printf("wear    %u sectors, erase count %u..%u\n",
+            res.stats.sectors, res.stats.erase_min, res.stats.erase_max);
+
+    unlink(image);
+    return errors ? 1 : 0;
+}
@@ -0,0 +1,37 @@
+#ifndef IOT_CONFIG_H_
+#define IOT_CONFIG_H_
+
+// config for the host build of iot-core.  every value can be overridden
+// from the compiler command line, see iot_host_core() in CMakeLists.txt
+
+#ifndef MAX_DEVICES
+ #define MAX_DEVICES        8
+#endif
+
+#ifndef MAX_SENSORS
+ #define MAX_SENSORS        2
+#endif
+
+// TLS is not emulated, the certificate is never checked
+#ifndef CA_CRT
+ #define CA_CRT             ""
+#endif
+
+// Influx and SmartThings talk to sinks on the local host
+#ifndef INFLUX_HOST
+ #define INFLUX_HOST        "127.0.0.1"
+#endif
+
+#ifndef INFLUX_PORT
+ #define INFLUX_PORT        8086
+#endif
+
+#ifndef INFLUX_DB_NAME
+ #define INFLUX_DB_NAME     "sensors"
+#endif
+
+#ifndef ST_MDNS_SVC
+ #define ST_MDNS_SVC        "SxNET"
+#endif
+
+#endif
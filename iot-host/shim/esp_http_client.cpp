@@ -0,0 +1,594 @@
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <netdb.h>
+#include <unistd.h>
+#include <errno.h>
+#include <strings.h>
+#include <string>
+#include <vector>
+#include "host.h"
+#include "esp_http_client.h"
+#include "esp_log.h"
+
+static const char *TAG = "HTTP_CLIENT";
+
+#define HTTP_DEFAULT_TIMEOUT_MS     5000
+#define HTTP_RECV_CHUNK             4096
+
+typedef std::pair<std::string, std::string> http_header_entry_t;
+
+struct esp_http_client {
+    std::string                         scheme;
+    std::string                         host;
+    int                                 port;
+    std::string                         path;
+    std::string                         query;
+    std::string                         username;
+    std::string                         password;
+    std::string                         user_agent;
+    esp_http_client_method_t            method;
+    int                                 timeout_ms;
+    http_event_handle_cb                event_handler;
+    void                                *user_data;
+    std::vector<http_header_entry_t>    headers;
+    const char                          *post_data;
+    int                                 post_len;
+
+    int                                 fd;
+    std::string                         rbuf;
+    size_t                              rpos;
+
+    int                                 status;
+    int64_t                             content_length;
+    int64_t                             body_read;
+    int64_t                             chunk_left;
+    bool                                chunked;
+    bool                                body_done;
+    bool                                server_close;
+    bool                                in_response;
+};
+
+static esp_err_t http_dispatch(esp_http_client_handle_t client, esp_http_client_event_id_t id,
+                        void *data = NULL, int len = 0, char *key = NULL, char *value = NULL) {
+    if(client->event_handler == NULL) {
+        return ESP_OK;
+    }
+    esp_http_client_event_t evt;
+    evt.event_id = id;
+    evt.client = client;
+    evt.data = data;
+    evt.data_len = len;
+    evt.user_data = client->user_data;
+    evt.header_key = key;
+    evt.header_value = value;
+    return client->event_handler(&evt);
+}
+
+static int http_default_port(const std::string &scheme) {
+    return (scheme == "https") ? 443 : 80;
+}
+
+static esp_err_t http_parse_url(esp_http_client_handle_t client, const char *url) {
+    std::string u(url);
+    size_t pos = u.find("://");
+    if(pos == std::string::npos) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    client->scheme = u.substr(0, pos);
+    u = u.substr(pos + 3);
+    size_t slash = u.find('/');
+    std::string authority = u.substr(0, slash);
+    std::string rest = (slash == std::string::npos) ? "/" : u.substr(slash);
+    size_t at = authority.rfind('@');
+    if(at != std::string::npos) {
+        std::string cred = authority.substr(0, at);
+        size_t colon = cred.find(':');
+        client->username = cred.substr(0, colon);
+        client->password = (colon == std::string::npos) ? "" : cred.substr(colon + 1);
+        authority = authority.substr(at + 1);
+    }
+    size_t colon = authority.rfind(':');
+    if(colon != std::string::npos) {
+        client->host = authority.substr(0, colon);
+        client->port = atoi(authority.substr(colon + 1).c_str());
+    } else {
+        client->host = authority;
+        client->port = http_default_port(client->scheme);
+    }
+    size_t q = rest.find('?');
+    client->path = rest.substr(0, q);
+    client->query = (q == std::string::npos) ? "" : rest.substr(q + 1);
+    return ESP_OK;
+}
+
+static const char* http_method_str(esp_http_client_method_t method) {
+    switch(method) {
+        case HTTP_METHOD_POST:      return "POST";
+        case HTTP_METHOD_PUT:       return "PUT";
+        case HTTP_METHOD_PATCH:     return "PATCH";
+        case HTTP_METHOD_DELETE:    return "DELETE";
+        case HTTP_METHOD_HEAD:      return "HEAD";
+        default:                    return "GET";
+    }
+}
+
+static std::string http_base64(const std::string &in) {
+    static const char *alphabet = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    std::string out;
+    for(size_t i=0; i<in.size(); i+=3) {
+        uint32_t n = (uint8_t)in[i] << 16;
+        if(i + 1 < in.size()) n |= (uint8_t)in[i + 1] << 8;
+        if(i + 2 < in.size()) n |= (uint8_t)in[i + 2];
+        out += alphabet[(n >> 18) & 63];
+        out += alphabet[(n >> 12) & 63];
+        out += (i + 1 < in.size()) ? alphabet[(n >> 6) & 63] : '=';
+        out += (i + 2 < in.size()) ? alphabet[n & 63] : '=';
+    }
+    return out;
+}
+
+static void http_reset_response(esp_http_client_handle_t client) {
+    client->status = -1;
+    client->content_length = -1;
+    client->body_read = 0;
+    client->chunk_left = 0;
+    client->chunked = false;
+    client->body_done = false;
+    client->server_close = false;
+    client->in_response = false;
+}
+
+static void http_disconnect(esp_http_client_handle_t client) {
+    if(client->fd >= 0) {
+        close(client->fd);
+        client->fd = -1;
+        client->rbuf.clear();
+        client->rpos = 0;
+        http_dispatch(client, HTTP_EVENT_DISCONNECTED);
+    }
+}
+
+static esp_err_t http_connect(esp_http_client_handle_t client) {
+    struct addrinfo hints, *res;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    char port[8];
+    snprintf(port, sizeof(port), "%d", client->port);
+    if(getaddrinfo(client->host.c_str(), port, &hints, &res) != 0) {
+        ESP_LOGE(TAG, "couldn't resolve %s", client->host.c_str());
+        return ESP_ERR_HTTP_CONNECT;
+    }
+    int fd = socket(res->ai_family, res->ai_socktype, res->ai_protocol);
+    struct timeval tv = { client->timeout_ms / 1000, (client->timeout_ms % 1000) * 1000 };
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+    // request headers and body go out in separate writes, as over lwIP
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    if(connect(fd, res->ai_addr, res->ai_addrlen) != 0) {
+        ESP_LOGE(TAG, "connection to %s:%d failed: %s", client->host.c_str(), client->port, strerror(errno));
+        close(fd);
+        freeaddrinfo(res);
+        return ESP_ERR_HTTP_CONNECT;
+    }
+    freeaddrinfo(res);
+    client->fd = fd;
+    client->rbuf.clear();
+    client->rpos = 0;
+    http_dispatch(client, HTTP_EVENT_ON_CONNECTED);
+    return ESP_OK;
+}
+
+static bool http_send_all(esp_http_client_handle_t client, const char *data, size_t len) {
+    while(len) {
+        ssize_t n = send(client->fd, data, len, MSG_NOSIGNAL);
+        if(n <= 0) {
+            if(n < 0 && errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        data += n;
+        len -= n;
+    }
+    return true;
+}
+
+/* pull more bytes into rbuf, false on EOF, error or timeout */
+static bool http_fill(esp_http_client_handle_t client) {
+    if(client->fd < 0) {
+        return false;
+    }
+    if(client->rpos && client->rpos == client->rbuf.size()) {
+        client->rbuf.clear();
+        client->rpos = 0;
+    }
+    char buf[HTTP_RECV_CHUNK];
+    ssize_t n;
+    do {
+        n = recv(client->fd, buf, sizeof(buf), 0);
+    } while(n < 0 && errno == EINTR);
+    if(n <= 0) {
+        return false;
+    }
+    client->rbuf.append(buf, n);
+    return true;
+}
+
+static bool http_read_line(esp_http_client_handle_t client, std::string &line) {
+    size_t eol;
+    while((eol = client->rbuf.find("\r\n", client->rpos)) == std::string::npos) {
+        if(!http_fill(client)) {
+            return false;
+        }
+    }
+    line = client->rbuf.substr(client->rpos, eol - client->rpos);
+    client->rpos = eol + 2;
+    return true;
+}
+
+esp_http_client_handle_t esp_http_client_init(const esp_http_client_config_t *config) {
+    HOST_SHIM_SCOPE;
+    esp_http_client_handle_t client = new esp_http_client();
+    client->fd = -1;
+    client->rpos = 0;
+    client->post_data = NULL;
+    client->post_len = 0;
+    http_reset_response(client);
+    if(config->url && http_parse_url(client, config->url) != ESP_OK) {
+        ESP_LOGE(TAG, "invalid url: %s", config->url);
+        delete client;
+        return NULL;
+    }
+    if(!config->url) {
+        client->scheme = (config->transport_type == HTTP_TRANSPORT_OVER_SSL) ? "https" : "http";
+        client->host = config->host ? config->host : "";
+        client->port = config->port ? config->port : http_default_port(client->scheme);
+        client->path = config->path ? config->path : "/";
+        client->query = config->query ? config->query : "";
+    }
+    if(config->username) {
+        client->username = config->username;
+    }
+    if(config->password) {
+        client->password = config->password;
+    }
+    client->user_agent = config->user_agent ? config->user_agent : "ESP32 HTTP Client/1.0";
+    client->method = config->method;
+    client->timeout_ms = config->timeout_ms ? config->timeout_ms : HTTP_DEFAULT_TIMEOUT_MS;
+    client->event_handler = config->event_handler;
+    client->user_data = config->user_data;
+    return client;
+}
+
+esp_err_t esp_http_client_set_url(esp_http_client_handle_t client, const char *url) {
+    HOST_SHIM_SCOPE;
+    std::string host = client->host;
+    int port = client->port;
+    if(http_parse_url(client, url) != ESP_OK) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    // a different peer needs a new connection
+    if(host != client->host || port != client->port) {
+        http_disconnect(client);
+    }
+    return ESP_OK;
+}
+
+esp_err_t esp_http_client_get_url(esp_http_client_handle_t client, char *url, int len) {
+    HOST_SHIM_SCOPE;
+    snprintf(url, len, "%s://%s:%d%s%s%s", client->scheme.c_str(), client->host.c_str(),
+            client->port, client->path.c_str(), client->query.empty() ? "" : "?",
+            client->query.c_str());
+    return ESP_OK;
+}
+
+esp_err_t esp_http_client_set_post_field(esp_http_client_handle_t client, const char *data, int len) {
+    HOST_SHIM_SCOPE;
+    client->post_data = data;
+    client->post_len = data ? len : 0;
+    return ESP_OK;
+}
+
+esp_err_t esp_http_client_set_header(esp_http_client_handle_t client, const char *key, const char *value) {
+    HOST_SHIM_SCOPE;
+    for(http_header_entry_t &header : client->headers) {
+        if(strcasecmp(header.first.c_str(), key) == 0) {
+            header.second = value;
+            return ESP_OK;
+        }
+    }
+    client->headers.push_back(http_header_entry_t(key, value));
+    return ESP_OK;
+}
+
+esp_err_t esp_http_client_delete_header(esp_http_client_handle_t client, const char *key) {
+    HOST_SHIM_SCOPE;
+    for(auto it = client->headers.begin(); it != client->headers.end(); it++) {
+        if(strcasecmp(it->first.c_str(), key) == 0) {
+            client->headers.erase(it);
+            return ESP_OK;
+        }
+    }
+    return ESP_ERR_NOT_FOUND;
+}
+
+esp_err_t esp_http_client_set_method(esp_http_client_handle_t client, esp_http_client_method_t method) {
+    HOST_SHIM_SCOPE;
+    client->method = method;
+    return ESP_OK;
+}
+
+esp_err_t esp_http_client_get_user_data(esp_http_client_handle_t client, void **data) {
+    HOST_SHIM_SCOPE;
+    *data = client->user_data;
+    return ESP_OK;
+}
+
+esp_err_t esp_http_client_set_user_data(esp_http_client_handle_t client, void *data) {
+    HOST_SHIM_SCOPE;
+    client->user_data = data;
+    return ESP_OK;
+}
+
+esp_err_t esp_http_client_open(esp_http_client_handle_t client, int write_len) {
+    HOST_SHIM_SCOPE;
+    // a response left unread would be taken for the next one
+    if(client->in_response && !esp_http_client_is_complete_data_received(client)) {
+        http_disconnect(client);
+    }
+    if(client->server_close) {
+        http_disconnect(client);
+    }
+    http_reset_response(client);
+    if(client->fd < 0) {
+        esp_err_t err = http_connect(client);
+        if(err != ESP_OK) {
+            return err;
+        }
+    }
+
+    std::string req = http_method_str(client->method);
+    req += " " + client->path + (client->query.empty() ? "" : "?" + client->query) + " HTTP/1.1\r\n";
+    req += "Host: " + client->host;
+    if(client->port != http_default_port(client->scheme)) {
+        req += ":" + std::to_string(client->port);
+    }
+    req += "\r\nUser-Agent: " + client->user_agent + "\r\n";
+    if(!client->username.empty()) {
+        req += "Authorization: Basic " + http_base64(client->username + ":" + client->password) + "\r\n";
+    }
+    for(const http_header_entry_t &header : client->headers) {
+        req += header.first + ": " + header.second + "\r\n";
+    }
+    if(write_len >= 0) {
+        req += "Content-Length: " + std::to_string(write_len) + "\r\n";
+    } else {
+        req += "Transfer-Encoding: chunked\r\n";
+    }
+    req += "\r\n";
+    if(!http_send_all(client, req.data(), req.size())) {
+        ESP_LOGE(TAG, "failed to send the request headers");
+        http_disconnect(client);
+        return ESP_ERR_HTTP_WRITE_DATA;
+    }
+    http_dispatch(client, HTTP_EVENT_HEADER_SENT);
+    return ESP_OK;
+}
+
+int esp_http_client_write(esp_http_client_handle_t client, const char *buffer, int len) {
+    HOST_SHIM_SCOPE;
+    if(client->fd < 0 || !http_send_all(client, buffer, len)) {
+        return -1;
+    }
+    return len;
+}
+
+int esp_http_client_fetch_headers(esp_http_client_handle_t client) {
+    HOST_SHIM_SCOPE;
+    std::string line;
+    // skip interim 1xx responses
+    do {
+        if(!http_read_line(client, line) || line.compare(0, 5, "HTTP/") != 0) {
+            http_disconnect(client);
+            return ESP_FAIL;
+        }
+        size_t sp = line.find(' ');
+        client->status = (sp == std::string::npos) ? -1 : atoi(line.c_str() + sp + 1);
+        if(client->status / 100 == 1) {
+            while(http_read_line(client, line) && !line.empty());
+        }
+    } while(client->status / 100 == 1);
+
+    client->server_close = (line.compare(0, 8, "HTTP/1.0") == 0);
+    for(;;) {
+        if(!http_read_line(client, line)) {
+            http_disconnect(client);
+            return ESP_FAIL;
+        }
+        if(line.empty()) {
+            break;
+        }
+        size_t colon = line.find(':');
+        if(colon == std::string::npos) {
+            continue;
+        }
+        std::string key = line.substr(0, colon);
+        size_t vpos = line.find_first_not_of(' ', colon + 1);
+        std::string value = (vpos == std::string::npos) ? "" : line.substr(vpos);
+        if(strcasecmp(key.c_str(), "Content-Length") == 0) {
+            client->content_length = atoll(value.c_str());
+        } else if(strcasecmp(key.c_str(), "Transfer-Encoding") == 0 && strcasestr(value.c_str(), "chunked")) {
+            client->chunked = true;
+        } else if(strcasecmp(key.c_str(), "Connection") == 0) {
+            client->server_close = (strcasecmp(value.c_str(), "close") == 0);
+        }
+        http_dispatch(client, HTTP_EVENT_ON_HEADER, NULL, 0, (char*)key.c_str(), (char*)value.c_str());
+    }
+    client->in_response = true;
+    if(client->chunked) {
+        client->content_length = -1;
+    }
+    // no body for HEAD, 204 and 304, nor for an empty Content-Length body
+    if(client->method == HTTP_METHOD_HEAD || client->status == 204 || client->status == 304 ||
+            client->content_length == 0) {
+        client->content_length = client->chunked ? -1 : 0;
+        client->body_done = !client->chunked || client->method == HTTP_METHOD_HEAD ||
+                client->status == 204 || client->status == 304;
+    }
+    return client->chunked ? -1 : (int)client->content_length;
+}
+
+bool esp_http_client_is_chunked_response(esp_http_client_handle_t client) {
+    HOST_SHIM_SCOPE;
+    return client->chunked;
+}
+
+/* read up to len body bytes off the socket, 0 at the end of the body */
+static int http_read_body(esp_http_client_handle_t client, char *buffer, int len) {
+    if(client->body_done || len <= 0) {
+        return 0;
+    }
+    if(client->chunked && client->chunk_left == 0) {
+        std::string line;
+        if(client->body_read > 0 && !http_read_line(client, line)) {
+            return -1;
+        }
+        if(!http_read_line(client, line)) {
+            return -1;
+        }
+        client->chunk_left = strtoll(line.c_str(), NULL, 16);
+        if(client->chunk_left == 0) {
+            while(http_read_line(client, line) && !line.empty());
+            client->body_done = true;
+            return 0;
+        }
+    }
+    int64_t want = len;
+    if(client->chunked) {
+        want = (client->chunk_left < want) ? client->chunk_left : want;
+    } else if(client->content_length >= 0) {
+        int64_t left = client->content_length - client->body_read;
+        want = (left < want) ? left : want;
+    }
+    if(client->rpos == client->rbuf.size() && !http_fill(client)) {
+        // without a length the body ends with the connection
+        if(!client->chunked && client->content_length < 0) {
+            client->body_done = true;
+            client->server_close = true;
+            return 0;
+        }
+        return -1;
+    }
+    int64_t avail = client->rbuf.size() - client->rpos;
+    int n = (int)((avail < want) ? avail : want);
+    memcpy(buffer, client->rbuf.data() + client->rpos, n);
+    client->rpos += n;
+    client->body_read += n;
+    if(client->chunked) {
+        client->chunk_left -= n;
+    } else if(client->content_length >= 0 && client->body_read >= client->content_length) {
+        client->body_done = true;
+    }
+    http_dispatch(client, HTTP_EVENT_ON_DATA, buffer, n);
+    return n;
+}
+
+int esp_http_client_read(esp_http_client_handle_t client, char *buffer, int len) {
+    HOST_SHIM_SCOPE;
+    int n = http_read_body(client, buffer, len);
+    if(n < 0) {
+        ESP_LOGW(TAG, "connection lost while reading the response");
+        http_disconnect(client);
+    }
+    return n;
+}
+
+int esp_http_client_read_response(esp_http_client_handle_t client, char *buffer, int len) {
+    HOST_SHIM_SCOPE;
+    int total = 0;
+    while(total < len) {
+        int n = esp_http_client_read(client, buffer + total, len - total);
+        if(n <= 0) {
+            return (total || n == 0) ? total : n;
+        }
+        total += n;
+    }
+    return total;
+}
+
+int esp_http_client_flush_response(esp_http_client_handle_t client, int *len) {
+    HOST_SHIM_SCOPE;
+    char buf[512];
+    int total = 0;
+    int n;
+    while((n = esp_http_client_read(client, buf, sizeof(buf))) > 0) {
+        total += n;
+    }
+    if(len) {
+        *len = total;
+    }
+    return (n < 0) ? ESP_FAIL : ESP_OK;
+}
+
+esp_err_t esp_http_client_perform(esp_http_client_handle_t client) {
+    HOST_SHIM_SCOPE;
+    esp_err_t err = esp_http_client_open(client, client->post_len);
+    if(err != ESP_OK) {
+        http_dispatch(client, HTTP_EVENT_ERROR);
+        return err;
+    }
+    if(client->post_len && esp_http_client_write(client, client->post_data, client->post_len) < 0) {
+        http_dispatch(client, HTTP_EVENT_ERROR);
+        http_disconnect(client);
+        return ESP_ERR_HTTP_WRITE_DATA;
+    }
+    if(esp_http_client_fetch_headers(client) == ESP_FAIL && client->status < 0) {
+        http_dispatch(client, HTTP_EVENT_ERROR);
+        return ESP_ERR_HTTP_FETCH_HEADER;
+    }
+    if(esp_http_client_flush_response(client, NULL) != ESP_OK) {
+        http_dispatch(client, HTTP_EVENT_ERROR);
+        return ESP_FAIL;
+    }
+    http_dispatch(client, HTTP_EVENT_ON_FINISH);
+    if(client->server_close) {
+        http_disconnect(client);
+    }
+    return ESP_OK;
+}
+
+int esp_http_client_get_status_code(esp_http_client_handle_t client) {
+    HOST_SHIM_SCOPE;
+    return client->status;
+}
+
+int esp_http_client_get_content_length(esp_http_client_handle_t client) {
+    HOST_SHIM_SCOPE;
+    return (int)client->content_length;
+}
+
+bool esp_http_client_is_complete_data_received(esp_http_client_handle_t client) {
+    HOST_SHIM_SCOPE;
+    return client->body_done;
+}
+
+esp_err_t esp_http_client_close(esp_http_client_handle_t client) {
+    HOST_SHIM_SCOPE;
+    http_disconnect(client);
+    http_reset_response(client);
+    return ESP_OK;
+}
+
+esp_err_t esp_http_client_cleanup(esp_http_client_handle_t client) {
+    HOST_SHIM_SCOPE;
+    if(client == NULL) {
+        return ESP_FAIL;
+    }
+    esp_http_client_close(client);
+    delete client;
+    return ESP_OK;
+}
@@ -0,0 +1,222 @@
+#include <sys/time.h>
+#include <arpa/inet.h>
+#include <pthread.h>
+#include <vector>
+#include "host.h"
+#include "esp_event.h"
+#include "esp_wifi.h"
+#include "esp_sntp.h"
+#include "esp_log.h"
+#include "tcpip_adapter.h"
+#include "mdns.h"
+#include "esp_http_server.h"
+#include "esp_https_ota.h"
+#include "wifi_provisioning/manager.h"
+#include "wifi_provisioning/scheme_softap.h"
+
+static const char *TAG = "netif";
+
+esp_event_base_t WIFI_EVENT         = "WIFI_EVENT";
+esp_event_base_t IP_EVENT           = "IP_EVENT";
+esp_event_base_t WIFI_PROV_EVENT    = "WIFI_PROV_EVENT";
+
+const wifi_prov_scheme_t wifi_prov_scheme_softap = { "softap" };
+
+struct esp_netif_obj {
+    const char  *name;
+};
+
+/* esp_event */
+
+typedef struct {
+    esp_event_base_t    base;
+    int32_t             id;
+    esp_event_handler_t handler;
+    void                *arg;
+} event_handler_entry_t;
+
+static pthread_mutex_t                      event_lock  = PTHREAD_MUTEX_INITIALIZER;
+static std::vector<event_handler_entry_t>   event_handlers;
+
+esp_err_t esp_event_loop_create_default() {
+    return ESP_OK;
+}
+
+esp_err_t esp_event_handler_register(esp_event_base_t base, int32_t id,
+                        esp_event_handler_t handler, void *arg) {
+    pthread_mutex_lock(&event_lock);
+    event_handlers.push_back({ base, id, handler, arg });
+    pthread_mutex_unlock(&event_lock);
+    return ESP_OK;
+}
+
+esp_err_t esp_event_post(esp_event_base_t base, int32_t id, void *data, size_t len, uint32_t ticks) {
+    pthread_mutex_lock(&event_lock);
+    std::vector<event_handler_entry_t> handlers = event_handlers;
+    pthread_mutex_unlock(&event_lock);
+    for(const event_handler_entry_t &entry : handlers) {
+        if(entry.base == base && (entry.id == ESP_EVENT_ANY_ID || entry.id == id)) {
+            entry.handler(entry.arg, base, id, data);
+        }
+    }
+    return ESP_OK;
+}
+
+/* esp_netif and esp_wifi */
+
+esp_err_t esp_netif_init() {
+    return ESP_OK;
+}
+
+esp_netif_t* esp_netif_create_default_wifi_sta() {
+    static esp_netif_t sta = { "sta" };
+    return &sta;
+}
+
+esp_netif_t* esp_netif_create_default_wifi_ap() {
+    static esp_netif_t ap = { "ap" };
+    return &ap;
+}
+
+esp_err_t esp_wifi_init(const wifi_init_config_t *config) {
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_set_mode(wifi_mode_t mode) {
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_set_ps(wifi_ps_type_t type) {
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_start() {
+    return esp_event_post(WIFI_EVENT, WIFI_EVENT_STA_START, NULL, 0, 0);
+}
+
+esp_err_t esp_wifi_stop() {
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_connect() {
+    return esp_event_post(IP_EVENT, IP_EVENT_STA_GOT_IP, NULL, 0, 0);
+}
+
+esp_err_t tcpip_adapter_get_ip_info(tcpip_adapter_if_t tcpip_if, tcpip_adapter_ip_info_t *ip_info) {
+    ip_info->ip.addr = htonl(INADDR_LOOPBACK);
+    ip_info->netmask.addr = htonl(0xff000000);
+    ip_info->gw.addr = htonl(INADDR_LOOPBACK);
+    return ESP_OK;
+}
+
+/* wifi provisioning */
+
+esp_err_t wifi_prov_mgr_init(wifi_prov_mgr_config_t config) {
+    return ESP_OK;
+}
+
+void wifi_prov_mgr_deinit() {
+}
+
+esp_err_t wifi_prov_mgr_is_provisioned(bool *provisioned) {
+    *provisioned = true;
+    return ESP_OK;
+}
+
+esp_err_t wifi_prov_mgr_start_provisioning(wifi_prov_security_t security, const char *pop,
+                        const char *service_name, const char *service_key) {
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t wifi_prov_mgr_reset_sm_state_on_failure() {
+    return ESP_OK;
+}
+
+/* sntp: the host clock is the reference */
+
+static sntp_sync_time_cb_t  sntp_cb     = NULL;
+static uint8_t              sntp_synced = false;
+
+void sntp_setoperatingmode(uint8_t mode) {
+}
+
+void sntp_setservername(uint8_t idx, const char *server) {
+}
+
+void sntp_set_time_sync_notification_cb(sntp_sync_time_cb_t cb) {
+    sntp_cb = cb;
+}
+
+void sntp_init() {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    sntp_synced = true;
+    if(sntp_cb) {
+        sntp_cb(&tv);
+    }
+}
+
+void sntp_stop() {
+}
+
+sntp_sync_status_t sntp_get_sync_status() {
+    return sntp_synced ? SNTP_SYNC_STATUS_COMPLETED : SNTP_SYNC_STATUS_RESET;
+}
+
+/* mdns */
+
+esp_err_t mdns_init() {
+    return ESP_OK;
+}
+
+void mdns_free() {
+}
+
+esp_err_t mdns_hostname_set(const char *hostname) {
+    return ESP_OK;
+}
+
+esp_err_t mdns_service_add(const char *instance, const char *service, const char *proto,
+                        uint16_t port, mdns_txt_item_t txt[], size_t num_items) {
+    ESP_LOGD(TAG, "mdns: not announcing %s.%s.%s:%u", instance, service, proto, port);
+    return ESP_OK;
+}
+
+/* esp_http_server */
+
+esp_err_t httpd_start(httpd_handle_t *handle, const httpd_config_t *config) {
+    ESP_LOGW(TAG, "httpd_start(): no http server on the host");
+    *handle = NULL;
+    return ESP_FAIL;
+}
+
+esp_err_t httpd_stop(httpd_handle_t handle) {
+    return ESP_OK;
+}
+
+esp_err_t httpd_register_uri_handler(httpd_handle_t handle, const httpd_uri_t *uri_handler) {
+    return ESP_ERR_INVALID_ARG;
+}
+
+size_t httpd_req_get_url_query_len(httpd_req_t *r) {
+    return 0;
+}
+
+esp_err_t httpd_req_get_url_query_str(httpd_req_t *r, char *buf, size_t buf_len) {
+    return ESP_ERR_NOT_FOUND;
+}
+
+esp_err_t httpd_query_key_value(const char *qry, const char *key, char *val, size_t val_size) {
+    return ESP_ERR_NOT_FOUND;
+}
+
+esp_err_t httpd_resp_send(httpd_req_t *r, const char *buf, ssize_t buf_len) {
+    return ESP_ERR_INVALID_ARG;
+}
+
+/* esp_https_ota */
+
+esp_err_t esp_https_ota(const esp_http_client_config_t *config) {
+    ESP_LOGW(TAG, "esp_https_ota(): no app partition on the host");
+    return ESP_ERR_NOT_SUPPORTED;
+}
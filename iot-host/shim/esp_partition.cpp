@@ -0,0 +1,209 @@
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <string>
+#include <vector>
+#include "host.h"
+#include "esp_partition.h"
+#include "esp_log.h"
+
+static const char *TAG = "partition";
+
+/* a data partition backed by a file, with NOR flash semantics */
+typedef struct {
+    esp_partition_t part;
+    int             fd;
+    int32_t         budget;     // bytes left before the power cut, < 0 for none
+    bool            torn;
+} host_partition_t;
+
+static pthread_mutex_t                  part_lock   = PTHREAD_MUTEX_INITIALIZER;
+static std::vector<host_partition_t*>   part_table;
+static uint32_t                         part_next   = 0x110000;
+static pthread_once_t                   part_env    = PTHREAD_ONCE_INIT;
+
+static host_partition_t* part_find(const char *label) {
+    for(host_partition_t *hp : part_table) {
+        if(label == NULL || strcmp(hp->part.label, label) == 0) {
+            return hp;
+        }
+    }
+    return NULL;
+}
+
+static host_partition_t* part_from(const esp_partition_t *part) {
+    for(host_partition_t *hp : part_table) {
+        if(&hp->part == part) {
+            return hp;
+        }
+    }
+    return NULL;
+}
+
+esp_err_t host_partition_add(const char *label, const char *path, uint32_t size) {
+    if(size == 0 || (size % SPI_FLASH_SEC_SIZE) != 0) {
+        ESP_LOGE(TAG, "partition '%s': size %u is not a multiple of the sector size", label, size);
+        return ESP_ERR_INVALID_SIZE;
+    }
+    int fd = open(path, O_RDWR | O_CREAT, 0644);
+    if(fd < 0) {
+        ESP_LOGE(TAG, "partition '%s': cannot open %s", label, path);
+        return ESP_FAIL;
+    }
+    // grow with erased flash, an existing image keeps its contents
+    off_t len = lseek(fd, 0, SEEK_END);
+    uint8_t erased[SPI_FLASH_SEC_SIZE];
+    memset(erased, 0xff, sizeof(erased));
+    for(off_t at = len; at < (off_t)size; at += sizeof(erased)) {
+        size_t n = ((off_t)size - at < (off_t)sizeof(erased)) ? (size_t)(size - at) : sizeof(erased);
+        if(pwrite(fd, erased, n, at) != (ssize_t)n) {
+            close(fd);
+            return ESP_FAIL;
+        }
+    }
+
+    host_partition_t *hp = new host_partition_t();
+    hp->part.type = ESP_PARTITION_TYPE_DATA;
+    hp->part.subtype = ESP_PARTITION_SUBTYPE_DATA_UNDEFINED;
+    hp->part.size = size;
+    strncpy(hp->part.label, label, sizeof(hp->part.label) - 1);
+    hp->fd = fd;
+    hp->budget = -1;
+    pthread_mutex_lock(&part_lock);
+    hp->part.address = part_next;
+    part_next += size;
+    part_table.push_back(hp);
+    pthread_mutex_unlock(&part_lock);
+    ESP_LOGI(TAG, "partition '%s': %uK at %s", label, size / 1024, path);
+    return ESP_OK;
+}
+
+/* IOT_HOST_PARTITIONS="label=path:size[K],..." */
+static void part_load_env() {
+    const char *env = getenv("IOT_HOST_PARTITIONS");
+    std::string list = env ? env : "";
+    size_t pos = 0;
+    while(pos < list.size()) {
+        size_t end = list.find(',', pos);
+        std::string entry = list.substr(pos, (end == std::string::npos) ? std::string::npos : end - pos);
+        pos = (end == std::string::npos) ? list.size() : end + 1;
+        size_t eq = entry.find('='), colon = entry.rfind(':');
+        if(eq == std::string::npos || colon == std::string::npos || colon < eq) {
+            ESP_LOGE(TAG, "IOT_HOST_PARTITIONS: bad entry '%s'", entry.c_str());
+            continue;
+        }
+        char *unit = NULL;
+        uint32_t size = strtoul(entry.c_str() + colon + 1, &unit, 0);
+        if(unit && (*unit == 'K' || *unit == 'k')) {
+            size *= 1024;
+        }
+        host_partition_add(entry.substr(0, eq).c_str(), entry.substr(eq + 1, colon - eq - 1).c_str(), size);
+    }
+}
+
+void host_partition_tear(const char *label, int32_t bytes) {
+    pthread_mutex_lock(&part_lock);
+    host_partition_t *hp = part_find(label);
+    if(hp) {
+        hp->budget = bytes;
+        hp->torn = false;
+    }
+    pthread_mutex_unlock(&part_lock);
+}
+
+bool host_partition_torn(const char *label) {
+    pthread_mutex_lock(&part_lock);
+    host_partition_t *hp = part_find(label);
+    bool torn = hp && hp->torn;
+    pthread_mutex_unlock(&part_lock);
+    return torn;
+}
+
+const esp_partition_t* esp_partition_find_first(esp_partition_type_t type,
+                                esp_partition_subtype_t subtype, const char *label) {
+    pthread_once(&part_env, part_load_env);
+    const esp_partition_t *part = NULL;
+    pthread_mutex_lock(&part_lock);
+    for(host_partition_t *hp : part_table) {
+        if(hp->part.type == type &&
+                (subtype == ESP_PARTITION_SUBTYPE_ANY || hp->part.subtype == subtype) &&
+                (label == NULL || strcmp(hp->part.label, label) == 0)) {
+            part = &hp->part;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&part_lock);
+    if(part == NULL) {
+        ESP_LOGW(TAG, "no partition '%s' on the host, see IOT_HOST_PARTITIONS", label ? label : "");
+    }
+    return part;
+}
+
+static esp_err_t part_check(host_partition_t *hp, size_t offset, size_t size) {
+    if(hp == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if(offset > hp->part.size || size > (hp->part.size - offset)) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    return ESP_OK;
+}
+
+esp_err_t esp_partition_read(const esp_partition_t *part, size_t offset, void *dst, size_t size) {
+    pthread_mutex_lock(&part_lock);
+    host_partition_t *hp = part_from(part);
+    esp_err_t err = part_check(hp, offset, size);
+    if(err == ESP_OK && pread(hp->fd, dst, size, offset) != (ssize_t)size) {
+        err = ESP_FAIL;
+    }
+    pthread_mutex_unlock(&part_lock);
+    return err;
+}
+
+/* programming only clears bits, like NOR flash */
+esp_err_t esp_partition_write(const esp_partition_t *part, size_t offset, const void *src, size_t size) {
+    pthread_mutex_lock(&part_lock);
+    host_partition_t *hp = part_from(part);
+    esp_err_t err = part_check(hp, offset, size);
+    if(err == ESP_OK && hp->budget >= 0 && (size_t)hp->budget < size) {
+        size = hp->budget;
+        hp->torn = true;
+    }
+    if(err == ESP_OK && size) {
+        std::vector<uint8_t> cells(size);
+        if(pread(hp->fd, cells.data(), size, offset) != (ssize_t)size) {
+            err = ESP_FAIL;
+        } else {
+            for(size_t i=0; i<size; i++) {
+                cells[i] &= ((const uint8_t*)src)[i];
+            }
+            if(pwrite(hp->fd, cells.data(), size, offset) != (ssize_t)size) {
+                err = ESP_FAIL;
+            }
+        }
+        if(hp->budget >= 0) {
+            hp->budget -= size;
+        }
+    }
+    pthread_mutex_unlock(&part_lock);
+    return err;
+}
+
+esp_err_t esp_partition_erase_range(const esp_partition_t *part, size_t offset, size_t size) {
+    uint8_t erased[SPI_FLASH_SEC_SIZE];
+    memset(erased, 0xff, sizeof(erased));
+    pthread_mutex_lock(&part_lock);
+    host_partition_t *hp = part_from(part);
+    esp_err_t err = part_check(hp, offset, size);
+    if(err == ESP_OK && ((offset % SPI_FLASH_SEC_SIZE) || (size % SPI_FLASH_SEC_SIZE))) {
+        err = ESP_ERR_INVALID_ARG;
+    }
+    // erases do not count against the budget, after a tear they are dropped
+    for(size_t at = offset; err == ESP_OK && !hp->torn && at < offset + size; at += SPI_FLASH_SEC_SIZE) {
+        if(pwrite(hp->fd, erased, SPI_FLASH_SEC_SIZE, at) != SPI_FLASH_SEC_SIZE) {
+            err = ESP_FAIL;
+        }
+    }
+    pthread_mutex_unlock(&part_lock);
+    return err;
+}
@@ -0,0 +1,225 @@
+#include <time.h>
+#include <stdarg.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <string>
+#include <map>
+#include <vector>
+#include "host.h"
+#include "esp_system.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+#include "esp_crc.h"
+#include "soc/rtc.h"
+#include "driver/uart.h"
+#include "freertos/FreeRTOS.h"
+
+static const char *TAG = "system";
+
+/* esp_timer */
+
+static int64_t host_clock_us() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((int64_t)ts.tv_sec * 1000000) + (ts.tv_nsec / 1000);
+}
+
+/* the clock starts at the first call, early in main() */
+int64_t esp_timer_get_time() {
+    static const int64_t boot_us = host_clock_us();
+    return host_clock_us() - boot_us;
+}
+
+/* esp_log */
+
+static pthread_mutex_t                          log_lock    = PTHREAD_MUTEX_INITIALIZER;
+static std::map<std::string, esp_log_level_t>   log_levels;
+static int                                      log_default = -1;
+
+static int log_env_level() {
+    const char *env = getenv("IOT_HOST_LOG");
+    switch(env ? env[0] : 'w') {
+        case 'n': return ESP_LOG_NONE;
+        case 'e': return ESP_LOG_ERROR;
+        case 'i': return ESP_LOG_INFO;
+        case 'd': return ESP_LOG_DEBUG;
+        case 'v': return ESP_LOG_VERBOSE;
+        default:  return ESP_LOG_WARN;
+    }
+}
+
+void host_log_level(int level) {
+    pthread_mutex_lock(&log_lock);
+    log_default = level;
+    log_levels.clear();
+    pthread_mutex_unlock(&log_lock);
+}
+
+void esp_log_level_set(const char *tag, esp_log_level_t level) {
+    pthread_mutex_lock(&log_lock);
+    if(strcmp(tag, "*") == 0) {
+        log_default = level;
+        log_levels.clear();
+    } else {
+        log_levels[tag] = level;
+    }
+    pthread_mutex_unlock(&log_lock);
+}
+
+uint32_t esp_log_timestamp() {
+    return (uint32_t)(esp_timer_get_time() / 1000);
+}
+
+void esp_log_write(esp_log_level_t level, const char *tag, const char *fmt, ...) {
+    pthread_mutex_lock(&log_lock);
+    if(log_default < 0) {
+        log_default = log_env_level();
+    }
+    auto it = log_levels.find(tag);
+    int max = (it == log_levels.end()) ? log_default : it->second;
+    // a per tag level may only quieten, the global level still applies
+    max = (max < log_default) ? max : log_default;
+    if(level <= max) {
+        va_list args;
+        va_start(args, fmt);
+        vfprintf(stderr, fmt, args);
+        va_end(args);
+    }
+    pthread_mutex_unlock(&log_lock);
+}
+
+/* esp_err */
+
+void host_error_check(esp_err_t err, const char *expr, const char *file, int line) {
+    if(err != ESP_OK) {
+        fprintf(stderr, "ESP_ERROR_CHECK failed: esp_err_t 0x%x at %s:%d\nexpression: %s\n",
+                err, file, line, expr);
+        abort();
+    }
+}
+
+/* restart and shutdown */
+
+static pthread_mutex_t                  shutdown_lock   = PTHREAD_MUTEX_INITIALIZER;
+static std::vector<shutdown_handler_t>  shutdown_handlers;
+
+esp_err_t esp_register_shutdown_handler(shutdown_handler_t handler) {
+    pthread_mutex_lock(&shutdown_lock);
+    shutdown_handlers.push_back(handler);
+    pthread_mutex_unlock(&shutdown_lock);
+    return ESP_OK;
+}
+
+esp_err_t esp_unregister_shutdown_handler(shutdown_handler_t handler) {
+    esp_err_t err = ESP_ERR_INVALID_STATE;
+    pthread_mutex_lock(&shutdown_lock);
+    for(auto it = shutdown_handlers.begin(); it != shutdown_handlers.end(); it++) {
+        if(*it == handler) {
+            shutdown_handlers.erase(it);
+            err = ESP_OK;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&shutdown_lock);
+    return err;
+}
+
+void esp_restart() {
+    ESP_LOGW(TAG, "esp_restart(): running shutdown handlers and exiting");
+    pthread_mutex_lock(&shutdown_lock);
+    std::vector<shutdown_handler_t> handlers = shutdown_handlers;
+    pthread_mutex_unlock(&shutdown_lock);
+    for(auto it = handlers.rbegin(); it != handlers.rend(); it++) {
+        (*it)();
+    }
+    fflush(NULL);
+    _exit(3);
+}
+
+void rtc_sleep_get_default_config(uint32_t flags, rtc_sleep_config_t *cfg) {
+    cfg->flags = flags;
+}
+
+void rtc_sleep_init(rtc_sleep_config_t cfg) {
+}
+
+void rtc_sleep_set_wakeup_time(uint64_t t) {
+}
+
+uint32_t rtc_deep_sleep_start(uint32_t wakeup_opt, uint32_t reject_opt) {
+    ESP_LOGW(TAG, "rtc_deep_sleep_start(): the host does not wake up");
+    esp_restart();
+}
+
+/* esp_random */
+
+uint32_t esp_random() {
+    static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+    static uint64_t state = 0;
+    pthread_mutex_lock(&lock);
+    if(state == 0) {
+        state = ((uint64_t)time(NULL) << 20) ^ (uint64_t)host_clock_us() ^ 0x9e3779b97f4a7c15ULL;
+    }
+    // xorshift64*
+    state ^= state >> 12;
+    state ^= state << 25;
+    state ^= state >> 27;
+    uint32_t ret = (uint32_t)((state * 0x2545f4914f6cdd1dULL) >> 32);
+    pthread_mutex_unlock(&lock);
+    return ret;
+}
+
+void esp_fill_random(void *buf, size_t len) {
+    uint8_t *p = (uint8_t*)buf;
+    while(len) {
+        uint32_t r = esp_random();
+        size_t n = (len < sizeof(r)) ? len : sizeof(r);
+        memcpy(p, &r, n);
+        p += n;
+        len -= n;
+    }
+}
+
+char* itoa(int value, char *str, int base) {
+    if(base == 10) {
+        sprintf(str, "%d", value);
+    } else if(base == 16) {
+        sprintf(str, "%x", (unsigned)value);
+    } else if(base == 8) {
+        sprintf(str, "%o", (unsigned)value);
+    } else {
+        str[0] = '\0';
+    }
+    return str;
+}
+
+/* esp_crc */
+
+uint32_t esp_crc32_le(uint32_t crc, uint8_t const *buf, uint32_t len) {
+    static uint32_t table[256];
+    static pthread_once_t once = PTHREAD_ONCE_INIT;
+    pthread_once(&once, []() {
+        for(uint32_t i=0; i<256; i++) {
+            uint32_t c = i;
+            for(uint8_t k=0; k<8; k++) {
+                c = (c & 1) ? (0xedb88320UL ^ (c >> 1)) : (c >> 1);
+            }
+            table[i] = c;
+        }
+    });
+    crc = ~crc;
+    for(uint32_t i=0; i<len; i++) {
+        crc = table[(crc ^ buf[i]) & 0xff] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+/* uart */
+
+esp_err_t uart_param_config(uart_port_t port, const uart_config_t *config) {
+    return ESP_OK;
+}
+
+esp_err_t uart_set_pin(uart_port_t port, int tx, int rx, int rts, int cts) {
+    return ESP_OK;
+}
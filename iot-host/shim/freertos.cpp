@@ -0,0 +1,600 @@
+#include <pthread.h>
+#include <time.h>
+#include <errno.h>
+#include <unistd.h>
+#include <vector>
+#include <algorithm>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/event_groups.h"
+#include "freertos/timers.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+
+static const char *TAG = "freertos";
+
+struct host_task {
+    pthread_t       thread;
+    char            name[configMAX_TASK_NAME_LEN];
+    TaskFunction_t  fn;
+    void            *arg;
+    pthread_mutex_t lock;
+    pthread_cond_t  cond;
+    uint32_t        notify;
+};
+
+struct host_queue {
+    pthread_mutex_t lock;
+    pthread_cond_t  readable;
+    pthread_cond_t  writable;
+    uint8_t         *items;
+    UBaseType_t     length;
+    UBaseType_t     item_size;
+    UBaseType_t     head;
+    UBaseType_t     count;
+    uint8_t         mutex;
+    TaskHandle_t    holder;
+};
+
+typedef struct host_event_waiter {
+    EventBits_t     bits;
+    BaseType_t      clear;
+    BaseType_t      all;
+    uint8_t         done;
+    EventBits_t     result;
+} host_event_waiter_t;
+
+struct host_event_group {
+    pthread_mutex_t lock;
+    pthread_cond_t  cond;
+    EventBits_t     bits;
+    std::vector<host_event_waiter_t*> waiters;
+};
+
+struct host_timer {
+    char                    name[configMAX_TASK_NAME_LEN];
+    TickType_t              period;
+    UBaseType_t             reload;
+    void                    *id;
+    TimerCallbackFunction_t cb;
+    uint8_t                 active;
+    int64_t                 expiry;
+};
+
+static thread_local host_task   *host_current       = NULL;
+static thread_local uint32_t    host_mux_id         = 0;
+static uint32_t                 host_mux_next       = 0;
+
+static pthread_mutex_t          host_timer_lock     = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t           host_timer_cond;
+static std::vector<host_timer*> host_timers;
+static uint8_t                  host_timer_started  = false;
+
+static void host_cond_init(pthread_cond_t *cond) {
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(cond, &attr);
+    pthread_condattr_destroy(&attr);
+}
+
+static struct timespec host_abstime(int64_t at_us) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    int64_t wait_us = at_us - esp_timer_get_time();
+    if(wait_us < 0) {
+        wait_us = 0;
+    }
+    int64_t ns = now.tv_nsec + (wait_us % 1000000) * 1000;
+    struct timespec ts;
+    ts.tv_sec = now.tv_sec + (wait_us / 1000000) + (ns / 1000000000);
+    ts.tv_nsec = ns % 1000000000;
+    return ts;
+}
+
+static int64_t host_deadline(TickType_t ticks) {
+    if(ticks == portMAX_DELAY) {
+        return INT64_MAX;
+    }
+    return esp_timer_get_time() + ((int64_t)ticks * portTICK_PERIOD_MS * 1000);
+}
+
+/* wait for a signal on cond until the deadline, false once it passed */
+static uint8_t host_cond_wait(pthread_cond_t *cond, pthread_mutex_t *lock, int64_t deadline) {
+    if(deadline == INT64_MAX) {
+        pthread_cond_wait(cond, lock);
+        return true;
+    }
+    if(esp_timer_get_time() >= deadline) {
+        return false;
+    }
+    struct timespec ts = host_abstime(deadline);
+    pthread_cond_timedwait(cond, lock, &ts);
+    return true;
+}
+
+/* critical sections */
+
+void vPortEnterCritical(portMUX_TYPE *mux) {
+    if(host_mux_id == 0) {
+        host_mux_id = __atomic_add_fetch(&host_mux_next, 1, __ATOMIC_RELAXED);
+    }
+    if(__atomic_load_n(&mux->owner, __ATOMIC_ACQUIRE) == host_mux_id) {
+        mux->count++;
+        return;
+    }
+    uint32_t unlocked = 0;
+    while(!__atomic_compare_exchange_n(&mux->owner, &unlocked, host_mux_id, false,
+                __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+        unlocked = 0;
+        sched_yield();
+    }
+    mux->count = 1;
+}
+
+void vPortExitCritical(portMUX_TYPE *mux) {
+    if(__atomic_load_n(&mux->owner, __ATOMIC_RELAXED) != host_mux_id || mux->count == 0) {
+        ESP_LOGE(TAG, "vPortExitCritical(): mux not held by this thread");
+        abort();
+    }
+    if(--mux->count == 0) {
+        __atomic_store_n(&mux->owner, 0, __ATOMIC_RELEASE);
+    }
+}
+
+/* tasks */
+
+static host_task* host_task_alloc(const char *name) {
+    host_task *task = (host_task*)calloc(1, sizeof(host_task));
+    strncpy(task->name, name ? name : "", sizeof(task->name) - 1);
+    pthread_mutex_init(&task->lock, NULL);
+    host_cond_init(&task->cond);
+    return task;
+}
+
+static void* host_task_main(void *arg) {
+    host_current = (host_task*)arg;
+    host_current->fn(host_current->arg);
+    return NULL;
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char *name, uint32_t stack,
+                        void *arg, UBaseType_t prio, TaskHandle_t *handle, BaseType_t core) {
+    host_task *task = host_task_alloc(name);
+    task->fn = fn;
+    task->arg = arg;
+    if(handle) {
+        *handle = task;
+    }
+    if(pthread_create(&task->thread, NULL, host_task_main, task) != 0) {
+        ESP_LOGE(TAG, "failed to start task %s", task->name);
+        if(handle) {
+            *handle = NULL;
+        }
+        free(task);
+        return pdFAIL;
+    }
+    pthread_detach(task->thread);
+    return pdPASS;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t fn, const char *name, uint32_t stack,
+                        void *arg, UBaseType_t prio, TaskHandle_t *handle) {
+    return xTaskCreatePinnedToCore(fn, name, stack, arg, prio, handle, 0);
+}
+
+void vTaskDelete(TaskHandle_t task) {
+    if(task == NULL || task == xTaskGetCurrentTaskHandle()) {
+        pthread_exit(NULL);
+    }
+    ESP_LOGW(TAG, "vTaskDelete(%s): only a task can delete itself on the host", task->name);
+}
+
+void vTaskDelay(TickType_t ticks) {
+    if(ticks == 0) {
+        sched_yield();
+        return;
+    }
+    int64_t us = (int64_t)ticks * portTICK_PERIOD_MS * 1000;
+    struct timespec ts = { (time_t)(us / 1000000), (long)((us % 1000000) * 1000) };
+    while(nanosleep(&ts, &ts) != 0 && errno == EINTR);
+}
+
+TickType_t xTaskGetTickCount() {
+    return (TickType_t)(esp_timer_get_time() / (portTICK_PERIOD_MS * 1000));
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle() {
+    if(host_current == NULL) {
+        // a thread not started by xTaskCreate, like main()
+        host_current = host_task_alloc("main");
+        host_current->thread = pthread_self();
+    }
+    return host_current;
+}
+
+char* pcTaskGetName(TaskHandle_t task) {
+    return (task ? task : xTaskGetCurrentTaskHandle())->name;
+}
+
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task) {
+    return 0;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task) {
+    pthread_mutex_lock(&task->lock);
+    task->notify++;
+    pthread_cond_signal(&task->cond);
+    pthread_mutex_unlock(&task->lock);
+    return pdPASS;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear, TickType_t ticks) {
+    host_task *task = xTaskGetCurrentTaskHandle();
+    int64_t deadline = host_deadline(ticks);
+    pthread_mutex_lock(&task->lock);
+    while(task->notify == 0 && host_cond_wait(&task->cond, &task->lock, deadline));
+    uint32_t value = task->notify;
+    if(value) {
+        task->notify = clear ? 0 : value - 1;
+    }
+    pthread_mutex_unlock(&task->lock);
+    return value;
+}
+
+/* queues and semaphores */
+
+static QueueHandle_t host_queue_create(UBaseType_t length, UBaseType_t item_size, UBaseType_t count) {
+    host_queue *queue = (host_queue*)calloc(1, sizeof(host_queue));
+    pthread_mutex_init(&queue->lock, NULL);
+    host_cond_init(&queue->readable);
+    host_cond_init(&queue->writable);
+    queue->length = length;
+    queue->item_size = item_size;
+    queue->count = count;
+    if(item_size) {
+        queue->items = (uint8_t*)calloc(length, item_size);
+    }
+    return queue;
+}
+
+static BaseType_t host_queue_send(QueueHandle_t queue, const void *item, TickType_t ticks, uint8_t front) {
+    int64_t deadline = host_deadline(ticks);
+    pthread_mutex_lock(&queue->lock);
+    while(queue->count == queue->length) {
+        if(!host_cond_wait(&queue->writable, &queue->lock, deadline)) {
+            pthread_mutex_unlock(&queue->lock);
+            return pdFALSE;
+        }
+    }
+    if(queue->item_size) {
+        UBaseType_t pos;
+        if(front) {
+            queue->head = (queue->head + queue->length - 1) % queue->length;
+            pos = queue->head;
+        } else {
+            pos = (queue->head + queue->count) % queue->length;
+        }
+        memcpy(queue->items + (pos * queue->item_size), item, queue->item_size);
+    }
+    queue->count++;
+    if(queue->mutex) {
+        queue->holder = NULL;
+    }
+    pthread_cond_signal(&queue->readable);
+    pthread_mutex_unlock(&queue->lock);
+    return pdTRUE;
+}
+
+static BaseType_t host_queue_receive(QueueHandle_t queue, void *item, TickType_t ticks, uint8_t peek) {
+    int64_t deadline = host_deadline(ticks);
+    pthread_mutex_lock(&queue->lock);
+    while(queue->count == 0) {
+        if(!host_cond_wait(&queue->readable, &queue->lock, deadline)) {
+            pthread_mutex_unlock(&queue->lock);
+            return pdFALSE;
+        }
+    }
+    if(queue->item_size) {
+        memcpy(item, queue->items + (queue->head * queue->item_size), queue->item_size);
+    }
+    if(!peek) {
+        if(queue->item_size) {
+            queue->head = (queue->head + 1) % queue->length;
+        }
+        queue->count--;
+        if(queue->mutex) {
+            queue->holder = xTaskGetCurrentTaskHandle();
+        }
+        pthread_cond_signal(&queue->writable);
+    } else {
+        pthread_cond_signal(&queue->readable);
+    }
+    pthread_mutex_unlock(&queue->lock);
+    return pdTRUE;
+}
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t item_size) {
+    return host_queue_create(length, item_size, 0);
+}
+
+void vQueueDelete(QueueHandle_t queue) {
+    pthread_mutex_destroy(&queue->lock);
+    pthread_cond_destroy(&queue->readable);
+    pthread_cond_destroy(&queue->writable);
+    free(queue->items);
+    free(queue);
+}
+
+BaseType_t xQueueSend(QueueHandle_t queue, const void *item, TickType_t ticks) {
+    return host_queue_send(queue, item, ticks, false);
+}
+
+BaseType_t xQueueSendToBack(QueueHandle_t queue, const void *item, TickType_t ticks) {
+    return host_queue_send(queue, item, ticks, false);
+}
+
+BaseType_t xQueueSendToFront(QueueHandle_t queue, const void *item, TickType_t ticks) {
+    return host_queue_send(queue, item, ticks, true);
+}
+
+BaseType_t xQueueOverwrite(QueueHandle_t queue, const void *item) {
+    pthread_mutex_lock(&queue->lock);
+    if(queue->count == queue->length) {
+        queue->count--;
+    }
+    pthread_mutex_unlock(&queue->lock);
+    return host_queue_send(queue, item, 0, false);
+}
+
+BaseType_t xQueueReceive(QueueHandle_t queue, void *item, TickType_t ticks) {
+    return host_queue_receive(queue, item, ticks, false);
+}
+
+BaseType_t xQueuePeek(QueueHandle_t queue, void *item, TickType_t ticks) {
+    return host_queue_receive(queue, item, ticks, true);
+}
+
+BaseType_t xQueueReset(QueueHandle_t queue) {
+    pthread_mutex_lock(&queue->lock);
+    queue->head = 0;
+    queue->count = 0;
+    pthread_cond_broadcast(&queue->writable);
+    pthread_mutex_unlock(&queue->lock);
+    return pdPASS;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue) {
+    pthread_mutex_lock(&queue->lock);
+    UBaseType_t count = queue->count;
+    pthread_mutex_unlock(&queue->lock);
+    return count;
+}
+
+UBaseType_t uxQueueSpacesAvailable(QueueHandle_t queue) {
+    pthread_mutex_lock(&queue->lock);
+    UBaseType_t spaces = queue->length - queue->count;
+    pthread_mutex_unlock(&queue->lock);
+    return spaces;
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary() {
+    return host_queue_create(1, 0, 0);
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex() {
+    SemaphoreHandle_t sem = host_queue_create(1, 0, 1);
+    sem->mutex = true;
+    return sem;
+}
+
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t max, UBaseType_t initial) {
+    return host_queue_create(max, 0, initial);
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t ticks) {
+    return host_queue_receive(sem, NULL, ticks, false);
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t sem) {
+    return host_queue_send(sem, NULL, 0, false);
+}
+
+UBaseType_t uxSemaphoreGetCount(SemaphoreHandle_t sem) {
+    return uxQueueMessagesWaiting(sem);
+}
+
+TaskHandle_t xSemaphoreGetMutexHolder(SemaphoreHandle_t sem) {
+    pthread_mutex_lock(&sem->lock);
+    TaskHandle_t holder = sem->holder;
+    pthread_mutex_unlock(&sem->lock);
+    return holder;
+}
+
+/* event groups: waiters are released and their bits cleared inside
+ * xEventGroupSetBits(), as FreeRTOS does */
+
+static uint8_t host_event_match(EventBits_t bits, EventBits_t want, BaseType_t all) {
+    return all ? ((bits & want) == want) : ((bits & want) != 0);
+}
+
+EventGroupHandle_t xEventGroupCreate() {
+    host_event_group *group = new host_event_group();
+    pthread_mutex_init(&group->lock, NULL);
+    host_cond_init(&group->cond);
+    group->bits = 0;
+    return group;
+}
+
+void vEventGroupDelete(EventGroupHandle_t group) {
+    pthread_mutex_destroy(&group->lock);
+    pthread_cond_destroy(&group->cond);
+    delete group;
+}
+
+EventBits_t xEventGroupSetBits(EventGroupHandle_t group, EventBits_t bits) {
+    pthread_mutex_lock(&group->lock);
+    group->bits |= bits;
+    EventBits_t clear = 0;
+    for(host_event_waiter_t *waiter : group->waiters) {
+        if(!waiter->done && host_event_match(group->bits, waiter->bits, waiter->all)) {
+            waiter->done = true;
+            waiter->result = group->bits;
+            if(waiter->clear) {
+                clear |= waiter->bits;
+            }
+        }
+    }
+    group->bits &= ~clear;
+    EventBits_t ret = group->bits;
+    pthread_cond_broadcast(&group->cond);
+    pthread_mutex_unlock(&group->lock);
+    return ret;
+}
+
+EventBits_t xEventGroupClearBits(EventGroupHandle_t group, EventBits_t bits) {
+    pthread_mutex_lock(&group->lock);
+    EventBits_t ret = group->bits;
+    group->bits &= ~bits;
+    pthread_mutex_unlock(&group->lock);
+    return ret;
+}
+
+EventBits_t xEventGroupGetBits(EventGroupHandle_t group) {
+    pthread_mutex_lock(&group->lock);
+    EventBits_t ret = group->bits;
+    pthread_mutex_unlock(&group->lock);
+    return ret;
+}
+
+EventBits_t xEventGroupWaitBits(EventGroupHandle_t group, EventBits_t bits,
+                            BaseType_t clear, BaseType_t all, TickType_t ticks) {
+    int64_t deadline = host_deadline(ticks);
+    pthread_mutex_lock(&group->lock);
+    EventBits_t ret = group->bits;
+    if(host_event_match(group->bits, bits, all)) {
+        if(clear) {
+            group->bits &= ~bits;
+        }
+        pthread_mutex_unlock(&group->lock);
+        return ret;
+    }
+    host_event_waiter_t waiter = { bits, clear, all, false, 0 };
+    group->waiters.push_back(&waiter);
+    while(!waiter.done && host_cond_wait(&group->cond, &group->lock, deadline));
+    group->waiters.erase(std::find(group->waiters.begin(), group->waiters.end(), &waiter));
+    ret = waiter.done ? waiter.result : group->bits;
+    pthread_mutex_unlock(&group->lock);
+    return ret;
+}
+
+/* software timers */
+
+static void* host_timer_task(void *arg) {
+    pthread_mutex_lock(&host_timer_lock);
+    for(;;) {
+        host_timer *next = NULL;
+        for(host_timer *timer : host_timers) {
+            if(timer->active && (next == NULL || timer->expiry < next->expiry)) {
+                next = timer;
+            }
+        }
+        if(next == NULL || next->expiry > esp_timer_get_time()) {
+            host_cond_wait(&host_timer_cond, &host_timer_lock, next ? next->expiry : INT64_MAX);
+            continue;
+        }
+        if(next->reload) {
+            next->expiry += (int64_t)next->period * portTICK_PERIOD_MS * 1000;
+        } else {
+            next->active = false;
+        }
+        pthread_mutex_unlock(&host_timer_lock);
+        next->cb(next);
+        pthread_mutex_lock(&host_timer_lock);
+    }
+    return NULL;
+}
+
+static void host_timer_update(TimerHandle_t timer, uint8_t active) {
+    pthread_mutex_lock(&host_timer_lock);
+    if(!host_timer_started) {
+        pthread_t thread;
+        host_cond_init(&host_timer_cond);
+        pthread_create(&thread, NULL, host_timer_task, NULL);
+        pthread_detach(thread);
+        host_timer_started = true;
+    }
+    timer->active = active;
+    timer->expiry = esp_timer_get_time() + ((int64_t)timer->period * portTICK_PERIOD_MS * 1000);
+    pthread_cond_signal(&host_timer_cond);
+    pthread_mutex_unlock(&host_timer_lock);
+}
+
+TimerHandle_t xTimerCreate(const char *name, TickType_t period, UBaseType_t reload,
+                        void *id, TimerCallbackFunction_t cb) {
+    host_timer *timer = (host_timer*)calloc(1, sizeof(host_timer));
+    strncpy(timer->name, name ? name : "", sizeof(timer->name) - 1);
+    timer->period = period;
+    timer->reload = reload;
+    timer->id = id;
+    timer->cb = cb;
+    pthread_mutex_lock(&host_timer_lock);
+    host_timers.push_back(timer);
+    pthread_mutex_unlock(&host_timer_lock);
+    return timer;
+}
+
+BaseType_t xTimerDelete(TimerHandle_t timer, TickType_t ticks) {
+    pthread_mutex_lock(&host_timer_lock);
+    host_timers.erase(std::find(host_timers.begin(), host_timers.end(), timer));
+    pthread_mutex_unlock(&host_timer_lock);
+    free(timer);
+    return pdPASS;
+}
+
+BaseType_t xTimerStart(TimerHandle_t timer, TickType_t ticks) {
+    host_timer_update(timer, true);
+    return pdPASS;
+}
+
+BaseType_t xTimerStop(TimerHandle_t timer, TickType_t ticks) {
+    host_timer_update(timer, false);
+    return pdPASS;
+}
+
+BaseType_t xTimerReset(TimerHandle_t timer, TickType_t ticks) {
+    host_timer_update(timer, true);
+    return pdPASS;
+}
+
+BaseType_t xTimerChangePeriod(TimerHandle_t timer, TickType_t period, TickType_t ticks) {
+    pthread_mutex_lock(&host_timer_lock);
+    timer->period = period;
+    pthread_mutex_unlock(&host_timer_lock);
+    host_timer_update(timer, true);
+    return pdPASS;
+}
+
+BaseType_t xTimerIsTimerActive(TimerHandle_t timer) {
+    pthread_mutex_lock(&host_timer_lock);
+    BaseType_t active = timer->active;
+    pthread_mutex_unlock(&host_timer_lock);
+    return active;
+}
+
+TickType_t xTimerGetExpiryTime(TimerHandle_t timer) {
+    pthread_mutex_lock(&host_timer_lock);
+    TickType_t expiry = (TickType_t)(timer->expiry / (portTICK_PERIOD_MS * 1000));
+    pthread_mutex_unlock(&host_timer_lock);
+    return expiry;
+}
+
+void* pvTimerGetTimerID(TimerHandle_t timer) {
+    return timer->id;
+}
+
+void vTimerSetTimerID(TimerHandle_t timer, void *id) {
+    timer->id = id;
+}
@@ -0,0 +1,199 @@
+#include <malloc.h>
+#include <errno.h>
+#include <unistd.h>
+#include "host.h"
+#include "freertos/FreeRTOS.h"
+#include "esp_heap_caps.h"
+#include "esp_system.h"
+
+/* every allocation of the process goes through these wrappers around the
+ * glibc allocator, so the counters see libstdc++ and iot-core alike */
+
+extern "C" {
+void*   __libc_malloc(size_t size);
+void*   __libc_calloc(size_t n, size_t size);
+void*   __libc_realloc(void *ptr, size_t size);
+void*   __libc_memalign(size_t align, size_t size);
+void    __libc_free(void *ptr);
+}
+
+static uint64_t heap_allocs     = 0;
+static uint64_t heap_shim       = 0;
+static uint64_t heap_frees      = 0;
+static int64_t  heap_live       = 0;
+static int64_t  heap_peak       = 0;
+static int64_t  heap_peak_ever  = 0;
+static int64_t  heap_baseline   = 0;
+
+static thread_local uint32_t heap_shim_depth = 0;
+
+static void heap_raise(int64_t *peak, int64_t live) {
+    int64_t cur = __atomic_load_n(peak, __ATOMIC_RELAXED);
+    while(live > cur && !__atomic_compare_exchange_n(peak, &cur, live, true,
+                __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+}
+
+static void heap_count_alloc(void *ptr) {
+    if(ptr == NULL) {
+        return;
+    }
+    __atomic_add_fetch(&heap_allocs, 1, __ATOMIC_RELAXED);
+    if(heap_shim_depth) {
+        __atomic_add_fetch(&heap_shim, 1, __ATOMIC_RELAXED);
+    }
+    int64_t live = __atomic_add_fetch(&heap_live, (int64_t)malloc_usable_size(ptr), __ATOMIC_RELAXED);
+    heap_raise(&heap_peak, live);
+    heap_raise(&heap_peak_ever, live);
+}
+
+static void heap_count_free(void *ptr) {
+    if(ptr == NULL) {
+        return;
+    }
+    __atomic_add_fetch(&heap_frees, 1, __ATOMIC_RELAXED);
+    __atomic_sub_fetch(&heap_live, (int64_t)malloc_usable_size(ptr), __ATOMIC_RELAXED);
+}
+
+/* what the runtimes hold before main() is not part of the emulated heap */
+__attribute__((constructor))
+static void heap_init() {
+    heap_baseline = __atomic_load_n(&heap_live, __ATOMIC_RELAXED);
+    heap_peak = heap_baseline;
+    heap_peak_ever = heap_baseline;
+}
+
+static size_t heap_used(int64_t bytes) {
+    bytes -= heap_baseline;
+    return (bytes > 0) ? (size_t)bytes : 0;
+}
+
+extern "C" {
+
+void* malloc(size_t size) __THROW {
+    void *ptr = __libc_malloc(size);
+    heap_count_alloc(ptr);
+    return ptr;
+}
+
+void* calloc(size_t n, size_t size) __THROW {
+    void *ptr = __libc_calloc(n, size);
+    heap_count_alloc(ptr);
+    return ptr;
+}
+
+void* realloc(void *ptr, size_t size) __THROW {
+    if(ptr == NULL) {
+        return malloc(size);
+    }
+    if(size == 0) {
+        free(ptr);
+        return NULL;
+    }
+    size_t old_size = malloc_usable_size(ptr);
+    void *new_ptr = __libc_realloc(ptr, size);
+    if(new_ptr) {
+        // counted as a free of the old block and an allocation of the new one
+        __atomic_add_fetch(&heap_frees, 1, __ATOMIC_RELAXED);
+        __atomic_sub_fetch(&heap_live, (int64_t)old_size, __ATOMIC_RELAXED);
+        heap_count_alloc(new_ptr);
+    }
+    return new_ptr;
+}
+
+void free(void *ptr) __THROW {
+    heap_count_free(ptr);
+    __libc_free(ptr);
+}
+
+void* memalign(size_t align, size_t size) __THROW {
+    void *ptr = __libc_memalign(align, size);
+    heap_count_alloc(ptr);
+    return ptr;
+}
+
+void* aligned_alloc(size_t align, size_t size) __THROW {
+    return memalign(align, size);
+}
+
+int posix_memalign(void **out, size_t align, size_t size) __THROW {
+    void *ptr = memalign(align, size);
+    if(ptr == NULL) {
+        return ENOMEM;
+    }
+    *out = ptr;
+    return 0;
+}
+
+void* valloc(size_t size) __THROW {
+    return memalign(sysconf(_SC_PAGESIZE), size);
+}
+
+void* pvalloc(size_t size) __THROW {
+    size_t page = sysconf(_SC_PAGESIZE);
+    return memalign(page, (size + page - 1) & ~(page - 1));
+}
+
+} // extern "C"
+
+void host_heap_shim_enter() {
+    heap_shim_depth++;
+}
+
+void host_heap_shim_exit() {
+    heap_shim_depth--;
+}
+
+host_heap_stats_t host_heap_stats() {
+    host_heap_stats_t stats;
+    stats.allocs = __atomic_load_n(&heap_allocs, __ATOMIC_RELAXED);
+    stats.shim_allocs = __atomic_load_n(&heap_shim, __ATOMIC_RELAXED);
+    stats.frees = __atomic_load_n(&heap_frees, __ATOMIC_RELAXED);
+    stats.live = heap_used(__atomic_load_n(&heap_live, __ATOMIC_RELAXED));
+    stats.peak = heap_used(__atomic_load_n(&heap_peak, __ATOMIC_RELAXED));
+    return stats;
+}
+
+void host_heap_reset_peak() {
+    __atomic_store_n(&heap_peak, __atomic_load_n(&heap_live, __ATOMIC_RELAXED), __ATOMIC_RELAXED);
+}
+
+static size_t heap_free(int64_t used) {
+    size_t bytes = heap_used(used);
+    return (bytes < HOST_HEAP_SZ) ? HOST_HEAP_SZ - bytes : 0;
+}
+
+size_t xPortGetFreeHeapSize() {
+    return heap_free(__atomic_load_n(&heap_live, __ATOMIC_RELAXED));
+}
+
+size_t xPortGetMinimumEverFreeHeapSize() {
+    return heap_free(__atomic_load_n(&heap_peak_ever, __ATOMIC_RELAXED));
+}
+
+size_t esp_get_free_heap_size() {
+    return xPortGetFreeHeapSize();
+}
+
+size_t esp_get_minimum_free_heap_size() {
+    return xPortGetMinimumEverFreeHeapSize();
+}
+
+size_t heap_caps_get_free_size(uint32_t caps) {
+    return xPortGetFreeHeapSize();
+}
+
+size_t heap_caps_get_minimum_free_size(uint32_t caps) {
+    return xPortGetMinimumEverFreeHeapSize();
+}
+
+size_t heap_caps_get_largest_free_block(uint32_t caps) {
+    return xPortGetFreeHeapSize();
+}
+
+void* heap_caps_malloc(size_t size, uint32_t caps) {
+    return malloc(size);
+}
+
+void heap_caps_free(void *ptr) {
+    free(ptr);
+}
@@ -0,0 +1,329 @@
+#ifndef HOST_NIMBLE_DEVICE_H_
+#define HOST_NIMBLE_DEVICE_H_
+
+#include <string>
+#include <vector>
+#include "host.h"
+#include "sdkconfig.h"
+
+/*!
+    @file
+    @brief The NimBLE-Arduino 1.x classes iot-core uses, without a radio
+
+    Scanning reports the advertisements injected through nimble-host.h.
+    There are no peers to connect to: NimBLEClient::connect() fails, so
+    the connection paths run up to the point where a device would answer.
+ */
+
+#define BLE_HCI_SCAN_FILT_NO_WL         0
+#define BLE_HCI_SCAN_FILT_USE_WL        1
+
+#define BLE_ADDR_PUBLIC                 0
+#define BLE_ADDR_RANDOM                 1
+
+#define BLE_SM_PAIR_AUTHREQ_BOND        0x01
+#define BLE_SM_PAIR_AUTHREQ_MITM        0x04
+#define BLE_SM_PAIR_AUTHREQ_SC          0x08
+#define BLE_SM_PAIR_KEY_DIST_ENC        0x01
+#define BLE_SM_PAIR_KEY_DIST_ID         0x02
+#define BLE_HS_IO_DISPLAY_ONLY          0x00
+#define BLE_HS_IO_DISPLAY_YESNO         0x01
+#define BLE_HS_IO_KEYBOARD_ONLY         0x02
+#define BLE_HS_IO_NO_INPUT_OUTPUT       0x03
+
+#define BLE_HS_ENOTCONN                 7
+
+typedef enum {
+    ESP_PWR_LVL_N12, ESP_PWR_LVL_N9, ESP_PWR_LVL_N6, ESP_PWR_LVL_N3,
+    ESP_PWR_LVL_N0, ESP_PWR_LVL_P3, ESP_PWR_LVL_P6, ESP_PWR_LVL_P9,
+} esp_power_level_t;
+
+typedef enum {
+    ESP_BLE_PWR_TYPE_CONN_HDL0, ESP_BLE_PWR_TYPE_ADV = 9,
+    ESP_BLE_PWR_TYPE_SCAN, ESP_BLE_PWR_TYPE_DEFAULT,
+} esp_ble_power_type_t;
+
+typedef enum {
+    ESP_BT_MODE_IDLE, ESP_BT_MODE_BLE, ESP_BT_MODE_CLASSIC_BT, ESP_BT_MODE_BTDM,
+} esp_bt_mode_t;
+
+esp_err_t   esp_ble_tx_power_set(esp_ble_power_type_t type, esp_power_level_t level);
+esp_err_t   esp_bt_controller_mem_release(esp_bt_mode_t mode);
+esp_err_t   esp_bt_sleep_disable();
+
+typedef struct {
+    uint8_t type;
+    uint8_t val[6];
+} ble_addr_t;
+
+struct ble_gap_sec_state {
+    unsigned encrypted:1;
+    unsigned authenticated:1;
+    unsigned bonded:1;
+    unsigned key_size:5;
+};
+
+typedef struct ble_gap_conn_desc {
+    struct ble_gap_sec_state    sec_state;
+    ble_addr_t                  our_id_addr;
+    ble_addr_t                  peer_id_addr;
+    uint16_t                    conn_handle;
+    uint16_t                    conn_itvl;
+    uint16_t                    conn_latency;
+    uint16_t                    supervision_timeout;
+} ble_gap_conn_desc;
+
+class NimBLEAddress {
+public:
+    NimBLEAddress();
+    NimBLEAddress(ble_addr_t address);
+    NimBLEAddress(const uint8_t address[6], uint8_t type = BLE_ADDR_PUBLIC);
+    NimBLEAddress(const std::string &address, uint8_t type = BLE_ADDR_PUBLIC);
+    bool            equals(const NimBLEAddress &other) const;
+    const uint8_t*  getNative() const;
+    uint8_t         getType() const;
+    std::string     toString() const;
+    bool            operator==(const NimBLEAddress &rhs) const;
+private:
+    uint8_t         m_address[6];
+    uint8_t         m_addrType;
+};
+
+class NimBLEUUID {
+public:
+    NimBLEUUID();
+    NimBLEUUID(uint16_t uuid);
+    NimBLEUUID(uint32_t uuid);
+    NimBLEUUID(const std::string &uuid);
+    NimBLEUUID(const char *uuid);
+    NimBLEUUID(const uint8_t *pData, size_t size, bool msbFirst);
+    uint8_t         bitSize() const;
+    bool            equals(const NimBLEUUID &uuid) const;
+    NimBLEUUID&     to128();
+    std::string     toString() const;
+    bool            operator==(const NimBLEUUID &rhs) const;
+    bool            operator!=(const NimBLEUUID &rhs) const;
+    /* the value as it goes on air, little endian, returns its length */
+    size_t          getAdvBytes(uint8_t *buf) const;
+private:
+    uint8_t         m_bits;
+    uint8_t         m_val[16];
+};
+
+class NimBLEClient;
+class NimBLERemoteService;
+class NimBLERemoteCharacteristic;
+
+typedef void (*notify_callback)(NimBLERemoteCharacteristic *pChar, uint8_t *pData,
+                        size_t length, bool isNotify);
+
+class NimBLERemoteDescriptor {
+public:
+    uint16_t        getHandle();
+};
+
+class NimBLERemoteCharacteristic {
+public:
+    bool            canNotify();
+    bool            canRead();
+    bool            canWrite();
+    uint16_t        getHandle();
+    NimBLEUUID      getUUID();
+    NimBLERemoteService*    getRemoteService();
+    NimBLERemoteDescriptor* getDescriptor(const NimBLEUUID &uuid);
+    std::string     readValue(time_t *timestamp = nullptr);
+    bool            subscribe(bool notifications = true, notify_callback notifyCallback = nullptr,
+                        bool response = false);
+    bool            unsubscribe(bool response = false);
+    bool            writeValue(const uint8_t *data, size_t length, bool response = false);
+    bool            writeValue(const std::string &newValue, bool response = false);
+
+    template<typename T>
+    T readValue(time_t *timestamp = nullptr, bool skipSizeCheck = false) {
+        std::string value = readValue(timestamp);
+        if(!skipSizeCheck && value.size() < sizeof(T)) {
+            return T();
+        }
+        T ret;
+        memcpy(&ret, value.data(), sizeof(T));
+        return ret;
+    }
+
+    template<typename T>
+    bool writeValue(const T &s, bool response = false) {
+        return writeValue((uint8_t*)&s, sizeof(T), response);
+    }
+};
+
+class NimBLERemoteService {
+public:
+    NimBLEClient*   getClient();
+    NimBLEUUID      getUUID();
+    NimBLERemoteCharacteristic*                 getCharacteristic(const NimBLEUUID &uuid);
+    std::vector<NimBLERemoteCharacteristic*>*   getCharacteristics(bool refresh = false);
+};
+
+class NimBLEConnInfo {
+public:
+    uint16_t        getConnHandle();
+    uint16_t        getConnInterval();
+    uint16_t        getConnTimeout();
+    uint16_t        getConnLatency();
+private:
+    friend class NimBLEClient;
+    ble_gap_conn_desc   m_desc;
+};
+
+class NimBLEClientCallbacks {
+public:
+    virtual ~NimBLEClientCallbacks() {}
+    virtual void        onConnect(NimBLEClient *pClient) {}
+    virtual void        onDisconnect(NimBLEClient *pClient) {}
+    virtual uint32_t    onPassKeyRequest() { return 123456; }
+    virtual void        onPassKeyNotify(uint32_t pass_key) {}
+    virtual bool        onSecurityRequest() { return true; }
+    virtual void        onAuthenticationComplete(ble_gap_conn_desc *desc) {}
+    virtual bool        onConfirmPIN(uint32_t pin) { return true; }
+};
+
+class NimBLEClient {
+public:
+    bool            connect(const NimBLEAddress &address, bool deleteAttributes = true);
+    int             disconnect(uint8_t reason = 0x13);
+    bool            isConnected();
+    void            setClientCallbacks(NimBLEClientCallbacks *pClientCallbacks,
+                        bool deleteCallbacks = true);
+    void            setConnectTimeout(uint8_t timeout);
+    void            setConnectionParams(uint16_t minInterval, uint16_t maxInterval,
+                        uint16_t latency, uint16_t timeout,
+                        uint16_t scanInterval = 16, uint16_t scanWindow = 16);
+    void            updateConnParams(uint16_t minInterval, uint16_t maxInterval,
+                        uint16_t latency, uint16_t timeout);
+    NimBLEConnInfo  getConnInfo();
+    uint16_t        getConnId();
+    NimBLEAddress   getPeerAddress();
+    int             getRssi();
+    int             getLastError();
+    NimBLERemoteService*    getService(const NimBLEUUID &uuid);
+    void            deleteServices();
+private:
+    friend class NimBLEDevice;
+    NimBLEClient();
+    ~NimBLEClient();
+    NimBLEAddress           m_peerAddress;
+    NimBLEClientCallbacks   *m_pClientCallbacks;
+    bool                    m_deleteCallbacks;
+    int                     m_lastErr;
+};
+
+struct nimble_host_adv;
+
+class NimBLEAdvertisedDevice {
+public:
+    NimBLEAddress   getAddress();
+    uint8_t         getAddressType();
+    int             getRSSI();
+    bool            isConnectable();
+    bool            haveServiceUUID();
+    uint8_t         getServiceUUIDCount();
+    NimBLEUUID      getServiceUUID(uint8_t index = 0);
+    bool            isAdvertisingService(const NimBLEUUID &uuid) const;
+    bool            haveServiceData();
+    uint8_t         getServiceDataCount();
+    std::string     getServiceData(uint8_t index = 0);
+    std::string     getServiceData(const NimBLEUUID &uuid) const;
+    NimBLEUUID      getServiceDataUUID(uint8_t index = 0);
+    bool            haveManufacturerData();
+    std::string     getManufacturerData();
+    uint8_t*        getPayload();
+    size_t          getPayloadLength();
+private:
+    friend class NimBLEScan;
+    friend NimBLEAdvertisedDevice* nimble_host_adv_device(const nimble_host_adv *adv);
+    /* like NimBLE, the getters parse the raw payload on every call */
+    const uint8_t*  findAdvField(uint8_t type, uint8_t index, size_t *len) const;
+    NimBLEAddress                   m_address;
+    int                             m_rssi;
+    bool                            m_connectable;
+    std::vector<uint8_t>            m_payload;
+};
+
+class NimBLEAdvertisedDeviceCallbacks {
+public:
+    virtual ~NimBLEAdvertisedDeviceCallbacks() {}
+    virtual void    onResult(NimBLEAdvertisedDevice *advertisedDevice) = 0;
+};
+
+class NimBLEScan {
+public:
+    bool            start(uint32_t duration, void (*scanCompleteCB)(void*) = nullptr,
+                        bool is_continue = false);
+    bool            stop();
+    bool            isScanning();
+    void            setAdvertisedDeviceCallbacks(NimBLEAdvertisedDeviceCallbacks *pAdvertisedDeviceCallbacks,
+                        bool wantDuplicates = false);
+    void            setActiveScan(bool active);
+    void            setInterval(uint16_t intervalMSecs);
+    void            setWindow(uint16_t windowMSecs);
+    void            setDuplicateFilter(bool enabled);
+    void            setLimitedOnly(bool enabled);
+    void            setFilterPolicy(uint8_t filter);
+    void            setMaxResults(uint8_t maxResults);
+    void            clearResults();
+    void            clearDuplicateCache();
+    /* called by nimble_host_advertise() */
+    bool            onAdvertisement(const struct nimble_host_adv *adv);
+private:
+    friend class NimBLEDevice;
+    friend bool nimble_host_result(NimBLEAdvertisedDevice *device);
+    NimBLEScan();
+    NimBLEAdvertisedDeviceCallbacks *m_pAdvertisedDeviceCallbacks;
+    bool                            m_wantDuplicates;
+    bool                            m_duplicateFilter;
+    bool                            m_scanning;
+    int64_t                         m_endTime;
+    void                            (*m_scanCompleteCB)(void*);
+    std::vector<NimBLEAddress>      m_seen;
+};
+
+class NimBLEAdvertising {
+public:
+    void            setScanFilter(bool scanRequestWhitelistOnly, bool connectWhitelistOnly);
+};
+
+class NimBLESecurity {
+};
+
+class NimBLEDevice {
+public:
+    static void                 init(const std::string &deviceName);
+    static void                 deinit(bool clearAll = false);
+    static bool                 getInitialized();
+    static NimBLEScan*          getScan();
+    static NimBLEAdvertising*   getAdvertising();
+    static NimBLEClient*        createClient();
+    static bool                 deleteClient(NimBLEClient *pClient);
+    static size_t               getClientListSize();
+    static void                 setSecurityAuth(uint8_t auth_req);
+    static void                 setSecurityIOCap(uint8_t iocap);
+    static void                 setSecurityRespKey(uint8_t resp_key);
+    static void                 setSecurityInitKey(uint8_t init_key);
+    static bool                 whiteListAdd(const NimBLEAddress &address);
+    static bool                 onWhiteList(const NimBLEAddress &address);
+};
+
+#define BLEAddress                      NimBLEAddress
+#define BLEUUID                         NimBLEUUID
+#define BLEClient                       NimBLEClient
+#define BLERemoteService                NimBLERemoteService
+#define BLERemoteCharacteristic         NimBLERemoteCharacteristic
+#define BLERemoteDescriptor             NimBLERemoteDescriptor
+#define BLEClientCallbacks              NimBLEClientCallbacks
+#define BLEAdvertisedDevice             NimBLEAdvertisedDevice
+#define BLEAdvertisedDeviceCallbacks    NimBLEAdvertisedDeviceCallbacks
+#define BLEScan                         NimBLEScan
+#define BLEAdvertising                  NimBLEAdvertising
+#define BLESecurity                     NimBLESecurity
+#define BLEDevice                       NimBLEDevice
+
+#endif /* HOST_NIMBLE_DEVICE_H_ */
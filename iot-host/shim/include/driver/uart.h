@@ -0,0 +1,32 @@
+#ifndef HOST_DRIVER_UART_H_
+#define HOST_DRIVER_UART_H_
+
+#include "host.h"
+
+/* the UART is configured and otherwise left alone */
+typedef enum { UART_NUM_0, UART_NUM_1, UART_NUM_2 } uart_port_t;
+typedef enum { UART_DATA_5_BITS, UART_DATA_6_BITS, UART_DATA_7_BITS, UART_DATA_8_BITS } uart_word_length_t;
+typedef enum { UART_PARITY_DISABLE = 0, UART_PARITY_EVEN = 2, UART_PARITY_ODD = 3 } uart_parity_t;
+typedef enum { UART_STOP_BITS_1 = 1, UART_STOP_BITS_1_5 = 2, UART_STOP_BITS_2 = 3 } uart_stop_bits_t;
+typedef enum {
+    UART_HW_FLOWCTRL_DISABLE,
+    UART_HW_FLOWCTRL_RTS,
+    UART_HW_FLOWCTRL_CTS,
+    UART_HW_FLOWCTRL_CTS_RTS
+} uart_hw_flowcontrol_t;
+
+#define UART_PIN_NO_CHANGE      (-1)
+
+typedef struct {
+    int                     baud_rate;
+    uart_word_length_t      data_bits;
+    uart_parity_t           parity;
+    uart_stop_bits_t        stop_bits;
+    uart_hw_flowcontrol_t   flow_ctrl;
+    uint8_t                 rx_flow_ctrl_thresh;
+} uart_config_t;
+
+esp_err_t   uart_param_config(uart_port_t port, const uart_config_t *config);
+esp_err_t   uart_set_pin(uart_port_t port, int tx, int rx, int rts, int cts);
+
+#endif /* HOST_DRIVER_UART_H_ */
@@ -0,0 +1,11 @@
+#ifndef HOST_ESP_ATTR_H_
+#define HOST_ESP_ATTR_H_
+
+/* placement attributes have no meaning on the host */
+#define IRAM_ATTR
+#define DRAM_ATTR
+#define RTC_DATA_ATTR
+#define RTC_NOINIT_ATTR
+#define EXT_RAM_ATTR
+
+#endif /* HOST_ESP_ATTR_H_ */
@@ -0,0 +1,7 @@
+#ifndef HOST_ESP_BLUFI_API_H_
+#define HOST_ESP_BLUFI_API_H_
+
+#include "esp_wifi.h"
+#include "esp_bt_defs.h"
+
+#endif /* HOST_ESP_BLUFI_API_H_ */
@@ -0,0 +1,10 @@
+#ifndef HOST_ESP_BT_DEFS_H_
+#define HOST_ESP_BT_DEFS_H_
+
+#include <stdint.h>
+
+#define ESP_BD_ADDR_LEN     6
+
+typedef uint8_t esp_bd_addr_t[ESP_BD_ADDR_LEN];
+
+#endif /* HOST_ESP_BT_DEFS_H_ */
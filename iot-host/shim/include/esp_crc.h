@@ -0,0 +1,9 @@
+#ifndef HOST_ESP_CRC_H_
+#define HOST_ESP_CRC_H_
+
+#include "host.h"
+
+/* the zlib compatible CRC-32 of the ESP32 ROM */
+uint32_t    esp_crc32_le(uint32_t crc, uint8_t const *buf, uint32_t len);
+
+#endif /* HOST_ESP_CRC_H_ */
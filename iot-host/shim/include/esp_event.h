@@ -0,0 +1,18 @@
+#ifndef HOST_ESP_EVENT_H_
+#define HOST_ESP_EVENT_H_
+
+#include "host.h"
+
+typedef const char* esp_event_base_t;
+typedef void (*esp_event_handler_t)(void *arg, esp_event_base_t base, int32_t id, void *data);
+
+#define ESP_EVENT_ANY_ID        (-1)
+
+/* handlers run synchronously in the thread that posts the event */
+esp_err_t   esp_event_loop_create_default();
+esp_err_t   esp_event_handler_register(esp_event_base_t base, int32_t id,
+                        esp_event_handler_t handler, void *arg);
+esp_err_t   esp_event_post(esp_event_base_t base, int32_t id, void *data, size_t len,
+                        uint32_t ticks);
+
+#endif /* HOST_ESP_EVENT_H_ */
@@ -0,0 +1,21 @@
+#ifndef HOST_ESP_HEAP_CAPS_H_
+#define HOST_ESP_HEAP_CAPS_H_
+
+#include "host.h"
+
+/* every capability maps to the one counted heap of HOST_HEAP_SZ bytes */
+#define MALLOC_CAP_EXEC         (1 << 0)
+#define MALLOC_CAP_32BIT        (1 << 1)
+#define MALLOC_CAP_8BIT         (1 << 2)
+#define MALLOC_CAP_DMA          (1 << 3)
+#define MALLOC_CAP_SPIRAM       (1 << 10)
+#define MALLOC_CAP_INTERNAL     (1 << 11)
+#define MALLOC_CAP_DEFAULT      (1 << 12)
+
+size_t  heap_caps_get_free_size(uint32_t caps);
+size_t  heap_caps_get_minimum_free_size(uint32_t caps);
+size_t  heap_caps_get_largest_free_block(uint32_t caps);
+void*   heap_caps_malloc(size_t size, uint32_t caps);
+void    heap_caps_free(void *ptr);
+
+#endif /* HOST_ESP_HEAP_CAPS_H_ */
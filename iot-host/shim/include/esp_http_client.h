@@ -0,0 +1,135 @@
+#ifndef HOST_ESP_HTTP_CLIENT_H_
+#define HOST_ESP_HTTP_CLIENT_H_
+
+#include "host.h"
+
+/*!
+    @file
+    @brief esp_http_client over plain sockets
+
+    HTTP/1.1 with keep-alive, Content-Length and chunked bodies.  TLS is
+    not emulated: an https url or HTTP_TRANSPORT_OVER_SSL connects in
+    plaintext to the same host and port, so local sinks see every request.
+ */
+
+typedef struct esp_http_client* esp_http_client_handle_t;
+
+typedef enum {
+    HTTP_EVENT_ERROR,
+    HTTP_EVENT_ON_CONNECTED,
+    HTTP_EVENT_HEADER_SENT,
+    HTTP_EVENT_ON_HEADER,
+    HTTP_EVENT_ON_DATA,
+    HTTP_EVENT_ON_FINISH,
+    HTTP_EVENT_DISCONNECTED,
+} esp_http_client_event_id_t;
+
+typedef struct esp_http_client_event {
+    esp_http_client_event_id_t  event_id;
+    esp_http_client_handle_t    client;
+    void                        *data;
+    int                         data_len;
+    void                        *user_data;
+    char                        *header_key;
+    char                        *header_value;
+} esp_http_client_event_t;
+
+typedef esp_http_client_event_t* esp_http_client_event_handle_t;
+typedef esp_err_t (*http_event_handle_cb)(esp_http_client_event_t *evt);
+
+typedef enum {
+    HTTP_TRANSPORT_UNKNOWN,
+    HTTP_TRANSPORT_OVER_TCP,
+    HTTP_TRANSPORT_OVER_SSL,
+} esp_http_client_transport_t;
+
+typedef enum {
+    HTTP_METHOD_GET,
+    HTTP_METHOD_POST,
+    HTTP_METHOD_PUT,
+    HTTP_METHOD_PATCH,
+    HTTP_METHOD_DELETE,
+    HTTP_METHOD_HEAD,
+    HTTP_METHOD_MAX,
+} esp_http_client_method_t;
+
+typedef enum {
+    HTTP_AUTH_TYPE_NONE,
+    HTTP_AUTH_TYPE_BASIC,
+    HTTP_AUTH_TYPE_DIGEST,
+} esp_http_client_auth_type_t;
+
+/* the ESP-IDF 4.x field order, so designated initializers compile */
+typedef struct {
+    const char                  *url;
+    const char                  *host;
+    int                         port;
+    const char                  *username;
+    const char                  *password;
+    esp_http_client_auth_type_t auth_type;
+    const char                  *path;
+    const char                  *query;
+    const char                  *cert_pem;
+    const char                  *client_cert_pem;
+    const char                  *client_key_pem;
+    const char                  *user_agent;
+    esp_http_client_method_t    method;
+    int                         timeout_ms;
+    bool                        disable_auto_redirect;
+    int                         max_redirection_count;
+    int                         max_authorization_retries;
+    http_event_handle_cb        event_handler;
+    esp_http_client_transport_t transport_type;
+    int                         buffer_size;
+    int                         buffer_size_tx;
+    void                        *user_data;
+    bool                        is_async;
+    bool                        use_global_ca_store;
+    bool                        skip_cert_common_name_check;
+    esp_err_t                   (*crt_bundle_attach)(void *conf);
+    bool                        keep_alive_enable;
+    int                         keep_alive_idle;
+    int                         keep_alive_interval;
+    int                         keep_alive_count;
+} esp_http_client_config_t;
+
+typedef enum {
+    HttpStatus_Ok               = 200,
+    HttpStatus_MultipleChoices  = 300,
+    HttpStatus_MovedPermanently = 301,
+    HttpStatus_Found            = 302,
+    HttpStatus_TemporaryRedirect = 307,
+    HttpStatus_Unauthorized     = 401,
+    HttpStatus_Forbidden        = 403,
+    HttpStatus_NotFound         = 404,
+} HttpStatus_Code;
+
+esp_http_client_handle_t    esp_http_client_init(const esp_http_client_config_t *config);
+esp_err_t                   esp_http_client_perform(esp_http_client_handle_t client);
+esp_err_t                   esp_http_client_set_url(esp_http_client_handle_t client, const char *url);
+esp_err_t                   esp_http_client_get_url(esp_http_client_handle_t client, char *url, int len);
+esp_err_t                   esp_http_client_set_post_field(esp_http_client_handle_t client,
+                                    const char *data, int len);
+esp_err_t                   esp_http_client_set_header(esp_http_client_handle_t client,
+                                    const char *key, const char *value);
+esp_err_t                   esp_http_client_delete_header(esp_http_client_handle_t client, const char *key);
+esp_err_t                   esp_http_client_set_method(esp_http_client_handle_t client,
+                                    esp_http_client_method_t method);
+esp_err_t                   esp_http_client_get_user_data(esp_http_client_handle_t client, void **data);
+esp_err_t                   esp_http_client_set_user_data(esp_http_client_handle_t client, void *data);
+esp_err_t                   esp_http_client_open(esp_http_client_handle_t client, int write_len);
+int                         esp_http_client_write(esp_http_client_handle_t client,
+                                    const char *buffer, int len);
+int                         esp_http_client_fetch_headers(esp_http_client_handle_t client);
+bool                        esp_http_client_is_chunked_response(esp_http_client_handle_t client);
+int                         esp_http_client_read(esp_http_client_handle_t client, char *buffer, int len);
+int                         esp_http_client_read_response(esp_http_client_handle_t client,
+                                    char *buffer, int len);
+int                         esp_http_client_flush_response(esp_http_client_handle_t client, int *len);
+int                         esp_http_client_get_status_code(esp_http_client_handle_t client);
+int                         esp_http_client_get_content_length(esp_http_client_handle_t client);
+bool                        esp_http_client_is_complete_data_received(esp_http_client_handle_t client);
+esp_err_t                   esp_http_client_close(esp_http_client_handle_t client);
+esp_err_t                   esp_http_client_cleanup(esp_http_client_handle_t client);
+
+#endif /* HOST_ESP_HTTP_CLIENT_H_ */
@@ -0,0 +1,60 @@
+#ifndef HOST_ESP_HTTP_SERVER_H_
+#define HOST_ESP_HTTP_SERVER_H_
+
+#include <sys/types.h>
+#include "host.h"
+
+/* there is no server on the host, httpd_start() fails and callers take
+ * their no-server path */
+typedef void* httpd_handle_t;
+
+typedef enum {
+    HTTP_DELETE,
+    HTTP_GET,
+    HTTP_HEAD,
+    HTTP_POST,
+    HTTP_PUT,
+} httpd_method_t;
+
+typedef struct httpd_req {
+    httpd_handle_t  handle;
+    int             method;
+    const char      uri[513];
+    int             content_len;
+    void            *user_ctx;
+} httpd_req_t;
+
+typedef struct httpd_uri {
+    const char      *uri;
+    httpd_method_t  method;
+    esp_err_t       (*handler)(httpd_req_t *r);
+    void            *user_ctx;
+} httpd_uri_t;
+
+typedef struct httpd_config {
+    unsigned        task_priority;
+    size_t          stack_size;
+    uint16_t        server_port;
+    uint16_t        ctrl_port;
+    uint16_t        max_open_sockets;
+    uint16_t        max_uri_handlers;
+} httpd_config_t;
+
+#define HTTPD_DEFAULT_CONFIG() {    \
+        .task_priority = 5,         \
+        .stack_size = 4096,         \
+        .server_port = 80,          \
+        .ctrl_port = 32768,         \
+        .max_open_sockets = 7,      \
+        .max_uri_handlers = 8,      \
+    }
+
+esp_err_t   httpd_start(httpd_handle_t *handle, const httpd_config_t *config);
+esp_err_t   httpd_stop(httpd_handle_t handle);
+esp_err_t   httpd_register_uri_handler(httpd_handle_t handle, const httpd_uri_t *uri_handler);
+size_t      httpd_req_get_url_query_len(httpd_req_t *r);
+esp_err_t   httpd_req_get_url_query_str(httpd_req_t *r, char *buf, size_t buf_len);
+esp_err_t   httpd_query_key_value(const char *qry, const char *key, char *val, size_t val_size);
+esp_err_t   httpd_resp_send(httpd_req_t *r, const char *buf, ssize_t buf_len);
+
+#endif /* HOST_ESP_HTTP_SERVER_H_ */
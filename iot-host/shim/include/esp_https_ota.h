@@ -0,0 +1,9 @@
+#ifndef HOST_ESP_HTTPS_OTA_H_
+#define HOST_ESP_HTTPS_OTA_H_
+
+#include "esp_http_client.h"
+
+/* there is no second app slot to write, always ESP_ERR_NOT_SUPPORTED */
+esp_err_t   esp_https_ota(const esp_http_client_config_t *config);
+
+#endif /* HOST_ESP_HTTPS_OTA_H_ */
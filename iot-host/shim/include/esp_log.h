@@ -0,0 +1,35 @@
+#ifndef HOST_ESP_LOG_H_
+#define HOST_ESP_LOG_H_
+
+#include "host.h"
+#include "sdkconfig.h"
+
+typedef enum {
+    ESP_LOG_NONE,
+    ESP_LOG_ERROR,
+    ESP_LOG_WARN,
+    ESP_LOG_INFO,
+    ESP_LOG_DEBUG,
+    ESP_LOG_VERBOSE
+} esp_log_level_t;
+
+/* the level the firmware is built with, iot-core reads it to quieten
+ * chatty components */
+#ifndef LOG_LEVEL
+ #define LOG_LEVEL              ((esp_log_level_t)CONFIG_LOG_DEFAULT_LEVEL)
+#endif
+
+void        esp_log_level_set(const char *tag, esp_log_level_t level);
+void        esp_log_write(esp_log_level_t level, const char *tag, const char *fmt, ...);
+uint32_t    esp_log_timestamp();
+
+#define ESP_LOG_LEVEL(level, letter, tag, fmt, ...) \
+    esp_log_write(level, tag, letter " (%u) %s: " fmt "\n", esp_log_timestamp(), tag __VA_OPT__(,) __VA_ARGS__)
+
+#define ESP_LOGE(tag, fmt, ...)     ESP_LOG_LEVEL(ESP_LOG_ERROR,   "E", tag, fmt __VA_OPT__(,) __VA_ARGS__)
+#define ESP_LOGW(tag, fmt, ...)     ESP_LOG_LEVEL(ESP_LOG_WARN,    "W", tag, fmt __VA_OPT__(,) __VA_ARGS__)
+#define ESP_LOGI(tag, fmt, ...)     ESP_LOG_LEVEL(ESP_LOG_INFO,    "I", tag, fmt __VA_OPT__(,) __VA_ARGS__)
+#define ESP_LOGD(tag, fmt, ...)     ESP_LOG_LEVEL(ESP_LOG_DEBUG,   "D", tag, fmt __VA_OPT__(,) __VA_ARGS__)
+#define ESP_LOGV(tag, fmt, ...)     ESP_LOG_LEVEL(ESP_LOG_VERBOSE, "V", tag, fmt __VA_OPT__(,) __VA_ARGS__)
+
+#endif /* HOST_ESP_LOG_H_ */
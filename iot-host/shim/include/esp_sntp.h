@@ -0,0 +1,25 @@
+#ifndef HOST_ESP_SNTP_H_
+#define HOST_ESP_SNTP_H_
+
+#include <sys/time.h>
+#include "host.h"
+
+/* the host clock is already synced, sntp_init() reports gettimeofday() */
+typedef enum {
+    SNTP_SYNC_STATUS_RESET,
+    SNTP_SYNC_STATUS_COMPLETED,
+    SNTP_SYNC_STATUS_IN_PROGRESS,
+} sntp_sync_status_t;
+
+typedef void (*sntp_sync_time_cb_t)(struct timeval *tv);
+
+#define SNTP_OPMODE_POLL        0
+
+void                sntp_setoperatingmode(uint8_t mode);
+void                sntp_setservername(uint8_t idx, const char *server);
+void                sntp_set_time_sync_notification_cb(sntp_sync_time_cb_t cb);
+void                sntp_init();
+void                sntp_stop();
+sntp_sync_status_t  sntp_get_sync_status();
+
+#endif /* HOST_ESP_SNTP_H_ */
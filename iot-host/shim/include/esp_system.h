@@ -0,0 +1,23 @@
+#ifndef HOST_ESP_SYSTEM_H_
+#define HOST_ESP_SYSTEM_H_
+
+#include "host.h"
+#include "esp_timer.h"
+
+typedef void (*shutdown_handler_t)(void);
+
+esp_err_t   esp_register_shutdown_handler(shutdown_handler_t handler);
+esp_err_t   esp_unregister_shutdown_handler(shutdown_handler_t handler);
+
+/* runs the shutdown handlers and exits the process */
+void        esp_restart() __attribute__((noreturn));
+
+uint32_t    esp_random();
+void        esp_fill_random(void *buf, size_t len);
+size_t      esp_get_free_heap_size();
+size_t      esp_get_minimum_free_heap_size();
+
+/* newlib provides itoa() on the ESP32, glibc does not */
+char*       itoa(int value, char *str, int base);
+
+#endif /* HOST_ESP_SYSTEM_H_ */
@@ -0,0 +1,9 @@
+#ifndef HOST_ESP_TIMER_H_
+#define HOST_ESP_TIMER_H_
+
+#include "host.h"
+
+/* microseconds since the process started, from CLOCK_MONOTONIC */
+int64_t     esp_timer_get_time();
+
+#endif /* HOST_ESP_TIMER_H_ */
@@ -0,0 +1,39 @@
+#ifndef HOST_ESP_WIFI_H_
+#define HOST_ESP_WIFI_H_
+
+#include "host.h"
+#include "esp_event.h"
+#include "esp_wifi_types.h"
+
+/*!
+    @file
+    @brief The station is always in range
+
+    esp_wifi_start() posts WIFI_EVENT_STA_START and esp_wifi_connect()
+    posts IP_EVENT_STA_GOT_IP, so wifi_connect() returns as soon as the
+    handlers have run.  Sockets go out over the host network.
+ */
+
+extern esp_event_base_t WIFI_EVENT;
+extern esp_event_base_t IP_EVENT;
+
+typedef struct {
+    int     magic;
+} wifi_init_config_t;
+
+#define WIFI_INIT_CONFIG_DEFAULT()  { 0x1F2F3F4F }
+
+typedef struct esp_netif_obj esp_netif_t;
+
+esp_err_t       esp_netif_init();
+esp_netif_t*    esp_netif_create_default_wifi_sta();
+esp_netif_t*    esp_netif_create_default_wifi_ap();
+
+esp_err_t       esp_wifi_init(const wifi_init_config_t *config);
+esp_err_t       esp_wifi_set_mode(wifi_mode_t mode);
+esp_err_t       esp_wifi_set_ps(wifi_ps_type_t type);
+esp_err_t       esp_wifi_start();
+esp_err_t       esp_wifi_stop();
+esp_err_t       esp_wifi_connect();
+
+#endif /* HOST_ESP_WIFI_H_ */
@@ -0,0 +1,31 @@
+#ifndef HOST_ESP_WIFI_TYPES_H_
+#define HOST_ESP_WIFI_TYPES_H_
+
+#include "host.h"
+
+typedef enum {
+    WIFI_MODE_NULL,
+    WIFI_MODE_STA,
+    WIFI_MODE_AP,
+    WIFI_MODE_APSTA
+} wifi_mode_t;
+
+typedef enum {
+    WIFI_PS_NONE,
+    WIFI_PS_MIN_MODEM,
+    WIFI_PS_MAX_MODEM
+} wifi_ps_type_t;
+
+typedef enum {
+    WIFI_EVENT_STA_START = 2,
+    WIFI_EVENT_STA_STOP,
+    WIFI_EVENT_STA_CONNECTED,
+    WIFI_EVENT_STA_DISCONNECTED,
+} wifi_event_t;
+
+typedef enum {
+    IP_EVENT_STA_GOT_IP,
+    IP_EVENT_STA_LOST_IP,
+} ip_event_t;
+
+#endif /* HOST_ESP_WIFI_TYPES_H_ */
@@ -0,0 +1,58 @@
+#ifndef HOST_FREERTOS_H_
+#define HOST_FREERTOS_H_
+
+#include "host.h"
+#include "sdkconfig.h"
+/* pulled in by the ESP32 port layer, iot-core relies on it */
+#include "esp_heap_caps.h"
+
+/*!
+    @file
+    @brief FreeRTOS types and port layer on pthreads
+
+    One tick is one millisecond.  Task priorities and core affinity are
+    accepted and ignored, the Linux scheduler runs every task as a thread.
+ */
+
+typedef uint32_t        TickType_t;
+typedef int             BaseType_t;
+typedef unsigned int    UBaseType_t;
+
+#define pdFALSE                 ((BaseType_t)0)
+#define pdTRUE                  ((BaseType_t)1)
+#define pdPASS                  pdTRUE
+#define pdFAIL                  pdFALSE
+
+#define configTICK_RATE_HZ      1000
+#define configMAX_TASK_NAME_LEN 16
+#define configASSERT(x)         do { if(!(x)) { abort(); } } while(0)
+
+#define portMAX_DELAY           ((TickType_t)0xffffffffUL)
+#define portTICK_PERIOD_MS      ((TickType_t)1000 / configTICK_RATE_HZ)
+#define portTICK_RATE_MS        portTICK_PERIOD_MS
+#define pdMS_TO_TICKS(ms)       ((TickType_t)(ms) / portTICK_PERIOD_MS)
+#define portNUM_PROCESSORS      2
+
+/* critical sections are recursive spinlocks, as on the ESP32 */
+typedef struct {
+    volatile uint32_t owner;
+    uint32_t          count;     // only touched by the owner
+} portMUX_TYPE;
+
+#define portMUX_INITIALIZER_UNLOCKED    { 0, 0 }
+
+void    vPortEnterCritical(portMUX_TYPE *mux);
+void    vPortExitCritical(portMUX_TYPE *mux);
+
+#define portENTER_CRITICAL(mux)         vPortEnterCritical(mux)
+#define portEXIT_CRITICAL(mux)          vPortExitCritical(mux)
+#define portENTER_CRITICAL_ISR(mux)     vPortEnterCritical(mux)
+#define portEXIT_CRITICAL_ISR(mux)      vPortExitCritical(mux)
+#define portYIELD()                     sched_yield()
+
+size_t  xPortGetFreeHeapSize();
+size_t  xPortGetMinimumEverFreeHeapSize();
+
+#include <sched.h>
+
+#endif /* HOST_FREERTOS_H_ */
@@ -0,0 +1,17 @@
+#ifndef HOST_FREERTOS_EVENT_GROUPS_H_
+#define HOST_FREERTOS_EVENT_GROUPS_H_
+
+#include "freertos/FreeRTOS.h"
+
+typedef struct host_event_group* EventGroupHandle_t;
+typedef uint32_t EventBits_t;
+
+EventGroupHandle_t  xEventGroupCreate();
+void                vEventGroupDelete(EventGroupHandle_t group);
+EventBits_t         xEventGroupSetBits(EventGroupHandle_t group, EventBits_t bits);
+EventBits_t         xEventGroupClearBits(EventGroupHandle_t group, EventBits_t bits);
+EventBits_t         xEventGroupGetBits(EventGroupHandle_t group);
+EventBits_t         xEventGroupWaitBits(EventGroupHandle_t group, EventBits_t bits,
+                            BaseType_t clear, BaseType_t all, TickType_t ticks);
+
+#endif /* HOST_FREERTOS_EVENT_GROUPS_H_ */
@@ -0,0 +1,21 @@
+#ifndef HOST_FREERTOS_QUEUE_H_
+#define HOST_FREERTOS_QUEUE_H_
+
+#include "freertos/FreeRTOS.h"
+
+/* semaphores are queues without item storage, as in FreeRTOS */
+typedef struct host_queue* QueueHandle_t;
+
+QueueHandle_t   xQueueCreate(UBaseType_t length, UBaseType_t item_size);
+void            vQueueDelete(QueueHandle_t queue);
+BaseType_t      xQueueSend(QueueHandle_t queue, const void *item, TickType_t ticks);
+BaseType_t      xQueueSendToBack(QueueHandle_t queue, const void *item, TickType_t ticks);
+BaseType_t      xQueueSendToFront(QueueHandle_t queue, const void *item, TickType_t ticks);
+BaseType_t      xQueueOverwrite(QueueHandle_t queue, const void *item);
+BaseType_t      xQueueReceive(QueueHandle_t queue, void *item, TickType_t ticks);
+BaseType_t      xQueuePeek(QueueHandle_t queue, void *item, TickType_t ticks);
+BaseType_t      xQueueReset(QueueHandle_t queue);
+UBaseType_t     uxQueueMessagesWaiting(QueueHandle_t queue);
+UBaseType_t     uxQueueSpacesAvailable(QueueHandle_t queue);
+
+#endif /* HOST_FREERTOS_QUEUE_H_ */
@@ -0,0 +1,19 @@
+#ifndef HOST_FREERTOS_SEMPHR_H_
+#define HOST_FREERTOS_SEMPHR_H_
+
+#include "freertos/queue.h"
+#include "freertos/task.h"
+
+typedef QueueHandle_t SemaphoreHandle_t;
+
+SemaphoreHandle_t   xSemaphoreCreateBinary();
+SemaphoreHandle_t   xSemaphoreCreateMutex();
+SemaphoreHandle_t   xSemaphoreCreateCounting(UBaseType_t max, UBaseType_t initial);
+BaseType_t          xSemaphoreTake(SemaphoreHandle_t sem, TickType_t ticks);
+BaseType_t          xSemaphoreGive(SemaphoreHandle_t sem);
+UBaseType_t         uxSemaphoreGetCount(SemaphoreHandle_t sem);
+TaskHandle_t        xSemaphoreGetMutexHolder(SemaphoreHandle_t sem);
+
+#define vSemaphoreDelete(sem)   vQueueDelete(sem)
+
+#endif /* HOST_FREERTOS_SEMPHR_H_ */
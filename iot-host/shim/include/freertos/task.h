@@ -0,0 +1,23 @@
+#ifndef HOST_FREERTOS_TASK_H_
+#define HOST_FREERTOS_TASK_H_
+
+#include "freertos/FreeRTOS.h"
+
+typedef struct host_task* TaskHandle_t;
+typedef void (*TaskFunction_t)(void*);
+
+BaseType_t      xTaskCreate(TaskFunction_t fn, const char *name, uint32_t stack,
+                        void *arg, UBaseType_t prio, TaskHandle_t *handle);
+BaseType_t      xTaskCreatePinnedToCore(TaskFunction_t fn, const char *name, uint32_t stack,
+                        void *arg, UBaseType_t prio, TaskHandle_t *handle, BaseType_t core);
+void            vTaskDelete(TaskHandle_t task);
+void            vTaskDelay(TickType_t ticks);
+TickType_t      xTaskGetTickCount();
+TaskHandle_t    xTaskGetCurrentTaskHandle();
+char*           pcTaskGetName(TaskHandle_t task);
+UBaseType_t     uxTaskGetStackHighWaterMark(TaskHandle_t task);
+
+BaseType_t      xTaskNotifyGive(TaskHandle_t task);
+uint32_t        ulTaskNotifyTake(BaseType_t clear, TickType_t ticks);
+
+#endif /* HOST_FREERTOS_TASK_H_ */
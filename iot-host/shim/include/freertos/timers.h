@@ -0,0 +1,23 @@
+#ifndef HOST_FREERTOS_TIMERS_H_
+#define HOST_FREERTOS_TIMERS_H_
+
+#include "freertos/FreeRTOS.h"
+
+/* callbacks run one at a time in a timer service thread, like the
+ * FreeRTOS timer task */
+typedef struct host_timer* TimerHandle_t;
+typedef void (*TimerCallbackFunction_t)(TimerHandle_t);
+
+TimerHandle_t   xTimerCreate(const char *name, TickType_t period, UBaseType_t reload,
+                        void *id, TimerCallbackFunction_t cb);
+BaseType_t      xTimerDelete(TimerHandle_t timer, TickType_t ticks);
+BaseType_t      xTimerStart(TimerHandle_t timer, TickType_t ticks);
+BaseType_t      xTimerStop(TimerHandle_t timer, TickType_t ticks);
+BaseType_t      xTimerReset(TimerHandle_t timer, TickType_t ticks);
+BaseType_t      xTimerChangePeriod(TimerHandle_t timer, TickType_t period, TickType_t ticks);
+BaseType_t      xTimerIsTimerActive(TimerHandle_t timer);
+TickType_t      xTimerGetExpiryTime(TimerHandle_t timer);
+void*           pvTimerGetTimerID(TimerHandle_t timer);
+void            vTimerSetTimerID(TimerHandle_t timer, void *id);
+
+#endif /* HOST_FREERTOS_TIMERS_H_ */
@@ -0,0 +1,113 @@
+#ifndef HOST_H_
+#define HOST_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include "esp_err.h"
+
+/*!
+    @file
+    @brief Controls of the host shim that have no ESP-IDF counterpart
+
+    The shim maps FreeRTOS tasks, queues, semaphores, event groups and
+    timers onto pthreads, esp_http_client onto plain sockets and the flash,
+    NVS and radio APIs onto files and fakes, so iot-core builds and runs on
+    a Linux box.  See iot-host/README.md.
+ */
+
+/* size of the emulated internal heap reported by the heap_caps calls */
+#ifndef HOST_HEAP_SZ
+ #define HOST_HEAP_SZ          (320 * 1024)
+#endif
+
+/*!
+    @struct host_heap_stats_t
+    @brief Process wide malloc counters
+
+    Every malloc/calloc/realloc/free of the process is counted, including
+    those of libc and libstdc++.  `live` and `peak` are usable bytes.
+    `shim_allocs` is the part of `allocs` made by the emulated ESP-IDF
+    APIs themselves, e.g. the strings of the esp_http_client shim, which
+    the real components don't make.
+ */
+typedef struct host_heap_stats {
+    uint64_t allocs;
+    uint64_t shim_allocs;
+    uint64_t frees;
+    size_t   live;
+    size_t   peak;
+} host_heap_stats_t;
+
+/*!
+    @brief Snapshot of the malloc counters
+ */
+host_heap_stats_t   host_heap_stats();
+
+/*!
+    @brief Restart peak tracking from the current live size
+ */
+void                host_heap_reset_peak();
+
+/*!
+    @brief Count the allocations of the calling thread as shim_allocs
+
+    Calls nest, each host_heap_shim_enter() needs a host_heap_shim_exit().
+    Shim functions use HOST_SHIM_SCOPE instead.
+ */
+void                host_heap_shim_enter();
+void                host_heap_shim_exit();
+
+#ifdef __cplusplus
+struct host_shim_scope {
+    host_shim_scope()   { host_heap_shim_enter(); }
+    ~host_shim_scope()  { host_heap_shim_exit(); }
+};
+ #define HOST_SHIM_SCOPE    host_shim_scope shim_scope
+#endif
+
+/*!
+    @brief Set the level of ESP_LOGx output for all tags
+
+    The default is ESP_LOG_WARN, or the level named by the IOT_HOST_LOG
+    environment variable (e, w, i, d or v).
+ */
+void                host_log_level(int level);
+
+/*!
+    @brief Back a data partition with a file
+
+    The file is created if needed and grown to `size` with erased (0xff)
+    bytes.  Writes behave like NOR flash, they can only clear bits, and
+    erases set whole 4K sectors back to 0xff.  Partitions are also read from
+    the IOT_HOST_PARTITIONS environment variable on the first lookup, as a
+    comma separated list of `label=path:size`, size in bytes or with a K
+    suffix, e.g. `spool=/tmp/spool.bin:64K`.
+    @param label  name esp_partition_find_first() matches on
+    @param path   backing file
+    @param size   multiple of 4K
+    @return esp_err_t  ESP_ERR_INVALID_SIZE if size is not a multiple of 4K
+ */
+esp_err_t           host_partition_add(const char *label, const char *path, uint32_t size);
+
+/*!
+    @brief Cut the power to a partition after `bytes` more programmed bytes
+
+    The write that crosses the budget is only partly programmed and every
+    later write or erase is silently dropped, as if the device lost power
+    while the code kept running.  Used to exercise crash recovery: tear,
+    write, then re-open the partition from a fresh process.
+    @param label
+    @param bytes  budget, negative to restore power
+ */
+void                host_partition_tear(const char *label, int32_t bytes);
+
+/*!
+    @brief Evaluates true once a tear has dropped a write or erase
+ */
+bool                host_partition_torn(const char *label);
+
+#endif /* HOST_H_ */
@@ -0,0 +1,18 @@
+#ifndef HOST_MDNS_H_
+#define HOST_MDNS_H_
+
+#include "host.h"
+
+/* accepted and not announced */
+typedef struct {
+    const char  *key;
+    const char  *value;
+} mdns_txt_item_t;
+
+esp_err_t   mdns_init();
+void        mdns_free();
+esp_err_t   mdns_hostname_set(const char *hostname);
+esp_err_t   mdns_service_add(const char *instance, const char *service, const char *proto,
+                        uint16_t port, mdns_txt_item_t txt[], size_t num_items);
+
+#endif /* HOST_MDNS_H_ */
@@ -0,0 +1,66 @@
+#ifndef HOST_NIMBLE_HOST_H_
+#define HOST_NIMBLE_HOST_H_
+
+#include "NimBLEDevice.h"
+
+/*!
+    @file
+    @brief Inject advertisements into the fake NimBLE scan
+
+    Only used by host programs, iot-core never includes this.
+ */
+
+#define NIMBLE_HOST_MAX_UUIDS       4
+
+/*!
+    @struct nimble_host_adv_t
+    @brief One advertisement as the controller would report it
+
+    `addr` is in display order (as printed by DEVICE_ADDR_FMT), service
+    UUIDs are strings accepted by NimBLEUUID.  `svc_data_uuid` is NULL when
+    the advertisement carries no service data, `mfg_data_len` 0 when it
+    carries no manufacturer data.  They are packed into the AD structures
+    of the raw payload that NimBLEAdvertisedDevice parses.
+ */
+typedef struct nimble_host_adv {
+    uint8_t         addr[6];
+    uint8_t         addr_type;
+    int8_t          rssi;
+    uint8_t         connectable;
+    const char      *uuids[NIMBLE_HOST_MAX_UUIDS];
+    const char      *svc_data_uuid;
+    const uint8_t   *svc_data;
+    size_t          svc_data_len;
+    const uint8_t   *mfg_data;
+    size_t          mfg_data_len;
+} nimble_host_adv_t;
+
+/*!
+    @brief Report an advertisement to the running scan
+
+    Follows NimBLE: nothing is reported while no scan runs, and without
+    `wantDuplicates` each address is reported once per scan.
+
+    @return true if onResult() was called
+ */
+bool    nimble_host_advertise(const nimble_host_adv_t *adv);
+
+/*!
+    @brief Build the NimBLEAdvertisedDevice a scan would report for `adv`
+
+    The caller owns the result.  With nimble_host_result() it lets a
+    program time onResult() without building a device per call.
+ */
+NimBLEAdvertisedDevice* nimble_host_adv_device(const nimble_host_adv_t *adv);
+
+/*!
+    @brief Hand a device straight to onResult() of the scan callbacks
+
+    Skips the scan state and the duplicate filter of
+    nimble_host_advertise().
+
+    @return false if no callbacks are registered
+ */
+bool    nimble_host_result(NimBLEAdvertisedDevice *device);
+
+#endif /* HOST_NIMBLE_HOST_H_ */
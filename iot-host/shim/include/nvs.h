@@ -0,0 +1,22 @@
+#ifndef HOST_NVS_H_
+#define HOST_NVS_H_
+
+#include "host.h"
+
+typedef uint32_t nvs_handle_t;
+
+typedef enum {
+    NVS_READONLY,
+    NVS_READWRITE
+} nvs_open_mode_t;
+
+esp_err_t   nvs_open(const char *name, nvs_open_mode_t mode, nvs_handle_t *handle);
+esp_err_t   nvs_set_str(nvs_handle_t handle, const char *key, const char *value);
+esp_err_t   nvs_get_str(nvs_handle_t handle, const char *key, char *out, size_t *len);
+esp_err_t   nvs_set_blob(nvs_handle_t handle, const char *key, const void *value, size_t len);
+esp_err_t   nvs_get_blob(nvs_handle_t handle, const char *key, void *out, size_t *len);
+esp_err_t   nvs_erase_key(nvs_handle_t handle, const char *key);
+esp_err_t   nvs_commit(nvs_handle_t handle);
+void        nvs_close(nvs_handle_t handle);
+
+#endif /* HOST_NVS_H_ */
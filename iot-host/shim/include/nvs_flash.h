@@ -0,0 +1,11 @@
+#ifndef HOST_NVS_FLASH_H_
+#define HOST_NVS_FLASH_H_
+
+#include "nvs.h"
+
+/* NVS lives in memory, and is loaded from and committed to the file
+ * named by the IOT_HOST_NVS environment variable when it is set */
+esp_err_t   nvs_flash_init();
+esp_err_t   nvs_flash_erase();
+
+#endif /* HOST_NVS_FLASH_H_ */
@@ -0,0 +1,11 @@
+#ifndef HOST_SDKCONFIG_H_
+#define HOST_SDKCONFIG_H_
+
+/* the handful of Kconfig values iot-core reads, at their ESP32 defaults */
+#define CONFIG_IDF_TARGET_ESP32         1
+#define CONFIG_FREERTOS_HZ              1000
+#define CONFIG_LOG_DEFAULT_LEVEL        3
+#define CONFIG_BTDM_CTRL_BLE_MAX_CONN   3
+#define CONFIG_ESP_MAIN_TASK_STACK_SIZE 3584
+
+#endif /* HOST_SDKCONFIG_H_ */
@@ -0,0 +1,20 @@
+#ifndef HOST_SOC_RTC_H_
+#define HOST_SOC_RTC_H_
+
+#include "host.h"
+
+typedef struct {
+    uint32_t    flags;
+} rtc_sleep_config_t;
+
+#define RTC_SLEEP_PD_DIG        (1 << 0)
+#define RTC_TIMER_TRIG_EN       (1 << 0)
+
+void    rtc_sleep_get_default_config(uint32_t flags, rtc_sleep_config_t *cfg);
+void    rtc_sleep_init(rtc_sleep_config_t cfg);
+void    rtc_sleep_set_wakeup_time(uint64_t t);
+
+/* the host has nothing to wake up from, this behaves as esp_restart() */
+uint32_t rtc_deep_sleep_start(uint32_t wakeup_opt, uint32_t reject_opt);
+
+#endif /* HOST_SOC_RTC_H_ */
@@ -0,0 +1,24 @@
+#ifndef HOST_TCPIP_ADAPTER_H_
+#define HOST_TCPIP_ADAPTER_H_
+
+#include "host.h"
+
+typedef struct {
+    uint32_t    addr;
+} ip4_addr_t;
+
+typedef struct {
+    ip4_addr_t  ip;
+    ip4_addr_t  netmask;
+    ip4_addr_t  gw;
+} tcpip_adapter_ip_info_t;
+
+typedef enum {
+    TCPIP_ADAPTER_IF_STA,
+    TCPIP_ADAPTER_IF_AP,
+} tcpip_adapter_if_t;
+
+/* reports 127.0.0.1 */
+esp_err_t   tcpip_adapter_get_ip_info(tcpip_adapter_if_t tcpip_if, tcpip_adapter_ip_info_t *ip_info);
+
+#endif /* HOST_TCPIP_ADAPTER_H_ */
@@ -0,0 +1,48 @@
+#ifndef HOST_WIFI_PROV_MANAGER_H_
+#define HOST_WIFI_PROV_MANAGER_H_
+
+#include "esp_wifi.h"
+
+/* the host is always provisioned */
+extern esp_event_base_t WIFI_PROV_EVENT;
+
+typedef enum {
+    WIFI_PROV_INIT,
+    WIFI_PROV_START,
+    WIFI_PROV_CRED_RECV,
+    WIFI_PROV_CRED_FAIL,
+    WIFI_PROV_CRED_SUCCESS,
+    WIFI_PROV_END,
+    WIFI_PROV_DEINIT,
+} wifi_prov_cb_event_t;
+
+typedef enum {
+    WIFI_PROV_SECURITY_0,
+    WIFI_PROV_SECURITY_1,
+} wifi_prov_security_t;
+
+typedef struct wifi_prov_scheme {
+    const char  *name;
+} wifi_prov_scheme_t;
+
+typedef struct {
+    void    (*event_cb)(void *user_data, wifi_prov_cb_event_t event, void *event_data);
+    void    *user_data;
+} wifi_prov_event_handler_t;
+
+#define WIFI_PROV_EVENT_HANDLER_NONE    { .event_cb = NULL, .user_data = NULL }
+
+typedef struct {
+    wifi_prov_scheme_t          scheme;
+    wifi_prov_event_handler_t   scheme_event_handler;
+    wifi_prov_event_handler_t   app_event_handler;
+} wifi_prov_mgr_config_t;
+
+esp_err_t   wifi_prov_mgr_init(wifi_prov_mgr_config_t config);
+void        wifi_prov_mgr_deinit();
+esp_err_t   wifi_prov_mgr_is_provisioned(bool *provisioned);
+esp_err_t   wifi_prov_mgr_start_provisioning(wifi_prov_security_t security, const char *pop,
+                        const char *service_name, const char *service_key);
+esp_err_t   wifi_prov_mgr_reset_sm_state_on_failure();
+
+#endif /* HOST_WIFI_PROV_MANAGER_H_ */
@@ -0,0 +1,8 @@
+#ifndef HOST_WIFI_PROV_SCHEME_SOFTAP_H_
+#define HOST_WIFI_PROV_SCHEME_SOFTAP_H_
+
+#include "wifi_provisioning/manager.h"
+
+extern const wifi_prov_scheme_t wifi_prov_scheme_softap;
+
+#endif /* HOST_WIFI_PROV_SCHEME_SOFTAP_H_ */
@@ -0,0 +1,774 @@
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include "NimBLEDevice.h"
+#include "nimble-host.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+
+static const char *TAG = "NimBLE";
+
+static const uint8_t BLE_BASE_UUID[16] = {
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x10, 0x00,
+    0x80, 0x00, 0x00, 0x80, 0x5f, 0x9b, 0x34, 0xfb,
+};
+
+/* AD structure types of the advertising payload */
+#define ADV_TYPE_UUIDS16            0x03
+#define ADV_TYPE_UUIDS32            0x05
+#define ADV_TYPE_UUIDS128           0x07
+#define ADV_TYPE_SVC_DATA16         0x16
+#define ADV_TYPE_SVC_DATA32         0x20
+#define ADV_TYPE_SVC_DATA128        0x21
+#define ADV_TYPE_MFG_DATA           0xff
+
+static std::mutex                   nimble_lock;
+static NimBLEScan                   *nimble_scan        = nullptr;
+static NimBLEAdvertising            *nimble_adv         = nullptr;
+static std::vector<NimBLEClient*>   nimble_clients;
+static std::vector<NimBLEAddress>   nimble_whitelist;
+
+esp_err_t esp_ble_tx_power_set(esp_ble_power_type_t type, esp_power_level_t level) {
+    return ESP_OK;
+}
+
+esp_err_t esp_bt_controller_mem_release(esp_bt_mode_t mode) {
+    return ESP_OK;
+}
+
+esp_err_t esp_bt_sleep_disable() {
+    return ESP_OK;
+}
+
+/* NimBLEAddress: native order is little endian, as in NimBLE */
+
+NimBLEAddress::NimBLEAddress() {
+    memset(m_address, 0, sizeof(m_address));
+    m_addrType = BLE_ADDR_PUBLIC;
+}
+
+NimBLEAddress::NimBLEAddress(ble_addr_t address) {
+    memcpy(m_address, address.val, sizeof(m_address));
+    m_addrType = address.type;
+}
+
+NimBLEAddress::NimBLEAddress(const uint8_t address[6], uint8_t type) {
+    std::reverse_copy(address, address + sizeof(m_address), m_address);
+    m_addrType = type;
+}
+
+NimBLEAddress::NimBLEAddress(const std::string &address, uint8_t type) {
+    unsigned int b[6];
+    memset(m_address, 0, sizeof(m_address));
+    m_addrType = type;
+    if(sscanf(address.c_str(), "%2x:%2x:%2x:%2x:%2x:%2x", &b[0], &b[1], &b[2], &b[3], &b[4], &b[5]) == 6) {
+        for(uint8_t i=0; i<6; i++) {
+            m_address[5 - i] = b[i];
+        }
+    }
+}
+
+bool NimBLEAddress::equals(const NimBLEAddress &other) const {
+    return memcmp(m_address, other.m_address, sizeof(m_address)) == 0;
+}
+
+bool NimBLEAddress::operator==(const NimBLEAddress &rhs) const {
+    return equals(rhs);
+}
+
+const uint8_t* NimBLEAddress::getNative() const {
+    return m_address;
+}
+
+uint8_t NimBLEAddress::getType() const {
+    return m_addrType;
+}
+
+std::string NimBLEAddress::toString() const {
+    char buf[18];
+    snprintf(buf, sizeof(buf), "%02x:%02x:%02x:%02x:%02x:%02x",
+            m_address[5], m_address[4], m_address[3], m_address[2], m_address[1], m_address[0]);
+    return buf;
+}
+
+/* NimBLEUUID: m_val holds the value in display order */
+
+NimBLEUUID::NimBLEUUID() {
+    m_bits = 0;
+    memset(m_val, 0, sizeof(m_val));
+}
+
+NimBLEUUID::NimBLEUUID(uint16_t uuid) : NimBLEUUID() {
+    m_bits = 16;
+    m_val[0] = uuid >> 8;
+    m_val[1] = uuid & 0xff;
+}
+
+NimBLEUUID::NimBLEUUID(uint32_t uuid) : NimBLEUUID() {
+    m_bits = 32;
+    for(uint8_t i=0; i<4; i++) {
+        m_val[i] = (uuid >> (24 - (i * 8))) & 0xff;
+    }
+}
+
+NimBLEUUID::NimBLEUUID(const char *uuid) : NimBLEUUID(std::string(uuid ? uuid : "")) {
+}
+
+NimBLEUUID::NimBLEUUID(const uint8_t *pData, size_t size, bool msbFirst) : NimBLEUUID() {
+    if(size != 2 && size != 4 && size != 16) {
+        return;
+    }
+    m_bits = size * 8;
+    for(size_t i=0; i<size; i++) {
+        m_val[i] = msbFirst ? pData[i] : pData[size - 1 - i];
+    }
+}
+
+NimBLEUUID::NimBLEUUID(const std::string &uuid) : NimBLEUUID() {
+    std::string hex;
+    for(char c : uuid) {
+        if(isxdigit((unsigned char)c)) {
+            hex += c;
+        } else if(c != '-') {
+            return;
+        }
+    }
+    if(hex.size() == 4) {
+        *this = NimBLEUUID((uint16_t)strtoul(hex.c_str(), NULL, 16));
+    } else if(hex.size() == 8) {
+        *this = NimBLEUUID((uint32_t)strtoul(hex.c_str(), NULL, 16));
+    } else if(hex.size() == 32) {
+        m_bits = 128;
+        for(uint8_t i=0; i<16; i++) {
+            m_val[i] = strtoul(hex.substr(i * 2, 2).c_str(), NULL, 16);
+        }
+    }
+}
+
+uint8_t NimBLEUUID::bitSize() const {
+    return m_bits;
+}
+
+NimBLEUUID& NimBLEUUID::to128() {
+    if(m_bits == 16 || m_bits == 32) {
+        uint8_t val[16];
+        memcpy(val, BLE_BASE_UUID, sizeof(val));
+        if(m_bits == 16) {
+            memcpy(val + 2, m_val, 2);
+        } else {
+            memcpy(val, m_val, 4);
+        }
+        memcpy(m_val, val, sizeof(m_val));
+        m_bits = 128;
+    }
+    return *this;
+}
+
+bool NimBLEUUID::equals(const NimBLEUUID &uuid) const {
+    if(m_bits == 0 || uuid.m_bits == 0) {
+        return false;
+    }
+    NimBLEUUID a = *this;
+    NimBLEUUID b = uuid;
+    return memcmp(a.to128().m_val, b.to128().m_val, sizeof(m_val)) == 0;
+}
+
+size_t NimBLEUUID::getAdvBytes(uint8_t *buf) const {
+    size_t size = m_bits / 8;
+    for(size_t i=0; i<size; i++) {
+        buf[i] = m_val[size - 1 - i];
+    }
+    return size;
+}
+
+bool NimBLEUUID::operator==(const NimBLEUUID &rhs) const {
+    return equals(rhs);
+}
+
+bool NimBLEUUID::operator!=(const NimBLEUUID &rhs) const {
+    return !equals(rhs);
+}
+
+std::string NimBLEUUID::toString() const {
+    char buf[37];
+    const uint8_t *v = m_val;
+    switch(m_bits) {
+        case 16:
+            snprintf(buf, sizeof(buf), "0x%02x%02x", v[0], v[1]);
+            break;
+        case 32:
+            snprintf(buf, sizeof(buf), "0x%02x%02x%02x%02x", v[0], v[1], v[2], v[3]);
+            break;
+        case 128:
+            snprintf(buf, sizeof(buf),
+                    "%02x%02x%02x%02x-%02x%02x-%02x%02x-%02x%02x-%02x%02x%02x%02x%02x%02x",
+                    v[0], v[1], v[2], v[3], v[4], v[5], v[6], v[7],
+                    v[8], v[9], v[10], v[11], v[12], v[13], v[14], v[15]);
+            break;
+        default:
+            buf[0] = '\0';
+    }
+    return buf;
+}
+
+/* remote attributes: there are no peers, so none are ever discovered */
+
+uint16_t NimBLERemoteDescriptor::getHandle() {
+    return 0;
+}
+
+bool NimBLERemoteCharacteristic::canNotify() {
+    return false;
+}
+
+bool NimBLERemoteCharacteristic::canRead() {
+    return false;
+}
+
+bool NimBLERemoteCharacteristic::canWrite() {
+    return false;
+}
+
+uint16_t NimBLERemoteCharacteristic::getHandle() {
+    return 0;
+}
+
+NimBLEUUID NimBLERemoteCharacteristic::getUUID() {
+    return NimBLEUUID();
+}
+
+NimBLERemoteService* NimBLERemoteCharacteristic::getRemoteService() {
+    return nullptr;
+}
+
+NimBLERemoteDescriptor* NimBLERemoteCharacteristic::getDescriptor(const NimBLEUUID &uuid) {
+    return nullptr;
+}
+
+std::string NimBLERemoteCharacteristic::readValue(time_t *timestamp) {
+    return std::string();
+}
+
+bool NimBLERemoteCharacteristic::subscribe(bool notifications, notify_callback notifyCallback, bool response) {
+    return false;
+}
+
+bool NimBLERemoteCharacteristic::unsubscribe(bool response) {
+    return false;
+}
+
+bool NimBLERemoteCharacteristic::writeValue(const uint8_t *data, size_t length, bool response) {
+    return false;
+}
+
+bool NimBLERemoteCharacteristic::writeValue(const std::string &newValue, bool response) {
+    return false;
+}
+
+NimBLEClient* NimBLERemoteService::getClient() {
+    return nullptr;
+}
+
+NimBLEUUID NimBLERemoteService::getUUID() {
+    return NimBLEUUID();
+}
+
+NimBLERemoteCharacteristic* NimBLERemoteService::getCharacteristic(const NimBLEUUID &uuid) {
+    return nullptr;
+}
+
+std::vector<NimBLERemoteCharacteristic*>* NimBLERemoteService::getCharacteristics(bool refresh) {
+    static std::vector<NimBLERemoteCharacteristic*> none;
+    return &none;
+}
+
+uint16_t NimBLEConnInfo::getConnHandle() {
+    return m_desc.conn_handle;
+}
+
+uint16_t NimBLEConnInfo::getConnInterval() {
+    return m_desc.conn_itvl;
+}
+
+uint16_t NimBLEConnInfo::getConnTimeout() {
+    return m_desc.supervision_timeout;
+}
+
+uint16_t NimBLEConnInfo::getConnLatency() {
+    return m_desc.conn_latency;
+}
+
+/* NimBLEClient */
+
+NimBLEClient::NimBLEClient() {
+    m_pClientCallbacks = nullptr;
+    m_deleteCallbacks = false;
+    m_lastErr = 0;
+}
+
+NimBLEClient::~NimBLEClient() {
+    if(m_deleteCallbacks) {
+        delete m_pClientCallbacks;
+    }
+}
+
+bool NimBLEClient::connect(const NimBLEAddress &address, bool deleteAttributes) {
+    m_peerAddress = address;
+    m_lastErr = BLE_HS_ENOTCONN;
+    ESP_LOGD(TAG, "connect(%s): no peer on the host", address.toString().c_str());
+    return false;
+}
+
+int NimBLEClient::disconnect(uint8_t reason) {
+    return BLE_HS_ENOTCONN;
+}
+
+bool NimBLEClient::isConnected() {
+    return false;
+}
+
+void NimBLEClient::setClientCallbacks(NimBLEClientCallbacks *pClientCallbacks, bool deleteCallbacks) {
+    if(m_deleteCallbacks && m_pClientCallbacks != pClientCallbacks) {
+        delete m_pClientCallbacks;
+    }
+    m_pClientCallbacks = pClientCallbacks;
+    m_deleteCallbacks = deleteCallbacks;
+}
+
+void NimBLEClient::setConnectTimeout(uint8_t timeout) {
+}
+
+void NimBLEClient::setConnectionParams(uint16_t minInterval, uint16_t maxInterval,
+                        uint16_t latency, uint16_t timeout, uint16_t scanInterval, uint16_t scanWindow) {
+}
+
+void NimBLEClient::updateConnParams(uint16_t minInterval, uint16_t maxInterval,
+                        uint16_t latency, uint16_t timeout) {
+}
+
+NimBLEConnInfo NimBLEClient::getConnInfo() {
+    NimBLEConnInfo info;
+    memset(&info.m_desc, 0, sizeof(info.m_desc));
+    return info;
+}
+
+uint16_t NimBLEClient::getConnId() {
+    return 0xffff;
+}
+
+NimBLEAddress NimBLEClient::getPeerAddress() {
+    return m_peerAddress;
+}
+
+int NimBLEClient::getRssi() {
+    return 0;
+}
+
+int NimBLEClient::getLastError() {
+    return m_lastErr;
+}
+
+NimBLERemoteService* NimBLEClient::getService(const NimBLEUUID &uuid) {
+    return nullptr;
+}
+
+void NimBLEClient::deleteServices() {
+}
+
+/* NimBLEAdvertisedDevice */
+
+NimBLEAddress NimBLEAdvertisedDevice::getAddress() {
+    return m_address;
+}
+
+uint8_t NimBLEAdvertisedDevice::getAddressType() {
+    return m_address.getType();
+}
+
+int NimBLEAdvertisedDevice::getRSSI() {
+    return m_rssi;
+}
+
+bool NimBLEAdvertisedDevice::isConnectable() {
+    return m_connectable;
+}
+
+/* data of the index'th AD structure of `type`, nullptr if there is none */
+const uint8_t* NimBLEAdvertisedDevice::findAdvField(uint8_t type, uint8_t index, size_t *len) const {
+    size_t pos = 0;
+    while(pos + 1 < m_payload.size()) {
+        uint8_t field = m_payload[pos];
+        if(field == 0 || pos + 1 + field > m_payload.size()) {
+            break;
+        }
+        if(m_payload[pos + 1] == type && index-- == 0) {
+            *len = field - 1;
+            return &m_payload[pos + 2];
+        }
+        pos += 1 + field;
+    }
+    return nullptr;
+}
+
+static const uint8_t ADV_UUID_TYPES[] = { ADV_TYPE_UUIDS16, ADV_TYPE_UUIDS32, ADV_TYPE_UUIDS128 };
+static const uint8_t ADV_SVC_DATA_TYPES[] = { ADV_TYPE_SVC_DATA16, ADV_TYPE_SVC_DATA32, ADV_TYPE_SVC_DATA128 };
+static const uint8_t ADV_UUID_SIZES[] = { 2, 4, 16 };
+
+bool NimBLEAdvertisedDevice::haveServiceUUID() {
+    return getServiceUUIDCount() > 0;
+}
+
+uint8_t NimBLEAdvertisedDevice::getServiceUUIDCount() {
+    uint8_t count = 0;
+    for(uint8_t t=0; t<sizeof(ADV_UUID_TYPES); t++) {
+        const uint8_t *data;
+        size_t len;
+        for(uint8_t i=0; (data = findAdvField(ADV_UUID_TYPES[t], i, &len)); i++) {
+            count += len / ADV_UUID_SIZES[t];
+        }
+    }
+    return count;
+}
+
+NimBLEUUID NimBLEAdvertisedDevice::getServiceUUID(uint8_t index) {
+    for(uint8_t t=0; t<sizeof(ADV_UUID_TYPES); t++) {
+        const uint8_t *data;
+        size_t len;
+        for(uint8_t i=0; (data = findAdvField(ADV_UUID_TYPES[t], i, &len)); i++) {
+            size_t items = len / ADV_UUID_SIZES[t];
+            if(index < items) {
+                return NimBLEUUID(data + index * ADV_UUID_SIZES[t], ADV_UUID_SIZES[t], false);
+            }
+            index -= items;
+        }
+    }
+    return NimBLEUUID();
+}
+
+/* as NimBLE, one payload walk per advertised UUID */
+bool NimBLEAdvertisedDevice::isAdvertisingService(const NimBLEUUID &uuid) const {
+    NimBLEAdvertisedDevice *self = const_cast<NimBLEAdvertisedDevice*>(this);
+    uint8_t count = self->getServiceUUIDCount();
+    for(uint8_t i=0; i<count; i++) {
+        if(self->getServiceUUID(i).equals(uuid)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool NimBLEAdvertisedDevice::haveServiceData() {
+    return getServiceDataCount() > 0;
+}
+
+uint8_t NimBLEAdvertisedDevice::getServiceDataCount() {
+    uint8_t count = 0;
+    size_t len;
+    for(uint8_t t=0; t<sizeof(ADV_SVC_DATA_TYPES); t++) {
+        for(uint8_t i=0; findAdvField(ADV_SVC_DATA_TYPES[t], i, &len); i++) {
+            count++;
+        }
+    }
+    return count;
+}
+
+std::string NimBLEAdvertisedDevice::getServiceData(uint8_t index) {
+    for(uint8_t t=0; t<sizeof(ADV_SVC_DATA_TYPES); t++) {
+        const uint8_t *data;
+        size_t len;
+        for(uint8_t i=0; (data = findAdvField(ADV_SVC_DATA_TYPES[t], i, &len)); i++) {
+            if(index-- == 0) {
+                size_t size = ADV_UUID_SIZES[t];
+                return (len >= size) ? std::string((const char*)data + size, len - size) : std::string();
+            }
+        }
+    }
+    return std::string();
+}
+
+std::string NimBLEAdvertisedDevice::getServiceData(const NimBLEUUID &uuid) const {
+    for(uint8_t t=0; t<sizeof(ADV_SVC_DATA_TYPES); t++) {
+        const uint8_t *data;
+        size_t len;
+        size_t size = ADV_UUID_SIZES[t];
+        for(uint8_t i=0; (data = findAdvField(ADV_SVC_DATA_TYPES[t], i, &len)); i++) {
+            if(len >= size && NimBLEUUID(data, size, false).equals(uuid)) {
+                return std::string((const char*)data + size, len - size);
+            }
+        }
+    }
+    return std::string();
+}
+
+NimBLEUUID NimBLEAdvertisedDevice::getServiceDataUUID(uint8_t index) {
+    for(uint8_t t=0; t<sizeof(ADV_SVC_DATA_TYPES); t++) {
+        const uint8_t *data;
+        size_t len;
+        for(uint8_t i=0; (data = findAdvField(ADV_SVC_DATA_TYPES[t], i, &len)); i++) {
+            if(index-- == 0) {
+                return (len >= ADV_UUID_SIZES[t]) ? NimBLEUUID(data, ADV_UUID_SIZES[t], false) : NimBLEUUID();
+            }
+        }
+    }
+    return NimBLEUUID();
+}
+
+bool NimBLEAdvertisedDevice::haveManufacturerData() {
+    size_t len;
+    return findAdvField(ADV_TYPE_MFG_DATA, 0, &len) != nullptr;
+}
+
+std::string NimBLEAdvertisedDevice::getManufacturerData() {
+    size_t len;
+    const uint8_t *data = findAdvField(ADV_TYPE_MFG_DATA, 0, &len);
+    return data ? std::string((const char*)data, len) : std::string();
+}
+
+uint8_t* NimBLEAdvertisedDevice::getPayload() {
+    return m_payload.data();
+}
+
+size_t NimBLEAdvertisedDevice::getPayloadLength() {
+    return m_payload.size();
+}
+
+/* NimBLEScan: a timed scan only notices its end on the next call into it */
+
+NimBLEScan::NimBLEScan() {
+    m_pAdvertisedDeviceCallbacks = nullptr;
+    m_wantDuplicates = false;
+    m_duplicateFilter = true;
+    m_scanning = false;
+    m_endTime = 0;
+    m_scanCompleteCB = nullptr;
+}
+
+bool NimBLEScan::start(uint32_t duration, void (*scanCompleteCB)(void*), bool is_continue) {
+    std::lock_guard<std::mutex> guard(nimble_lock);
+    if(!is_continue) {
+        m_seen.clear();
+    }
+    m_scanning = true;
+    m_scanCompleteCB = scanCompleteCB;
+    m_endTime = duration ? esp_timer_get_time() + ((int64_t)duration * 1000000) : 0;
+    return true;
+}
+
+bool NimBLEScan::stop() {
+    std::lock_guard<std::mutex> guard(nimble_lock);
+    m_scanning = false;
+    return true;
+}
+
+bool NimBLEScan::isScanning() {
+    void (*done)(void*) = nullptr;
+    nimble_lock.lock();
+    if(m_scanning && m_endTime && esp_timer_get_time() >= m_endTime) {
+        m_scanning = false;
+        done = m_scanCompleteCB;
+    }
+    bool scanning = m_scanning;
+    nimble_lock.unlock();
+    if(done) {
+        done(nullptr);
+    }
+    return scanning;
+}
+
+void NimBLEScan::setAdvertisedDeviceCallbacks(NimBLEAdvertisedDeviceCallbacks *pAdvertisedDeviceCallbacks,
+                        bool wantDuplicates) {
+    std::lock_guard<std::mutex> guard(nimble_lock);
+    m_pAdvertisedDeviceCallbacks = pAdvertisedDeviceCallbacks;
+    m_wantDuplicates = wantDuplicates;
+}
+
+void NimBLEScan::setActiveScan(bool active) {
+}
+
+void NimBLEScan::setInterval(uint16_t intervalMSecs) {
+}
+
+void NimBLEScan::setWindow(uint16_t windowMSecs) {
+}
+
+void NimBLEScan::setDuplicateFilter(bool enabled) {
+    std::lock_guard<std::mutex> guard(nimble_lock);
+    m_duplicateFilter = enabled;
+}
+
+void NimBLEScan::setLimitedOnly(bool enabled) {
+}
+
+void NimBLEScan::setFilterPolicy(uint8_t filter) {
+}
+
+void NimBLEScan::setMaxResults(uint8_t maxResults) {
+}
+
+void NimBLEScan::clearResults() {
+}
+
+void NimBLEScan::clearDuplicateCache() {
+    std::lock_guard<std::mutex> guard(nimble_lock);
+    m_seen.clear();
+}
+
+bool NimBLEScan::onAdvertisement(const nimble_host_adv_t *adv) {
+    if(!isScanning()) {
+        return false;
+    }
+    std::unique_ptr<NimBLEAdvertisedDevice> device(nimble_host_adv_device(adv));
+
+    nimble_lock.lock();
+    NimBLEAdvertisedDeviceCallbacks *cb = m_pAdvertisedDeviceCallbacks;
+    // the controller filters repeats unless the callbacks want them all
+    bool report = (cb != nullptr);
+    if(report && !(m_wantDuplicates && !m_duplicateFilter)) {
+        if(std::find(m_seen.begin(), m_seen.end(), device->m_address) != m_seen.end()) {
+            report = false;
+        } else {
+            m_seen.push_back(device->m_address);
+        }
+    }
+    nimble_lock.unlock();
+    if(report) {
+        cb->onResult(device.get());
+    }
+    return report;
+}
+
+static void adv_field_put(std::vector<uint8_t> &payload, uint8_t type, const uint8_t *data, size_t len) {
+    payload.push_back(len + 1);
+    payload.push_back(type);
+    payload.insert(payload.end(), data, data + len);
+}
+
+NimBLEAdvertisedDevice* nimble_host_adv_device(const nimble_host_adv_t *adv) {
+    NimBLEAdvertisedDevice *device = new NimBLEAdvertisedDevice();
+    device->m_address = NimBLEAddress(adv->addr, adv->addr_type);
+    device->m_rssi = adv->rssi;
+    device->m_connectable = adv->connectable;
+
+    static const uint8_t flags = 0x06;
+    adv_field_put(device->m_payload, 0x01, &flags, 1);
+    // one list per UUID size, as a peripheral advertises them
+    for(uint8_t t=0; t<sizeof(ADV_UUID_TYPES); t++) {
+        uint8_t list[NIMBLE_HOST_MAX_UUIDS * 16];
+        size_t len = 0;
+        for(uint8_t i=0; i<NIMBLE_HOST_MAX_UUIDS && adv->uuids[i]; i++) {
+            NimBLEUUID uuid(adv->uuids[i]);
+            if(uuid.bitSize() / 8 == ADV_UUID_SIZES[t]) {
+                len += uuid.getAdvBytes(list + len);
+            }
+        }
+        if(len) {
+            adv_field_put(device->m_payload, ADV_UUID_TYPES[t], list, len);
+        }
+    }
+    if(adv->svc_data_uuid) {
+        uint8_t data[16 + 31];
+        NimBLEUUID uuid(adv->svc_data_uuid);
+        size_t size = uuid.getAdvBytes(data);
+        size_t len = std::min(adv->svc_data_len, sizeof(data) - size);
+        memcpy(data + size, adv->svc_data, len);
+        uint8_t type = (size == 2) ? ADV_TYPE_SVC_DATA16 : (size == 4) ? ADV_TYPE_SVC_DATA32 : ADV_TYPE_SVC_DATA128;
+        adv_field_put(device->m_payload, type, data, size + len);
+    }
+    if(adv->mfg_data_len) {
+        adv_field_put(device->m_payload, ADV_TYPE_MFG_DATA, adv->mfg_data, adv->mfg_data_len);
+    }
+    return device;
+}
+
+bool nimble_host_advertise(const nimble_host_adv_t *adv) {
+    return nimble_scan && nimble_scan->onAdvertisement(adv);
+}
+
+bool nimble_host_result(NimBLEAdvertisedDevice *device) {
+    NimBLEAdvertisedDeviceCallbacks *cb = nimble_scan ? nimble_scan->m_pAdvertisedDeviceCallbacks : nullptr;
+    if(cb == nullptr) {
+        return false;
+    }
+    cb->onResult(device);
+    return true;
+}
+
+void NimBLEAdvertising::setScanFilter(bool scanRequestWhitelistOnly, bool connectWhitelistOnly) {
+}
+
+/* NimBLEDevice */
+
+void NimBLEDevice::init(const std::string &deviceName) {
+    std::lock_guard<std::mutex> guard(nimble_lock);
+    if(nimble_scan == nullptr) {
+        nimble_scan = new NimBLEScan();
+        nimble_adv = new NimBLEAdvertising();
+    }
+}
+
+void NimBLEDevice::deinit(bool clearAll) {
+}
+
+bool NimBLEDevice::getInitialized() {
+    return nimble_scan != nullptr;
+}
+
+NimBLEScan* NimBLEDevice::getScan() {
+    return nimble_scan;
+}
+
+NimBLEAdvertising* NimBLEDevice::getAdvertising() {
+    return nimble_adv;
+}
+
+NimBLEClient* NimBLEDevice::createClient() {
+    std::lock_guard<std::mutex> guard(nimble_lock);
+    if(nimble_clients.size() >= CONFIG_BTDM_CTRL_BLE_MAX_CONN) {
+        ESP_LOGE(TAG, "Unable to create client; already at max: %d", CONFIG_BTDM_CTRL_BLE_MAX_CONN);
+        return nullptr;
+    }
+    NimBLEClient *client = new NimBLEClient();
+    nimble_clients.push_back(client);
+    return client;
+}
+
+bool NimBLEDevice::deleteClient(NimBLEClient *pClient) {
+    std::lock_guard<std::mutex> guard(nimble_lock);
+    auto it = std::find(nimble_clients.begin(), nimble_clients.end(), pClient);
+    if(it == nimble_clients.end()) {
+        return false;
+    }
+    nimble_clients.erase(it);
+    delete pClient;
+    return true;
+}
+
+size_t NimBLEDevice::getClientListSize() {
+    std::lock_guard<std::mutex> guard(nimble_lock);
+    return nimble_clients.size();
+}
+
+void NimBLEDevice::setSecurityAuth(uint8_t auth_req) {
+}
+
+void NimBLEDevice::setSecurityIOCap(uint8_t iocap) {
+}
+
+void NimBLEDevice::setSecurityRespKey(uint8_t resp_key) {
+}
+
+void NimBLEDevice::setSecurityInitKey(uint8_t init_key) {
+}
+
+bool NimBLEDevice::whiteListAdd(const NimBLEAddress &address) {
+    std::lock_guard<std::mutex> guard(nimble_lock);
+    if(std::find(nimble_whitelist.begin(), nimble_whitelist.end(), address) == nimble_whitelist.end()) {
+        nimble_whitelist.push_back(address);
+    }
+    return true;
+}
+
+bool NimBLEDevice::onWhiteList(const NimBLEAddress &address) {
+    std::lock_guard<std::mutex> guard(nimble_lock);
+    return std::find(nimble_whitelist.begin(), nimble_whitelist.end(), address) != nimble_whitelist.end();
+}
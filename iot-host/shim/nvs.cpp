@@ -0,0 +1,175 @@
+#include <pthread.h>
+#include <string>
+#include <map>
+#include "host.h"
+#include "nvs.h"
+#include "nvs_flash.h"
+
+/* namespace -> key -> value; strings keep their terminating NUL */
+typedef std::map<std::string, std::string> nvs_namespace_t;
+
+typedef struct {
+    std::string     name;
+    nvs_open_mode_t mode;
+} nvs_open_t;
+
+static pthread_mutex_t                          nvs_lock    = PTHREAD_MUTEX_INITIALIZER;
+static std::map<std::string, nvs_namespace_t>   nvs_data;
+static std::map<nvs_handle_t, nvs_open_t>       nvs_handles;
+static nvs_handle_t                             nvs_next    = 1;
+static uint8_t                                  nvs_ready   = false;
+
+static const char* nvs_path() {
+    return getenv("IOT_HOST_NVS");
+}
+
+/* one "namespace key hex" line per entry, "-" for an empty value */
+static void nvs_load() {
+    const char *path = nvs_path();
+    FILE *fp = path ? fopen(path, "r") : NULL;
+    if(fp == NULL) {
+        return;
+    }
+    char ns[64], key[64];
+    static char hex[8192];
+    while(fscanf(fp, "%63s %63s %8191s", ns, key, hex) == 3) {
+        std::string value;
+        for(size_t i=0; hex[0] != '-' && hex[i] && hex[i+1]; i+=2) {
+            char byte[3] = { hex[i], hex[i+1], '\0' };
+            value += (char)strtoul(byte, NULL, 16);
+        }
+        nvs_data[ns][key] = value;
+    }
+    fclose(fp);
+}
+
+static void nvs_save() {
+    const char *path = nvs_path();
+    FILE *fp = path ? fopen(path, "w") : NULL;
+    if(fp == NULL) {
+        return;
+    }
+    for(const auto &ns : nvs_data) {
+        for(const auto &entry : ns.second) {
+            fprintf(fp, "%s %s ", ns.first.c_str(), entry.first.c_str());
+            for(unsigned char c : entry.second) {
+                fprintf(fp, "%02x", c);
+            }
+            fprintf(fp, entry.second.empty() ? "-\n" : "\n");
+        }
+    }
+    fclose(fp);
+}
+
+esp_err_t nvs_flash_init() {
+    pthread_mutex_lock(&nvs_lock);
+    if(!nvs_ready) {
+        nvs_load();
+        nvs_ready = true;
+    }
+    pthread_mutex_unlock(&nvs_lock);
+    return ESP_OK;
+}
+
+esp_err_t nvs_flash_erase() {
+    pthread_mutex_lock(&nvs_lock);
+    nvs_data.clear();
+    nvs_save();
+    pthread_mutex_unlock(&nvs_lock);
+    return ESP_OK;
+}
+
+esp_err_t nvs_open(const char *name, nvs_open_mode_t mode, nvs_handle_t *handle) {
+    esp_err_t err = ESP_OK;
+    pthread_mutex_lock(&nvs_lock);
+    if(mode == NVS_READONLY && nvs_data.find(name) == nvs_data.end()) {
+        err = ESP_ERR_NVS_NOT_FOUND;
+    } else {
+        *handle = nvs_next++;
+        nvs_handles[*handle] = { name, mode };
+        nvs_data[name];
+    }
+    pthread_mutex_unlock(&nvs_lock);
+    return err;
+}
+
+static esp_err_t nvs_set(nvs_handle_t handle, const char *key, const std::string &value) {
+    esp_err_t err = ESP_OK;
+    pthread_mutex_lock(&nvs_lock);
+    auto it = nvs_handles.find(handle);
+    if(it == nvs_handles.end()) {
+        err = ESP_ERR_INVALID_ARG;
+    } else if(it->second.mode == NVS_READONLY) {
+        err = ESP_ERR_INVALID_STATE;
+    } else {
+        nvs_data[it->second.name][key] = value;
+    }
+    pthread_mutex_unlock(&nvs_lock);
+    return err;
+}
+
+static esp_err_t nvs_get(nvs_handle_t handle, const char *key, void *out, size_t *len) {
+    esp_err_t err = ESP_OK;
+    pthread_mutex_lock(&nvs_lock);
+    auto it = nvs_handles.find(handle);
+    if(it == nvs_handles.end()) {
+        err = ESP_ERR_INVALID_ARG;
+    } else {
+        nvs_namespace_t &ns = nvs_data[it->second.name];
+        auto entry = ns.find(key);
+        if(entry == ns.end()) {
+            err = ESP_ERR_NVS_NOT_FOUND;
+        } else if(out == NULL) {
+            *len = entry->second.size();
+        } else if(*len < entry->second.size()) {
+            err = ESP_ERR_NVS_INVALID_LENGTH;
+        } else {
+            memcpy(out, entry->second.data(), entry->second.size());
+            *len = entry->second.size();
+        }
+    }
+    pthread_mutex_unlock(&nvs_lock);
+    return err;
+}
+
+esp_err_t nvs_set_str(nvs_handle_t handle, const char *key, const char *value) {
+    return nvs_set(handle, key, std::string(value, strlen(value) + 1));
+}
+
+esp_err_t nvs_get_str(nvs_handle_t handle, const char *key, char *out, size_t *len) {
+    return nvs_get(handle, key, out, len);
+}
+
+esp_err_t nvs_set_blob(nvs_handle_t handle, const char *key, const void *value, size_t len) {
+    return nvs_set(handle, key, std::string((const char*)value, len));
+}
+
+esp_err_t nvs_get_blob(nvs_handle_t handle, const char *key, void *out, size_t *len) {
+    return nvs_get(handle, key, out, len);
+}
+
+esp_err_t nvs_erase_key(nvs_handle_t handle, const char *key) {
+    esp_err_t err = ESP_OK;
+    pthread_mutex_lock(&nvs_lock);
+    auto it = nvs_handles.find(handle);
+    if(it == nvs_handles.end()) {
+        err = ESP_ERR_INVALID_ARG;
+    } else if(nvs_data[it->second.name].erase(key) == 0) {
+        err = ESP_ERR_NVS_NOT_FOUND;
+    }
+    pthread_mutex_unlock(&nvs_lock);
+    return err;
+}
+
+esp_err_t nvs_commit(nvs_handle_t handle) {
+    pthread_mutex_lock(&nvs_lock);
+    nvs_save();
+    pthread_mutex_unlock(&nvs_lock);
+    return ESP_OK;
+}
+
+void nvs_close(nvs_handle_t handle) {
+    pthread_mutex_lock(&nvs_lock);
+    nvs_handles.erase(handle);
+    pthread_mutex_unlock(&nvs_lock);
+}